@@ -18,6 +18,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/ToolChainHarnessLib.h>
+#include <Library/CustomMutatorLib.h>
 
 #include "FatLitePeim.h"
 
@@ -30,6 +32,50 @@ FatFindGptPartitions(
 #define TOTAL_SIZE   (512 * 1024)
 #define BLOCK_SIZE   (512)
 
+//
+// Build the GPT header and entry array CRC rules for the header at HeaderOffset.
+// The entry array CRC comes first since the header CRC covers it.
+//
+VOID
+BuildGptFixupRules (
+  IN  UINT32              HeaderOffset,
+  IN  UINT32              BlockSize,
+  OUT HARNESS_FIXUP_RULE  *Rules
+  )
+{
+  HARNESS_FIXUP_VALUE          EntryArrayCrc = FIXUP_CONST (HeaderOffset + OFFSET_OF (EFI_PARTITION_TABLE_HEADER, PartitionEntryArrayCRC32));
+  HARNESS_FIXUP_VALUE          EntryArray = FIXUP_FIELD (0, HeaderOffset + OFFSET_OF (EFI_PARTITION_TABLE_HEADER, PartitionEntryLBA), sizeof (EFI_LBA), BlockSize);
+  HARNESS_FIXUP_VALUE          EntryArraySize = FIXUP_FIELD_X_FIELD (0, HeaderOffset + OFFSET_OF (EFI_PARTITION_TABLE_HEADER, NumberOfPartitionEntries), sizeof (UINT32), HeaderOffset + OFFSET_OF (EFI_PARTITION_TABLE_HEADER, SizeOfPartitionEntry), sizeof (UINT32));
+  HARNESS_FIXUP_VALUE          HeaderCrc = FIXUP_CONST (HeaderOffset + OFFSET_OF (EFI_TABLE_HEADER, CRC32));
+  HARNESS_FIXUP_VALUE          Header = FIXUP_CONST (HeaderOffset);
+  HARNESS_FIXUP_VALUE          HeaderSize = FIXUP_FIELD (0, HeaderOffset + OFFSET_OF (EFI_TABLE_HEADER, HeaderSize), sizeof (UINT32), 1);
+
+  Rules[0].Algorithm = HarnessFixupCrc32;
+  Rules[0].TargetWidth = sizeof (UINT32);
+  Rules[0].Target = EntryArrayCrc;
+  Rules[0].DataOffset = EntryArray;
+  Rules[0].DataLength = EntryArraySize;
+
+  Rules[1].Algorithm = HarnessFixupCrc32;
+  Rules[1].TargetWidth = sizeof (UINT32);
+  Rules[1].Target = HeaderCrc;
+  Rules[1].DataOffset = Header;
+  Rules[1].DataLength = HeaderSize;
+}
+
+BOOLEAN
+EFIAPI
+SetHarnessMutatorFormat (
+  VOID
+  )
+{
+  return CustomMutatorSetFormat ("gpt");
+}
+
+//
+// The block size is only known at runtime, so the rules are built here and
+// not returned by GetHarnessFixupRules.
+//
 VOID
 FixBuffer (
   UINT8                   *TestBuffer,
@@ -37,38 +83,17 @@ FixBuffer (
   UINT32                  BlockSize
   )
 {
-  EFI_PARTITION_TABLE_HEADER   *PrimaryHeader;
-  EFI_PARTITION_TABLE_HEADER   *BackupHeader;
+  HARNESS_FIXUP_RULE           Rules[4];
   EFI_LBA                      LastBlock;
-  UINT8                        *Ptr;
-
-  PrimaryHeader = NULL;
-  BackupHeader = NULL;
 
   LastBlock = (BufferSize + BlockSize - 1) / BlockSize - 1;
-
-  PrimaryHeader = (EFI_PARTITION_TABLE_HEADER*)(TestBuffer + MultU64x32(PRIMARY_PART_HEADER_LBA, BlockSize));
-  if (PrimaryHeader->PartitionEntryLBA <= LastBlock -1 && MultU64x32(PrimaryHeader->PartitionEntryLBA, BlockSize) + MultU64x32(PrimaryHeader->NumberOfPartitionEntries, PrimaryHeader->SizeOfPartitionEntry) < BufferSize) {
-    Ptr = TestBuffer + MultU64x32(PrimaryHeader->PartitionEntryLBA, BlockSize);
-    PrimaryHeader->PartitionEntryArrayCRC32 = CalculateCrc32(Ptr, (UINTN)MultU64x32(PrimaryHeader->NumberOfPartitionEntries, PrimaryHeader->SizeOfPartitionEntry));
-  }
-
-  if (PrimaryHeader->Header.HeaderSize + MultU64x32(PRIMARY_PART_HEADER_LBA, BlockSize) < BufferSize) {
-    PrimaryHeader->Header.CRC32 = 0;
-    PrimaryHeader->Header.CRC32 = CalculateCrc32(PrimaryHeader, PrimaryHeader->Header.HeaderSize);
-  }
-
-
-  BackupHeader = (EFI_PARTITION_TABLE_HEADER*)(TestBuffer + MultU64x32(LastBlock, BlockSize));
-  if (BackupHeader->PartitionEntryLBA <= LastBlock - 1 && MultU64x32(BackupHeader->PartitionEntryLBA, BlockSize) + MultU64x32(BackupHeader->NumberOfPartitionEntries, BackupHeader->SizeOfPartitionEntry) < BufferSize) {
-    Ptr = TestBuffer + MultU64x32(BackupHeader->PartitionEntryLBA, BlockSize);
-    BackupHeader->PartitionEntryArrayCRC32 = CalculateCrc32(Ptr, (UINTN)MultU64x32(BackupHeader->NumberOfPartitionEntries, BackupHeader->SizeOfPartitionEntry));
+  if (LastBlock <= PRIMARY_PART_HEADER_LBA || MultU64x32 (LastBlock, BlockSize) > MAX_UINT32) {
+    return;
   }
 
-  if (BackupHeader->Header.HeaderSize + MultU64x32(LastBlock, BlockSize) < BufferSize) {
-    BackupHeader->Header.CRC32 = 0;
-    BackupHeader->Header.CRC32 = CalculateCrc32(BackupHeader, BackupHeader->Header.HeaderSize);
-  }
+  BuildGptFixupRules ((UINT32)MultU64x32 (PRIMARY_PART_HEADER_LBA, BlockSize), BlockSize, &Rules[0]);
+  BuildGptFixupRules ((UINT32)MultU64x32 (LastBlock, BlockSize), BlockSize, &Rules[2]);
+  HarnessApplyFixupRules (TestBuffer, BufferSize, Rules, ARRAY_SIZE (Rules));
 }
 
 VOID
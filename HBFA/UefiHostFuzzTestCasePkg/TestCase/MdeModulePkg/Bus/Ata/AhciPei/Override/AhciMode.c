@@ -83,8 +83,7 @@ AhciReadReg (
 {
   UINT32   Data;
 
-  Data = 0;
-  //Data = MmioRead32 (AhciBar + Offset);  // for fuzz
+  Data = MmioRead32 (AhciBar + Offset);
 
   return Data;
 }
@@ -104,7 +103,7 @@ AhciWriteReg (
   IN UINT32    Data
   )
 {
-  //MmioWrite32 (AhciBar + Offset, Data);  // for fuzz
+  MmioWrite32 (AhciBar + Offset, Data);
 }
 
 /**
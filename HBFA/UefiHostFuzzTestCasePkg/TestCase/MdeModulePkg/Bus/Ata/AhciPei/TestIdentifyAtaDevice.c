@@ -22,14 +22,28 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/IoEmulationLib.h>
+#include <Library/ToolChainHarnessLib.h>
 
 #include "AhciPei.h"
 
 #define TOTAL_SIZE (512 * 1024)
-VOID FixBuffer(
-    UINT8 *TestBuffer,
-    UINTN TestBufferSize)
+
+//
+// The AHCI BAR of the controller. The input starts with the IDENTIFY data of
+// the device, and the rest of it is read by the driver from the HBA and port
+// registers.
+//
+#define AHCI_HARNESS_BAR        0xFEB00000
+#define AHCI_HARNESS_BAR_SIZE   (AHCI_PORT_START + AHCI_MAX_PORTS * AHCI_PORT_REG_WIDTH)
+
+UINTN
+EFIAPI
+GetHarnessIoInputOffset (
+  VOID
+  )
 {
+  return sizeof (ATA_IDENTIFY_DATA);
 }
 
 UINTN
@@ -44,8 +58,7 @@ VOID
     EFIAPI
     RunTestHarness(
         IN VOID *TestBuffer,
-        IN UINTN TestBufferSize,
-        PEI_AHCI_ATA_DEVICE_DATA *DeviceDataPtr)
+        IN UINTN TestBufferSize)
 {
   EFI_STATUS                          Status;
   PEI_AHCI_CONTROLLER_PRIVATE_DATA    *Private;
@@ -55,14 +68,16 @@ VOID
   VOID                                *DataBuffer;
   UINTN                               DataTransferSize;
 
-  FixBuffer(TestBuffer, TestBufferSize);
-  
+  Status = IoEmulationAddRegisters (IoEmulationMmio, AHCI_HARNESS_BAR, AHCI_HARNESS_BAR_SIZE, NULL, TRUE);
+  ASSERT_RETURN_ERROR (Status);
+
   IdentifyData1 = (ATA_IDENTIFY_DATA *)TestBuffer;
 
   Private = AllocateZeroPool (sizeof (PEI_AHCI_CONTROLLER_PRIVATE_DATA));
   ASSERT (Private != NULL);
 
   Private->Signature        = AHCI_PEI_CONTROLLER_PRIVATE_DATA_SIGNATURE;
+  Private->MmioBase         = AHCI_HARNESS_BAR;
   Private->PortBitMap       = 0x1;
   InitializeListHead (&Private->DeviceList);
 
@@ -16,6 +16,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/ToolChainHarnessLib.h>
+#include <Library/CustomMutatorLib.h>
 
 #define TOTAL_SIZE (512 * 1024)
 
@@ -25,13 +27,36 @@ ValidateFmpCapsule (
   OUT UINT16             *EmbeddedDriverCount OPTIONAL
   );
 
-VOID
-FixBuffer (
-  UINT8                   *TestBuffer,
-  UINTN                   TestBufferSize
+//
+// CapsuleImageSize = TestBufferSize
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HARNESS_FIXUP_RULE mFixupRules[] = {
+  {
+    HarnessFixupSize,
+    sizeof (UINT32),
+    FIXUP_CONST (OFFSET_OF (EFI_CAPSULE_HEADER, CapsuleImageSize)),
+    FIXUP_CONST (0),
+    FIXUP_FROM_END (0)
+  },
+};
+
+UINTN
+EFIAPI
+GetHarnessFixupRules (
+  OUT CONST HARNESS_FIXUP_RULE  **Rules
+  )
+{
+  *Rules = mFixupRules;
+  return ARRAY_SIZE (mFixupRules);
+}
+
+BOOLEAN
+EFIAPI
+SetHarnessMutatorFormat (
+  VOID
   )
 {
-  ((EFI_CAPSULE_HEADER *)TestBuffer)->CapsuleImageSize = (UINT32)TestBufferSize;
+  return CustomMutatorSetFormat ("capsule");
 }
 
 UINTN
@@ -50,6 +75,5 @@ RunTestHarness(
   IN UINTN TestBufferSize
   )
 {
-  FixBuffer (TestBuffer, TestBufferSize);
   ValidateFmpCapsule(TestBuffer, NULL);
 }
\ No newline at end of file
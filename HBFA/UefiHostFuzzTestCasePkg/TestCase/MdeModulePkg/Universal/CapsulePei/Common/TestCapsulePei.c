@@ -17,6 +17,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/ToolChainHarnessLib.h>
 
 #include "CommonHeader.h"
 
@@ -32,13 +33,27 @@ CapsuleDataCoalesce (
   IN OUT UINTN                       *MemorySize
   );
 
-VOID
-FixBuffer (
-  UINT8                   *TestBuffer,
-  UINTN                   TestBufferSize
+//
+// CapsuleImageSize = TestBufferSize
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HARNESS_FIXUP_RULE mFixupRules[] = {
+  {
+    HarnessFixupSize,
+    sizeof (UINT32),
+    FIXUP_CONST (OFFSET_OF (EFI_CAPSULE_HEADER, CapsuleImageSize)),
+    FIXUP_CONST (0),
+    FIXUP_FROM_END (0)
+  },
+};
+
+UINTN
+EFIAPI
+GetHarnessFixupRules (
+  OUT CONST HARNESS_FIXUP_RULE  **Rules
   )
 {
-  ((EFI_CAPSULE_HEADER *)TestBuffer)->CapsuleImageSize = (UINT32)TestBufferSize;
+  *Rules = mFixupRules;
+  return ARRAY_SIZE (mFixupRules);
 }
 
 UINTN
@@ -73,8 +88,6 @@ RunTestHarness(
   MemoryResource[2].PhysicalStart  = 0;
   MemoryResource[2].ResourceLength = 0;
 
-  FixBuffer (TestBuffer, TestBufferSize);
-
   CapsuleMemoryBase = MemoryBase;
   CapsuleMemorySize = MemorySize;
   CapsuleDataCoalesce(NULL, TestBuffer, MemoryResource, &CapsuleMemoryBase, &CapsuleMemorySize);
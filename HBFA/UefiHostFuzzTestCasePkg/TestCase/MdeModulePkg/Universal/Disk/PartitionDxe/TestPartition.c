@@ -24,6 +24,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DiskStubLib.h>
+#include <Library/ToolChainHarnessLib.h>
+#include <Library/CustomMutatorLib.h>
+
+#include "../UdfHarness.h"
 
 EFI_STATUS
 FindUdfFileSystem (
@@ -37,12 +41,56 @@ FindUdfFileSystem (
 #define BLOCK_SIZE   (512)
 #define IO_ALIGN     (1)
 
-VOID
-FixBuffer (
-  UINT8                   *TestBuffer
+//
+// For KLEE, only the structures FindUdfFileSystem starts from are symbolic:
+// the volume recognition sequence at 32KB and the anchor volume descriptor
+// pointer at LBA 256. The rest of the volume comes from the seed image.
+//
+#define UDF_VRS_OFFSET       (16 * 2048)
+#define UDF_VRS_ENTRY_SIZE   (2048)
+#define UDF_AVDP_OFFSET      (256 * BLOCK_SIZE)
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HARNESS_SYMBOLIC_REGION mSymbolicRegions[] = {
+  SYMBOLIC_BYTES (UDF_VRS_OFFSET, 7),                                       // BEA01
+  SYMBOLIC_BYTES (UDF_VRS_OFFSET + UDF_VRS_ENTRY_SIZE, 7),                  // NSR02/NSR03
+  SYMBOLIC_BYTES (UDF_VRS_OFFSET + 2 * UDF_VRS_ENTRY_SIZE, 7),              // TEA01
+  UDF_ANCHOR_SYMBOLIC_REGIONS (UDF_AVDP_OFFSET, TOTAL_SIZE, BLOCK_SIZE),
+};
+
+UINTN
+EFIAPI
+GetHarnessSymbolicRegions (
+  OUT CONST HARNESS_SYMBOLIC_REGION  **Regions
   )
 {
+  *Regions = mSymbolicRegions;
+  return ARRAY_SIZE (mSymbolicRegions);
 }
+
+BOOLEAN
+EFIAPI
+SetHarnessMutatorFormat (
+  VOID
+  )
+{
+  return CustomMutatorSetFormat ("udf");
+}
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HARNESS_FIXUP_RULE mFixupRules[] = {
+  UDF_ANCHOR_FIXUP_RULES (256 * BLOCK_SIZE),
+  UDF_ANCHOR_FIXUP_RULES (512 * BLOCK_SIZE),
+};
+
+UINTN
+EFIAPI
+GetHarnessFixupRules (
+  OUT CONST HARNESS_FIXUP_RULE  **Rules
+  )
+{
+  *Rules = mFixupRules;
+  return ARRAY_SIZE (mFixupRules);
+}
+
 UINTN
 EFIAPI
 GetMaxBufferSize (
@@ -64,8 +112,6 @@ RunTestHarness(
   EFI_BLOCK_IO_PROTOCOL  *BlockIo;
   EFI_DISK_IO_PROTOCOL   *DiskIo;
 
-  FixBuffer (TestBuffer);
-
   DiskStubInitialize (TestBuffer, TestBufferSize, BLOCK_SIZE, IO_ALIGN, &BlockIo, &DiskIo);
 
   // fuzz function:
@@ -19,8 +19,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DiskStubLib.h>
+#include <Library/ToolChainHarnessLib.h>
+#include <Library/CustomMutatorLib.h>
 
 #include "Udf.h"
+#include "../UdfHarness.h"
 
 extern EFI_SIMPLE_FILE_SYSTEM_PROTOCOL gUdfSimpleFsTemplate;
 
@@ -37,11 +40,53 @@ FindUdfFileSystem (
 #define IO_ALIGN     (1)
 #define MAX_FILENAME_LEN   (4096)
 
-VOID
-FixBuffer (
-  UINT8                   *TestBuffer
+//
+// RunTestHarness opens the volume of the partition at block 0x202 of the
+// input, where UdfDxe finds the anchor volume descriptor pointers at the last
+// block and 256 blocks before it, as in the seeds. For KLEE, only those are
+// symbolic.
+//
+#define UDF_PARTITION_OFFSET   (0x202 * BLOCK_SIZE)
+#define UDF_PARTITION_SIZE     (TOTAL_SIZE - UDF_PARTITION_OFFSET)
+#define UDF_LAST_BLOCK         (UDF_PARTITION_SIZE / BLOCK_SIZE - 1)
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HARNESS_SYMBOLIC_REGION mSymbolicRegions[] = {
+  UDF_ANCHOR_SYMBOLIC_REGIONS (UDF_PARTITION_OFFSET + UDF_LAST_BLOCK * BLOCK_SIZE, UDF_PARTITION_SIZE, BLOCK_SIZE),
+  UDF_ANCHOR_SYMBOLIC_REGIONS (UDF_PARTITION_OFFSET + (UDF_LAST_BLOCK - 256) * BLOCK_SIZE, UDF_PARTITION_SIZE, BLOCK_SIZE),
+};
+
+UINTN
+EFIAPI
+GetHarnessSymbolicRegions (
+  OUT CONST HARNESS_SYMBOLIC_REGION  **Regions
+  )
+{
+  *Regions = mSymbolicRegions;
+  return ARRAY_SIZE (mSymbolicRegions);
+}
+
+BOOLEAN
+EFIAPI
+SetHarnessMutatorFormat (
+  VOID
+  )
+{
+  return CustomMutatorSetFormat ("udf");
+}
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HARNESS_FIXUP_RULE mFixupRules[] = {
+  UDF_ANCHOR_FIXUP_RULES (UDF_PARTITION_OFFSET + UDF_LAST_BLOCK * BLOCK_SIZE),
+  UDF_ANCHOR_FIXUP_RULES (UDF_PARTITION_OFFSET + (UDF_LAST_BLOCK - 256) * BLOCK_SIZE),
+};
+
+UINTN
+EFIAPI
+GetHarnessFixupRules (
+  OUT CONST HARNESS_FIXUP_RULE  **Rules
   )
 {
+  *Rules = mFixupRules;
+  return ARRAY_SIZE (mFixupRules);
 }
 
 PRIVATE_UDF_SIMPLE_FS_DATA       *PrivFsData = NULL;
@@ -498,13 +543,12 @@ RunTestHarness(
   CHAR16                  *FileName;
 
   FileName = NULL;
-  FixBuffer (TestBuffer);
 
   //
   // NOTE: There are 2 partitions: 0x101, and 0x202.
   // The files are updated in 0x202.
   //
-  DiskStubInitialize ((UINT8 *)TestBuffer + 0x202 * BLOCK_SIZE, TOTAL_SIZE - 0x202 * BLOCK_SIZE, BLOCK_SIZE, IO_ALIGN, &PartitionBlockIo, &PartitionDiskIo);
+  DiskStubInitialize ((UINT8 *)TestBuffer + UDF_PARTITION_OFFSET, UDF_PARTITION_SIZE, BLOCK_SIZE, IO_ALIGN, &PartitionBlockIo, &PartitionDiskIo);
   
   TestUdfFileSystem (PartitionBlockIo, PartitionDiskIo, TestBuffer, FileName);
   
@@ -0,0 +1,57 @@
+/** @file
+  Fixup rules and symbolic regions of the UDF test harnesses.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _UDF_HARNESS_H_
+#define _UDF_HARNESS_H_
+
+#include <IndustryStandard/Udf.h>
+#include <Library/ToolChainHarnessLib.h>
+
+//
+// Tag checksum and descriptor CRC of an anchor volume descriptor pointer at
+// Offset. The CRC comes first since the tag checksum covers it. The other
+// descriptors are found through extents, so their tags are left to the "udf"
+// format of CustomMutatorLib.
+//
+#define UDF_ANCHOR_FIXUP_RULES(Offset) \
+  { \
+    HarnessFixupCrc16Itu, \
+    sizeof (UINT16), \
+    FIXUP_CONST ((Offset) + OFFSET_OF (UDF_DESCRIPTOR_TAG, DescriptorCRC)), \
+    FIXUP_CONST ((Offset) + sizeof (UDF_DESCRIPTOR_TAG)), \
+    FIXUP_FIELD (0, (Offset) + OFFSET_OF (UDF_DESCRIPTOR_TAG, DescriptorCRCLength), sizeof (UINT16), 1) \
+  }, \
+  { \
+    HarnessFixupSum8, \
+    sizeof (UINT8), \
+    FIXUP_CONST ((Offset) + OFFSET_OF (UDF_DESCRIPTOR_TAG, TagChecksum)), \
+    FIXUP_CONST (Offset), \
+    FIXUP_CONST (sizeof (UDF_DESCRIPTOR_TAG)) \
+  }
+
+//
+// For KLEE, the tag and the main volume descriptor sequence extent of an
+// anchor volume descriptor pointer at Offset, in a volume of VolumeSize bytes
+// made of BlockSize byte blocks. The rest of the volume comes from the seed.
+//
+#define UDF_ANCHOR_SYMBOLIC_REGIONS(Offset, VolumeSize, BlockSize) \
+  SYMBOLIC_BYTES ((Offset), sizeof (UDF_DESCRIPTOR_TAG)), \
+  SYMBOLIC_FIELD ( \
+    (Offset) + OFFSET_OF (UDF_ANCHOR_VOLUME_DESCRIPTOR_POINTER, MainVolumeDescriptorSequenceExtent) + OFFSET_OF (UDF_EXTENT_AD, ExtentLength), \
+    sizeof (UINT32), \
+    0, \
+    (VolumeSize) \
+    ), \
+  SYMBOLIC_FIELD ( \
+    (Offset) + OFFSET_OF (UDF_ANCHOR_VOLUME_DESCRIPTOR_POINTER, MainVolumeDescriptorSequenceExtent) + OFFSET_OF (UDF_EXTENT_AD, ExtentLocation), \
+    sizeof (UINT32), \
+    0, \
+    (VolumeSize) / (BlockSize) - 1 \
+    )
+
+#endif
@@ -0,0 +1,101 @@
+/** @file
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef TEST_WITH_LIBFUZZER
+#include <stdint.h>
+#include <stddef.h>
+#endif
+
+#include <PiSmm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SmmServicesTableLib.h>
+#include <Library/SmmCommunicationStubLib.h>
+#include <Library/SmmLockBoxLib/SmmLockBoxLibPrivate.h>
+
+#define TOTAL_SIZE (64 * 1024)
+
+EFI_STATUS
+EFIAPI
+SmmLockBoxSmmConstructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  );
+
+EFI_STATUS
+EFIAPI
+SmmLockBoxEntryPoint (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  );
+
+//
+// The lockboxes saved in SMRAM by SmmLockBoxSmmLib.
+//
+extern LIST_ENTRY  mLockBoxQueue;
+
+BOOLEAN  mDriverLoaded = FALSE;
+
+/**
+  Free the lockboxes saved by the previous input, so every input starts from
+  an empty SMRAM lockbox queue.
+**/
+VOID
+ResetLockBoxQueue (
+  VOID
+  )
+{
+  LIST_ENTRY         *Link;
+  SMM_LOCK_BOX_DATA  *LockBox;
+
+  while (!IsListEmpty (&mLockBoxQueue)) {
+    Link = GetFirstNode (&mLockBoxQueue);
+    LockBox = BASE_CR (Link, SMM_LOCK_BOX_DATA, Link);
+    RemoveEntryList (Link);
+    gSmst->SmmFreePages (LockBox->SmramBuffer, EFI_SIZE_TO_PAGES ((UINTN)LockBox->Length));
+    gSmst->SmmFreePool (LockBox);
+  }
+}
+
+UINTN
+EFIAPI
+GetMaxBufferSize (
+  VOID
+  )
+{
+  return TOTAL_SIZE;
+}
+
+VOID
+EFIAPI
+RunTestHarness(
+  IN VOID  *TestBuffer,
+  IN UINTN TestBufferSize
+  )
+{
+  //
+  // Load the driver once per process, the SMI handlers it registers stay
+  // in gSmst for every input. The lockboxes do not.
+  //
+  if (!mDriverLoaded) {
+    SmmLockBoxSmmConstructor (NULL, NULL);
+    SmmLockBoxEntryPoint (NULL, NULL);
+    mDriverLoaded = TRUE;
+  }
+
+  SmmCommunicationStubDispatch (TestBuffer, TestBufferSize, TOTAL_SIZE);
+
+  ResetLockBoxQueue ();
+}
@@ -16,17 +16,39 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #endif
 
 #include <Uefi.h>
+#include <Guid/SmmVariableCommon.h>
 
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/SmmMemLibStubLib.h>
+#include <Library/ToolChainHarnessLib.h>
+#include <Library/CustomMutatorLib.h>
 
 extern BOOLEAN                      mEndOfDxe;
 
 #define TOTAL_SIZE (512 * 1024)
 
+//
+// For KLEE, the function and the SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE
+// header that GetVariable and SetVariable take are symbolic, with the first
+// characters of the name. Other functions read their payload from the same
+// bytes.
+//
+#define SMM_VARIABLE_HEADER_SIZE   OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, Data)
+#define SMM_VARIABLE_NAME_BYTES    (8 * sizeof (CHAR16))
+
+GLOBAL_REMOVE_IF_UNREFERENCED CONST HARNESS_SYMBOLIC_REGION mSymbolicRegions[] = {
+  SYMBOLIC_INPUT_SIZE (SMM_VARIABLE_HEADER_SIZE, TOTAL_SIZE),
+  SYMBOLIC_FIELD (OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, Function), sizeof (UINTN), SMM_VARIABLE_FUNCTION_GET_VARIABLE, SMM_VARIABLE_FUNCTION_GET_PAYLOAD_SIZE),
+  SYMBOLIC_BYTES (SMM_VARIABLE_HEADER_SIZE + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Guid), sizeof (EFI_GUID)),
+  SYMBOLIC_FIELD (SMM_VARIABLE_HEADER_SIZE + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, DataSize), sizeof (UINTN), 0, TOTAL_SIZE),
+  SYMBOLIC_FIELD (SMM_VARIABLE_HEADER_SIZE + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, NameSize), sizeof (UINTN), 0, TOTAL_SIZE),
+  SYMBOLIC_BYTES (SMM_VARIABLE_HEADER_SIZE + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Attributes), sizeof (UINT32)),
+  SYMBOLIC_BYTES (SMM_VARIABLE_HEADER_SIZE + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name), SMM_VARIABLE_NAME_BYTES),
+};
+
 extern UINT8                                                *mVariableBufferPayload;
 extern UINTN                                                mVariableBufferPayloadSize;
 
@@ -39,12 +61,23 @@ SmmVariableHandler (
   IN OUT UINTN                                     *CommBufferSize
   );
 
-VOID
-FixBuffer (
-  UINT8                   *TestBuffer,
-  UINTN                   TestBufferSize
+BOOLEAN
+EFIAPI
+SetHarnessMutatorFormat (
+  VOID
   )
 {
+  return CustomMutatorSetFormat ("smmvariable");
+}
+
+UINTN
+EFIAPI
+GetHarnessSymbolicRegions (
+  OUT CONST HARNESS_SYMBOLIC_REGION  **Regions
+  )
+{
+  *Regions = mSymbolicRegions;
+  return ARRAY_SIZE (mSymbolicRegions);
 }
 
 UINTN
@@ -68,8 +101,6 @@ RunTestHarness(
   SmmCommBufferDesc[0].Address = (UINTN)TestBuffer;
   SmmCommBufferDesc[0].Size = TOTAL_SIZE;
 
-  FixBuffer (TestBuffer, TestBufferSize);
-
   SmmMemLibInitialize (ARRAY_SIZE(SmmCommBufferDesc), SmmCommBufferDesc);
   mEndOfDxe = TRUE;
 
@@ -0,0 +1,41 @@
+/** @file
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _SMM_COMMUNICATION_STUB_LIB_H_
+#define _SMM_COMMUNICATION_STUB_LIB_H_
+
+#include <Uefi.h>
+
+/**
+  Deliver a fuzzing input to the SMI handlers of the host SMM Services Table,
+  as the SMM core does for an SMM communication buffer.
+
+  The handlers are the ones the driver under test registered with
+  gSmst->SmiHandlerRegister(), typically from its entry point. The first byte
+  of the input selects one of the registered handler types, modulo their
+  number, in registration order. The rest of the input is moved to the start
+  of Buffer, declared to SmmMemLib as the communication buffer, and passed to
+  gSmst->SmiManage().
+
+  @param[in] Buffer         The input. It is modified.
+  @param[in] BufferSize     The size of the input.
+  @param[in] MaxBufferSize  The size of the Buffer allocation, the window
+                            SmmMemLib accepts as outside SMRAM.
+
+  @retval EFI_NOT_FOUND  The input is empty or no handler type is registered.
+  @return The status of gSmst->SmiManage().
+
+**/
+EFI_STATUS
+EFIAPI
+SmmCommunicationStubDispatch (
+  IN VOID   *Buffer,
+  IN UINTN  BufferSize,
+  IN UINTN  MaxBufferSize
+  );
+
+#endif
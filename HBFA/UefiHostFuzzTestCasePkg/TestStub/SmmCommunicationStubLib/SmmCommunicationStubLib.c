@@ -0,0 +1,71 @@
+/** @file
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiSmm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/SmmServicesTableLib.h>
+#include <Library/SmmMemLibStubLib.h>
+#include <Library/SmiHandlerRegistryLib.h>
+#include <Library/SmmCommunicationStubLib.h>
+
+/**
+  Deliver a fuzzing input to the SMI handlers of the host SMM Services Table,
+  as the SMM core does for an SMM communication buffer.
+
+  The handlers are the ones the driver under test registered with
+  gSmst->SmiHandlerRegister(), typically from its entry point. The first byte
+  of the input selects one of the registered handler types, modulo their
+  number, in registration order. The rest of the input is moved to the start
+  of Buffer, declared to SmmMemLib as the communication buffer, and passed to
+  gSmst->SmiManage().
+
+  @param[in] Buffer         The input. It is modified.
+  @param[in] BufferSize     The size of the input.
+  @param[in] MaxBufferSize  The size of the Buffer allocation, the window
+                            SmmMemLib accepts as outside SMRAM.
+
+  @retval EFI_NOT_FOUND  The input is empty or no handler type is registered.
+  @return The status of gSmst->SmiManage().
+
+**/
+EFI_STATUS
+EFIAPI
+SmmCommunicationStubDispatch (
+  IN VOID   *Buffer,
+  IN UINTN  BufferSize,
+  IN UINTN  MaxBufferSize
+  )
+{
+  SMM_COMMUNICATION_BUFFER_DESCRIPTOR  SmmCommBufferDesc[1];
+  UINTN                                TypeCount;
+  CONST EFI_GUID                       *HandlerType;
+  UINTN                                CommBufferSize;
+
+  TypeCount = SmiHandlerRegistryGetTypeCount ();
+  if (BufferSize == 0 || TypeCount == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  HandlerType = SmiHandlerRegistryGetType (*(UINT8 *)Buffer % TypeCount);
+  ASSERT (HandlerType != NULL);
+
+  //
+  // Keep the communication buffer at the aligned start of the allocation,
+  // where a real SMM communication buffer would start.
+  //
+  CommBufferSize = BufferSize - 1;
+  CopyMem (Buffer, (UINT8 *)Buffer + 1, CommBufferSize);
+
+  SmmCommBufferDesc[0].Address = (UINTN)Buffer;
+  SmmCommBufferDesc[0].Size = MaxBufferSize;
+  SmmMemLibInitialize (ARRAY_SIZE(SmmCommBufferDesc), SmmCommBufferDesc);
+
+  return gSmst->SmiManage (HandlerType, NULL, Buffer, &CommBufferSize);
+}
@@ -7,26 +7,106 @@
 import os
 import subprocess
 import sys
+import hashlib
+from multiprocessing.pool import ThreadPool
 from optparse import OptionParser
 
+sys.path.append(os.path.join(os.path.dirname(os.path.dirname(os.path.dirname(os.path.realpath(__file__)))), 'UefiHostTestTools', 'Script'))
+from CoreNum import GetCoreNum
+
 # python version
 python_version = sys.version_info[0]
 
-def GetObjFile(TargetPath):
-    ObjFileList = []
+# Linked bitcode of a library is cached next to it as <Library>.<Digest>.bc
+CACHE_SUFFIX = '.bc'
+DIGEST_LENGTH = 16
+
+def GetLibFile(TargetPath):
+    LibFileList = []
     static_library_files = open(os.path.join(TargetPath, r'static_library_files.lst'), 'r')
     static_library_files_list = static_library_files.readlines()
     static_library_files.close()
 
     for file in static_library_files_list:
-        object_files = open(os.path.join(os.path.dirname(file.replace('.lib\n','.lib')), r'object_files.lst'), 'r')
-        object_files_list = object_files.readlines()
-        object_files.close()
-        for objfile in object_files_list:
-            ObjFileList.append(objfile.replace('.obj\n', '.obj'))
+        if file.strip():
+            LibFileList.append(file.strip())
+
+    return LibFileList
+
+def GetLibObjFile(LibFile):
+    ObjFileList = []
+    object_files = open(os.path.join(os.path.dirname(LibFile), r'object_files.lst'), 'r')
+    object_files_list = object_files.readlines()
+    object_files.close()
+    for objfile in object_files_list:
+        if objfile.strip():
+            ObjFileList.append(objfile.strip())
 
     return ObjFileList
 
+def GetCacheFile(Command, LibFile, ObjFileList):
+    """
+    The cache file of a library is named after the content of its objects, so
+    it is valid as long as it exists.
+    """
+    Digest = hashlib.sha1(Command.encode())
+    for objfile in ObjFileList:
+        Digest.update(objfile.encode())
+        with open(objfile, 'rb') as f:
+            Digest.update(hashlib.sha1(f.read()).digest())
+    return '{}.{}{}'.format(os.path.splitext(LibFile)[0], Digest.hexdigest()[:DIGEST_LENGTH], CACHE_SUFFIX)
+
+def RemoveStaleCacheFile(LibFile, CacheFile):
+    LibDir = os.path.dirname(LibFile)
+    Prefix = os.path.basename(os.path.splitext(LibFile)[0]) + '.'
+    for file in os.listdir(LibDir):
+        path = os.path.join(LibDir, file)
+        if file.startswith(Prefix) and file.endswith(CACHE_SUFFIX) and path != CacheFile \
+           and len(file) == len(Prefix) + DIGEST_LENGTH + len(CACHE_SUFFIX):
+            try:
+                os.remove(path)
+            except OSError:
+                pass
+
+def LinkLib(Args):
+    """
+    Link the objects of one library to bitcode, unless its cache file exists.
+
+    :return: (cache file, None if the link failed)
+    """
+    Command, LibFile = Args
+    ObjFileList = GetLibObjFile(LibFile)
+    CacheFile = GetCacheFile(Command, LibFile, ObjFileList)
+    if os.path.exists(CacheFile):
+        return CacheFile
+    # Other modules of a parallel build may link the same library, so the
+    # bitcode is written aside and renamed, which is atomic.
+    TempFile = '{}.{}.tmp'.format(CacheFile, os.getpid())
+    if not CallCommand(GenerateCommand(Command, "", ObjFileList, TempFile)) or not os.path.exists(TempFile):
+        if os.path.exists(TempFile):
+            os.remove(TempFile)
+        return None
+    if os.path.exists(CacheFile):
+        os.remove(TempFile)
+    else:
+        os.rename(TempFile, CacheFile)
+    RemoveStaleCacheFile(LibFile, CacheFile)
+    return CacheFile
+
+def LinkTarget(Command, TargetPath, OutputFile, Jobs):
+    LibFileList = GetLibFile(TargetPath)
+    Pool = ThreadPool(Jobs)
+    try:
+        CacheFileList = Pool.map(LinkLib, [(Command, LibFile) for LibFile in LibFileList])
+    finally:
+        Pool.close()
+        Pool.join()
+    for LibFile, CacheFile in zip(LibFileList, CacheFileList):
+        if not CacheFile:
+            print("Failed to link {}".format(LibFile))
+            return False
+    return CallCommand(GenerateCommand(Command, "", CacheFileList, OutputFile))
+
 def GenerateCommand(Command, Flags, InputFileList, OutputFile):
     Template = "<Command> -o <OutputFile> <Flags> <InputFileList>"
     InputFile = ' '.join(InputFileList)
@@ -42,7 +122,9 @@ def CallCommand(CommandLine):
                           shell=True)
     msg = Cm.communicate()
     for m in msg:
-        print(m if python_version == 2 else m.decode())
+        if m:
+            print(m if python_version == 2 else m.decode())
+    return Cm.returncode == 0
 
 if __name__ == '__main__':
     # # # Opt Parser
@@ -50,11 +132,13 @@ if __name__ == '__main__':
     parse.add_option("-o", dest="output", metavar=" ", help="output file name", default=None)
     parse.add_option("-d", dest="targetpath", metavar=" ", help="target path", default=None)
     parse.add_option("-t", dest="tool", metavar=" ", help="the tool you use", default=None)
+    parse.add_option("-j", dest="jobs", metavar=" ", type="int", help="libraries linked in parallel, default is one per core", default=0)
     options, args = parse.parse_args()
     if options.tool:
         if options.targetpath:
             if options.output:
-                CallCommand(GenerateCommand(options.tool, "", GetObjFile(options.targetpath), options.output))
+                if not LinkTarget(options.tool, options.targetpath, options.output, options.jobs if options.jobs > 0 else GetCoreNum()):
+                    sys.exit(1)
             else:
                 raise Exception("Please input -o output file name")
         else:
@@ -0,0 +1,78 @@
+/** @file
+  Structure-aware mutators for firmware input formats.
+
+  The mutators know the layout of UDF descriptors, GPT headers and entries,
+  FMP capsules and SMM variable communicate buffers. They mutate one field at
+  a time and recompute the dependent checksums, CRCs and sizes, so mutated
+  inputs still pass the cheap sanity checks of the code under test.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _CUSTOM_MUTATOR_LIB_H_
+#define _CUSTOM_MUTATOR_LIB_H_
+
+//
+// Environment variable used to force a format instead of detecting it:
+// "udf", "gpt", "capsule", "smmvariable" or "none".
+//
+#define CUSTOM_MUTATOR_FORMAT_ENV   "HBFA_CUSTOM_MUTATOR"
+
+/**
+  Select the format of the inputs instead of detecting it per input.
+
+  A format set in CUSTOM_MUTATOR_FORMAT_ENV takes precedence over Name.
+
+  @param[in] Name  The format name, or NULL.
+
+  @retval TRUE   A format is selected.
+  @retval FALSE  Name is NULL or unknown, or mutators are disabled.
+
+**/
+BOOLEAN
+EFIAPI
+CustomMutatorSetFormat (
+  IN CONST CHAR8  *Name  OPTIONAL
+  );
+
+/**
+  Apply one structure-aware mutation to Data in place.
+
+  @param[in, out] Data     The input to mutate.
+  @param[in]      Size     The size of the input.
+  @param[in]      MaxSize  The size of the buffer behind Data.
+  @param[in]      Seed     The random seed for this mutation.
+
+  @return The new size of the input, or 0 if the format of Data is not
+          recognized and the caller should fall back to a generic mutator.
+
+**/
+UINTN
+EFIAPI
+CustomMutatorMutate (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Size,
+  IN     UINTN   MaxSize,
+  IN     UINT32  Seed
+  );
+
+/**
+  Recompute the checksums, CRCs and size fields of Data in place.
+
+  @param[in, out] Data     The input to fix.
+  @param[in]      Size     The size of the input.
+
+  @retval TRUE   The format of Data was recognized and fixed.
+  @retval FALSE  The format of Data is not recognized.
+
+**/
+BOOLEAN
+EFIAPI
+CustomMutatorFixup (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Size
+  );
+
+#endif
@@ -21,4 +21,249 @@ GetMaxBufferSize (
   VOID
   );
 
+//
+// Declarative input fixups.
+//
+// A harness describes the checksums, CRCs and size fields of its input as a
+// table of HARNESS_FIXUP_RULE. ToolChainHarnessLib applies the rules in place,
+// in table order, before every RunTestHarness call, so mutated inputs are not
+// rejected by the first integrity check. The same table can be dumped with
+// "<TestXxx> --dump-fixup-rules <File>" and applied by the AFL++
+// post-processor of CustomMutatorLib, see RunAFL.py -c.
+//
+typedef enum {
+  HarnessFixupCrc32,      // CalculateCrc32 of the data, target zeroed first (GPT)
+  HarnessFixupCrc16Itu,   // CRC-ITU-T of the data (UDF descriptor tag)
+  HarnessFixupSum8,       // UINT8 sum of the data, target zeroed first (UDF tag checksum)
+  HarnessFixupChecksum8,  // UINT8 making the sum of the data 0, target zeroed first
+  HarnessFixupChecksum16, // UINT16 making the UINT16 sum of the data 0, target zeroed first
+  HarnessFixupSize,       // length of the data
+  HarnessFixupMax
+} HARNESS_FIXUP_ALGORITHM;
+
+//
+// The value is counted back from the end of the input. For a data length it
+// means "up to that point".
+//
+#define HARNESS_FIXUP_FROM_END  0x1
+
+//
+// An offset or a length in the input:
+//   Constant + Field * Scale    or    Constant + Field * ScaleField
+// where Field is the little endian integer of FieldWidth bytes at FieldOffset
+// (no field if FieldWidth is 0), and ScaleField the one of ScaleFieldWidth
+// bytes at Scale (constant Scale if ScaleFieldWidth is 0).
+//
+typedef struct {
+  UINT32  Constant;
+  UINT16  Flags;
+  UINT8   FieldWidth;
+  UINT8   ScaleFieldWidth;
+  UINT32  FieldOffset;
+  UINT32  Scale;
+} HARNESS_FIXUP_VALUE;
+
+#define FIXUP_CONST(Constant)                         {(Constant), 0, 0, 0, 0, 1}
+#define FIXUP_FROM_END(Constant)                      {(Constant), HARNESS_FIXUP_FROM_END, 0, 0, 0, 1}
+#define FIXUP_FIELD(Constant, Offset, Width, Scale)   {(Constant), 0, (Width), 0, (Offset), (Scale)}
+#define FIXUP_FIELD_X_FIELD(Constant, Offset, Width, ScaleOffset, ScaleWidth) \
+                                                      {(Constant), 0, (Width), (ScaleWidth), (Offset), (ScaleOffset)}
+
+//
+// Compute Algorithm over [DataOffset, DataOffset + DataLength) and store the
+// result in the TargetWidth bytes at Target. Rules whose data or target does
+// not fit in the input are skipped.
+//
+typedef struct {
+  UINT32               Algorithm;
+  UINT32               TargetWidth;
+  HARNESS_FIXUP_VALUE  Target;
+  HARNESS_FIXUP_VALUE  DataOffset;
+  HARNESS_FIXUP_VALUE  DataLength;
+} HARNESS_FIXUP_RULE;
+
+#define HARNESS_FIXUP_RULES_SIGNATURE  SIGNATURE_32 ('H', 'F', 'X', 'R')
+#define HARNESS_FIXUP_RULES_VERSION    1
+#define HARNESS_FIXUP_DUMP_OPTION      "--dump-fixup-rules"
+
+//
+// Layout of a dumped rule table: this header followed by RuleCount rules.
+//
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  RuleSize;
+  UINT32  RuleCount;
+} HARNESS_FIXUP_RULES_HEADER;
+
+/**
+  Return the fixup rules of the test harness.
+
+  A harness with fixed input layout defines this function. It is optional:
+  ToolChainHarnessLib provides a weak default returning no rule.
+
+  @param[out] Rules   The rule table.
+
+  @return The number of rules.
+
+**/
+UINTN
+EFIAPI
+GetHarnessFixupRules (
+  OUT CONST HARNESS_FIXUP_RULE  **Rules
+  );
+
+/**
+  CRC-ITU-T (polynomial 0x1021, initial value 0) as used by UDF descriptor
+  tags, for HarnessFixupCrc16Itu rules and the "udf" format of
+  CustomMutatorLib.
+
+  @param[in] Data    The data.
+  @param[in] Length  The size of the data.
+
+  @return The CRC.
+
+**/
+UINT16
+EFIAPI
+HarnessCalculateCrc16Itu (
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  );
+
+/**
+  Apply fixup rules to a buffer in place.
+
+  @param[in, out] Buffer     The input.
+  @param[in]      Size       The size of the input.
+  @param[in]      Rules      The rule table.
+  @param[in]      RuleCount  The number of rules.
+
+**/
+VOID
+EFIAPI
+HarnessApplyFixupRules (
+  IN OUT VOID                      *Buffer,
+  IN     UINTN                     Size,
+  IN     CONST HARNESS_FIXUP_RULE  *Rules,
+  IN     UINTN                     RuleCount
+  );
+
+/**
+  Validate a dumped rule table.
+
+  @param[in]  Data       The content of the rule file.
+  @param[in]  Size       The size of the rule file.
+  @param[out] Rules      The rules in Data.
+  @param[out] RuleCount  The number of rules.
+
+  @retval TRUE   The table is valid.
+  @retval FALSE  The table is corrupted or from another version.
+
+**/
+BOOLEAN
+EFIAPI
+HarnessParseFixupRules (
+  IN  CONST VOID                *Data,
+  IN  UINTN                     Size,
+  OUT CONST HARNESS_FIXUP_RULE  **Rules,
+  OUT UINTN                     *RuleCount
+  );
+
+//
+// Symbolic regions for KLEE.
+//
+// By default the whole input of GetMaxBufferSize() bytes is symbolic. A
+// harness parsing a large input can instead list the bytes worth exploring
+// as a table of HARNESS_SYMBOLIC_REGION. Only those are made symbolic, the
+// rest of the input holds the concrete bytes of the seed file given as first
+// argument ("klee <TestXxx> <Seed>"), or zero without seed. Regions are
+// applied in table order, a later one overrides the bytes of an earlier one.
+//
+typedef enum {
+  HarnessSymbolicBytes,       // Length symbolic bytes at Offset
+  HarnessSymbolicField,       // little endian integer of Length bytes at Offset, in [Min, Max]
+  HarnessSymbolicInputSize,   // TestBufferSize, in [Min, Max]
+  HarnessSymbolicMax
+} HARNESS_SYMBOLIC_TYPE;
+
+typedef struct {
+  UINT32  Type;
+  UINT32  Offset;
+  UINT32  Length;
+  UINT32  Min;
+  UINT32  Max;
+} HARNESS_SYMBOLIC_REGION;
+
+#define SYMBOLIC_BYTES(Offset, Length)           {HarnessSymbolicBytes, (Offset), (Length), 0, 0}
+#define SYMBOLIC_FIELD(Offset, Width, Min, Max)  {HarnessSymbolicField, (Offset), (Width), (Min), (Max)}
+#define SYMBOLIC_INPUT_SIZE(Min, Max)            {HarnessSymbolicInputSize, 0, 0, (Min), (Max)}
+
+/**
+  Return the symbolic regions of the test harness.
+
+  It is optional: ToolChainHarnessLib provides a weak default returning no
+  region, which makes the whole input symbolic.
+
+  @param[out] Regions   The region table.
+
+  @return The number of regions.
+
+**/
+UINTN
+EFIAPI
+GetHarnessSymbolicRegions (
+  OUT CONST HARNESS_SYMBOLIC_REGION  **Regions
+  );
+
+//
+// Structure-aware mutation with libFuzzer.
+//
+// The LIBFUZZER build of ToolChainHarnessLib only hands mutations to
+// CustomMutatorLib for a harness selecting the format of its input, so
+// targets of other formats keep the generic libFuzzer mutations.
+//
+
+/**
+  Select the CustomMutatorLib format of the test harness input, with
+  CustomMutatorSetFormat().
+
+  It is optional: ToolChainHarnessLib provides a weak default returning
+  FALSE, which leaves the custom mutator off. Only a harness defining it
+  links CustomMutatorLib, so it lists CustomMutatorLib in its INF.
+
+  @retval TRUE   A format is selected.
+  @retval FALSE  No format is selected.
+
+**/
+BOOLEAN
+EFIAPI
+SetHarnessMutatorFormat (
+  VOID
+  );
+
+//
+// Device registers.
+//
+// ToolChainHarnessLib resets the IoLibHost emulation around every run of a
+// harness linking IoLibHost. A harness maps the registers of its device with
+// IoEmulationAddRegisters() in RunTestHarness(), and the register files
+// mapped with FromInput read the test input from the offset returned below.
+//
+
+/**
+  Return the offset of the device register data in the test harness input.
+
+  It is optional: ToolChainHarnessLib provides a weak default returning
+  MAX_UINTN, which gives the registers no input.
+
+  @return The offset in the input, or MAX_UINTN.
+
+**/
+UINTN
+EFIAPI
+GetHarnessIoInputOffset (
+  VOID
+  );
+
 #endif
\ No newline at end of file
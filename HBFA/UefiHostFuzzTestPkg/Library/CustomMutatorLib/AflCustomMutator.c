@@ -0,0 +1,346 @@
+/** @file
+  AFL++ custom mutator wrapping CustomMutatorLib.
+
+  This file is not part of CustomMutatorLib.inf. It is compiled together with
+  all .c files of this directory and ToolChainHarnessLib/HarnessFixup.c into a
+  shared object outside of the EDK2 build, e.g. with
+
+    cc -shared -fPIC -O2 -fshort-wchar -DNO_MSABI_VA_FUNCS
+       -I MdePkg/Include -I MdePkg/Include/X64 -I MdeModulePkg/Include
+       -I UefiHostFuzzTestPkg/Include <sources> -o HBFACustomMutator.so
+
+  and loaded with AFL_CUSTOM_MUTATOR_LIBRARY. RunAFL.py --custom-mutator does
+  both. The few BaseLib and BaseMemoryLib functions the mutators use are
+  provided below, so the object has no EDK2 link dependencies.
+
+  If HBFA_FIXUP_RULES names a rule table dumped by the test binary, the
+  post-processor applies those harness fixup rules before the format fixups.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <stdio.h>
+
+#include "CustomMutatorInternal.h"
+
+#include <Library/ToolChainHarnessLib.h>
+
+#define FIXUP_RULES_ENV  "HBFA_FIXUP_RULES"
+
+typedef struct {
+  UINT32                    Seed;
+  UINT8                     *Buffer;
+  UINTN                     BufferSize;
+  VOID                      *RuleFile;
+  CONST HARNESS_FIXUP_RULE  *Rules;
+  UINTN                     RuleCount;
+} AFL_CUSTOM_MUTATOR;
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  return memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+GUID *
+EFIAPI
+CopyGuid (
+  OUT GUID       *DestinationGuid,
+  IN CONST GUID  *SourceGuid
+  )
+{
+  return memcpy (DestinationGuid, SourceGuid, sizeof (GUID));
+}
+
+BOOLEAN
+EFIAPI
+CompareGuid (
+  IN CONST GUID  *Guid1,
+  IN CONST GUID  *Guid2
+  )
+{
+  return (BOOLEAN)(memcmp (Guid1, Guid2, sizeof (GUID)) == 0);
+}
+
+UINT16
+EFIAPI
+ReadUnaligned16 (
+  IN CONST UINT16  *Buffer
+  )
+{
+  UINT16  Value;
+
+  memcpy (&Value, Buffer, sizeof (Value));
+  return Value;
+}
+
+UINT16
+EFIAPI
+WriteUnaligned16 (
+  OUT UINT16  *Buffer,
+  IN  UINT16  Value
+  )
+{
+  memcpy (Buffer, &Value, sizeof (Value));
+  return Value;
+}
+
+UINT32
+EFIAPI
+ReadUnaligned32 (
+  IN CONST UINT32  *Buffer
+  )
+{
+  UINT32  Value;
+
+  memcpy (&Value, Buffer, sizeof (Value));
+  return Value;
+}
+
+UINT32
+EFIAPI
+WriteUnaligned32 (
+  OUT UINT32  *Buffer,
+  IN  UINT32  Value
+  )
+{
+  memcpy (Buffer, &Value, sizeof (Value));
+  return Value;
+}
+
+UINT64
+EFIAPI
+ReadUnaligned64 (
+  IN CONST UINT64  *Buffer
+  )
+{
+  UINT64  Value;
+
+  memcpy (&Value, Buffer, sizeof (Value));
+  return Value;
+}
+
+UINT64
+EFIAPI
+WriteUnaligned64 (
+  OUT UINT64  *Buffer,
+  IN  UINT64  Value
+  )
+{
+  memcpy (Buffer, &Value, sizeof (Value));
+  return Value;
+}
+
+UINT64
+EFIAPI
+LShiftU64 (
+  IN UINT64  Operand,
+  IN UINTN   Count
+  )
+{
+  return Operand << (Count & 63);
+}
+
+UINT64
+EFIAPI
+MultU64x32 (
+  IN UINT64  Multiplicand,
+  IN UINT32  Multiplier
+  )
+{
+  return Multiplicand * Multiplier;
+}
+
+UINT64
+EFIAPI
+DivU64x32 (
+  IN UINT64  Dividend,
+  IN UINT32  Divisor
+  )
+{
+  return Dividend / Divisor;
+}
+
+UINTN
+EFIAPI
+StrSize (
+  IN CONST CHAR16  *String
+  )
+{
+  UINTN  Length;
+
+  for (Length = 0; String[Length] != 0; Length++) {
+  }
+  return (Length + 1) * sizeof (CHAR16);
+}
+
+UINT32
+EFIAPI
+CalculateCrc32 (
+  IN VOID   *Buffer,
+  IN UINTN  Length
+  )
+{
+  STATIC UINT32   Table[256];
+  STATIC BOOLEAN  TableReady = FALSE;
+  UINT32          Crc;
+  UINTN           Index;
+  UINTN           Bit;
+  UINT8           *Ptr;
+
+  if (!TableReady) {
+    for (Index = 0; Index < 256; Index++) {
+      Crc = (UINT32)Index;
+      for (Bit = 0; Bit < 8; Bit++) {
+        Crc = (Crc & 1) ? ((Crc >> 1) ^ 0xEDB88320) : (Crc >> 1);
+      }
+      Table[Index] = Crc;
+    }
+    TableReady = TRUE;
+  }
+
+  Crc = 0xFFFFFFFF;
+  for (Index = 0, Ptr = Buffer; Index < Length; Index++, Ptr++) {
+    Crc = (Crc >> 8) ^ Table[(UINT8)Crc ^ *Ptr];
+  }
+  return Crc ^ 0xFFFFFFFF;
+}
+
+VOID
+LoadFixupRules (
+  IN OUT AFL_CUSTOM_MUTATOR  *Mutator
+  )
+{
+  CHAR8  *FileName;
+  FILE   *File;
+  long   FileSize;
+
+  FileName = getenv (FIXUP_RULES_ENV);
+  if (FileName == NULL || (File = fopen (FileName, "rb")) == NULL) {
+    return;
+  }
+  if (fseek (File, 0, SEEK_END) == 0 && (FileSize = ftell (File)) > 0 &&
+      (Mutator->RuleFile = malloc (FileSize)) != NULL) {
+    rewind (File);
+    if (fread (Mutator->RuleFile, 1, FileSize, File) != (size_t)FileSize ||
+        !HarnessParseFixupRules (Mutator->RuleFile, FileSize, &Mutator->Rules, &Mutator->RuleCount)) {
+      fprintf (stderr, "%s: invalid fixup rules %s\n", __FILE__, FileName);
+      Mutator->RuleCount = 0;
+    }
+  }
+  fclose (File);
+}
+
+void *
+afl_custom_init (
+  void          *afl,
+  unsigned int  seed
+  )
+{
+  AFL_CUSTOM_MUTATOR  *Mutator;
+
+  Mutator = calloc (1, sizeof (*Mutator));
+  if (Mutator == NULL) {
+    return NULL;
+  }
+  Mutator->Seed = seed;
+  LoadFixupRules (Mutator);
+  return Mutator;
+}
+
+unsigned int
+afl_custom_fuzz_count (
+  void                 *data,
+  const unsigned char  *buf,
+  size_t               buf_size
+  )
+{
+  //
+  // Skip the custom stage for inputs no mutator knows, instead of spending
+  // executions on unmodified copies.
+  //
+  return (MutatorGetFormat (buf, buf_size) != NULL) ? 256 : 0;
+}
+
+size_t
+afl_custom_fuzz (
+  void           *data,
+  unsigned char  *buf,
+  size_t         buf_size,
+  unsigned char  **out_buf,
+  unsigned char  *add_buf,
+  size_t         add_buf_size,
+  size_t         max_size
+  )
+{
+  AFL_CUSTOM_MUTATOR  *Mutator;
+  UINT8               *Buffer;
+  UINTN               NewSize;
+
+  Mutator = data;
+  if (Mutator->BufferSize < max_size) {
+    Buffer = realloc (Mutator->Buffer, max_size);
+    if (Buffer == NULL) {
+      *out_buf = buf;
+      return buf_size;
+    }
+    Mutator->Buffer = Buffer;
+    Mutator->BufferSize = max_size;
+  }
+  if (buf_size > max_size) {
+    buf_size = max_size;
+  }
+  memcpy (Mutator->Buffer, buf, buf_size);
+
+  MutatorRandom (&Mutator->Seed);
+  NewSize = CustomMutatorMutate (Mutator->Buffer, buf_size, max_size, Mutator->Seed);
+  if (NewSize == 0) {
+    //
+    // Unknown format: hand the input back and let the havoc stage work on it.
+    //
+    *out_buf = buf;
+    return buf_size;
+  }
+  *out_buf = Mutator->Buffer;
+  return NewSize;
+}
+
+size_t
+afl_custom_post_process (
+  void           *data,
+  unsigned char  *buf,
+  size_t         buf_size,
+  unsigned char  **out_buf
+  )
+{
+  AFL_CUSTOM_MUTATOR  *Mutator;
+
+  Mutator = data;
+  HarnessApplyFixupRules (buf, buf_size, Mutator->Rules, Mutator->RuleCount);
+  CustomMutatorFixup (buf, buf_size);
+  *out_buf = buf;
+  return buf_size;
+}
+
+void
+afl_custom_deinit (
+  void  *data
+  )
+{
+  AFL_CUSTOM_MUTATOR  *Mutator;
+
+  Mutator = data;
+  free (Mutator->Buffer);
+  free (Mutator->RuleFile);
+  free (Mutator);
+}
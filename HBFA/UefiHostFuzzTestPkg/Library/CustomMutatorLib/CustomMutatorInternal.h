@@ -0,0 +1,150 @@
+/** @file
+  Internal definitions shared by the format specific mutators.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _CUSTOM_MUTATOR_INTERNAL_H_
+#define _CUSTOM_MUTATOR_INTERNAL_H_
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/CustomMutatorLib.h>
+#include <Library/ToolChainHarnessLib.h>
+
+//
+// A mutable field of a structure: offset from the structure start and width
+// in bytes (1, 2, 4 or 8).
+//
+typedef struct {
+  UINT16  Offset;
+  UINT16  Width;
+} MUTATOR_FIELD;
+
+typedef
+BOOLEAN
+(*MUTATOR_DETECT) (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  );
+
+//
+// Mutate one field and return the new size, or 0 if the input does not have
+// the expected layout. The checksums and sizes depending on the mutated field
+// are updated by the mutator itself, which is cheaper than a full fixup.
+//
+typedef
+UINTN
+(*MUTATOR_MUTATE) (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  );
+
+typedef
+VOID
+(*MUTATOR_FIXUP) (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size
+  );
+
+typedef struct {
+  CONST CHAR8     *Name;
+  MUTATOR_DETECT  Detect;
+  MUTATOR_MUTATE  Mutate;
+  MUTATOR_FIXUP   Fixup;
+} MUTATOR_FORMAT;
+
+extern MUTATOR_FORMAT  mUdfMutator;
+extern MUTATOR_FORMAT  mGptMutator;
+extern MUTATOR_FORMAT  mFmpCapsuleMutator;
+extern MUTATOR_FORMAT  mSmmVariableMutator;
+
+/**
+  Return the mutator of the format of Data, honoring CUSTOM_MUTATOR_FORMAT_ENV,
+  or NULL if the format is not recognized or mutators are disabled.
+**/
+MUTATOR_FORMAT *
+MutatorGetFormat (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  );
+
+/**
+  Return the next value of a xorshift32 generator.
+**/
+UINT32
+MutatorRandom (
+  IN OUT UINT32  *Random
+  );
+
+/**
+  Return a random value in [0, Limit), or 0 if Limit is 0.
+**/
+UINTN
+MutatorRandomBelow (
+  IN OUT UINT32  *Random,
+  IN     UINTN   Limit
+  );
+
+/**
+  Read a little endian integer field of Width bytes.
+**/
+UINT64
+MutatorReadInteger (
+  IN CONST UINT8  *Field,
+  IN UINTN        Width
+  );
+
+/**
+  Write a little endian integer field of Width bytes.
+**/
+VOID
+MutatorWriteInteger (
+  OUT UINT8       *Field,
+  IN  UINTN       Width,
+  IN  UINT64      Value
+  );
+
+/**
+  Overwrite an integer field of Width bytes with an interesting value:
+  a boundary, a small delta of the old value, or random bits.
+**/
+VOID
+MutatorMutateInteger (
+  IN OUT UINT8   *Field,
+  IN     UINTN   Width,
+  IN OUT UINT32  *Random
+  );
+
+/**
+  Mutate one field of Fields, relative to Base, if it fits in Size bytes.
+
+  @retval TRUE   A field was mutated.
+  @retval FALSE  No field of the table fits.
+**/
+BOOLEAN
+MutatorMutateFieldTable (
+  IN OUT UINT8                *Base,
+  IN     UINTN                Size,
+  IN     CONST MUTATOR_FIELD  *Fields,
+  IN     UINTN                FieldCount,
+  IN OUT UINT32               *Random
+  );
+
+/**
+  Randomize a few bytes of the Length bytes at Data.
+**/
+VOID
+MutatorMutateBytes (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Length,
+  IN OUT UINT32  *Random
+  );
+
+#endif
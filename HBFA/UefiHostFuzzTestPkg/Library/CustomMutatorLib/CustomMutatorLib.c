@@ -0,0 +1,311 @@
+/** @file
+  Dispatch structure-aware mutations to the format specific mutators.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "CustomMutatorInternal.h"
+
+MUTATOR_FORMAT  *mMutatorFormats[] = {
+  &mFmpCapsuleMutator,
+  &mGptMutator,
+  &mUdfMutator,
+  &mSmmVariableMutator,
+};
+
+//
+// Format forced through CUSTOM_MUTATOR_FORMAT_ENV or CustomMutatorSetFormat().
+// NULL means detect.
+//
+BOOLEAN         mMutatorFormatInitialized = FALSE;
+BOOLEAN         mMutatorDisabled = FALSE;
+MUTATOR_FORMAT  *mMutatorForcedFormat = NULL;
+
+UINT64  mMutatorInterestingValues[] = {
+  0x0, 0x1, 0x7F, 0x80, 0xFF, 0x100, 0x200, 0x800, 0x1000, 0x7FFF, 0x8000, 0xFFFF,
+  0x10000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0x100000000ull, 0x7FFFFFFFFFFFFFFFull,
+  0x8000000000000000ull, 0xFFFFFFFFFFFFFFFFull
+};
+
+UINT32
+MutatorRandom (
+  IN OUT UINT32  *Random
+  )
+{
+  UINT32  Value;
+
+  Value = *Random;
+  if (Value == 0) {
+    Value = 0x9E3779B9;
+  }
+  Value ^= Value << 13;
+  Value ^= Value >> 17;
+  Value ^= Value << 5;
+  *Random = Value;
+  return Value;
+}
+
+UINTN
+MutatorRandomBelow (
+  IN OUT UINT32  *Random,
+  IN     UINTN   Limit
+  )
+{
+  if (Limit == 0) {
+    return 0;
+  }
+  return MutatorRandom (Random) % Limit;
+}
+
+UINT64
+MutatorReadInteger (
+  IN CONST UINT8  *Field,
+  IN UINTN        Width
+  )
+{
+  UINT64  Value;
+
+  Value = 0;
+  CopyMem (&Value, Field, Width);
+  return Value;
+}
+
+VOID
+MutatorWriteInteger (
+  OUT UINT8       *Field,
+  IN  UINTN       Width,
+  IN  UINT64      Value
+  )
+{
+  CopyMem (Field, &Value, Width);
+}
+
+VOID
+MutatorMutateInteger (
+  IN OUT UINT8   *Field,
+  IN     UINTN   Width,
+  IN OUT UINT32  *Random
+  )
+{
+  UINT64  Value;
+  UINT64  Delta;
+
+  Value = MutatorReadInteger (Field, Width);
+  switch (MutatorRandomBelow (Random, 4)) {
+  case 0:
+    Value = mMutatorInterestingValues[MutatorRandomBelow (Random, ARRAY_SIZE (mMutatorInterestingValues))];
+    break;
+  case 1:
+    Delta = 1 + MutatorRandomBelow (Random, 16);
+    Value = (MutatorRandom (Random) & 1) ? Value + Delta : Value - Delta;
+    break;
+  case 2:
+    Value ^= LShiftU64 (1, MutatorRandomBelow (Random, Width * 8));
+    break;
+  default:
+    Value = LShiftU64 (MutatorRandom (Random), 32) | MutatorRandom (Random);
+    break;
+  }
+  MutatorWriteInteger (Field, Width, Value);
+}
+
+BOOLEAN
+MutatorMutateFieldTable (
+  IN OUT UINT8                *Base,
+  IN     UINTN                Size,
+  IN     CONST MUTATOR_FIELD  *Fields,
+  IN     UINTN                FieldCount,
+  IN OUT UINT32               *Random
+  )
+{
+  UINTN  Index;
+  UINTN  Try;
+
+  for (Try = 0; Try < FieldCount; Try++) {
+    Index = MutatorRandomBelow (Random, FieldCount);
+    if ((UINTN)Fields[Index].Offset + Fields[Index].Width <= Size) {
+      MutatorMutateInteger (Base + Fields[Index].Offset, Fields[Index].Width, Random);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+VOID
+MutatorMutateBytes (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Length,
+  IN OUT UINT32  *Random
+  )
+{
+  UINTN  Count;
+
+  if (Length == 0) {
+    return;
+  }
+  Count = 1 + MutatorRandomBelow (Random, 4);
+  while (Count-- != 0) {
+    Data[MutatorRandomBelow (Random, Length)] = (UINT8)MutatorRandom (Random);
+  }
+}
+
+VOID
+MutatorInitializeFormat (
+  VOID
+  )
+{
+  CHAR8  *Name;
+  UINTN  Index;
+
+  if (mMutatorFormatInitialized) {
+    return;
+  }
+  mMutatorFormatInitialized = TRUE;
+
+  Name = getenv (CUSTOM_MUTATOR_FORMAT_ENV);
+  if (Name == NULL || strcmp (Name, "auto") == 0) {
+    return;
+  }
+  if (strcmp (Name, "none") == 0) {
+    mMutatorDisabled = TRUE;
+    return;
+  }
+  for (Index = 0; Index < ARRAY_SIZE (mMutatorFormats); Index++) {
+    if (strcmp (Name, mMutatorFormats[Index]->Name) == 0) {
+      mMutatorForcedFormat = mMutatorFormats[Index];
+      return;
+    }
+  }
+}
+
+MUTATOR_FORMAT *
+MutatorGetFormat (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  UINTN  Index;
+
+  MutatorInitializeFormat ();
+  if (mMutatorDisabled) {
+    return NULL;
+  }
+  if (mMutatorForcedFormat != NULL) {
+    return mMutatorForcedFormat;
+  }
+  for (Index = 0; Index < ARRAY_SIZE (mMutatorFormats); Index++) {
+    if (mMutatorFormats[Index]->Detect (Data, Size)) {
+      return mMutatorFormats[Index];
+    }
+  }
+  return NULL;
+}
+
+/**
+  Select the format of the inputs instead of detecting it per input.
+
+  A format set in CUSTOM_MUTATOR_FORMAT_ENV takes precedence over Name.
+
+  @param[in] Name  The format name, or NULL.
+
+  @retval TRUE   A format is selected.
+  @retval FALSE  Name is NULL or unknown, or mutators are disabled.
+
+**/
+BOOLEAN
+EFIAPI
+CustomMutatorSetFormat (
+  IN CONST CHAR8  *Name  OPTIONAL
+  )
+{
+  UINTN  Index;
+
+  MutatorInitializeFormat ();
+  if (mMutatorDisabled) {
+    return FALSE;
+  }
+  if (mMutatorForcedFormat != NULL) {
+    return TRUE;
+  }
+  if (Name == NULL) {
+    return FALSE;
+  }
+  for (Index = 0; Index < ARRAY_SIZE (mMutatorFormats); Index++) {
+    if (strcmp (Name, mMutatorFormats[Index]->Name) == 0) {
+      mMutatorForcedFormat = mMutatorFormats[Index];
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Apply one structure-aware mutation to Data in place.
+
+  @param[in, out] Data     The input to mutate.
+  @param[in]      Size     The size of the input.
+  @param[in]      MaxSize  The size of the buffer behind Data.
+  @param[in]      Seed     The random seed for this mutation.
+
+  @return The new size of the input, or 0 if the format of Data is not
+          recognized and the caller should fall back to a generic mutator.
+
+**/
+UINTN
+EFIAPI
+CustomMutatorMutate (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Size,
+  IN     UINTN   MaxSize,
+  IN     UINT32  Seed
+  )
+{
+  MUTATOR_FORMAT  *Format;
+  UINT32          Random;
+
+  if (Data == NULL || Size == 0 || Size > MaxSize) {
+    return 0;
+  }
+  Format = MutatorGetFormat (Data, Size);
+  if (Format == NULL) {
+    return 0;
+  }
+
+  Random = Seed;
+  return Format->Mutate (Data, Size, MaxSize, &Random);
+}
+
+/**
+  Recompute the checksums, CRCs and size fields of Data in place.
+
+  @param[in, out] Data     The input to fix.
+  @param[in]      Size     The size of the input.
+
+  @retval TRUE   The format of Data was recognized and fixed.
+  @retval FALSE  The format of Data is not recognized.
+
+**/
+BOOLEAN
+EFIAPI
+CustomMutatorFixup (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Size
+  )
+{
+  MUTATOR_FORMAT  *Format;
+
+  if (Data == NULL || Size == 0) {
+    return FALSE;
+  }
+  Format = MutatorGetFormat (Data, Size);
+  if (Format == NULL) {
+    return FALSE;
+  }
+  Format->Fixup (Data, Size);
+  return TRUE;
+}
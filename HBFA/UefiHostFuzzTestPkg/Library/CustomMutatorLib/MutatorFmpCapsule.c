@@ -0,0 +1,253 @@
+/** @file
+  Structure-aware mutator for FMP capsules.
+
+  Mutations target the capsule header, the FMP capsule header, the item
+  offset list and the image headers it points to. Items can also be
+  duplicated, which shifts the offset list. CapsuleImageSize always follows
+  the input size, as in the TestDxeCapsuleLibFmp FixBuffer.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "CustomMutatorInternal.h"
+
+#include <Guid/FmpCapsule.h>
+#include <Guid/WinCertificate.h>
+#include <Protocol/FirmwareManagement.h>
+
+#define FMP_MAX_ITEMS  32
+
+EFI_GUID  mMutatorFmpCapsuleGuid = EFI_FIRMWARE_MANAGEMENT_CAPSULE_ID_GUID;
+
+CONST MUTATOR_FIELD  mFmpCapsuleHeaderFields[] = {
+  {OFFSET_OF (EFI_CAPSULE_HEADER, HeaderSize),                                   4},
+  {OFFSET_OF (EFI_CAPSULE_HEADER, Flags),                                        4},
+};
+
+CONST MUTATOR_FIELD  mFmpHeaderFields[] = {
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER, Version),                  4},
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER, EmbeddedDriverCount),      2},
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER, PayloadItemCount),         2},
+};
+
+CONST MUTATOR_FIELD  mFmpImageHeaderFields[] = {
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, Version),            4},
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, UpdateImageIndex),   1},
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, UpdateImageSize),    4},
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, UpdateVendorCodeSize), 4},
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, UpdateHardwareInstance), 8},
+  {OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, ImageCapsuleSupport), 8},
+};
+
+//
+// EFI_FIRMWARE_IMAGE_AUTHENTICATION at the start of an image payload.
+//
+CONST MUTATOR_FIELD  mFmpImageAuthFields[] = {
+  {OFFSET_OF (EFI_FIRMWARE_IMAGE_AUTHENTICATION, MonotonicCount),                8},
+  {OFFSET_OF (EFI_FIRMWARE_IMAGE_AUTHENTICATION, AuthInfo.Hdr.dwLength),         4},
+  {OFFSET_OF (EFI_FIRMWARE_IMAGE_AUTHENTICATION, AuthInfo.Hdr.wRevision),        2},
+  {OFFSET_OF (EFI_FIRMWARE_IMAGE_AUTHENTICATION, AuthInfo.Hdr.wCertificateType), 2},
+};
+
+BOOLEAN
+FmpCapsuleDetect (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  return (BOOLEAN)(Size >= sizeof (EFI_CAPSULE_HEADER) &&
+                   CompareGuid ((EFI_GUID *)Data, &mMutatorFmpCapsuleGuid));
+}
+
+/**
+  Return the offset of the FMP capsule header and its item count, or 0 if the
+  header does not fit in the input.
+**/
+UINTN
+FmpGetHeader (
+  IN  CONST UINT8  *Data,
+  IN  UINTN        Size,
+  OUT UINTN        *ItemCount
+  )
+{
+  UINTN  FmpOffset;
+  UINTN  Count;
+
+  FmpOffset = ReadUnaligned32 ((UINT32 *)(Data + OFFSET_OF (EFI_CAPSULE_HEADER, HeaderSize)));
+  if (FmpOffset < sizeof (EFI_CAPSULE_HEADER) ||
+      FmpOffset > Size - sizeof (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER)) {
+    return 0;
+  }
+  Count = ReadUnaligned16 ((UINT16 *)(Data + FmpOffset + OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER, EmbeddedDriverCount))) +
+          ReadUnaligned16 ((UINT16 *)(Data + FmpOffset + OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER, PayloadItemCount)));
+  Count = MIN (Count, (Size - FmpOffset - sizeof (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER)) / sizeof (UINT64));
+  *ItemCount = Count;
+  return FmpOffset;
+}
+
+UINT64 *
+FmpGetItemOffset (
+  IN UINT8  *Data,
+  IN UINTN  FmpOffset,
+  IN UINTN  Index
+  )
+{
+  return (UINT64 *)(Data + FmpOffset + sizeof (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER) + Index * sizeof (UINT64));
+}
+
+/**
+  Append a copy of the last payload item. A new entry is inserted at the end
+  of the item offset list, so all item offsets move by sizeof (UINT64).
+**/
+UINTN
+FmpDuplicateLastItem (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN     UINTN    FmpOffset,
+  IN     UINTN    ItemCount
+  )
+{
+  UINT8   *ListEnd;
+  UINT64  LastItem;
+  UINTN   ItemSize;
+  UINTN   Index;
+  UINT16  PayloadItemCount;
+
+  if (ItemCount == 0 || ItemCount >= FMP_MAX_ITEMS) {
+    return 0;
+  }
+  LastItem = ReadUnaligned64 (FmpGetItemOffset (Data, FmpOffset, ItemCount - 1));
+  if (LastItem > Size - FmpOffset) {
+    return 0;
+  }
+  ItemSize = Size - FmpOffset - (UINTN)LastItem;
+  if (MaxSize - Size < sizeof (UINT64) || ItemSize > MaxSize - Size - sizeof (UINT64)) {
+    return 0;
+  }
+
+  ListEnd = (UINT8 *)FmpGetItemOffset (Data, FmpOffset, ItemCount);
+  CopyMem (ListEnd + sizeof (UINT64), ListEnd, Size - (ListEnd - Data));
+  Size += sizeof (UINT64);
+  for (Index = 0; Index < ItemCount; Index++) {
+    WriteUnaligned64 (
+      FmpGetItemOffset (Data, FmpOffset, Index),
+      ReadUnaligned64 (FmpGetItemOffset (Data, FmpOffset, Index)) + sizeof (UINT64)
+      );
+  }
+  LastItem += sizeof (UINT64);
+  WriteUnaligned64 (FmpGetItemOffset (Data, FmpOffset, ItemCount), Size - FmpOffset);
+  CopyMem (Data + Size, Data + FmpOffset + LastItem, ItemSize);
+  Size += ItemSize;
+
+  PayloadItemCount = ReadUnaligned16 ((UINT16 *)(Data + FmpOffset + OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER, PayloadItemCount)));
+  WriteUnaligned16 ((UINT16 *)(Data + FmpOffset + OFFSET_OF (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER, PayloadItemCount)), (UINT16)(PayloadItemCount + 1));
+  return Size;
+}
+
+UINTN
+FmpCapsuleMutateField (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  )
+{
+  UINTN   FmpOffset;
+  UINTN   ItemCount;
+  UINTN   Item;
+  UINT64  ItemOffset;
+  UINTN   NewSize;
+
+  if (!FmpCapsuleDetect (Data, Size)) {
+    return 0;
+  }
+  FmpOffset = FmpGetHeader (Data, Size, &ItemCount);
+  if (FmpOffset == 0 || MutatorRandomBelow (Random, 10) == 0) {
+    MutatorMutateFieldTable (Data, Size, mFmpCapsuleHeaderFields, ARRAY_SIZE (mFmpCapsuleHeaderFields), Random);
+    return Size;
+  }
+
+  switch (MutatorRandomBelow (Random, 6)) {
+  case 0:
+    MutatorMutateFieldTable (Data + FmpOffset, Size - FmpOffset, mFmpHeaderFields, ARRAY_SIZE (mFmpHeaderFields), Random);
+    return Size;
+  case 1:
+    if (ItemCount != 0) {
+      MutatorMutateInteger ((UINT8 *)FmpGetItemOffset (Data, FmpOffset, MutatorRandomBelow (Random, ItemCount)), sizeof (UINT64), Random);
+      return Size;
+    }
+    break;
+  case 2:
+    NewSize = FmpDuplicateLastItem (Data, Size, MaxSize, FmpOffset, ItemCount);
+    if (NewSize != 0) {
+      return NewSize;
+    }
+    break;
+  default:
+    break;
+  }
+
+  if (ItemCount == 0) {
+    MutatorMutateFieldTable (Data + FmpOffset, Size - FmpOffset, mFmpHeaderFields, ARRAY_SIZE (mFmpHeaderFields), Random);
+    return Size;
+  }
+  Item = MutatorRandomBelow (Random, ItemCount);
+  ItemOffset = ReadUnaligned64 (FmpGetItemOffset (Data, FmpOffset, Item));
+  if (ItemOffset >= Size - FmpOffset) {
+    MutatorMutateInteger ((UINT8 *)FmpGetItemOffset (Data, FmpOffset, Item), sizeof (UINT64), Random);
+    return Size;
+  }
+  ItemOffset += FmpOffset;
+  if (MutatorRandomBelow (Random, 3) == 0 &&
+      ItemOffset + sizeof (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER) < Size &&
+      MutatorMutateFieldTable (
+        Data + (UINTN)ItemOffset + sizeof (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER),
+        Size - (UINTN)ItemOffset - sizeof (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER),
+        mFmpImageAuthFields,
+        ARRAY_SIZE (mFmpImageAuthFields),
+        Random
+        )) {
+    return Size;
+  }
+  MutatorMutateFieldTable (Data + (UINTN)ItemOffset, Size - (UINTN)ItemOffset, mFmpImageHeaderFields, ARRAY_SIZE (mFmpImageHeaderFields), Random);
+  return Size;
+}
+
+VOID
+FmpCapsuleFixup (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size
+  )
+{
+  if (Size < sizeof (EFI_CAPSULE_HEADER)) {
+    return;
+  }
+  WriteUnaligned32 ((UINT32 *)(Data + OFFSET_OF (EFI_CAPSULE_HEADER, CapsuleImageSize)), (UINT32)Size);
+}
+
+UINTN
+FmpCapsuleMutate (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  )
+{
+  UINTN  NewSize;
+
+  NewSize = FmpCapsuleMutateField (Data, Size, MaxSize, Random);
+  if (NewSize != 0) {
+    FmpCapsuleFixup (Data, NewSize);
+  }
+  return NewSize;
+}
+
+MUTATOR_FORMAT  mFmpCapsuleMutator = {
+  "capsule",
+  FmpCapsuleDetect,
+  FmpCapsuleMutate,
+  FmpCapsuleFixup
+};
@@ -0,0 +1,234 @@
+/** @file
+  Structure-aware mutator for GPT disk images.
+
+  The primary header is expected at LBA 1, with the block size probed from
+  512 bytes up to 16KB, and the backup header in the last block. After a mutation both headers get their partition entry array CRC and
+  header CRC recomputed, the same way TestPeiGpt FixBuffer does.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "CustomMutatorInternal.h"
+
+#include <Uefi/UefiGpt.h>
+#include <IndustryStandard/Mbr.h>
+
+#define GPT_MIN_BLOCK_SIZE  512
+#define GPT_MAX_BLOCK_SIZE  (16 * 1024)
+
+CONST MUTATOR_FIELD  mGptHeaderFields[] = {
+  {OFFSET_OF (EFI_TABLE_HEADER, Revision),                             4},
+  {OFFSET_OF (EFI_TABLE_HEADER, HeaderSize),                           4},
+  {OFFSET_OF (EFI_PARTITION_TABLE_HEADER, MyLBA),                      8},
+  {OFFSET_OF (EFI_PARTITION_TABLE_HEADER, AlternateLBA),               8},
+  {OFFSET_OF (EFI_PARTITION_TABLE_HEADER, FirstUsableLBA),             8},
+  {OFFSET_OF (EFI_PARTITION_TABLE_HEADER, LastUsableLBA),              8},
+  {OFFSET_OF (EFI_PARTITION_TABLE_HEADER, PartitionEntryLBA),          8},
+  {OFFSET_OF (EFI_PARTITION_TABLE_HEADER, NumberOfPartitionEntries),   4},
+  {OFFSET_OF (EFI_PARTITION_TABLE_HEADER, SizeOfPartitionEntry),       4},
+};
+
+CONST MUTATOR_FIELD  mGptEntryFields[] = {
+  {OFFSET_OF (EFI_PARTITION_ENTRY, PartitionTypeGUID),                 4},
+  {OFFSET_OF (EFI_PARTITION_ENTRY, StartingLBA),                       8},
+  {OFFSET_OF (EFI_PARTITION_ENTRY, EndingLBA),                         8},
+  {OFFSET_OF (EFI_PARTITION_ENTRY, Attributes),                        8},
+};
+
+CONST MUTATOR_FIELD  mGptMbrRecordFields[] = {
+  {OFFSET_OF (MBR_PARTITION_RECORD, BootIndicator),                    1},
+  {OFFSET_OF (MBR_PARTITION_RECORD, OSIndicator),                      1},
+  {OFFSET_OF (MBR_PARTITION_RECORD, StartingLBA),                      4},
+  {OFFSET_OF (MBR_PARTITION_RECORD, SizeInLBA),                        4},
+};
+
+BOOLEAN
+GptIsHeader (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size,
+  IN UINTN        Offset
+  )
+{
+  return (BOOLEAN)(Offset + sizeof (EFI_PARTITION_TABLE_HEADER) <= Size &&
+                   ReadUnaligned64 ((UINT64 *)(Data + Offset)) == EFI_PTAB_HEADER_ID);
+}
+
+/**
+  Return the block size the primary header is found with, or 0.
+**/
+UINT32
+GptGetBlockSize (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  UINT32  BlockSize;
+
+  for (BlockSize = GPT_MIN_BLOCK_SIZE; BlockSize <= GPT_MAX_BLOCK_SIZE; BlockSize *= 2) {
+    if (GptIsHeader (Data, Size, BlockSize * PRIMARY_PART_HEADER_LBA)) {
+      return BlockSize;
+    }
+  }
+  return 0;
+}
+
+BOOLEAN
+GptDetect (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  return (BOOLEAN)(GptGetBlockSize (Data, Size) != 0);
+}
+
+/**
+  Return the offset of the partition entry array of the header at
+  HeaderOffset, or 0 if it does not fit in the input.
+**/
+UINTN
+GptGetEntryArray (
+  IN  CONST UINT8  *Data,
+  IN  UINTN        Size,
+  IN  UINT32       BlockSize,
+  IN  UINTN        HeaderOffset,
+  OUT UINTN        *ArraySize
+  )
+{
+  EFI_PARTITION_TABLE_HEADER  Header;
+  UINT64                      Offset;
+  UINT64                      Length;
+
+  CopyMem (&Header, Data + HeaderOffset, sizeof (Header));
+  if (Header.PartitionEntryLBA >= DivU64x32 (Size, BlockSize)) {
+    return 0;
+  }
+  Offset = MultU64x32 (Header.PartitionEntryLBA, BlockSize);
+  Length = MultU64x32 (Header.NumberOfPartitionEntries, Header.SizeOfPartitionEntry);
+  if (Offset == 0 || Length > Size - Offset) {
+    return 0;
+  }
+  *ArraySize = (UINTN)Length;
+  return (UINTN)Offset;
+}
+
+UINTN
+GptMutateField (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  )
+{
+  EFI_PARTITION_TABLE_HEADER  Header;
+  UINTN                       HeaderOffset;
+  UINTN                       ArrayOffset;
+  UINTN                       ArraySize;
+  UINTN                       EntryOffset;
+  UINTN                       Choice;
+  UINT32                      BlockSize;
+
+  BlockSize = GptGetBlockSize (Data, Size);
+  if (BlockSize == 0) {
+    return 0;
+  }
+  HeaderOffset = BlockSize * PRIMARY_PART_HEADER_LBA;
+  if (MutatorRandomBelow (Random, 4) == 0 &&
+      GptIsHeader (Data, Size, (Size / BlockSize - 1) * BlockSize)) {
+    HeaderOffset = (Size / BlockSize - 1) * BlockSize;
+  }
+
+  Choice = MutatorRandomBelow (Random, 10);
+  if (Choice < 4) {
+    MutatorMutateFieldTable (Data + HeaderOffset, Size - HeaderOffset, mGptHeaderFields, ARRAY_SIZE (mGptHeaderFields), Random);
+    return Size;
+  }
+
+  if (Choice < 9) {
+    ArrayOffset = GptGetEntryArray (Data, Size, BlockSize, HeaderOffset, &ArraySize);
+    CopyMem (&Header, Data + HeaderOffset, sizeof (Header));
+    if (ArrayOffset != 0 && Header.SizeOfPartitionEntry >= sizeof (EFI_PARTITION_ENTRY)) {
+      EntryOffset = ArrayOffset + MutatorRandomBelow (Random, Header.NumberOfPartitionEntries) * Header.SizeOfPartitionEntry;
+      MutatorMutateFieldTable (Data + EntryOffset, Size - EntryOffset, mGptEntryFields, ARRAY_SIZE (mGptEntryFields), Random);
+      return Size;
+    }
+  }
+
+  //
+  // Protective MBR partition records.
+  //
+  EntryOffset = OFFSET_OF (MASTER_BOOT_RECORD, Partition) + MutatorRandomBelow (Random, MAX_MBR_PARTITIONS) * sizeof (MBR_PARTITION_RECORD);
+  MutatorMutateFieldTable (Data + EntryOffset, Size - EntryOffset, mGptMbrRecordFields, ARRAY_SIZE (mGptMbrRecordFields), Random);
+  return Size;
+}
+
+VOID
+GptFixHeader (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINT32   BlockSize,
+  IN     UINTN    HeaderOffset
+  )
+{
+  EFI_PARTITION_TABLE_HEADER  *Header;
+  UINTN                       ArrayOffset;
+  UINTN                       ArraySize;
+  UINT32                      Crc;
+
+  if (!GptIsHeader (Data, Size, HeaderOffset)) {
+    return;
+  }
+  Header = (EFI_PARTITION_TABLE_HEADER *)(Data + HeaderOffset);
+
+  ArrayOffset = GptGetEntryArray (Data, Size, BlockSize, HeaderOffset, &ArraySize);
+  if (ArrayOffset != 0) {
+    WriteUnaligned32 (&Header->PartitionEntryArrayCRC32, CalculateCrc32 (Data + ArrayOffset, ArraySize));
+  }
+
+  if (ReadUnaligned32 (&Header->Header.HeaderSize) <= Size - HeaderOffset) {
+    WriteUnaligned32 (&Header->Header.CRC32, 0);
+    Crc = CalculateCrc32 (Header, ReadUnaligned32 (&Header->Header.HeaderSize));
+    WriteUnaligned32 (&Header->Header.CRC32, Crc);
+  }
+}
+
+VOID
+GptFixup (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size
+  )
+{
+  UINT32  BlockSize;
+
+  BlockSize = GptGetBlockSize (Data, Size);
+  if (BlockSize == 0) {
+    return;
+  }
+  GptFixHeader (Data, Size, BlockSize, BlockSize * PRIMARY_PART_HEADER_LBA);
+  GptFixHeader (Data, Size, BlockSize, (Size / BlockSize - 1) * BlockSize);
+}
+
+UINTN
+GptMutate (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  )
+{
+  UINTN  NewSize;
+
+  NewSize = GptMutateField (Data, Size, MaxSize, Random);
+  if (NewSize != 0) {
+    GptFixup (Data, NewSize);
+  }
+  return NewSize;
+}
+
+MUTATOR_FORMAT  mGptMutator = {
+  "gpt",
+  GptDetect,
+  GptMutate,
+  GptFixup
+};
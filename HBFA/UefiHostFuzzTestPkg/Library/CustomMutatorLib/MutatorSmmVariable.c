@@ -0,0 +1,326 @@
+/** @file
+  Structure-aware mutator for SMM variable communicate buffers.
+
+  The input is a SMM_VARIABLE_COMMUNICATE_HEADER followed by the function
+  specific payload. Mutations pick a function, mutate the payload fields, or
+  replace the variable name with a well-known one and move the data behind
+  it. The fixup keeps NameSize and DataSize inside the buffer.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "CustomMutatorInternal.h"
+
+#include <Guid/SmmVariableCommon.h>
+#include <Guid/GlobalVariable.h>
+#include <Guid/ImageAuthentication.h>
+
+#define SMM_VARIABLE_HEADER_SIZE  OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, Data)
+#define SMM_VARIABLE_MAX_FUNCTION SMM_VARIABLE_FUNCTION_GET_PAYLOAD_SIZE
+
+typedef struct {
+  CONST CHAR16  *Name;
+  EFI_GUID      Guid;
+} SMM_VARIABLE_KNOWN_NAME;
+
+SMM_VARIABLE_KNOWN_NAME  mSmmVariableKnownNames[] = {
+  {L"",                         EFI_GLOBAL_VARIABLE},
+  {L"BootOrder",                EFI_GLOBAL_VARIABLE},
+  {L"Boot0000",                 EFI_GLOBAL_VARIABLE},
+  {L"PK",                       EFI_GLOBAL_VARIABLE},
+  {L"KEK",                      EFI_GLOBAL_VARIABLE},
+  {L"SecureBoot",               EFI_GLOBAL_VARIABLE},
+  {L"db",                       EFI_IMAGE_SECURITY_DATABASE_GUID},
+  {L"dbx",                      EFI_IMAGE_SECURITY_DATABASE_GUID},
+};
+
+CONST MUTATOR_FIELD  mSmmVariableAccessFields[] = {
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, DataSize),   sizeof (UINTN)},
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, NameSize),   sizeof (UINTN)},
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Attributes), 4},
+};
+
+CONST MUTATOR_FIELD  mSmmVariableGetNextFields[] = {
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAME, NameSize), sizeof (UINTN)},
+};
+
+CONST MUTATOR_FIELD  mSmmVariableQueryInfoFields[] = {
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_QUERY_VARIABLE_INFO, Attributes), 4},
+};
+
+CONST MUTATOR_FIELD  mSmmVariableLockFields[] = {
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_LOCK_VARIABLE, NameSize),     sizeof (UINTN)},
+};
+
+CONST MUTATOR_FIELD  mSmmVariablePropertyFields[] = {
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, NameSize),                    sizeof (UINTN)},
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, VariableProperty.Revision),   2},
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, VariableProperty.Property),   2},
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, VariableProperty.Attributes), 4},
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, VariableProperty.MinSize),    sizeof (UINTN)},
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, VariableProperty.MaxSize),    sizeof (UINTN)},
+};
+
+CONST MUTATOR_FIELD  mSmmVariablePayloadSizeFields[] = {
+  {OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_PAYLOAD_SIZE, VariablePayloadSize), sizeof (UINTN)},
+};
+
+/**
+  Get the field table of the payload of Function, and the offsets of its
+  NameSize and Name in the payload, or MAX_UINTN if it has no name.
+**/
+CONST MUTATOR_FIELD *
+SmmVariableGetFields (
+  IN  UINTN  Function,
+  OUT UINTN  *FieldCount,
+  OUT UINTN  *NameSizeOffset,
+  OUT UINTN  *NameOffset
+  )
+{
+  *NameSizeOffset = MAX_UINTN;
+  *NameOffset = MAX_UINTN;
+  switch (Function) {
+  case SMM_VARIABLE_FUNCTION_GET_VARIABLE:
+  case SMM_VARIABLE_FUNCTION_SET_VARIABLE:
+    *NameSizeOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, NameSize);
+    *NameOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, Name);
+    *FieldCount = ARRAY_SIZE (mSmmVariableAccessFields);
+    return mSmmVariableAccessFields;
+  case SMM_VARIABLE_FUNCTION_GET_NEXT_VARIABLE_NAME:
+    *NameSizeOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAME, NameSize);
+    *NameOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_GET_NEXT_VARIABLE_NAME, Name);
+    *FieldCount = ARRAY_SIZE (mSmmVariableGetNextFields);
+    return mSmmVariableGetNextFields;
+  case SMM_VARIABLE_FUNCTION_QUERY_VARIABLE_INFO:
+    *FieldCount = ARRAY_SIZE (mSmmVariableQueryInfoFields);
+    return mSmmVariableQueryInfoFields;
+  case SMM_VARIABLE_FUNCTION_LOCK_VARIABLE:
+    *NameSizeOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_LOCK_VARIABLE, NameSize);
+    *NameOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_LOCK_VARIABLE, Name);
+    *FieldCount = ARRAY_SIZE (mSmmVariableLockFields);
+    return mSmmVariableLockFields;
+  case SMM_VARIABLE_FUNCTION_VAR_CHECK_VARIABLE_PROPERTY_SET:
+  case SMM_VARIABLE_FUNCTION_VAR_CHECK_VARIABLE_PROPERTY_GET:
+    *NameSizeOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, NameSize);
+    *NameOffset = OFFSET_OF (SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY, Name);
+    *FieldCount = ARRAY_SIZE (mSmmVariablePropertyFields);
+    return mSmmVariablePropertyFields;
+  case SMM_VARIABLE_FUNCTION_GET_PAYLOAD_SIZE:
+    *FieldCount = ARRAY_SIZE (mSmmVariablePayloadSizeFields);
+    return mSmmVariablePayloadSizeFields;
+  default:
+    *FieldCount = 0;
+    return NULL;
+  }
+}
+
+/**
+  Replace the variable name with a well-known one. Everything after the old
+  name moves with the end of the new name, so the data stays attached.
+**/
+UINTN
+SmmVariableReplaceName (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN     UINTN    NameSizeOffset,
+  IN     UINTN    NameOffset,
+  IN OUT UINT32   *Random
+  )
+{
+  SMM_VARIABLE_KNOWN_NAME  *Known;
+  UINT8                    *Payload;
+  UINTN                    PayloadSize;
+  UINTN                    OldNameSize;
+  UINTN                    NewNameSize;
+  UINTN                    TailSize;
+
+  Payload = Data + SMM_VARIABLE_HEADER_SIZE;
+  PayloadSize = Size - SMM_VARIABLE_HEADER_SIZE;
+  if (NameOffset > PayloadSize) {
+    return 0;
+  }
+  Known = &mSmmVariableKnownNames[MutatorRandomBelow (Random, ARRAY_SIZE (mSmmVariableKnownNames))];
+  NewNameSize = StrSize (Known->Name);
+  OldNameSize = (UINTN)MutatorReadInteger (Payload + NameSizeOffset, sizeof (UINTN));
+  OldNameSize = MIN (OldNameSize, PayloadSize - NameOffset);
+  if (NewNameSize > OldNameSize && NewNameSize - OldNameSize > MaxSize - Size) {
+    return 0;
+  }
+
+  TailSize = PayloadSize - NameOffset - OldNameSize;
+  CopyMem (Payload + NameOffset + NewNameSize, Payload + NameOffset + OldNameSize, TailSize);
+  CopyMem (Payload + NameOffset, Known->Name, NewNameSize);
+  MutatorWriteInteger (Payload + NameSizeOffset, sizeof (UINTN), NewNameSize);
+  //
+  // Every payload with a name starts with the vendor GUID.
+  //
+  CopyGuid ((EFI_GUID *)Payload, &Known->Guid);
+  return Size - OldNameSize + NewNameSize;
+}
+
+UINTN
+SmmVariableMutateField (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  )
+{
+  UINT64               Function;
+  CONST MUTATOR_FIELD  *Fields;
+  UINTN                FieldCount;
+  UINTN                NameSizeOffset;
+  UINTN                NameOffset;
+  UINTN                NewSize;
+
+  if (Size < SMM_VARIABLE_HEADER_SIZE) {
+    return 0;
+  }
+  if (MutatorRandomBelow (Random, 16) == 0) {
+    Function = SMM_VARIABLE_FUNCTION_GET_VARIABLE + MutatorRandomBelow (Random, SMM_VARIABLE_MAX_FUNCTION);
+    MutatorWriteInteger (Data + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, Function), sizeof (UINTN), Function);
+    return Size;
+  }
+
+  Function = MutatorReadInteger (Data + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, Function), sizeof (UINTN));
+  Fields = SmmVariableGetFields ((UINTN)Function, &FieldCount, &NameSizeOffset, &NameOffset);
+  if (NameOffset != MAX_UINTN && MutatorRandomBelow (Random, 4) == 0) {
+    NewSize = SmmVariableReplaceName (Data, Size, MaxSize, NameSizeOffset, NameOffset, Random);
+    if (NewSize != 0) {
+      return NewSize;
+    }
+  }
+  if (Fields == NULL ||
+      !MutatorMutateFieldTable (Data + SMM_VARIABLE_HEADER_SIZE, Size - SMM_VARIABLE_HEADER_SIZE, Fields, FieldCount, Random)) {
+    MutatorMutateBytes (Data + SMM_VARIABLE_HEADER_SIZE, Size - SMM_VARIABLE_HEADER_SIZE, Random);
+  }
+  return Size;
+}
+
+VOID
+SmmVariableFixup (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size
+  )
+{
+  UINT8                *Payload;
+  UINTN                PayloadSize;
+  UINT64               Function;
+  UINTN                FieldCount;
+  UINTN                NameSizeOffset;
+  UINTN                NameOffset;
+  UINT64               NameSize;
+  UINT64               DataSize;
+
+  if (Size < SMM_VARIABLE_HEADER_SIZE) {
+    return;
+  }
+  Payload = Data + SMM_VARIABLE_HEADER_SIZE;
+  PayloadSize = Size - SMM_VARIABLE_HEADER_SIZE;
+  Function = MutatorReadInteger (Data + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, Function), sizeof (UINTN));
+  SmmVariableGetFields ((UINTN)Function, &FieldCount, &NameSizeOffset, &NameOffset);
+  if (NameOffset == MAX_UINTN || NameOffset > PayloadSize) {
+    return;
+  }
+
+  NameSize = MutatorReadInteger (Payload + NameSizeOffset, sizeof (UINTN));
+  if (NameSize > PayloadSize - NameOffset) {
+    NameSize = PayloadSize - NameOffset;
+    MutatorWriteInteger (Payload + NameSizeOffset, sizeof (UINTN), NameSize);
+  }
+  if (Function == SMM_VARIABLE_FUNCTION_GET_VARIABLE || Function == SMM_VARIABLE_FUNCTION_SET_VARIABLE) {
+    DataSize = MutatorReadInteger (Payload + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, DataSize), sizeof (UINTN));
+    if (DataSize > PayloadSize - NameOffset - NameSize) {
+      DataSize = PayloadSize - NameOffset - NameSize;
+      MutatorWriteInteger (Payload + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, DataSize), sizeof (UINTN), DataSize);
+    }
+  }
+}
+
+/**
+  Recognize a communicate buffer: a function with a payload, a return status
+  that is EFI_SUCCESS or an error code, and for the functions taking a name, a
+  NameSize (and a DataSize) inside the buffer. Only checking the function
+  would take any input starting with a small integer.
+**/
+BOOLEAN
+SmmVariableDetect (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  CONST UINT8  *Payload;
+  UINTN        PayloadSize;
+  UINT64       Function;
+  UINT64       ReturnStatus;
+  UINTN        FieldCount;
+  UINTN        NameSizeOffset;
+  UINTN        NameOffset;
+  UINT64       NameSize;
+  UINT64       DataSize;
+
+  if (Size < SMM_VARIABLE_HEADER_SIZE) {
+    return FALSE;
+  }
+  Payload = Data + SMM_VARIABLE_HEADER_SIZE;
+  PayloadSize = Size - SMM_VARIABLE_HEADER_SIZE;
+  Function = MutatorReadInteger (Data + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, Function), sizeof (UINTN));
+  ReturnStatus = MutatorReadInteger (Data + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_HEADER, ReturnStatus), sizeof (UINTN));
+  if (ReturnStatus != EFI_SUCCESS && (ReturnStatus & ~(UINT64)MAX_BIT) > 0xFF) {
+    return FALSE;
+  }
+  if (SmmVariableGetFields ((UINTN)Function, &FieldCount, &NameSizeOffset, &NameOffset) == NULL) {
+    return FALSE;
+  }
+
+  switch (Function) {
+  case SMM_VARIABLE_FUNCTION_QUERY_VARIABLE_INFO:
+    return (BOOLEAN)(PayloadSize >= sizeof (SMM_VARIABLE_COMMUNICATE_QUERY_VARIABLE_INFO));
+  case SMM_VARIABLE_FUNCTION_GET_PAYLOAD_SIZE:
+    return (BOOLEAN)(PayloadSize >= sizeof (SMM_VARIABLE_COMMUNICATE_GET_PAYLOAD_SIZE));
+  default:
+    break;
+  }
+
+  if (NameOffset > PayloadSize) {
+    return FALSE;
+  }
+  NameSize = MutatorReadInteger (Payload + NameSizeOffset, sizeof (UINTN));
+  if (NameSize == 0 || (NameSize & 1) != 0 || NameSize > PayloadSize - NameOffset) {
+    return FALSE;
+  }
+  if (Function == SMM_VARIABLE_FUNCTION_GET_VARIABLE || Function == SMM_VARIABLE_FUNCTION_SET_VARIABLE) {
+    DataSize = MutatorReadInteger (Payload + OFFSET_OF (SMM_VARIABLE_COMMUNICATE_ACCESS_VARIABLE, DataSize), sizeof (UINTN));
+    if (DataSize > PayloadSize - NameOffset - NameSize) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+UINTN
+SmmVariableMutate (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  )
+{
+  UINTN  NewSize;
+
+  NewSize = SmmVariableMutateField (Data, Size, MaxSize, Random);
+  if (NewSize != 0) {
+    SmmVariableFixup (Data, NewSize);
+  }
+  return NewSize;
+}
+
+MUTATOR_FORMAT  mSmmVariableMutator = {
+  "smmvariable",
+  SmmVariableDetect,
+  SmmVariableMutate,
+  SmmVariableFixup
+};
@@ -0,0 +1,391 @@
+/** @file
+  Structure-aware mutator for UDF volumes.
+
+  Descriptors are located by their 16-byte tag: sector aligned for volume and
+  file descriptors, 4-byte aligned for file identifier descriptors inside
+  directories. After a mutation the tag checksum and the descriptor CRC are
+  recomputed, so the descriptor still passes the tag validation of UdfDxe.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "CustomMutatorInternal.h"
+
+#define UDF_SECTOR_ALIGNMENT      512
+#define UDF_FID_ALIGNMENT         4
+#define UDF_TAG_SIZE              16
+#define UDF_MAX_TAGS              256
+#define UDF_TAG_CACHE_REFRESH     256
+
+#define UDF_TAG_ID_AVDP           2
+#define UDF_TAG_ID_PD             5
+#define UDF_TAG_ID_LVD            6
+#define UDF_TAG_ID_FSD            256
+#define UDF_TAG_ID_FID            257
+#define UDF_TAG_ID_FE             261
+#define UDF_TAG_ID_EFE            266
+
+typedef struct {
+  UINT16               TagIdentifier;
+  CONST MUTATOR_FIELD  *Fields;
+  UINTN                FieldCount;
+} UDF_DESCRIPTOR_FIELDS;
+
+//
+// Fields of the descriptor tag itself.
+//
+CONST MUTATOR_FIELD  mUdfTagFields[] = {
+  {2, 2},   // DescriptorVersion
+  {6, 2},   // TagSerialNumber
+  {10, 2},  // DescriptorCRCLength
+  {12, 4},  // TagLocation
+};
+
+CONST MUTATOR_FIELD  mUdfAvdpFields[] = {
+  {16, 4},  // MainVolumeDescriptorSequenceExtent.ExtentLength
+  {20, 4},  // MainVolumeDescriptorSequenceExtent.ExtentLocation
+  {24, 4},  // ReserveVolumeDescriptorSequenceExtent.ExtentLength
+  {28, 4},  // ReserveVolumeDescriptorSequenceExtent.ExtentLocation
+};
+
+CONST MUTATOR_FIELD  mUdfPdFields[] = {
+  {20, 2},  // PartitionFlags
+  {22, 2},  // PartitionNumber
+  {184, 4}, // AccessType
+  {188, 4}, // PartitionStartingLocation
+  {192, 4}, // PartitionLength
+};
+
+CONST MUTATOR_FIELD  mUdfLvdFields[] = {
+  {212, 4}, // LogicalBlockSize
+  {248, 4}, // LogicalVolumeContentsUse.ExtentLength
+  {252, 4}, // LogicalVolumeContentsUse.ExtentLocation.LogicalBlockNumber
+  {256, 2}, // LogicalVolumeContentsUse.ExtentLocation.PartitionReferenceNumber
+  {264, 4}, // MapTableLength
+  {268, 4}, // NumberOfPartitionMaps
+  {432, 4}, // IntegritySequenceExtent.ExtentLength
+  {436, 4}, // IntegritySequenceExtent.ExtentLocation
+  {440, 1}, // PartitionMaps[0].Type
+  {441, 1}, // PartitionMaps[0].Length
+  {444, 2}, // PartitionMaps[0].PartitionNumber
+};
+
+CONST MUTATOR_FIELD  mUdfFsdFields[] = {
+  {400, 4}, // RootDirectoryIcb.ExtentLength
+  {404, 4}, // RootDirectoryIcb.ExtentLocation.LogicalBlockNumber
+  {408, 2}, // RootDirectoryIcb.ExtentLocation.PartitionReferenceNumber
+  {448, 4}, // NextExtent.ExtentLength
+  {452, 4}, // NextExtent.ExtentLocation.LogicalBlockNumber
+  {464, 4}, // SystemStreamDirectoryIcb.ExtentLength
+  {468, 4}, // SystemStreamDirectoryIcb.ExtentLocation.LogicalBlockNumber
+};
+
+CONST MUTATOR_FIELD  mUdfFidFields[] = {
+  {16, 2},  // FileVersionNumber
+  {18, 1},  // FileCharacteristics
+  {19, 1},  // LengthOfFileIdentifier
+  {20, 4},  // Icb.ExtentLength
+  {24, 4},  // Icb.ExtentLocation.LogicalBlockNumber
+  {28, 2},  // Icb.ExtentLocation.PartitionReferenceNumber
+  {36, 2},  // LengthOfImplementationUse
+};
+
+CONST MUTATOR_FIELD  mUdfFeFields[] = {
+  {27, 1},  // IcbTag.FileType
+  {34, 2},  // IcbTag.Flags
+  {56, 8},  // InformationLength
+  {64, 8},  // LogicalBlocksRecorded
+  {112, 4}, // ExtendedAttributeIcb.ExtentLength
+  {116, 4}, // ExtendedAttributeIcb.ExtentLocation.LogicalBlockNumber
+  {168, 4}, // LengthOfExtendedAttributes
+  {172, 4}, // LengthOfAllocationDescriptors
+  {176, 4}, // AllocationDescriptors[0].ExtentLength, if no extended attributes
+  {180, 4}, // AllocationDescriptors[0].ExtentPosition
+};
+
+CONST MUTATOR_FIELD  mUdfEfeFields[] = {
+  {27, 1},  // IcbTag.FileType
+  {34, 2},  // IcbTag.Flags
+  {56, 8},  // InformationLength
+  {64, 8},  // ObjectSize
+  {72, 8},  // LogicalBlocksRecorded
+  {136, 4}, // ExtendedAttributeIcb.ExtentLength
+  {152, 4}, // StreamDirectoryIcb.ExtentLength
+  {208, 4}, // LengthOfExtendedAttributes
+  {212, 4}, // LengthOfAllocationDescriptors
+  {216, 4}, // AllocationDescriptors[0].ExtentLength, if no extended attributes
+  {220, 4}, // AllocationDescriptors[0].ExtentPosition
+};
+
+//
+// Tag offsets of the last scanned input. Fuzzers mutate the same input many
+// times in a row, so the 4-byte aligned scan of a whole volume is only redone
+// when a cached tag went away or the size changed, or every
+// UDF_TAG_CACHE_REFRESH mutations or fixups to pick up new descriptors.
+//
+UINTN  mUdfTagCache[UDF_MAX_TAGS];
+UINTN  mUdfTagCacheCount = 0;
+UINTN  mUdfTagCacheSize = 0;
+UINTN  mUdfTagCacheUses = 0;
+
+CONST UDF_DESCRIPTOR_FIELDS  mUdfDescriptorFields[] = {
+  {UDF_TAG_ID_AVDP, mUdfAvdpFields, ARRAY_SIZE (mUdfAvdpFields)},
+  {UDF_TAG_ID_PD,   mUdfPdFields,   ARRAY_SIZE (mUdfPdFields)},
+  {UDF_TAG_ID_LVD,  mUdfLvdFields,  ARRAY_SIZE (mUdfLvdFields)},
+  {UDF_TAG_ID_FSD,  mUdfFsdFields,  ARRAY_SIZE (mUdfFsdFields)},
+  {UDF_TAG_ID_FID,  mUdfFidFields,  ARRAY_SIZE (mUdfFidFields)},
+  {UDF_TAG_ID_FE,   mUdfFeFields,   ARRAY_SIZE (mUdfFeFields)},
+  {UDF_TAG_ID_EFE,  mUdfEfeFields,  ARRAY_SIZE (mUdfEfeFields)},
+};
+
+UINT8
+UdfTagChecksum (
+  IN CONST UINT8  *Tag
+  )
+{
+  UINT8  Checksum;
+  UINTN  Index;
+
+  Checksum = 0;
+  for (Index = 0; Index < UDF_TAG_SIZE; Index++) {
+    if (Index != 4) {
+      Checksum = (UINT8)(Checksum + Tag[Index]);
+    }
+  }
+  return Checksum;
+}
+
+BOOLEAN
+UdfIsKnownTagIdentifier (
+  IN UINT16  TagIdentifier
+  )
+{
+  return (BOOLEAN)((TagIdentifier >= 1 && TagIdentifier <= 9) ||
+                   (TagIdentifier >= 256 && TagIdentifier <= 258) ||
+                   TagIdentifier == UDF_TAG_ID_FE ||
+                   TagIdentifier == UDF_TAG_ID_EFE);
+}
+
+/**
+  Check whether Data[Offset] looks like a descriptor tag.
+
+  @param[in] Data           The input.
+  @param[in] Size           The size of the input.
+  @param[in] Offset         The candidate tag offset.
+  @param[in] CheckChecksum  Also require a valid tag checksum. The fixup does
+                            not, since a generic mutation may have broken it.
+
+**/
+BOOLEAN
+UdfIsTag (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size,
+  IN UINTN        Offset,
+  IN BOOLEAN      CheckChecksum
+  )
+{
+  CONST UINT8  *Tag;
+  UINT16       TagIdentifier;
+  UINT16       DescriptorVersion;
+
+  if (Offset + UDF_TAG_SIZE > Size) {
+    return FALSE;
+  }
+  Tag = Data + Offset;
+  if (Tag[3] != 0 || Tag[5] != 0 || Tag[1] > 1) {
+    return FALSE;
+  }
+  TagIdentifier = (UINT16)(Tag[0] | (Tag[1] << 8));
+  DescriptorVersion = (UINT16)(Tag[2] | (Tag[3] << 8));
+  if (!UdfIsKnownTagIdentifier (TagIdentifier) ||
+      (DescriptorVersion != 2 && DescriptorVersion != 3)) {
+    return FALSE;
+  }
+  //
+  // Only file identifier descriptors may start off a sector boundary.
+  //
+  if ((Offset % UDF_SECTOR_ALIGNMENT) != 0 && TagIdentifier != UDF_TAG_ID_FID) {
+    return FALSE;
+  }
+  return (BOOLEAN)(!CheckChecksum || Tag[4] == UdfTagChecksum (Tag));
+}
+
+UINTN
+UdfCollectTags (
+  IN  CONST UINT8  *Data,
+  IN  UINTN        Size,
+  IN  BOOLEAN      CheckChecksum,
+  OUT UINTN        *Offsets,
+  IN  UINTN        MaxCount
+  )
+{
+  UINTN  Offset;
+  UINTN  Count;
+
+  Count = 0;
+  for (Offset = 0; Offset + UDF_TAG_SIZE <= Size && Count < MaxCount; Offset += UDF_FID_ALIGNMENT) {
+    if (UdfIsTag (Data, Size, Offset, CheckChecksum)) {
+      Offsets[Count++] = Offset;
+    }
+  }
+  return Count;
+}
+
+/**
+  Get the offsets of the valid tags of Data, from the cache if possible.
+**/
+UINTN
+UdfGetTags (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  UINTN  Index;
+
+  if (mUdfTagCacheCount != 0 && mUdfTagCacheSize == Size && mUdfTagCacheUses < UDF_TAG_CACHE_REFRESH) {
+    for (Index = 0; Index < mUdfTagCacheCount; Index++) {
+      if (!UdfIsTag (Data, Size, mUdfTagCache[Index], TRUE)) {
+        break;
+      }
+    }
+    if (Index == mUdfTagCacheCount) {
+      mUdfTagCacheUses++;
+      return mUdfTagCacheCount;
+    }
+  }
+  mUdfTagCacheCount = UdfCollectTags (Data, Size, TRUE, mUdfTagCache, UDF_MAX_TAGS);
+  mUdfTagCacheSize = Size;
+  mUdfTagCacheUses = 0;
+  return mUdfTagCacheCount;
+}
+
+BOOLEAN
+UdfDetect (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  UINTN  Offset;
+
+  for (Offset = 0; Offset + UDF_TAG_SIZE <= Size; Offset += UDF_SECTOR_ALIGNMENT) {
+    if (UdfIsTag (Data, Size, Offset, TRUE)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Recompute the descriptor CRC and the tag checksum of the tag at Offset.
+  A DescriptorCRCLength running past the input is clamped first.
+**/
+VOID
+UdfFixTag (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    Offset
+  )
+{
+  UINT8   *Tag;
+  UINTN   CrcLength;
+  UINT16  Crc;
+
+  Tag = Data + Offset;
+  CrcLength = Tag[10] | (Tag[11] << 8);
+  if (CrcLength > Size - Offset - UDF_TAG_SIZE) {
+    CrcLength = Size - Offset - UDF_TAG_SIZE;
+    Tag[10] = (UINT8)CrcLength;
+    Tag[11] = (UINT8)(CrcLength >> 8);
+  }
+  Crc = HarnessCalculateCrc16Itu (Tag + UDF_TAG_SIZE, CrcLength);
+  Tag[8] = (UINT8)Crc;
+  Tag[9] = (UINT8)(Crc >> 8);
+  Tag[4] = UdfTagChecksum (Tag);
+}
+
+UINTN
+UdfMutate (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size,
+  IN     UINTN    MaxSize,
+  IN OUT UINT32   *Random
+  )
+{
+  UINTN   Count;
+  UINTN   Offset;
+  UINT16  TagIdentifier;
+  UINTN   Index;
+
+  Count = UdfGetTags (Data, Size);
+  if (Count == 0) {
+    return 0;
+  }
+  Offset = mUdfTagCache[MutatorRandomBelow (Random, Count)];
+  TagIdentifier = (UINT16)(Data[Offset] | (Data[Offset + 1] << 8));
+
+  if (MutatorRandomBelow (Random, 8) == 0) {
+    MutatorMutateFieldTable (Data + Offset, Size - Offset, mUdfTagFields, ARRAY_SIZE (mUdfTagFields), Random);
+    UdfFixTag (Data, Size, Offset);
+    return Size;
+  }
+  for (Index = 0; Index < ARRAY_SIZE (mUdfDescriptorFields); Index++) {
+    if (mUdfDescriptorFields[Index].TagIdentifier == TagIdentifier &&
+        MutatorMutateFieldTable (
+          Data + Offset,
+          Size - Offset,
+          mUdfDescriptorFields[Index].Fields,
+          mUdfDescriptorFields[Index].FieldCount,
+          Random
+          )) {
+      UdfFixTag (Data, Size, Offset);
+      return Size;
+    }
+  }
+  //
+  // No field table for this descriptor, or it is truncated: hit the body.
+  //
+  MutatorMutateBytes (
+    Data + Offset + UDF_TAG_SIZE,
+    MIN (Size - Offset - UDF_TAG_SIZE, UDF_SECTOR_ALIGNMENT - UDF_TAG_SIZE),
+    Random
+    );
+  UdfFixTag (Data, Size, Offset);
+  return Size;
+}
+
+/**
+  Fix the tags of Data after a generic mutation. The tags are taken from the
+  cache of the input the mutation started from, and only looked up again if
+  the size changed or the cache is due for a refresh. A tag the mutation
+  created elsewhere is picked up by the next refresh.
+**/
+VOID
+UdfFixup (
+  IN OUT UINT8    *Data,
+  IN     UINTN    Size
+  )
+{
+  UINTN  Index;
+
+  if (mUdfTagCacheCount == 0 || mUdfTagCacheSize != Size || mUdfTagCacheUses >= UDF_TAG_CACHE_REFRESH) {
+    mUdfTagCacheCount = UdfCollectTags (Data, Size, FALSE, mUdfTagCache, UDF_MAX_TAGS);
+    mUdfTagCacheSize = Size;
+    mUdfTagCacheUses = 0;
+  } else {
+    mUdfTagCacheUses++;
+  }
+  for (Index = 0; Index < mUdfTagCacheCount; Index++) {
+    if (UdfIsTag (Data, Size, mUdfTagCache[Index], FALSE)) {
+      UdfFixTag (Data, Size, mUdfTagCache[Index]);
+    }
+  }
+}
+
+MUTATOR_FORMAT  mUdfMutator = {
+  "udf",
+  UdfDetect,
+  UdfMutate,
+  UdfFixup
+};
@@ -0,0 +1,197 @@
+/** @file
+  Defaults of the optional test harness functions, and of the host library
+  functions ToolChainHarnessLib calls around a run.
+
+  A test harness overrides a default by defining the function itself. The
+  host libraries override theirs whenever a harness links them, so a harness
+  that does not use IoLibHost, the virtual clock of BaseTimerLibHost, the
+  events of UefiBootServicesTableLibHost or CustomMutatorLib does not need
+  them, and ToolChainHarnessLib only depends on BaseLib.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/ToolChainHarnessLib.h>
+#include <Library/CustomMutatorLib.h>
+#include <Library/VirtualClockLib.h>
+#include <Library/IoEmulationLib.h>
+#include <Library/EventQueueLib.h>
+
+//
+// HARNESS_DEFAULT (Name) names the default definition of Name: a weak Name
+// with GCC and CLANG, DefaultName with an alternate name of Name with MSVC.
+//
+#if defined(_MSC_VER)
+#if defined(_M_IX86)
+#define HARNESS_DEFAULT(Name) \
+  __pragma (comment (linker, "/alternatename:_" #Name "=_Default" #Name)) Default##Name
+#else
+#define HARNESS_DEFAULT(Name) \
+  __pragma (comment (linker, "/alternatename:" #Name "=Default" #Name)) Default##Name
+#endif
+#else
+#define HARNESS_DEFAULT(Name)  __attribute__((weak)) Name
+#endif
+
+/**
+  Default for harnesses without fixup rules.
+
+  @param[out] Rules   The rule table.
+
+  @return 0.
+
+**/
+UINTN
+EFIAPI
+HARNESS_DEFAULT (GetHarnessFixupRules) (
+  OUT CONST HARNESS_FIXUP_RULE  **Rules
+  )
+{
+  *Rules = NULL;
+  return 0;
+}
+
+/**
+  Default for harnesses without symbolic regions: the whole input is
+  symbolic.
+
+  @param[out] Regions   The region table.
+
+  @return 0.
+
+**/
+UINTN
+EFIAPI
+HARNESS_DEFAULT (GetHarnessSymbolicRegions) (
+  OUT CONST HARNESS_SYMBOLIC_REGION  **Regions
+  )
+{
+  *Regions = NULL;
+  return 0;
+}
+
+/**
+  Default for harnesses without a custom mutator format: libFuzzer only does
+  its generic mutations.
+
+  @return FALSE.
+
+**/
+BOOLEAN
+EFIAPI
+HARNESS_DEFAULT (SetHarnessMutatorFormat) (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Default for harnesses without device registers: register files mapped with
+  FromInput keep the values written to them.
+
+  @return MAX_UINTN.
+
+**/
+UINTN
+EFIAPI
+HARNESS_DEFAULT (GetHarnessIoInputOffset) (
+  VOID
+  )
+{
+  return MAX_UINTN;
+}
+
+/**
+  Default without CustomMutatorLib. Not called, since no format is set.
+
+  @return 0.
+
+**/
+UINTN
+EFIAPI
+HARNESS_DEFAULT (CustomMutatorMutate) (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Size,
+  IN     UINTN   MaxSize,
+  IN     UINT32  Seed
+  )
+{
+  return 0;
+}
+
+/**
+  Default without CustomMutatorLib. Not called, since no format is set.
+
+  @return FALSE.
+
+**/
+BOOLEAN
+EFIAPI
+HARNESS_DEFAULT (CustomMutatorFixup) (
+  IN OUT UINT8   *Data,
+  IN     UINTN   Size
+  )
+{
+  return FALSE;
+}
+
+/**
+  Default without BaseTimerLibHost: there is no virtual clock to restart.
+
+  @param[in] Budget   Nanoseconds the run may take, 0 for no limit.
+  @param[in] Expired  Handler called when the budget is exhausted.
+
+**/
+VOID
+EFIAPI
+HARNESS_DEFAULT (VirtualClockReset) (
+  IN UINT64                 Budget,
+  IN VIRTUAL_CLOCK_EXPIRED  Expired  OPTIONAL
+  )
+{
+}
+
+/**
+  Default without UefiBootServicesTableLibHost: there are no events.
+
+**/
+VOID
+EFIAPI
+HARNESS_DEFAULT (EventQueueReset) (
+  VOID
+  )
+{
+}
+
+/**
+  Default without IoLibHost: there are no device registers.
+
+  @param[in] Buffer  The input, NULL for none.
+  @param[in] Size    The size of the input in bytes.
+
+**/
+VOID
+EFIAPI
+HARNESS_DEFAULT (IoEmulationSetInput) (
+  IN CONST VOID  *Buffer  OPTIONAL,
+  IN UINTN       Size
+  )
+{
+}
+
+/**
+  Default without IoLibHost: there are no device registers.
+
+**/
+VOID
+EFIAPI
+HARNESS_DEFAULT (IoEmulationReset) (
+  VOID
+  )
+{
+}
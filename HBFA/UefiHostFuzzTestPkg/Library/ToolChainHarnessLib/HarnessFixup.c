@@ -0,0 +1,265 @@
+/** @file
+  Declarative checksum, CRC and size fixups of test inputs.
+
+  This file only needs CalculateCrc32 from BaseLib, so it can also be built into the
+  AFL++ custom mutator of CustomMutatorLib, see AflCustomMutator.c.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/ToolChainHarnessLib.h>
+
+/**
+  Read a little endian integer of Width bytes at Offset.
+
+  @retval TRUE   The field fits in the input.
+  @retval FALSE  The field is out of the input.
+**/
+BOOLEAN
+HarnessFixupReadField (
+  IN  CONST UINT8  *Buffer,
+  IN  UINTN        Size,
+  IN  UINT64       Offset,
+  IN  UINTN        Width,
+  OUT UINT64       *Value
+  )
+{
+  UINTN  Index;
+
+  if (Width > sizeof (UINT64) || Offset > Size || Width > Size - Offset) {
+    return FALSE;
+  }
+  *Value = 0;
+  for (Index = Width; Index > 0; Index--) {
+    *Value = (*Value << 8) | Buffer[(UINTN)Offset + Index - 1];
+  }
+  return TRUE;
+}
+
+VOID
+HarnessFixupWriteField (
+  OUT UINT8   *Field,
+  IN  UINTN   Width,
+  IN  UINT64  Value
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Width; Index++) {
+    Field[Index] = (UINT8)Value;
+    Value >>= 8;
+  }
+}
+
+/**
+  Evaluate a HARNESS_FIXUP_VALUE against the input.
+
+  @retval TRUE   The value is in [0, Size].
+  @retval FALSE  A field is out of the input, or the value is.
+**/
+BOOLEAN
+HarnessFixupEvaluate (
+  IN  CONST UINT8                *Buffer,
+  IN  UINTN                      Size,
+  IN  CONST HARNESS_FIXUP_VALUE  *Value,
+  OUT UINTN                      *Result
+  )
+{
+  UINT64  Field;
+  UINT64  Scale;
+  UINT64  Total;
+
+  Total = Value->Constant;
+  if (Value->FieldWidth != 0) {
+    if (!HarnessFixupReadField (Buffer, Size, Value->FieldOffset, Value->FieldWidth, &Field)) {
+      return FALSE;
+    }
+    Scale = Value->Scale;
+    if (Value->ScaleFieldWidth != 0 &&
+        !HarnessFixupReadField (Buffer, Size, Value->Scale, Value->ScaleFieldWidth, &Scale)) {
+      return FALSE;
+    }
+    //
+    // Reject products above Size before computing them, so they cannot overflow.
+    //
+    if (Field > Size || (Scale != 0 && Field > Size / Scale)) {
+      return FALSE;
+    }
+    Total += Field * Scale;
+  }
+  if (Total > Size) {
+    return FALSE;
+  }
+  if ((Value->Flags & HARNESS_FIXUP_FROM_END) != 0) {
+    Total = Size - Total;
+  }
+  *Result = (UINTN)Total;
+  return TRUE;
+}
+
+/**
+  CRC-ITU-T (polynomial 0x1021, initial value 0) as used by UDF descriptor
+  tags, for HarnessFixupCrc16Itu rules and the "udf" format of
+  CustomMutatorLib.
+
+  @param[in] Data    The data.
+  @param[in] Length  The size of the data.
+
+  @return The CRC.
+
+**/
+UINT16
+EFIAPI
+HarnessCalculateCrc16Itu (
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  )
+{
+  STATIC UINT16   Table[256];
+  STATIC BOOLEAN  TableReady = FALSE;
+  UINT16          Crc;
+  UINTN           Index;
+  UINTN           Bit;
+
+  if (!TableReady) {
+    for (Index = 0; Index < 256; Index++) {
+      Crc = (UINT16)(Index << 8);
+      for (Bit = 0; Bit < 8; Bit++) {
+        Crc = (UINT16)((Crc & 0x8000) ? ((Crc << 1) ^ 0x1021) : (Crc << 1));
+      }
+      Table[Index] = Crc;
+    }
+    TableReady = TRUE;
+  }
+
+  Crc = 0;
+  for (Index = 0; Index < Length; Index++) {
+    Crc = (UINT16)((Crc << 8) ^ Table[((Crc >> 8) ^ Data[Index]) & 0xFF]);
+  }
+  return Crc;
+}
+
+/**
+  Apply fixup rules to a buffer in place.
+
+  @param[in, out] Buffer     The input.
+  @param[in]      Size       The size of the input.
+  @param[in]      Rules      The rule table.
+  @param[in]      RuleCount  The number of rules.
+
+**/
+VOID
+EFIAPI
+HarnessApplyFixupRules (
+  IN OUT VOID                      *Buffer,
+  IN     UINTN                     Size,
+  IN     CONST HARNESS_FIXUP_RULE  *Rules,
+  IN     UINTN                     RuleCount
+  )
+{
+  UINT8   *Data;
+  UINTN   Index;
+  UINTN   Target;
+  UINTN   Offset;
+  UINTN   Length;
+  UINTN   Width;
+  UINTN   Byte;
+  UINT64  Result;
+
+  Data = Buffer;
+  for (Index = 0; Index < RuleCount; Index++) {
+    Width = Rules[Index].TargetWidth;
+    if (Width == 0 || Width > sizeof (UINT64) ||
+        !HarnessFixupEvaluate (Data, Size, &Rules[Index].Target, &Target) ||
+        !HarnessFixupEvaluate (Data, Size, &Rules[Index].DataOffset, &Offset) ||
+        !HarnessFixupEvaluate (Data, Size, &Rules[Index].DataLength, &Length) ||
+        Width > Size - Target) {
+      continue;
+    }
+    if ((Rules[Index].DataLength.Flags & HARNESS_FIXUP_FROM_END) != 0) {
+      //
+      // Length holds the end of the data.
+      //
+      if (Length < Offset) {
+        continue;
+      }
+      Length -= Offset;
+    }
+    if (Length > Size - Offset) {
+      continue;
+    }
+
+    if (Rules[Index].Algorithm != HarnessFixupSize && Rules[Index].Algorithm != HarnessFixupCrc16Itu) {
+      HarnessFixupWriteField (Data + Target, Width, 0);
+    }
+    Result = 0;
+    switch (Rules[Index].Algorithm) {
+    case HarnessFixupCrc32:
+      Result = CalculateCrc32 (Data + Offset, Length);
+      break;
+    case HarnessFixupCrc16Itu:
+      Result = HarnessCalculateCrc16Itu (Data + Offset, Length);
+      break;
+    case HarnessFixupSum8:
+    case HarnessFixupChecksum8:
+      for (Byte = 0; Byte < Length; Byte++) {
+        Result += Data[Offset + Byte];
+      }
+      Result = (Rules[Index].Algorithm == HarnessFixupChecksum8) ? (UINT8)(0 - Result) : (UINT8)Result;
+      break;
+    case HarnessFixupChecksum16:
+      for (Byte = 0; Byte + 1 < Length; Byte += 2) {
+        Result += Data[Offset + Byte] | (Data[Offset + Byte + 1] << 8);
+      }
+      Result = (UINT16)(0 - Result);
+      break;
+    case HarnessFixupSize:
+      Result = Length;
+      break;
+    default:
+      continue;
+    }
+    HarnessFixupWriteField (Data + Target, Width, Result);
+  }
+}
+
+/**
+  Validate a dumped rule table.
+
+  @param[in]  Data       The content of the rule file.
+  @param[in]  Size       The size of the rule file.
+  @param[out] Rules      The rules in Data.
+  @param[out] RuleCount  The number of rules.
+
+  @retval TRUE   The table is valid.
+  @retval FALSE  The table is corrupted or from another version.
+
+**/
+BOOLEAN
+EFIAPI
+HarnessParseFixupRules (
+  IN  CONST VOID                *Data,
+  IN  UINTN                     Size,
+  OUT CONST HARNESS_FIXUP_RULE  **Rules,
+  OUT UINTN                     *RuleCount
+  )
+{
+  CONST HARNESS_FIXUP_RULES_HEADER  *Header;
+
+  Header = Data;
+  if (Size < sizeof (*Header) ||
+      Header->Signature != HARNESS_FIXUP_RULES_SIGNATURE ||
+      Header->Version != HARNESS_FIXUP_RULES_VERSION ||
+      Header->RuleSize != sizeof (HARNESS_FIXUP_RULE) ||
+      Header->RuleCount > (Size - sizeof (*Header)) / sizeof (HARNESS_FIXUP_RULE)) {
+    return FALSE;
+  }
+  *Rules = (CONST HARNESS_FIXUP_RULE *)(Header + 1);
+  *RuleCount = Header->RuleCount;
+  return TRUE;
+}
@@ -16,6 +16,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/ToolChainHarnessLib.h>
+#include <Library/CustomMutatorLib.h>
+#include <Library/VirtualClockLib.h>
+#include <Library/IoEmulationLib.h>
+#include <Library/EventQueueLib.h>
 
 #ifdef TEST_WITH_INSTRUMENT
 #include <Library/InstrumentHookLib.h>
@@ -62,6 +66,227 @@ ReadInstrumentProfile (
 }
 #endif
 
+VOID
+DumpHarnessFixupRules (
+  IN CHAR8 *FileName
+  )
+{
+  CONST HARNESS_FIXUP_RULE    *Rules;
+  HARNESS_FIXUP_RULES_HEADER  Header;
+
+  Header.Signature = HARNESS_FIXUP_RULES_SIGNATURE;
+  Header.Version = HARNESS_FIXUP_RULES_VERSION;
+  Header.RuleSize = sizeof (HARNESS_FIXUP_RULE);
+  Header.RuleCount = (UINT32)GetHarnessFixupRules (&Rules);
+
+  FILE *f = fopen(FileName, "wb");
+  if (f==NULL) {
+    fputs ("File error",stderr);
+    exit (1);
+  }
+  if (fwrite(&Header, sizeof(Header), 1, f) != 1 ||
+      (Header.RuleCount != 0 && fwrite(Rules, sizeof(HARNESS_FIXUP_RULE), Header.RuleCount, f) != Header.RuleCount)) {
+    fputs ("File error",stderr);
+    exit (1);
+  }
+  fclose(f);
+}
+
+VOID
+ApplyHarnessFixupRules (
+  IN VOID  *TestBuffer,
+  IN UINTN TestBufferSize
+  )
+{
+  CONST HARNESS_FIXUP_RULE    *Rules;
+  UINTN                       RuleCount;
+
+  RuleCount = GetHarnessFixupRules (&Rules);
+#ifdef TEST_WITH_KLEE
+  //
+  // A CRC over symbolic data explodes the path count. Only keep size fields
+  // consistent, the solver is left to find the checksums.
+  //
+  for (; RuleCount != 0; Rules++, RuleCount--) {
+    if (Rules->Algorithm == HarnessFixupSize) {
+      HarnessApplyFixupRules (TestBuffer, TestBufferSize, Rules, 1);
+    }
+  }
+#else
+  HarnessApplyFixupRules (TestBuffer, TestBufferSize, Rules, RuleCount);
+#endif
+}
+
+//
+// Map no device registers but those the harness maps itself, and feed the
+// register files it maps with FromInput from GetHarnessIoInputOffset().
+//
+VOID
+ResetHarnessIoEmulation (
+  IN VOID  *TestBuffer  OPTIONAL,
+  IN UINTN TestBufferSize
+  )
+{
+  UINTN  Offset;
+
+  IoEmulationReset ();
+  if (TestBuffer == NULL) {
+    return;
+  }
+  Offset = GetHarnessIoInputOffset ();
+  if (Offset < TestBufferSize) {
+    IoEmulationSetInput ((UINT8 *)TestBuffer + Offset, TestBufferSize - Offset);
+  }
+}
+
+//
+// Run the harness with the virtual clock of TimerLib restarted. If
+// HBFA_TIME_BUDGET_MS is set, a run that spends more virtual time than that
+// in Stall() or timeout loops aborts, so the fuzzer keeps the input as a
+// hang. The run is not unwound: with libFuzzer a longjmp out of
+// LLVMFuzzerTestOneInput would leave the TPL, locks, events and pool of the
+// run behind for the next input. The timers, pending notifications and event
+// groups a run leaves behind on return are dropped, so they cannot fire into
+// the freed buffers of the run during the next one. The resets are no-ops
+// for a harness that does not link the host library concerned, see
+// HarnessDefaults.c.
+//
+STATIC
+VOID
+RunTestHarnessOnVirtualClock (
+  IN VOID  *TestBuffer,
+  IN UINTN TestBufferSize
+  )
+{
+#ifdef TEST_WITH_KLEE
+  ResetHarnessIoEmulation (TestBuffer, TestBufferSize);
+  RunTestHarness(TestBuffer, TestBufferSize);
+#else
+  CHAR8   *BudgetString;
+  UINT64  Budget;
+
+  Budget = 0;
+  BudgetString = getenv (VIRTUAL_CLOCK_BUDGET_ENV);
+  if (BudgetString != NULL) {
+    Budget = strtoull (BudgetString, NULL, 0) * 1000000;
+  }
+
+  VirtualClockReset (Budget, NULL);
+  EventQueueReset ();
+  ResetHarnessIoEmulation (TestBuffer, TestBufferSize);
+  RunTestHarness(TestBuffer, TestBufferSize);
+  ResetHarnessIoEmulation (NULL, 0);
+  EventQueueReset ();
+  VirtualClockReset (0, NULL);
+#endif
+}
+
+//
+// Read a test input file, up to MaxBufferSize bytes.
+//
+UINTN
+ReadTestFile (
+  IN  CHAR8  *FileName,
+  OUT VOID   *Buffer,
+  IN  UINTN  MaxBufferSize
+  )
+{
+  FILE *f = fopen(FileName, "rb");
+  if (f==NULL) {
+    fputs ("File error",stderr);
+    exit (1);
+  }
+  fseek(f, 0, SEEK_END);
+
+  UINTN fsize = ftell(f);
+  rewind(f);
+
+  fsize = fsize > MaxBufferSize ? MaxBufferSize : fsize;
+  size_t bytes_read = fread((void *)Buffer, 1, fsize, f);
+  if ((UINTN)bytes_read!=fsize) {
+    fputs ("File error",stderr);
+    exit (1);
+  }
+  fclose(f);
+  return fsize;
+}
+
+#ifdef TEST_WITH_KLEE
+//
+// Make only the symbolic regions of the harness symbolic, over the concrete
+// bytes of the seed file, or zero without seed. The symbolic objects are
+// named after their place in the input, so TransferKtestToSeed.py can put a
+// .ktest back into the same seed.
+//
+BOOLEAN
+MakeHarnessRegionsSymbolic (
+  IN  CHAR8  *SeedFileName  OPTIONAL,
+  IN  VOID   *Buffer,
+  IN  UINTN  MaxBufferSize,
+  OUT UINTN  *BufferSize
+  )
+{
+  CONST HARNESS_SYMBOLIC_REGION  *Regions;
+  UINTN                          RegionCount;
+  UINT8                          *Window;
+  UINT64                         Value;
+  UINTN                          Size;
+  CHAR8                          Name[32];
+
+  RegionCount = GetHarnessSymbolicRegions (&Regions);
+  if (RegionCount == 0) {
+    return FALSE;
+  }
+
+  ZeroMem (Buffer, MaxBufferSize);
+  *BufferSize = MaxBufferSize;
+  if (SeedFileName != NULL) {
+    *BufferSize = ReadTestFile (SeedFileName, Buffer, MaxBufferSize);
+  }
+
+  for (; RegionCount != 0; Regions++, RegionCount--) {
+    switch (Regions->Type) {
+    case HarnessSymbolicBytes:
+      if (Regions->Length == 0 || Regions->Offset > MaxBufferSize ||
+          Regions->Length > MaxBufferSize - Regions->Offset) {
+        break;
+      }
+      //
+      // klee_make_symbolic() takes a whole memory object, so the window is
+      // made symbolic on its own and copied in.
+      //
+      Window = malloc (Regions->Length);
+      snprintf (Name, sizeof (Name), "Buffer@0x%x", Regions->Offset);
+      klee_make_symbolic (Window, Regions->Length, Name);
+      CopyMem ((UINT8 *)Buffer + Regions->Offset, Window, Regions->Length);
+      free (Window);
+      break;
+
+    case HarnessSymbolicField:
+      if (Regions->Length == 0 || Regions->Length > sizeof (Value) ||
+          Regions->Offset > MaxBufferSize || Regions->Length > MaxBufferSize - Regions->Offset) {
+        break;
+      }
+      snprintf (Name, sizeof (Name), "Field@0x%x:%u", Regions->Offset, Regions->Length);
+      klee_make_symbolic (&Value, sizeof (Value), Name);
+      klee_assume ((Value >= Regions->Min) & (Value <= Regions->Max));
+      CopyMem ((UINT8 *)Buffer + Regions->Offset, &Value, Regions->Length);
+      break;
+
+    case HarnessSymbolicInputSize:
+      klee_make_symbolic (&Size, sizeof (Size), "BufferSize");
+      klee_assume ((Size >= Regions->Min) & (Size <= Regions->Max) & (Size <= MaxBufferSize));
+      *BufferSize = Size;
+      break;
+
+    default:
+      break;
+    }
+  }
+  return TRUE;
+}
+#endif
+
 VOID
 InitTestBuffer (
   int argc,
@@ -80,7 +305,11 @@ InitTestBuffer (
 
   // 3. Initialize TestBuffer
 #ifdef TEST_WITH_KLEE
-  // 3.1 For test with KLEE: write symbolic values to TestBuffer
+  // 3.1 For test with KLEE: write symbolic values to TestBuffer, or only to
+  //     the symbolic regions of the harness over an optional seed file
+  if (MakeHarnessRegionsSymbolic (argc >= 2 ? argv[1] : NULL, Buffer, MaxBufferSize, BufferSize)) {
+    return;
+  }
   klee_make_symbolic((UINT8 *)Buffer, MaxBufferSize, "Buffer");
   return;
 #endif
@@ -91,29 +320,8 @@ InitTestBuffer (
     printf ("error - missing input file\n");
     exit(1);
   }
-  CHAR8 *FileName = argv[1];
+  *BufferSize = ReadTestFile (argv[1], Buffer, MaxBufferSize);
 
-  FILE *f = fopen(FileName, "rb");
-  if (f==NULL) {
-    fputs ("File error",stderr);
-    exit (1);
-  }
-  fseek(f, 0, SEEK_END);
-
-  UINTN fsize = ftell(f);
-  rewind(f);
-
-  fsize = fsize > MaxBufferSize ? MaxBufferSize : fsize;
-  size_t bytes_read = fread((void *)Buffer, 1, fsize, f);
-  if ((UINTN)bytes_read!=fsize) {
-    fputs ("File error",stderr);
-    exit (1);
-  }
-  fclose(f);
-  if (BufferSize != NULL) {
-    *BufferSize = fsize;
-  }
-  
   // 3.3 For ErrorInjection: read instrument profile for initialization
 #ifdef TEST_WITH_INSTRUMENT
   if (argc >= 3) {
@@ -123,6 +331,40 @@ InitTestBuffer (
 }
 
 #ifdef TEST_WITH_LIBFUZZER
+size_t LLVMFuzzerMutate(uint8_t *Data, size_t Size, size_t MaxSize);
+
+//
+// -1 until the first mutation, then whether the harness (or
+// CUSTOM_MUTATOR_FORMAT_ENV) selected a CustomMutatorLib format.
+//
+STATIC INTN  mHarnessMutatorEnabled = -1;
+
+//
+// Alternate between the structure-aware mutators of CustomMutatorLib and the
+// generic libFuzzer mutations. Generic mutations are followed by a fixup of
+// checksums and sizes, so they are not thrown away by the first sanity check.
+// Harnesses without SetHarnessMutatorFormat() only get generic mutations.
+//
+size_t LLVMFuzzerCustomMutator(uint8_t *Data, size_t Size, size_t MaxSize, unsigned int Seed) {
+  UINTN                  NewSize;
+
+  if (mHarnessMutatorEnabled < 0) {
+    mHarnessMutatorEnabled = SetHarnessMutatorFormat () ? 1 : 0;
+  }
+  if (mHarnessMutatorEnabled == 0) {
+    return LLVMFuzzerMutate (Data, Size, MaxSize);
+  }
+  if ((Seed & 1) == 0) {
+    NewSize = CustomMutatorMutate (Data, Size, MaxSize, Seed >> 1);
+    if (NewSize != 0) {
+      return NewSize;
+    }
+  }
+  Size = LLVMFuzzerMutate (Data, Size, MaxSize);
+  CustomMutatorFixup (Data, Size);
+  return Size;
+}
+
 int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
   VOID                   *TestBuffer;
   UINTN                  MaxBufferSize;
@@ -134,8 +376,9 @@ int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size) {
     Size = MaxBufferSize;
   }
   CopyMem (TestBuffer, Data, Size);
+  ApplyHarnessFixupRules (TestBuffer, Size);
   // 2. Run test
-  RunTestHarness(TestBuffer, Size);
+  RunTestHarnessOnVirtualClock (TestBuffer, Size);
   // 3. Clean up
   FreePool (TestBuffer);
   return 0;
@@ -153,8 +396,9 @@ int LLVMFuzzerTestOneInput(const wint_t *Data, size_t Size) {
     Size = MaxBufferSize;
   }
   CopyMem (TestBuffer, Data, Size);
+  ApplyHarnessFixupRules (TestBuffer, Size);
   // 2. Run test
-  RunTestHarness(TestBuffer, Size);
+  RunTestHarnessOnVirtualClock (TestBuffer, Size);
   // 3. Clean up
   FreePool (TestBuffer);
   return 0;
@@ -165,10 +409,16 @@ int main(int argc, char **argv)
   VOID                   *TestBuffer;
   UINTN                  TestBufferSize;
 
+  // 0. Dump fixup rules for the AFL++ post-processor
+  if (argc == 3 && strcmp (argv[1], HARNESS_FIXUP_DUMP_OPTION) == 0) {
+    DumpHarnessFixupRules (argv[2]);
+    return 0;
+  }
   // 1. Initialize TestBuffer
   InitTestBuffer (argc, argv, GetMaxBufferSize(), &TestBuffer, &TestBufferSize);
+  ApplyHarnessFixupRules (TestBuffer, TestBufferSize);
   // 2. Run test
-  RunTestHarness(TestBuffer, TestBufferSize);
+  RunTestHarnessOnVirtualClock (TestBuffer, TestBufferSize);
   // 3. Clean up
   FreePool (TestBuffer);
   return 0;
@@ -0,0 +1,85 @@
+/** @file
+  Comparison operand logging for host based fuzzing.
+
+  The CMPLOG builds of BaseLibHost and BaseMemoryLibHost report the operands
+  of CompareMem, CompareGuid, StrCmp and AsciiStrCmp here, so the fuzzer can
+  learn the GUIDs and signatures that gate the code under test.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _CMP_LOG_LIB_H_
+#define _CMP_LOG_LIB_H_
+
+//
+// File the operands are appended to, in AFL/libFuzzer dictionary format.
+//
+#define CMP_LOG_DICT_ENV  "HBFA_CMPLOG_DICT"
+
+#if defined(_MSC_VER)
+VOID * _ReturnAddress (VOID);
+#pragma intrinsic(_ReturnAddress)
+#define CMP_LOG_CALLER_PC()  _ReturnAddress ()
+#else
+#define CMP_LOG_CALLER_PC()  __builtin_return_address (0)
+#endif
+
+/**
+  Log the operands of a memory comparison.
+
+  @param[in] CallerPc  Return address of the comparison function.
+  @param[in] Buffer1   The first operand.
+  @param[in] Buffer2   The second operand.
+  @param[in] Length    The number of bytes compared.
+  @param[in] Result    The result of the comparison.
+
+**/
+VOID
+EFIAPI
+CmpLogMemory (
+  IN VOID        *CallerPc,
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2,
+  IN UINTN       Length,
+  IN INTN        Result
+  );
+
+/**
+  Log the operands of a Null-terminated ASCII string comparison.
+
+  @param[in] CallerPc      Return address of the comparison function.
+  @param[in] FirstString   The first operand.
+  @param[in] SecondString  The second operand.
+  @param[in] Result        The result of the comparison.
+
+**/
+VOID
+EFIAPI
+CmpLogAsciiString (
+  IN VOID         *CallerPc,
+  IN CONST CHAR8  *FirstString,
+  IN CONST CHAR8  *SecondString,
+  IN INTN         Result
+  );
+
+/**
+  Log the operands of a Null-terminated Unicode string comparison.
+
+  @param[in] CallerPc      Return address of the comparison function.
+  @param[in] FirstString   The first operand.
+  @param[in] SecondString  The second operand.
+  @param[in] Result        The result of the comparison.
+
+**/
+VOID
+EFIAPI
+CmpLogUnicodeString (
+  IN VOID          *CallerPc,
+  IN CONST CHAR16  *FirstString,
+  IN CONST CHAR16  *SecondString,
+  IN INTN          Result
+  );
+
+#endif
@@ -0,0 +1,32 @@
+/** @file
+  Reset of the event and timer queues of UefiBootServicesTableLibHost.
+
+  The host DXE core keeps its timers, pending notifications and event groups
+  for the life of the process. A harness running many inputs in one process
+  resets them between runs, so a timer or event group of one run cannot call
+  into the freed context of a previous run.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _EVENT_QUEUE_LIB_H_
+#define _EVENT_QUEUE_LIB_H_
+
+/**
+  Cancel all timers, drop the pending notifications and remove all events
+  from their event groups, and return to TPL_APPLICATION.
+
+  The events are not freed: a target may still close them. A timer event
+  fires again once its timer is set again, and the events of a group are no
+  longer signaled with the group.
+
+**/
+VOID
+EFIAPI
+EventQueueReset (
+  VOID
+  );
+
+#endif
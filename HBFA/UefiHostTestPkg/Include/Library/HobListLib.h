@@ -0,0 +1,69 @@
+/** @file
+  Preload of the host HOB list of HobLibHost.
+
+  HobLibHost keeps the HOB list in a reserved address range that is committed
+  as the list grows, so the HOBs never move and a target can create as many
+  HOBs as it needs. KLEE builds keep it in a heap buffer instead, which moves
+  when the list grows. The list starts with a PHIT HOB only, or with the HOBs of
+  the image named by the HOB_LIST_IMAGE_ENV environment variable, loaded the
+  first time the list is used. A harness can load another image with the
+  functions below.
+
+  GetNextGuidHob() and GetFirstGuidHob() look GUID HOBs up in an index that
+  is updated with the HOBs appended to the list since the last lookup. A HOB
+  that is turned into a GUID HOB in place is not found through the index.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _HOB_LIST_LIB_H_
+#define _HOB_LIST_LIB_H_
+
+//
+// File name of the HOB list image loaded at startup.
+//
+#define HOB_LIST_IMAGE_ENV  "HBFA_HOB_LIST"
+
+/**
+  Replace the host HOB list with the HOBs of a HOB list image.
+
+  The image starts with a PHIT HOB and ends with an end of HOB list HOB, like
+  the HOB list a PEI core hands off to DXE. The HOBs are copied to the host
+  list and EfiEndOfHobList of the PHIT HOB is set to the copy of the end HOB.
+  Pointers to the HOBs of the previous list are no longer valid HOBs.
+
+  @param[in] Image      The HOB list image.
+  @param[in] ImageSize  The size of the image.
+
+  @retval EFI_SUCCESS            The HOB list is loaded.
+  @retval EFI_INVALID_PARAMETER  Image is NULL.
+  @retval EFI_VOLUME_CORRUPTED   The image is not a valid HOB list.
+  @retval EFI_OUT_OF_RESOURCES   The image does not fit in the host list.
+
+**/
+EFI_STATUS
+EFIAPI
+HobListLoadImage (
+  IN CONST VOID  *Image,
+  IN UINTN       ImageSize
+  );
+
+/**
+  Replace the host HOB list with the HOBs of a HOB list image file.
+
+  @param[in] FileName  The name of the image file.
+
+  @retval EFI_SUCCESS      The HOB list is loaded.
+  @retval EFI_NOT_FOUND    The file cannot be read.
+  @return The status of HobListLoadImage().
+
+**/
+EFI_STATUS
+EFIAPI
+HobListLoadFile (
+  IN CONST CHAR8  *FileName
+  );
+
+#endif
@@ -0,0 +1,200 @@
+/** @file
+  MMIO and I/O port emulation of the host IoLib.
+
+  IoLibHost dispatches every IoLib access through a page table of the
+  ranges registered here, so drivers doing MmioRead32()/IoWrite8() run
+  unmodified in a test harness. A range is either a register file, which may
+  refresh its reads from the fuzz input, or a pair of read/write handlers.
+  Accesses outside every range read as all ones and writes are dropped, like
+  a master abort on real hardware.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _IO_EMULATION_LIB_H_
+#define _IO_EMULATION_LIB_H_
+
+//
+// File every access is logged to, one line per access.
+//
+#define IO_EMULATION_TRACE_ENV  "HBFA_IO_TRACE"
+
+typedef enum {
+  IoEmulationMmio,
+  IoEmulationIo,
+  IoEmulationSpaceMax
+} IO_EMULATION_SPACE;
+
+/**
+  Emulate a read of a handler range.
+
+  @param[in] Context  The context passed to IoEmulationAddHandler().
+  @param[in] Offset   Offset of the access in the range.
+  @param[in] Width    Size of the access in bytes: 1, 2, 4 or 8.
+
+  @return The value read.
+
+**/
+typedef
+UINT64
+(EFIAPI *IO_EMULATION_READ) (
+  IN VOID    *Context,
+  IN UINT64  Offset,
+  IN UINTN   Width
+  );
+
+/**
+  Emulate a write of a handler range.
+
+  @param[in] Context  The context passed to IoEmulationAddHandler().
+  @param[in] Offset   Offset of the access in the range.
+  @param[in] Width    Size of the access in bytes: 1, 2, 4 or 8.
+  @param[in] Value    The value written.
+
+**/
+typedef
+VOID
+(EFIAPI *IO_EMULATION_WRITE) (
+  IN VOID    *Context,
+  IN UINT64  Offset,
+  IN UINTN   Width,
+  IN UINT64  Value
+  );
+
+/**
+  Observe an access.
+
+  @param[in] Space    The address space of the access.
+  @param[in] Write    TRUE for a write, FALSE for a read.
+  @param[in] Address  The MMIO address or I/O port.
+  @param[in] Width    Size of the access in bytes: 1, 2, 4 or 8.
+  @param[in] Value    The value read or written.
+  @param[in] Mapped   FALSE if no range covers the access.
+
+**/
+typedef
+VOID
+(EFIAPI *IO_EMULATION_TRACE) (
+  IN IO_EMULATION_SPACE  Space,
+  IN BOOLEAN             Write,
+  IN UINT64              Address,
+  IN UINTN               Width,
+  IN UINT64              Value,
+  IN BOOLEAN             Mapped
+  );
+
+/**
+  Map a range to a register file.
+
+  Writes store the value in the register file and reads return it. If
+  FromInput is TRUE, every read first refreshes the bytes read from the
+  input set by IoEmulationSetInput(), until the input is exhausted, so the
+  fuzzer controls status registers a driver polls.
+
+  @param[in] Space      The address space of the range.
+  @param[in] Base       The first MMIO address or I/O port of the range.
+  @param[in] Length     The size of the range in bytes.
+  @param[in] Registers  Backing store of Length bytes, NULL to allocate a
+                        zeroed one.
+  @param[in] FromInput  Refresh reads from the fuzz input.
+
+  @retval RETURN_SUCCESS            The range is mapped.
+  @retval RETURN_INVALID_PARAMETER  The range is empty or out of the space.
+  @retval RETURN_OUT_OF_RESOURCES   There is not enough memory.
+
+**/
+RETURN_STATUS
+EFIAPI
+IoEmulationAddRegisters (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Base,
+  IN UINT64              Length,
+  IN VOID                *Registers  OPTIONAL,
+  IN BOOLEAN             FromInput
+  );
+
+/**
+  Map a range to read and write handlers.
+
+  @param[in] Space    The address space of the range.
+  @param[in] Base     The first MMIO address or I/O port of the range.
+  @param[in] Length   The size of the range in bytes.
+  @param[in] Read     Read handler, NULL to read all ones.
+  @param[in] Write    Write handler, NULL to drop writes.
+  @param[in] Context  Passed to the handlers.
+
+  @retval RETURN_SUCCESS            The range is mapped.
+  @retval RETURN_INVALID_PARAMETER  The range is empty or out of the space.
+  @retval RETURN_OUT_OF_RESOURCES   There is not enough memory.
+
+**/
+RETURN_STATUS
+EFIAPI
+IoEmulationAddHandler (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Base,
+  IN UINT64              Length,
+  IN IO_EMULATION_READ   Read     OPTIONAL,
+  IN IO_EMULATION_WRITE  Write    OPTIONAL,
+  IN VOID                *Context OPTIONAL
+  );
+
+/**
+  Set the fuzz input consumed by register files mapped with FromInput.
+
+  The buffer is not copied and must stay valid until the next call or
+  IoEmulationReset().
+
+  @param[in] Buffer  The input, NULL for none.
+  @param[in] Size    The size of the input in bytes.
+
+**/
+VOID
+EFIAPI
+IoEmulationSetInput (
+  IN CONST VOID  *Buffer  OPTIONAL,
+  IN UINTN       Size
+  );
+
+/**
+  Consume bytes of the fuzz input, for handlers.
+
+  @param[out] Buffer  Receives the bytes.
+  @param[in]  Size    The number of bytes wanted.
+
+  @return The number of bytes copied, less than Size if the input is
+          exhausted.
+
+**/
+UINTN
+EFIAPI
+IoEmulationConsumeInput (
+  OUT VOID   *Buffer,
+  IN  UINTN  Size
+  );
+
+/**
+  Set the trace callback. It replaces the trace file of HBFA_IO_TRACE.
+
+  @param[in] Trace  The callback, NULL to stop tracing.
+
+**/
+VOID
+EFIAPI
+IoEmulationSetTrace (
+  IN IO_EMULATION_TRACE  Trace  OPTIONAL
+  );
+
+/**
+  Remove all ranges and the fuzz input, for the next test run.
+
+**/
+VOID
+EFIAPI
+IoEmulationReset (
+  VOID
+  );
+
+#endif
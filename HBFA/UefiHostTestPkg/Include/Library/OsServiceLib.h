@@ -21,4 +21,60 @@ FreeExecutableMemory (
   IN UINTN  Size
   );
 
+/**
+  Reserve a range of the host address space without backing memory.
+
+  The pages of the range cannot be accessed until CommitVirtualMemory()
+  commits them, so a buffer can grow inside the range without moving.
+
+  @param[in] Size  The size of the range, a multiple of the page size.
+
+  @return The start of the range, or NULL if it cannot be reserved.
+**/
+VOID *
+ReserveVirtualMemory (
+  IN UINTN  Size
+  );
+
+/**
+  Commit read/write memory to part of a range reserved with
+  ReserveVirtualMemory(). The committed pages are zero.
+
+  @param[in] Buffer  The start of the pages, page aligned.
+  @param[in] Size    The size of the pages, a multiple of the page size.
+
+  @retval TRUE   The pages are committed.
+  @retval FALSE  The host has no memory for the pages.
+**/
+BOOLEAN
+CommitVirtualMemory (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  );
+
+/**
+  Release a range reserved with ReserveVirtualMemory().
+
+  @param[in] Buffer  The start of the range.
+  @param[in] Size    The size of the range.
+**/
+VOID
+FreeVirtualMemory (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  );
+
+/**
+  Return the time of the monotonic clock of the host.
+
+  BaseTimerLibHost only runs a virtual clock, so benchmarks measure real
+  elapsed time with this one.
+
+  @return Nanoseconds elapsed since an arbitrary point in the past.
+**/
+UINT64
+GetMonotonicTimeInNanoSecond (
+  VOID
+  );
+
 #endif
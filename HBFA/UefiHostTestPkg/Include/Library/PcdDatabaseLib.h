@@ -0,0 +1,52 @@
+/** @file
+  Preload of the dynamic PCDs of BasePcdLibHost.
+
+  LibPcdGet*() and LibPcdSet*S() work on an in-memory PCD database. It starts
+  with the PCDs of the file named by the PCD_DATABASE_ENV environment
+  variable, loaded the first time a PCD is accessed, so the code under test
+  reads the DSC and DEC values of its dynamic PCDs without a harness setting
+  them first.
+
+  UefiHostTestTools/Script/GenPcdDatabase.py generates the file of a test
+  module from its AutoGen files and the DSC and DEC files of the build. Each
+  line is TokenNumber|TokenSpaceGuid|DatumType|Value, for example:
+
+    0x1||UINT64|0xE0000000  # gEfiMdePkgTokenSpaceGuid.PcdPciExpressBaseAddress
+    0x80040000|9EDB214F-55A4-465C-A923-7DF45F545610|VOID*|{0x53, 0x00}
+
+  TokenSpaceGuid is empty for a non-Ex PCD. DatumType is BOOLEAN, UINT8,
+  UINT16, UINT32, UINT64 or VOID*, and the value of a VOID* PCD is a byte list.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PCD_DATABASE_LIB_H_
+#define _PCD_DATABASE_LIB_H_
+
+//
+// File name of the PCD database loaded at startup.
+//
+#define PCD_DATABASE_ENV  "HBFA_PCD_DATABASE"
+
+/**
+  Set the PCDs of a PCD database file.
+
+  A PCD that is already set is updated, and must have the same datum type.
+
+  @param[in] FileName  The name of the PCD database file.
+
+  @retval RETURN_SUCCESS            The PCDs are set.
+  @retval RETURN_NOT_FOUND          The file cannot be read.
+  @retval RETURN_INVALID_PARAMETER  A line of the file is not valid.
+  @retval RETURN_OUT_OF_RESOURCES   There is no memory for the PCDs.
+
+**/
+RETURN_STATUS
+EFIAPI
+PcdDatabaseLoadFile (
+  IN CONST CHAR8  *FileName
+  );
+
+#endif
@@ -0,0 +1,47 @@
+/** @file
+  Registry of the SMI handlers of the host SMM Services Table.
+
+  SmmServicesTableLibHost keeps the handlers registered with
+  gSmst->SmiHandlerRegister() and dispatches them from gSmst->SmiManage() like
+  the SMM core does. The handler types are enumerated in the order they were
+  first registered, so a harness can map its input to the handlers a driver
+  installed from its entry point.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _SMI_HANDLER_REGISTRY_LIB_H_
+#define _SMI_HANDLER_REGISTRY_LIB_H_
+
+/**
+  Return the number of handler types with at least one handler registered.
+
+  Root SMI handlers, registered with a NULL HandlerType, are not counted.
+
+  @return The number of handler types.
+
+**/
+UINTN
+EFIAPI
+SmiHandlerRegistryGetTypeCount (
+  VOID
+  );
+
+/**
+  Return a registered handler type.
+
+  @param[in] Index  The index of the handler type, in registration order.
+
+  @return The handler type, or NULL if Index is not below
+          SmiHandlerRegistryGetTypeCount().
+
+**/
+CONST EFI_GUID *
+EFIAPI
+SmiHandlerRegistryGetType (
+  IN UINTN  Index
+  );
+
+#endif
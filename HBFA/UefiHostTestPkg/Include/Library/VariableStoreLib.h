@@ -0,0 +1,67 @@
+/** @file
+  Preload of the host variable store of UefiRuntimeServicesTableLibHost.
+
+  gRT->GetVariable(), gRT->GetNextVariableName() and gRT->SetVariable() work
+  on an in-memory store. It starts empty, or with the variables of the image
+  named by the VARIABLE_STORE_IMAGE_ENV environment variable, imported the
+  first time the store is used. A harness can import more images with the
+  functions below.
+
+  The image is a variable firmware volume like the OVMF_VARS.fd of an OVMF
+  build, or a bare variable store starting with its VARIABLE_STORE_HEADER.
+  Normal and authenticated stores are accepted.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_STORE_LIB_H_
+#define _VARIABLE_STORE_LIB_H_
+
+//
+// File name of the variable store image imported at startup.
+//
+#define VARIABLE_STORE_IMAGE_ENV  "HBFA_VARIABLE_STORE"
+
+/**
+  Import the variables of a variable store image into the host store.
+
+  The added variables, and the ones in deleted transition that have no added
+  copy in the image, are imported. A variable that is already in the host
+  store is replaced.
+
+  @param[in] Image      The variable store image.
+  @param[in] ImageSize  The size of the image.
+
+  @retval EFI_SUCCESS            The variables are imported.
+  @retval EFI_INVALID_PARAMETER  Image is NULL.
+  @retval EFI_UNSUPPORTED        The store signature is unknown.
+  @retval EFI_VOLUME_CORRUPTED   The store header is not valid.
+  @retval EFI_OUT_OF_RESOURCES   There is no memory for the variables.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableStoreImportImage (
+  IN CONST VOID  *Image,
+  IN UINTN       ImageSize
+  );
+
+/**
+  Import the variables of a variable store image file into the host store.
+
+  @param[in] FileName  The name of the image file.
+
+  @retval EFI_SUCCESS      The variables are imported.
+  @retval EFI_NOT_FOUND    The file cannot be read.
+  @return The status of VariableStoreImportImage().
+
+**/
+EFI_STATUS
+EFIAPI
+VariableStoreImportFile (
+  IN CONST CHAR8  *FileName
+  );
+
+#endif
@@ -0,0 +1,73 @@
+/** @file
+  Simulated monotonic clock of the host TimerLib.
+
+  BaseTimerLibHost does not sleep. MicroSecondDelay(), NanoSecondDelay() and
+  the Stall() boot service advance a virtual clock instead, and the
+  performance counter reads it, so timeout loops finish in a deterministic
+  number of iterations without wasting execution time.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VIRTUAL_CLOCK_LIB_H_
+#define _VIRTUAL_CLOCK_LIB_H_
+
+//
+// Virtual time budget of one test run, in milliseconds.
+//
+#define VIRTUAL_CLOCK_BUDGET_ENV  "HBFA_TIME_BUDGET_MS"
+
+/**
+  Called when the virtual clock goes past the budget of the run.
+
+  The handler may log the state of the run. If it returns, or if no handler
+  is set, the process aborts, so a fuzzer records the input as a hang.
+
+**/
+typedef
+VOID
+(EFIAPI *VIRTUAL_CLOCK_EXPIRED) (
+  VOID
+  );
+
+/**
+  Return the virtual time.
+
+  @return Nanoseconds elapsed since the last VirtualClockReset().
+
+**/
+UINT64
+EFIAPI
+VirtualClockGetTime (
+  VOID
+  );
+
+/**
+  Advance the virtual clock.
+
+  @param[in] NanoSeconds  The time to add.
+
+**/
+VOID
+EFIAPI
+VirtualClockAdvance (
+  IN UINT64  NanoSeconds
+  );
+
+/**
+  Restart the virtual clock from 0.
+
+  @param[in] Budget   Nanoseconds the run may take, 0 for no limit.
+  @param[in] Expired  Handler called when the budget is exhausted.
+
+**/
+VOID
+EFIAPI
+VirtualClockReset (
+  IN UINT64                 Budget,
+  IN VIRTUAL_CLOCK_EXPIRED  Expired  OPTIONAL
+  );
+
+#endif
@@ -10,6 +10,10 @@
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 
+#ifdef TEST_WITH_CMPLOG
+#include <Library/CmpLogLib.h>
+#endif
+
 /**
   Returns the length of a Null-terminated Unicode string.
 
@@ -109,16 +113,28 @@ StrCmp (
   IN      CONST CHAR16              *SecondString
   )
 {
+#ifdef TEST_WITH_CMPLOG
+  CONST CHAR16  *Start1;
+  CONST CHAR16  *Start2;
+#endif
+
   //
   // ASSERT both strings are less long than PcdMaximumUnicodeStringLength
   //
   ASSERT (StrSize (FirstString) != 0);
   ASSERT (StrSize (SecondString) != 0);
 
+#ifdef TEST_WITH_CMPLOG
+  Start1 = FirstString;
+  Start2 = SecondString;
+#endif
   while ((*FirstString != L'\0') && (*FirstString == *SecondString)) {
     FirstString++;
     SecondString++;
   }
+#ifdef TEST_WITH_CMPLOG
+  CmpLogUnicodeString (CMP_LOG_CALLER_PC (), Start1, Start2, *FirstString - *SecondString);
+#endif
   return *FirstString - *SecondString;
 }
 
@@ -689,17 +705,29 @@ AsciiStrCmp (
   IN      CONST CHAR8               *SecondString
   )
 {
+#ifdef TEST_WITH_CMPLOG
+  CONST CHAR8   *Start1;
+  CONST CHAR8   *Start2;
+#endif
+
   //
   // ASSERT both strings are less long than PcdMaximumAsciiStringLength
   //
   ASSERT (AsciiStrSize (FirstString));
   ASSERT (AsciiStrSize (SecondString));
 
+#ifdef TEST_WITH_CMPLOG
+  Start1 = FirstString;
+  Start2 = SecondString;
+#endif
   while ((*FirstString != '\0') && (*FirstString == *SecondString)) {
     FirstString++;
     SecondString++;
   }
 
+#ifdef TEST_WITH_CMPLOG
+  CmpLogAsciiString (CMP_LOG_CALLER_PC (), Start1, Start2, *FirstString - *SecondString);
+#endif
   return *FirstString - *SecondString;
 }
 
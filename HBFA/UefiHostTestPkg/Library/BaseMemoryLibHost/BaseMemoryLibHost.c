@@ -11,6 +11,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <assert.h>
 
 #include <Uefi.h>
+
+#ifdef TEST_WITH_CMPLOG
+#include <Library/CmpLogLib.h>
+#endif
+
 #define MAX_ADDRESS   0xFFFFFFFFFFFFFFFFULL
 VOID *
 EFIAPI
@@ -112,7 +117,15 @@ CompareMem (
   IN UINTN       Length
   )
 {
+#ifdef TEST_WITH_CMPLOG
+  INTN  Result;
+
+  Result = memcmp (DestinationBuffer, SourceBuffer, Length);
+  CmpLogMemory (CMP_LOG_CALLER_PC (), DestinationBuffer, SourceBuffer, Length, Result);
+  return Result;
+#else
   return memcmp (DestinationBuffer, SourceBuffer, Length);
+#endif
 }
 
 BOOLEAN
@@ -122,7 +135,15 @@ CompareGuid (
   IN CONST GUID  *Guid2
   )
 {
+#ifdef TEST_WITH_CMPLOG
+  INTN  Result;
+
+  Result = memcmp (Guid1, Guid2, sizeof (GUID));
+  CmpLogMemory (CMP_LOG_CALLER_PC (), Guid1, Guid2, sizeof (GUID), Result);
+  return ((BOOLEAN)(Result == 0));
+#else
   return ((BOOLEAN)(memcmp (Guid1, Guid2, sizeof (GUID)) == 0));
+#endif
 }
 
 GUID *
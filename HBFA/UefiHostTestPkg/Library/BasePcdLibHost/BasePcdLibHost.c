@@ -8,12 +8,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <Base.h>
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/PcdLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/PcdDatabaseLib.h>
 
 #define PCD_INFO_PRIVATE_SIGNATURE  SIGNATURE_32 ('P', 'I', 'P', 'S')
 
@@ -30,6 +32,7 @@ typedef enum {
 typedef struct {
   UINTN            Signature;
   LIST_ENTRY       Link;
+  LIST_ENTRY       HashLink;
 
   UINTN            TokenNumber;
   GUID             Guid;
@@ -39,10 +42,101 @@ typedef struct {
 } PCD_INFO_PRIVATE;
 
 #define PCD_INFO_PRIVATE_FROM_LINK(a)  CR (a, PCD_INFO_PRIVATE, Link, PCD_INFO_PRIVATE_SIGNATURE)
+#define PCD_INFO_PRIVATE_FROM_HASH_LINK(a)  CR (a, PCD_INFO_PRIVATE, HashLink, PCD_INFO_PRIVATE_SIGNATURE)
+
+//
+// The token numbers of non-Ex PCDs are the local token numbers of the module
+// AutoGen.h, numbered from 1, so they index mPcdTokenTable directly. The rare
+// token number above the table limit is only found in mPcdListEntry.
+// Ex PCDs are hashed by token space GUID and token number.
+//
+#define PCD_TOKEN_TABLE_MIN_SIZE  64
+#define PCD_TOKEN_TABLE_MAX_SIZE  0x10000
+#define PCD_EX_HASH_BUCKETS       256
 
 LIST_ENTRY                  mPcdListEntry = INITIALIZE_LIST_HEAD_VARIABLE(mPcdListEntry);
 LIST_ENTRY                  mPcdExListEntry = INITIALIZE_LIST_HEAD_VARIABLE(mPcdExListEntry);
 
+PCD_INFO_PRIVATE            **mPcdTokenTable;
+UINTN                       mPcdTokenTableSize;
+LIST_ENTRY                  mPcdExHashBuckets[PCD_EX_HASH_BUCKETS];
+BOOLEAN                     mPcdDatabaseInitialized;
+
+/**
+  Initialize the PCD index, and load the PCD database file named by
+  PCD_DATABASE_ENV, the first time a PCD is accessed.
+**/
+VOID
+InitializePcdDatabase (
+  VOID
+  )
+{
+  CHAR8          *FileName;
+  UINTN          Index;
+  RETURN_STATUS  Status;
+
+  mPcdDatabaseInitialized = TRUE;
+  for (Index = 0; Index < PCD_EX_HASH_BUCKETS; Index++) {
+    InitializeListHead (&mPcdExHashBuckets[Index]);
+  }
+
+  FileName = getenv (PCD_DATABASE_ENV);
+  if (FileName == NULL || FileName[0] == 0) {
+    return;
+  }
+  Status = PcdDatabaseLoadFile (FileName);
+  if (RETURN_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Loading PCD database %a - %r\n", FileName, Status));
+  }
+}
+
+/**
+  Return the hash bucket of an Ex PCD.
+
+  @param[in] Guid         The token space GUID.
+  @param[in] TokenNumber  The token number.
+
+  @return The hash bucket.
+**/
+LIST_ENTRY *
+GetPcdExHashBucket (
+  IN CONST GUID       *Guid,
+  IN UINTN            TokenNumber
+  )
+{
+  UINT32  Hash;
+
+  Hash = ReadUnaligned32 ((CONST UINT32 *)Guid) ^ ReadUnaligned32 ((CONST UINT32 *)Guid + 1) ^
+         ReadUnaligned32 ((CONST UINT32 *)Guid + 2) ^ ReadUnaligned32 ((CONST UINT32 *)Guid + 3);
+  Hash = (Hash ^ (Hash >> 16)) * 0x45D9F3B;
+  Hash ^= (UINT32)TokenNumber;
+  Hash ^= Hash >> 8;
+  return &mPcdExHashBuckets[Hash % PCD_EX_HASH_BUCKETS];
+}
+
+/**
+  Check the type of a PCD found in the database.
+
+  @param[in] PcdInfo  The PCD, or NULL.
+  @param[in] Type     The type the caller expects, PcdTypeUnknown for any.
+
+  @return PcdInfo, or NULL if it is not of the expected type.
+**/
+PCD_INFO_PRIVATE *
+CheckPcdType (
+  IN PCD_INFO_PRIVATE *PcdInfo,
+  IN PCD_TYPE_PRIVATE Type
+  )
+{
+  if (PcdInfo != NULL && Type != PcdTypeUnknown) {
+    ASSERT (PcdInfo->Type == Type);
+    if (PcdInfo->Type != Type) {
+      return NULL;
+    }
+  }
+  return PcdInfo;
+}
+
 LIST_ENTRY *
 FindPcdList (
   IN LIST_ENTRY       *StorageListHead,
@@ -82,9 +176,17 @@ FindPcdInfoPtr(
 {
   LIST_ENTRY          *ListEntry;
 
-  //
-  //  Try to get auth variable by name and GUID.
-  //
+  if (!mPcdDatabaseInitialized) {
+    InitializePcdDatabase ();
+  }
+
+  if (TokenNumber < mPcdTokenTableSize) {
+    return CheckPcdType (mPcdTokenTable[TokenNumber], Type);
+  }
+  if (TokenNumber < PCD_TOKEN_TABLE_MAX_SIZE) {
+    return NULL;
+  }
+
   ListEntry = FindPcdList (&mPcdListEntry, NULL, TokenNumber, Type);
   if (ListEntry != NULL) {
     return PCD_INFO_PRIVATE_FROM_LINK (ListEntry);
@@ -101,18 +203,76 @@ FindPcdExInfoPtr(
   )
 {
   LIST_ENTRY          *ListEntry;
+  LIST_ENTRY          *Bucket;
+  PCD_INFO_PRIVATE    *PcdInfo;
 
-  //
-  //  Try to get auth variable by name and GUID.
-  //
-  ListEntry = FindPcdList (&mPcdExListEntry, (GUID *)Guid, TokenNumber, Type);
-  if (ListEntry != NULL) {
-    return PCD_INFO_PRIVATE_FROM_LINK (ListEntry);
+  if (!mPcdDatabaseInitialized) {
+    InitializePcdDatabase ();
+  }
+
+  if (Guid == NULL) {
+    ListEntry = FindPcdList (&mPcdExListEntry, NULL, TokenNumber, Type);
+    if (ListEntry != NULL) {
+      return PCD_INFO_PRIVATE_FROM_LINK (ListEntry);
+    }
+    return NULL;
+  }
+
+  Bucket = GetPcdExHashBucket (Guid, TokenNumber);
+  for (ListEntry = GetFirstNode (Bucket); !IsNull (Bucket, ListEntry); ListEntry = GetNextNode (Bucket, ListEntry)) {
+    PcdInfo = PCD_INFO_PRIVATE_FROM_HASH_LINK (ListEntry);
+    if ((PcdInfo->TokenNumber == TokenNumber) && CompareGuid (&PcdInfo->Guid, Guid)) {
+      return CheckPcdType (PcdInfo, Type);
+    }
   }
 
   return NULL;
 }
 
+/**
+  Make mPcdTokenTable large enough to index a token number.
+
+  @param[in] TokenNumber  The token number, below PCD_TOKEN_TABLE_MAX_SIZE.
+
+  @retval RETURN_SUCCESS            The table indexes TokenNumber.
+  @retval RETURN_OUT_OF_RESOURCES   There is no memory to grow the table.
+**/
+RETURN_STATUS
+GrowPcdTokenTable (
+  IN UINTN            TokenNumber
+  )
+{
+  PCD_INFO_PRIVATE    **NewTable;
+  UINTN               NewSize;
+
+  NewSize = (mPcdTokenTableSize == 0) ? PCD_TOKEN_TABLE_MIN_SIZE : mPcdTokenTableSize;
+  while (NewSize <= TokenNumber) {
+    NewSize *= 2;
+  }
+  NewTable = realloc (mPcdTokenTable, NewSize * sizeof(PCD_INFO_PRIVATE *));
+  if (NewTable == NULL) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+  ZeroMem (&NewTable[mPcdTokenTableSize], (NewSize - mPcdTokenTableSize) * sizeof(PCD_INFO_PRIVATE *));
+  mPcdTokenTable = NewTable;
+  mPcdTokenTableSize = NewSize;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Free a PCD created by CreatePcdInfo() that could not be inserted.
+
+  @param[in] PcdInfo  The PCD.
+**/
+VOID
+FreePcdInfo (
+  IN PCD_INFO_PRIVATE *PcdInfo
+  )
+{
+  free (PcdInfo->Buffer);
+  free (PcdInfo);
+}
+
 RETURN_STATUS
 CreatePcdInfo (
   IN GUID              *Guid,
@@ -229,6 +389,16 @@ InsertPcd (
     return Status;
   }
   if (PcdInfo != NULL) {
+    if (TokenNumber < PCD_TOKEN_TABLE_MAX_SIZE) {
+      if (TokenNumber >= mPcdTokenTableSize) {
+        Status = GrowPcdTokenTable (TokenNumber);
+        if (RETURN_ERROR (Status)) {
+          FreePcdInfo (PcdInfo);
+          return Status;
+        }
+      }
+      mPcdTokenTable[TokenNumber] = PcdInfo;
+    }
     InsertTailList(&mPcdListEntry, &PcdInfo->Link);
   }
 
@@ -254,11 +424,263 @@ InsertPcdEx (
   }
   if (PcdInfo != NULL) {
     InsertTailList(&mPcdExListEntry, &PcdInfo->Link);
+    if (Guid != NULL) {
+      InsertTailList(GetPcdExHashBucket (Guid, TokenNumber), &PcdInfo->HashLink);
+    }
   }
 
   return RETURN_SUCCESS;
 }
 
+/**
+  Trim the blanks around a field of a PCD database entry.
+
+  @param[in] Field  The field.
+
+  @return The trimmed field.
+**/
+CHAR8 *
+TrimPcdDatabaseField (
+  IN CHAR8            *Field
+  )
+{
+  CHAR8               *End;
+
+  while (*Field == ' ' || *Field == '\t') {
+    Field++;
+  }
+  End = Field + strlen (Field);
+  while (End > Field && (End[-1] == ' ' || End[-1] == '\t' || End[-1] == '\r')) {
+    End--;
+  }
+  *End = 0;
+  return Field;
+}
+
+/**
+  Parse the value of a PCD database entry.
+
+  @param[in]  Type    The datum type of the PCD.
+  @param[in]  Text    The value, a number or a {0x00, 0x01} byte list for VOID*.
+  @param[out] Buffer  The value. It is at least strlen(Text) + 8 bytes.
+  @param[out] Size    The size of the value.
+
+  @retval TRUE   The value is valid.
+  @retval FALSE  The value is not valid.
+**/
+BOOLEAN
+ParsePcdDatabaseValue (
+  IN  PCD_TYPE_PRIVATE Type,
+  IN  CHAR8            *Text,
+  OUT UINT8            *Buffer,
+  OUT UINTN            *Size
+  )
+{
+  UINT64  Value;
+  CHAR8   *End;
+
+  if (Type != PcdTypePtr) {
+    Value = strtoull (Text, &End, 0);
+    if (End == Text || *End != 0) {
+      return FALSE;
+    }
+    switch (Type) {
+    case PcdTypeBool:
+      *Buffer = (Value != 0);
+      *Size = sizeof(BOOLEAN);
+      break;
+    case PcdTypeUint8:
+      *Buffer = (UINT8)Value;
+      *Size = sizeof(UINT8);
+      break;
+    case PcdTypeUint16:
+      WriteUnaligned16 ((UINT16 *)Buffer, (UINT16)Value);
+      *Size = sizeof(UINT16);
+      break;
+    case PcdTypeUint32:
+      WriteUnaligned32 ((UINT32 *)Buffer, (UINT32)Value);
+      *Size = sizeof(UINT32);
+      break;
+    default:
+      WriteUnaligned64 ((UINT64 *)Buffer, Value);
+      *Size = sizeof(UINT64);
+      break;
+    }
+    return TRUE;
+  }
+
+  if (*Text != '{') {
+    return FALSE;
+  }
+  Text++;
+  *Size = 0;
+  while (TRUE) {
+    Value = strtoull (Text, &End, 0);
+    if (End == Text || Value > MAX_UINT8) {
+      return FALSE;
+    }
+    Buffer[(*Size)++] = (UINT8)Value;
+    Text = End;
+    while (*Text == ' ' || *Text == '\t') {
+      Text++;
+    }
+    if (*Text == '}') {
+      break;
+    }
+    if (*Text != ',') {
+      return FALSE;
+    }
+    Text++;
+  }
+  return (BOOLEAN)(Text[1] == 0);
+}
+
+/**
+  Set the PCDs of a PCD database file, as generated for a test module by
+  UefiHostTestTools/Script/GenPcdDatabase.py.
+
+  Each line is TokenNumber|TokenSpaceGuid|DatumType|Value. TokenSpaceGuid is
+  empty for a non-Ex PCD. Text after # is a comment.
+
+  @param[in] FileName  The name of the PCD database file.
+
+  @retval RETURN_SUCCESS            The PCDs are set.
+  @retval RETURN_NOT_FOUND          The file cannot be read.
+  @retval RETURN_INVALID_PARAMETER  A line of the file is not valid.
+  @retval RETURN_OUT_OF_RESOURCES   There is no memory for the PCDs.
+**/
+RETURN_STATUS
+EFIAPI
+PcdDatabaseLoadFile (
+  IN CONST CHAR8  *FileName
+  )
+{
+  FILE              *File;
+  CHAR8             *Content;
+  UINT8             *Value;
+  long              FileSize;
+  CHAR8             *Line;
+  CHAR8             *NextLine;
+  CHAR8             *Field[4];
+  UINTN             FieldCount;
+  UINTN             LineNumber;
+  CHAR8             *End;
+  UINTN             TokenNumber;
+  GUID              Guid;
+  PCD_TYPE_PRIVATE  Type;
+  UINTN             Size;
+  UINTN             Index;
+  RETURN_STATUS     Status;
+
+  if (!mPcdDatabaseInitialized) {
+    InitializePcdDatabase ();
+  }
+
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    return RETURN_NOT_FOUND;
+  }
+  Content = NULL;
+  FileSize = -1;
+  if (fseek (File, 0, SEEK_END) == 0) {
+    FileSize = ftell (File);
+  }
+  if (FileSize >= 0 && fseek (File, 0, SEEK_SET) == 0) {
+    Content = malloc (FileSize + 1);
+  }
+  if (Content == NULL || fread (Content, 1, FileSize, File) != (size_t)FileSize) {
+    free (Content);
+    fclose (File);
+    return (FileSize < 0) ? RETURN_NOT_FOUND : RETURN_OUT_OF_RESOURCES;
+  }
+  fclose (File);
+  Content[FileSize] = 0;
+
+  //
+  // A value is never longer than its text in the file.
+  //
+  Value = malloc (FileSize + sizeof(UINT64));
+  if (Value == NULL) {
+    free (Content);
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  Status = RETURN_SUCCESS;
+  LineNumber = 0;
+  for (Line = Content; Line != NULL && !RETURN_ERROR (Status); Line = NextLine) {
+    LineNumber++;
+    NextLine = strchr (Line, '\n');
+    if (NextLine != NULL) {
+      *NextLine++ = 0;
+    }
+    End = strchr (Line, '#');
+    if (End != NULL) {
+      *End = 0;
+    }
+
+    FieldCount = 0;
+    Field[FieldCount++] = Line;
+    for (End = Line; *End != 0; End++) {
+      if (*End == '|') {
+        *End = 0;
+        if (FieldCount < ARRAY_SIZE (Field)) {
+          Field[FieldCount] = End + 1;
+        }
+        FieldCount++;
+      }
+    }
+    for (Index = 0; Index < MIN (FieldCount, ARRAY_SIZE (Field)); Index++) {
+      Field[Index] = TrimPcdDatabaseField (Field[Index]);
+    }
+    if (FieldCount == 1 && Field[0][0] == 0) {
+      continue;
+    }
+
+    Status = RETURN_INVALID_PARAMETER;
+    if (FieldCount != ARRAY_SIZE (Field)) {
+      break;
+    }
+    TokenNumber = (UINTN)strtoull (Field[0], &End, 0);
+    if (End == Field[0] || *End != 0) {
+      break;
+    }
+    if (Field[1][0] != 0 && RETURN_ERROR (AsciiStrToGuid (Field[1], &Guid))) {
+      break;
+    }
+    if (strcmp (Field[2], "BOOLEAN") == 0) {
+      Type = PcdTypeBool;
+    } else if (strcmp (Field[2], "UINT8") == 0) {
+      Type = PcdTypeUint8;
+    } else if (strcmp (Field[2], "UINT16") == 0) {
+      Type = PcdTypeUint16;
+    } else if (strcmp (Field[2], "UINT32") == 0) {
+      Type = PcdTypeUint32;
+    } else if (strcmp (Field[2], "UINT64") == 0) {
+      Type = PcdTypeUint64;
+    } else if (strcmp (Field[2], "VOID*") == 0) {
+      Type = PcdTypePtr;
+    } else {
+      break;
+    }
+    if (!ParsePcdDatabaseValue (Type, Field[3], Value, &Size)) {
+      break;
+    }
+
+    if (Field[1][0] == 0) {
+      Status = InsertPcd (TokenNumber, Type, Value, Size);
+    } else {
+      Status = InsertPcdEx (&Guid, TokenNumber, Type, Value, Size);
+    }
+  }
+
+  if (RETURN_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a(%d): PCD database entry is not valid\n", FileName, LineNumber));
+  }
+  free (Value);
+  free (Content);
+  return Status;
+}
+
 /**
   This function provides a means by which SKU support can be established in the PCD infrastructure.
 
@@ -5,9 +5,93 @@
 
 **/
 
+#include <stdlib.h>
+
 #include <Base.h>
 #include <Library/TimerLib.h>
 #include <Library/DebugLib.h>
+#include <Library/VirtualClockLib.h>
+
+//
+// The performance counter runs at 1GHz on the virtual clock.
+//
+#define VIRTUAL_CLOCK_FREQUENCY  1000000000ull
+
+//
+// Time a read of the performance counter takes, so loops polling
+// GetPerformanceCounter() without any delay still time out.
+//
+#define VIRTUAL_CLOCK_READ_COST  1000
+
+UINT64                 mVirtualTime;
+UINT64                 mVirtualTimeBudget;
+VIRTUAL_CLOCK_EXPIRED  mVirtualClockExpired;
+
+/**
+  Return the virtual time.
+
+  @return Nanoseconds elapsed since the last VirtualClockReset().
+
+**/
+UINT64
+EFIAPI
+VirtualClockGetTime (
+  VOID
+  )
+{
+  return mVirtualTime;
+}
+
+/**
+  Advance the virtual clock.
+
+  @param[in] NanoSeconds  The time to add.
+
+**/
+VOID
+EFIAPI
+VirtualClockAdvance (
+  IN UINT64  NanoSeconds
+  )
+{
+  if (mVirtualTime > MAX_UINT64 - NanoSeconds) {
+    mVirtualTime = MAX_UINT64;
+  } else {
+    mVirtualTime += NanoSeconds;
+  }
+
+  if (mVirtualTimeBudget != 0 && mVirtualTime > mVirtualTimeBudget) {
+    DEBUG ((DEBUG_ERROR, "Virtual time budget of %ld ns exhausted\n", mVirtualTimeBudget));
+    mVirtualTimeBudget = 0;
+    if (mVirtualClockExpired != NULL) {
+      mVirtualClockExpired ();
+    }
+    //
+    // A run past its budget is a hang. Abort rather than exit(0), so the
+    // fuzzer does not take it for a clean run.
+    //
+    abort ();
+  }
+}
+
+/**
+  Restart the virtual clock from 0.
+
+  @param[in] Budget   Nanoseconds the run may take, 0 for no limit.
+  @param[in] Expired  Handler called when the budget is exhausted.
+
+**/
+VOID
+EFIAPI
+VirtualClockReset (
+  IN UINT64                 Budget,
+  IN VIRTUAL_CLOCK_EXPIRED  Expired  OPTIONAL
+  )
+{
+  mVirtualTime = 0;
+  mVirtualTimeBudget = Budget;
+  mVirtualClockExpired = Expired;
+}
 
 /**
   Stalls the CPU for at least the given number of microseconds.
@@ -25,6 +109,7 @@ MicroSecondDelay (
   IN      UINTN                     MicroSeconds
   )
 {
+  VirtualClockAdvance ((UINT64)MicroSeconds * 1000);
   return MicroSeconds;
 }
 
@@ -44,7 +129,8 @@ NanoSecondDelay (
   IN      UINTN                     NanoSeconds
   )
 {
-  return 0;
+  VirtualClockAdvance (NanoSeconds);
+  return NanoSeconds;
 }
 
 /**
@@ -64,7 +150,8 @@ GetPerformanceCounter (
   VOID
   )
 {
-  return 0;
+  VirtualClockAdvance (VIRTUAL_CLOCK_READ_COST);
+  return mVirtualTime;
 }
 
 /**
@@ -97,7 +184,13 @@ GetPerformanceCounterProperties (
   OUT      UINT64                    *EndValue     OPTIONAL
   )
 {
-  return (UINT64)(-1);
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+  if (EndValue != NULL) {
+    *EndValue = MAX_UINT64;
+  }
+  return VIRTUAL_CLOCK_FREQUENCY;
 }
 
 /**
@@ -117,5 +210,5 @@ GetTimeInNanoSecond (
   IN      UINT64                     Ticks
   )
 {
-  return 0;
+  return Ticks;
 }
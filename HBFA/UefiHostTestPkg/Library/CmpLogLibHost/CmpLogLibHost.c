@@ -0,0 +1,283 @@
+/** @file
+  Comparison operand logging for host based fuzzing.
+
+  Every comparison is forwarded to the sanitizer comparison hooks, which
+  libFuzzer implements to feed its table of recent compares. AFL has no such
+  hook, so if HBFA_CMPLOG_DICT is set, the constant operand of a failed
+  comparison is also appended to that file as an AFL/libFuzzer dictionary
+  entry. On Linux an operand is constant if it lies in the image of the test
+  module, while the other one does not (heap or stack data from the input).
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Uefi.h>
+
+#include <Library/CmpLogLib.h>
+
+#define CMP_LOG_MIN_TOKEN   2
+#define CMP_LOG_MAX_TOKEN   128
+#define CMP_LOG_MAX_ENTRIES 1024
+#define CMP_LOG_HASH_SIZE   (CMP_LOG_MAX_ENTRIES * 2)
+
+#if defined(__GNUC__)
+void __sanitizer_weak_hook_memcmp (void *caller_pc, const void *s1, const void *s2, size_t n, int result) __attribute__((weak));
+void __sanitizer_weak_hook_strcmp (void *caller_pc, const char *s1, const char *s2, int result) __attribute__((weak));
+#endif
+
+#if defined(__linux__)
+//
+// Provided by the default GNU ld linker script.
+//
+extern CHAR8  __executable_start[];
+extern CHAR8  _end[];
+#endif
+
+typedef enum {
+  CmpLogUninitialized,
+  CmpLogEnabled,
+  CmpLogDisabled
+} CMP_LOG_STATE;
+
+CMP_LOG_STATE  mCmpLogState = CmpLogUninitialized;
+FILE           *mCmpLogFile;
+UINT32         mCmpLogHash[CMP_LOG_HASH_SIZE];
+UINTN          mCmpLogCount;
+
+BOOLEAN
+CmpLogOpen (
+  VOID
+  )
+{
+  CHAR8  *FileName;
+
+  if (mCmpLogState == CmpLogUninitialized) {
+    mCmpLogState = CmpLogDisabled;
+    FileName = getenv (CMP_LOG_DICT_ENV);
+    if (FileName != NULL && FileName[0] != '\0') {
+      mCmpLogFile = fopen (FileName, "a");
+      if (mCmpLogFile != NULL) {
+        mCmpLogState = CmpLogEnabled;
+      }
+    }
+  }
+  return (BOOLEAN)(mCmpLogState == CmpLogEnabled);
+}
+
+/**
+  Check if a buffer is part of the test module image.
+
+  @retval TRUE   The buffer is static data of the image.
+  @retval FALSE  The buffer is heap or stack data, or the image range is
+                 unknown.
+
+**/
+BOOLEAN
+CmpLogIsImageData (
+  IN CONST VOID  *Buffer
+  )
+{
+#if defined(__linux__)
+  return (BOOLEAN)((CONST CHAR8 *)Buffer >= __executable_start && (CONST CHAR8 *)Buffer < _end);
+#else
+  return FALSE;
+#endif
+}
+
+BOOLEAN
+CmpLogIsImageRangeKnown (
+  VOID
+  )
+{
+#if defined(__linux__)
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+/**
+  Remember a token.
+
+  @retval TRUE   The token is new.
+  @retval FALSE  The token was logged before, or the table is full.
+
+**/
+BOOLEAN
+CmpLogInsert (
+  IN CONST UINT8  *Token,
+  IN UINTN        Length
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+  UINTN   Slot;
+
+  if (mCmpLogCount >= CMP_LOG_MAX_ENTRIES) {
+    return FALSE;
+  }
+
+  //
+  // FNV-1a, 0 marks a free slot.
+  //
+  Hash = 2166136261u;
+  for (Index = 0; Index < Length; Index++) {
+    Hash = (Hash ^ Token[Index]) * 16777619u;
+  }
+  if (Hash == 0) {
+    Hash = 1;
+  }
+
+  for (Slot = Hash % CMP_LOG_HASH_SIZE; mCmpLogHash[Slot] != 0; Slot = (Slot + 1) % CMP_LOG_HASH_SIZE) {
+    if (mCmpLogHash[Slot] == Hash) {
+      return FALSE;
+    }
+  }
+  mCmpLogHash[Slot] = Hash;
+  mCmpLogCount++;
+  return TRUE;
+}
+
+VOID
+CmpLogWriteToken (
+  IN CONST UINT8  *Token,
+  IN UINTN        Length
+  )
+{
+  UINTN  Index;
+
+  if (Length < CMP_LOG_MIN_TOKEN) {
+    return;
+  }
+  if (Length > CMP_LOG_MAX_TOKEN) {
+    Length = CMP_LOG_MAX_TOKEN;
+  }
+  if (!CmpLogInsert (Token, Length)) {
+    return;
+  }
+
+  fputs ("\"", mCmpLogFile);
+  for (Index = 0; Index < Length; Index++) {
+    if (Token[Index] >= 0x20 && Token[Index] < 0x7F && Token[Index] != '"' && Token[Index] != '\\') {
+      fputc (Token[Index], mCmpLogFile);
+    } else {
+      fprintf (mCmpLogFile, "\\x%02X", Token[Index]);
+    }
+  }
+  fputs ("\"\n", mCmpLogFile);
+  fflush (mCmpLogFile);
+}
+
+VOID
+CmpLogRecord (
+  IN CONST VOID  *Buffer1,
+  IN UINTN       Length1,
+  IN CONST VOID  *Buffer2,
+  IN UINTN       Length2
+  )
+{
+  BOOLEAN  Static1;
+  BOOLEAN  Static2;
+
+  if (!CmpLogOpen ()) {
+    return;
+  }
+
+  if (!CmpLogIsImageRangeKnown ()) {
+    CmpLogWriteToken (Buffer1, Length1);
+    CmpLogWriteToken (Buffer2, Length2);
+    return;
+  }
+
+  Static1 = CmpLogIsImageData (Buffer1);
+  Static2 = CmpLogIsImageData (Buffer2);
+  if (Static1 && !Static2) {
+    CmpLogWriteToken (Buffer1, Length1);
+  } else if (Static2 && !Static1) {
+    CmpLogWriteToken (Buffer2, Length2);
+  }
+}
+
+VOID
+EFIAPI
+CmpLogMemory (
+  IN VOID        *CallerPc,
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2,
+  IN UINTN       Length,
+  IN INTN        Result
+  )
+{
+#if defined(__GNUC__)
+  if (__sanitizer_weak_hook_memcmp != NULL) {
+    __sanitizer_weak_hook_memcmp (CallerPc, Buffer1, Buffer2, Length, (int)Result);
+  }
+#endif
+  if (Result != 0) {
+    CmpLogRecord (Buffer1, Length, Buffer2, Length);
+  }
+}
+
+VOID
+EFIAPI
+CmpLogAsciiString (
+  IN VOID         *CallerPc,
+  IN CONST CHAR8  *FirstString,
+  IN CONST CHAR8  *SecondString,
+  IN INTN         Result
+  )
+{
+#if defined(__GNUC__)
+  if (__sanitizer_weak_hook_strcmp != NULL) {
+    __sanitizer_weak_hook_strcmp (CallerPc, FirstString, SecondString, (int)Result);
+  }
+#endif
+  if (Result != 0) {
+    CmpLogRecord (FirstString, strlen (FirstString), SecondString, strlen (SecondString));
+  }
+}
+
+UINTN
+CmpLogUnicodeStrLen (
+  IN CONST CHAR16  *String
+  )
+{
+  UINTN  Length;
+
+  for (Length = 0; String[Length] != L'\0'; Length++) {
+  }
+  return Length;
+}
+
+VOID
+EFIAPI
+CmpLogUnicodeString (
+  IN VOID          *CallerPc,
+  IN CONST CHAR16  *FirstString,
+  IN CONST CHAR16  *SecondString,
+  IN INTN          Result
+  )
+{
+  UINTN  Length1;
+  UINTN  Length2;
+
+  Length1 = CmpLogUnicodeStrLen (FirstString) * sizeof (CHAR16);
+  Length2 = CmpLogUnicodeStrLen (SecondString) * sizeof (CHAR16);
+#if defined(__GNUC__)
+  //
+  // There is no hook for wide strings, report the common length as memory.
+  //
+  if (__sanitizer_weak_hook_memcmp != NULL) {
+    __sanitizer_weak_hook_memcmp (CallerPc, FirstString, SecondString, Length1 < Length2 ? Length1 : Length2, (int)Result);
+  }
+#endif
+  if (Result != 0) {
+    CmpLogRecord (FirstString, Length1, SecondString, Length2);
+  }
+}
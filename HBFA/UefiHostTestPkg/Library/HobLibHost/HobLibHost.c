@@ -14,9 +14,274 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/HobLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include <Library/OsServiceLib.h>
+#include <Library/HobListLib.h>
+
+//
+// The HOB list lives in a reserved address range that is committed in
+// HOB_LIST_COMMIT_SIZE steps as it grows, so the HOBs never move.
+//
+// KLEE does not model mmap() and mprotect(): with TEST_WITH_KLEE the HOB list
+// is a heap buffer reallocated in HOB_LIST_COMMIT_SIZE steps instead. It may
+// move when it grows, so HOB pointers taken before a HOB is built are stale.
+//
+#define HOB_LIST_RESERVED_SIZE  SIZE_64MB
+#define HOB_LIST_COMMIT_SIZE    SIZE_64KB
+
+#define HOB_GUID_INDEX_BUCKETS  64
+
+//
+// Offsets of the GUID HOBs with one name, in HOB list order.
+//
+typedef struct {
+  LIST_ENTRY  Link;
+  EFI_GUID    Name;
+  UINTN       Count;
+  UINTN       Capacity;
+  UINTN       *Offset;
+} HOB_GUID_INDEX_ENTRY;
 
 VOID *gHobPointer;
 
+UINTN       mHobListCommittedSize;
+LIST_ENTRY  mHobGuidIndex[HOB_GUID_INDEX_BUCKETS];
+//
+// Offset of the first HOB not yet in mHobGuidIndex.
+//
+UINTN       mHobGuidIndexedSize;
+
+/**
+  Commit the host HOB list up to a size.
+
+  @param  Size          The size the HOB list needs.
+
+  @retval TRUE          The HOB list is committed up to Size.
+  @retval FALSE         Size is beyond the reserved range, or the host has no memory.
+
+**/
+BOOLEAN
+CommitHobList (
+  IN UINTN                  Size
+  )
+{
+  UINTN                       NewSize;
+#ifdef TEST_WITH_KLEE
+  UINT8                       *NewList;
+  EFI_HOB_HANDOFF_INFO_TABLE  *HandOffHob;
+#endif
+
+  if (Size <= mHobListCommittedSize) {
+    return TRUE;
+  }
+  if (Size > HOB_LIST_RESERVED_SIZE) {
+    return FALSE;
+  }
+
+  NewSize = ALIGN_VALUE (Size, HOB_LIST_COMMIT_SIZE);
+#ifdef TEST_WITH_KLEE
+  NewList = realloc (gHobPointer, NewSize);
+  if (NewList == NULL) {
+    return FALSE;
+  }
+  //
+  // The end of the list is the only absolute address in the HOBs built by
+  // this library. The GUID index holds offsets.
+  //
+  if (mHobListCommittedSize != 0) {
+    HandOffHob = NewList;
+    HandOffHob->EfiEndOfHobList = HandOffHob->EfiEndOfHobList - (UINTN)gHobPointer + (UINTN)NewList;
+  }
+  ZeroMem (NewList + mHobListCommittedSize, NewSize - mHobListCommittedSize);
+  gHobPointer = NewList;
+#else
+  if (!CommitVirtualMemory ((UINT8 *)gHobPointer + mHobListCommittedSize, NewSize - mHobListCommittedSize)) {
+    return FALSE;
+  }
+#endif
+  mHobListCommittedSize = NewSize;
+  return TRUE;
+}
+
+/**
+  Return the bucket of mHobGuidIndex of a GUID.
+
+  @param  Guid          The GUID.
+
+  @return The bucket index.
+
+**/
+UINTN
+GetHobGuidIndexBucket (
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  CONST UINT32              *Data;
+
+  Data = (CONST UINT32 *)Guid;
+  return (Data[0] ^ Data[1] ^ Data[2] ^ Data[3]) % HOB_GUID_INDEX_BUCKETS;
+}
+
+/**
+  Find the index entry of a GUID.
+
+  @param  Guid          The GUID.
+
+  @return The index entry, or NULL if no GUID HOB with this name is indexed.
+
+**/
+HOB_GUID_INDEX_ENTRY *
+FindHobGuidIndexEntry (
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  LIST_ENTRY                *Bucket;
+  LIST_ENTRY                *Link;
+  HOB_GUID_INDEX_ENTRY      *Entry;
+
+  Bucket = &mHobGuidIndex[GetHobGuidIndexBucket (Guid)];
+  for (Link = GetFirstNode (Bucket); !IsNull (Bucket, Link); Link = GetNextNode (Bucket, Link)) {
+    Entry = BASE_CR (Link, HOB_GUID_INDEX_ENTRY, Link);
+    if (CompareGuid (&Entry->Name, Guid)) {
+      return Entry;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Empty mHobGuidIndex.
+
+**/
+VOID
+ResetHobGuidIndex (
+  VOID
+  )
+{
+  UINTN                     Index;
+  HOB_GUID_INDEX_ENTRY      *Entry;
+
+  for (Index = 0; Index < HOB_GUID_INDEX_BUCKETS; Index++) {
+    while (!IsListEmpty (&mHobGuidIndex[Index])) {
+      Entry = BASE_CR (GetFirstNode (&mHobGuidIndex[Index]), HOB_GUID_INDEX_ENTRY, Link);
+      RemoveEntryList (&Entry->Link);
+      free (Entry->Offset);
+      free (Entry);
+    }
+  }
+  mHobGuidIndexedSize = 0;
+}
+
+/**
+  Add the GUID HOBs appended to the host HOB list to mHobGuidIndex.
+
+  @retval TRUE          All the GUID HOBs of the list are indexed.
+  @retval FALSE         The host has no memory for the index.
+
+**/
+BOOLEAN
+UpdateHobGuidIndex (
+  VOID
+  )
+{
+  EFI_HOB_HANDOFF_INFO_TABLE  *HandOffHob;
+  EFI_PEI_HOB_POINTERS        Hob;
+  HOB_GUID_INDEX_ENTRY        *Entry;
+  UINTN                       *Offset;
+  UINTN                       Capacity;
+
+  //
+  // The list was written over if it ends before the HOBs already indexed.
+  //
+  HandOffHob = gHobPointer;
+  if ((UINTN)HandOffHob->EfiEndOfHobList < (UINTN)gHobPointer + mHobGuidIndexedSize) {
+    ResetHobGuidIndex ();
+  }
+
+  Hob.Raw = (UINT8 *)gHobPointer + mHobGuidIndexedSize;
+  while (!END_OF_HOB_LIST (Hob)) {
+    if (Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) {
+      Entry = FindHobGuidIndexEntry (&Hob.Guid->Name);
+      if (Entry == NULL) {
+        Entry = calloc (1, sizeof (HOB_GUID_INDEX_ENTRY));
+        if (Entry == NULL) {
+          return FALSE;
+        }
+        CopyGuid (&Entry->Name, &Hob.Guid->Name);
+        InsertTailList (&mHobGuidIndex[GetHobGuidIndexBucket (&Entry->Name)], &Entry->Link);
+      }
+      if (Entry->Count == Entry->Capacity) {
+        Capacity = (Entry->Capacity == 0) ? 4 : Entry->Capacity * 2;
+        Offset = realloc (Entry->Offset, Capacity * sizeof (UINTN));
+        if (Offset == NULL) {
+          return FALSE;
+        }
+        Entry->Offset   = Offset;
+        Entry->Capacity = Capacity;
+      }
+      Entry->Offset[Entry->Count++] = (UINTN)Hob.Raw - (UINTN)gHobPointer;
+    }
+    Hob.Raw = GET_NEXT_HOB (Hob);
+    mHobGuidIndexedSize = (UINTN)Hob.Raw - (UINTN)gHobPointer;
+  }
+  return TRUE;
+}
+
+/**
+  Look the next matched GUID HOB up in mHobGuidIndex.
+
+  @param  Guid          The GUID to match with in the HOB list.
+  @param  HobStart      A HOB of the host HOB list.
+
+  @return The next instance of the matched GUID HOB from the starting HOB.
+
+**/
+VOID *
+FindIndexedGuidHob (
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  HOB_GUID_INDEX_ENTRY      *Entry;
+  EFI_PEI_HOB_POINTERS      GuidHob;
+  UINTN                     Start;
+  UINTN                     Low;
+  UINTN                     High;
+  UINTN                     Middle;
+
+  Entry = FindHobGuidIndexEntry (Guid);
+  if (Entry == NULL) {
+    return NULL;
+  }
+
+  //
+  // Binary search the first indexed HOB at or after HobStart.
+  //
+  Start = (UINTN)HobStart - (UINTN)gHobPointer;
+  Low   = 0;
+  High  = Entry->Count;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Entry->Offset[Middle] < Start) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  //
+  // A HOB can be changed in place after it is indexed, so check it again.
+  //
+  for (; Low < Entry->Count; Low++) {
+    GuidHob.Raw = (UINT8 *)gHobPointer + Entry->Offset[Low];
+    if ((GuidHob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) &&
+        CompareGuid (Guid, &GuidHob.Guid->Name)) {
+      return GuidHob.Raw;
+    }
+  }
+  return NULL;
+}
+
 VOID
 InitHobPointer (
   VOID
@@ -24,10 +289,24 @@ InitHobPointer (
 {
   EFI_HOB_HANDOFF_INFO_TABLE           *HandOffHob;
   EFI_HOB_GENERIC_HEADER               *HobEnd;
+  UINTN                                Index;
+  CONST CHAR8                          *FileName;
+  EFI_STATUS                           Status;
+
+  for (Index = 0; Index < HOB_GUID_INDEX_BUCKETS; Index++) {
+    InitializeListHead (&mHobGuidIndex[Index]);
+  }
 
-  gHobPointer = AllocatePool (SIZE_64KB);
+#ifdef TEST_WITH_KLEE
+  gHobPointer = NULL;
+#else
+  gHobPointer = ReserveVirtualMemory (HOB_LIST_RESERVED_SIZE);
   assert (gHobPointer != NULL);
-  ZeroMem (gHobPointer, SIZE_64KB);
+#endif
+  mHobListCommittedSize = 0;
+  if (!CommitHobList (HOB_LIST_COMMIT_SIZE)) {
+    assert (FALSE);
+  }
   HandOffHob = gHobPointer;
   HandOffHob->Header.HobType = EFI_HOB_TYPE_HANDOFF;
   HandOffHob->Header.HobLength = sizeof(EFI_HOB_HANDOFF_INFO_TABLE);
@@ -38,6 +317,128 @@ InitHobPointer (
   HobEnd = (EFI_HOB_GENERIC_HEADER*) ((UINTN) HandOffHob + sizeof(EFI_HOB_HANDOFF_INFO_TABLE));
   HobEnd->HobType   = EFI_HOB_TYPE_END_OF_HOB_LIST;
   HobEnd->HobLength = (UINT16) sizeof (EFI_HOB_GENERIC_HEADER);
+
+  FileName = getenv (HOB_LIST_IMAGE_ENV);
+  if (FileName != NULL) {
+    Status = HobListLoadFile (FileName);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "HobLibHost: cannot load %a - %r\n", FileName, Status));
+    }
+  }
+}
+
+/**
+  Replace the host HOB list with the HOBs of a HOB list image.
+
+  @param[in] Image      The HOB list image.
+  @param[in] ImageSize  The size of the image.
+
+  @retval EFI_SUCCESS            The HOB list is loaded.
+  @retval EFI_INVALID_PARAMETER  Image is NULL.
+  @retval EFI_VOLUME_CORRUPTED   The image is not a valid HOB list.
+  @retval EFI_OUT_OF_RESOURCES   The image does not fit in the host list.
+
+**/
+EFI_STATUS
+EFIAPI
+HobListLoadImage (
+  IN CONST VOID  *Image,
+  IN UINTN       ImageSize
+  )
+{
+  EFI_HOB_HANDOFF_INFO_TABLE           *HandOffHob;
+  EFI_HOB_GENERIC_HEADER               *Hob;
+  EFI_HOB_GENERIC_HEADER               *HobEnd;
+  UINTN                                Size;
+
+  if (Image == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (gHobPointer == NULL) {
+    InitHobPointer ();
+  }
+
+  Hob = (EFI_HOB_GENERIC_HEADER *)Image;
+  if ((ImageSize < sizeof (EFI_HOB_HANDOFF_INFO_TABLE)) ||
+      (Hob->HobType != EFI_HOB_TYPE_HANDOFF) ||
+      (Hob->HobLength < sizeof (EFI_HOB_HANDOFF_INFO_TABLE))) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  //
+  // Size is the offset of the end of HOB list HOB.
+  //
+  Size = 0;
+  while (TRUE) {
+    if (ImageSize - Size < sizeof (EFI_HOB_GENERIC_HEADER)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    Hob = (EFI_HOB_GENERIC_HEADER *)((UINT8 *)Image + Size);
+    if (Hob->HobType == EFI_HOB_TYPE_END_OF_HOB_LIST) {
+      break;
+    }
+    if ((Hob->HobLength < sizeof (EFI_HOB_GENERIC_HEADER)) || (Hob->HobLength > ImageSize - Size)) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    Size += Hob->HobLength;
+  }
+
+  if (!CommitHobList (Size + sizeof (EFI_HOB_GENERIC_HEADER))) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem (gHobPointer, Image, Size);
+
+  HobEnd = (EFI_HOB_GENERIC_HEADER *)((UINT8 *)gHobPointer + Size);
+  HobEnd->HobType   = EFI_HOB_TYPE_END_OF_HOB_LIST;
+  HobEnd->HobLength = (UINT16) sizeof (EFI_HOB_GENERIC_HEADER);
+  HobEnd->Reserved  = 0;
+
+  HandOffHob = gHobPointer;
+  HandOffHob->EfiEndOfHobList = (EFI_PHYSICAL_ADDRESS) (UINTN) HobEnd;
+
+  ResetHobGuidIndex ();
+  return EFI_SUCCESS;
+}
+
+/**
+  Replace the host HOB list with the HOBs of a HOB list image file.
+
+  @param[in] FileName  The name of the image file.
+
+  @retval EFI_SUCCESS      The HOB list is loaded.
+  @retval EFI_NOT_FOUND    The file cannot be read.
+  @return The status of HobListLoadImage().
+
+**/
+EFI_STATUS
+EFIAPI
+HobListLoadFile (
+  IN CONST CHAR8  *FileName
+  )
+{
+  FILE        *File;
+  UINT8       *Image;
+  long        ImageSize;
+  EFI_STATUS  Status;
+
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  Image = NULL;
+  Status = EFI_NOT_FOUND;
+  if ((fseek (File, 0, SEEK_END) == 0) && ((ImageSize = ftell (File)) > 0) &&
+      (fseek (File, 0, SEEK_SET) == 0)) {
+    Image = malloc (ImageSize);
+    if (Image == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else if (fread (Image, 1, ImageSize, File) == (size_t) ImageSize) {
+      Status = HobListLoadImage (Image, ImageSize);
+    }
+  }
+  fclose (File);
+  free (Image);
+  return Status;
 }
 
 /**
@@ -62,6 +463,10 @@ GetHobList (
   VOID
   )
 {
+  if (gHobPointer == NULL) {
+    InitHobPointer ();
+  }
+
   return gHobPointer;
 }
 
@@ -160,6 +565,16 @@ GetNextGuidHob (
 {
   EFI_PEI_HOB_POINTERS  GuidHob;
 
+  //
+  // HOBs of the host HOB list are looked up in the GUID index.
+  //
+  if ((gHobPointer != NULL) &&
+      ((UINTN)HobStart >= (UINTN)gHobPointer) &&
+      ((UINTN)HobStart < (UINTN)gHobPointer + mHobListCommittedSize) &&
+      UpdateHobGuidIndex ()) {
+    return FindIndexedGuidHob (Guid, HobStart);
+  }
+
   GuidHob.Raw = (UINT8 *) HobStart;
   while ((GuidHob.Raw = GetNextHob (EFI_HOB_TYPE_GUID_EXTENSION, GuidHob.Raw)) != NULL) {
     if (CompareGuid (Guid, &GuidHob.Guid->Name)) {
@@ -259,10 +674,15 @@ InternalPeiCreateHob (
   
   HandOffHob = gHobPointer;
 
-  if ((UINTN)HandOffHob->EfiEndOfHobList + sizeof(EFI_HOB_GENERIC_HEADER) + Length > (UINTN)gHobPointer + SIZE_64KB) {
+  if (!CommitHobList ((UINTN)HandOffHob->EfiEndOfHobList - (UINTN)gHobPointer + Length + sizeof(EFI_HOB_GENERIC_HEADER))) {
+    DEBUG ((DEBUG_ERROR, "HobLibHost: HOB list is full\n"));
     assert (FALSE);
     return NULL;
   }
+  //
+  // The HOB list moves when it grows with TEST_WITH_KLEE.
+  //
+  HandOffHob = gHobPointer;
   
   Hob = (VOID*) (UINTN) HandOffHob->EfiEndOfHobList;
   ((EFI_HOB_GENERIC_HEADER*) Hob)->HobType   = Type;
@@ -0,0 +1,611 @@
+/** @file
+  MMIO and I/O port emulation of the host IoLib.
+
+  Every address space has a 4 level radix table indexed by the 52 bit page
+  number of an address, with 4KB pages. A leaf entry points to the range
+  covering the page. If several ranges share a page, the entry is marked
+  shared and the access searches the list of ranges, newest first. The page
+  of the last access is cached, so polling one register costs a compare.
+
+  The nodes of the tables are kept across IoEmulationReset(), which only
+  clears the leaf entries of the ranges, so a harness mapping the same
+  registers for every input allocates no nodes after the first one.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "IoLibHost.h"
+#include <Library/BaseMemoryLib.h>
+
+#define IO_PAGE_SHIFT     12
+#define IO_LEVEL_BITS     13
+#define IO_LEVELS         4
+#define IO_LEVEL_ENTRIES  (1 << IO_LEVEL_BITS)
+
+#define IO_SHARED_PAGE    ((IO_RANGE *)(UINTN)1)
+
+typedef struct _IO_RANGE IO_RANGE;
+
+struct _IO_RANGE {
+  IO_RANGE            *Next;
+  IO_EMULATION_SPACE  Space;
+  UINT64              Base;
+  UINT64              Length;
+  //
+  // Register file
+  //
+  UINT8               *Registers;
+  BOOLEAN             OwnRegisters;
+  BOOLEAN             FromInput;
+  //
+  // Handlers
+  //
+  BOOLEAN             Handler;
+  IO_EMULATION_READ   Read;
+  IO_EMULATION_WRITE  Write;
+  VOID                *Context;
+};
+
+typedef struct {
+  VOID  *Entry[IO_LEVEL_ENTRIES];
+} IO_PAGE_NODE;
+
+typedef struct {
+  IO_PAGE_NODE  *Root;
+  UINT64        CachedPage;
+  IO_RANGE      *CachedRange;
+  BOOLEAN       CacheValid;
+} IO_ADDRESS_SPACE;
+
+typedef enum {
+  IoTraceUninitialized,
+  IoTraceInitialized
+} IO_TRACE_STATE;
+
+IO_ADDRESS_SPACE    mIoSpace[IoEmulationSpaceMax];
+IO_RANGE            *mIoRanges;
+
+CONST UINT8         *mIoInput;
+UINTN               mIoInputSize;
+
+IO_TRACE_STATE      mIoTraceState = IoTraceUninitialized;
+IO_EMULATION_TRACE  mIoTrace;
+FILE                *mIoTraceFile;
+
+CONST CHAR8  *mIoSpaceName[IoEmulationSpaceMax] = {
+  "MMIO",
+  "IO"
+};
+
+VOID
+EFIAPI
+IoTraceToFile (
+  IN IO_EMULATION_SPACE  Space,
+  IN BOOLEAN             Write,
+  IN UINT64              Address,
+  IN UINTN               Width,
+  IN UINT64              Value,
+  IN BOOLEAN             Mapped
+  )
+{
+  fprintf (
+    mIoTraceFile,
+    "%s %c%d 0x%016llx 0x%0*llx%s\n",
+    mIoSpaceName[Space],
+    Write ? 'W' : 'R',
+    (int)Width,
+    (unsigned long long)Address,
+    (int)Width * 2,
+    (unsigned long long)Value,
+    Mapped ? "" : " unmapped"
+    );
+  fflush (mIoTraceFile);
+}
+
+VOID
+IoTrace (
+  IN IO_EMULATION_SPACE  Space,
+  IN BOOLEAN             Write,
+  IN UINT64              Address,
+  IN UINTN               Width,
+  IN UINT64              Value,
+  IN BOOLEAN             Mapped
+  )
+{
+  CHAR8  *FileName;
+
+  if (mIoTraceState == IoTraceUninitialized) {
+    mIoTraceState = IoTraceInitialized;
+    FileName = getenv (IO_EMULATION_TRACE_ENV);
+    if (FileName != NULL && FileName[0] != '\0') {
+      mIoTraceFile = fopen (FileName, "a");
+      if (mIoTraceFile != NULL) {
+        mIoTrace = IoTraceToFile;
+      }
+    }
+  }
+  if (mIoTrace != NULL) {
+    mIoTrace (Space, Write, Address, Width, Value, Mapped);
+  }
+}
+
+VOID
+IoInvalidateCache (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < IoEmulationSpaceMax; Index++) {
+    mIoSpace[Index].CacheValid = FALSE;
+  }
+}
+
+/**
+  Return the leaf entry of a page.
+
+  @param[in] Space   The address space.
+  @param[in] Page    The page number.
+  @param[in] Create  Allocate the missing nodes.
+
+  @return The leaf entry, or NULL if it does not exist or cannot be created.
+
+**/
+IO_RANGE **
+IoGetPageEntry (
+  IN IO_ADDRESS_SPACE  *Space,
+  IN UINT64            Page,
+  IN BOOLEAN           Create
+  )
+{
+  IO_PAGE_NODE  **Node;
+  UINTN         Level;
+  UINTN         Index;
+
+  Node = &Space->Root;
+  for (Level = 0; ; Level++) {
+    if (*Node == NULL) {
+      if (!Create) {
+        return NULL;
+      }
+      *Node = calloc (1, sizeof (IO_PAGE_NODE));
+      if (*Node == NULL) {
+        return NULL;
+      }
+    }
+    Index = (UINTN)RShiftU64 (Page, IO_LEVEL_BITS * (IO_LEVELS - 1 - Level)) & (IO_LEVEL_ENTRIES - 1);
+    if (Level == IO_LEVELS - 1) {
+      return (IO_RANGE **)&(*Node)->Entry[Index];
+    }
+    Node = (IO_PAGE_NODE **)&(*Node)->Entry[Index];
+  }
+}
+
+/**
+  Clear the leaf entries of the pages of a range.
+
+  @param[in] Range  The range.
+
+**/
+VOID
+IoClearRangePages (
+  IN IO_RANGE  *Range
+  )
+{
+  IO_ADDRESS_SPACE  *AddressSpace;
+  IO_RANGE          **Entry;
+  UINT64            Page;
+  UINT64            LastPage;
+
+  AddressSpace = &mIoSpace[Range->Space];
+  Page = RShiftU64 (Range->Base, IO_PAGE_SHIFT);
+  LastPage = RShiftU64 (Range->Base + Range->Length - 1, IO_PAGE_SHIFT);
+  for (; ; Page++) {
+    Entry = IoGetPageEntry (AddressSpace, Page, FALSE);
+    if (Entry != NULL) {
+      *Entry = NULL;
+    }
+    if (Page == LastPage) {
+      break;
+    }
+  }
+}
+
+BOOLEAN
+IoRangeContains (
+  IN IO_RANGE  *Range,
+  IN UINT64    Address,
+  IN UINTN     Width
+  )
+{
+  return (BOOLEAN)(Address >= Range->Base &&
+                   Width <= Range->Length &&
+                   Address - Range->Base <= Range->Length - Width);
+}
+
+/**
+  Find the range of an access.
+
+  @param[in] Space    The address space of the access.
+  @param[in] Address  The MMIO address or I/O port.
+  @param[in] Width    Size of the access in bytes.
+
+  @return The newest range covering the whole access, or NULL.
+
+**/
+IO_RANGE *
+IoLookupRange (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Address,
+  IN UINTN               Width
+  )
+{
+  IO_ADDRESS_SPACE  *AddressSpace;
+  IO_RANGE          **Entry;
+  IO_RANGE          *Range;
+  UINT64            Page;
+
+  AddressSpace = &mIoSpace[Space];
+  Page = RShiftU64 (Address, IO_PAGE_SHIFT);
+  if (AddressSpace->CacheValid && AddressSpace->CachedPage == Page) {
+    Range = AddressSpace->CachedRange;
+  } else {
+    Entry = IoGetPageEntry (AddressSpace, Page, FALSE);
+    Range = (Entry == NULL) ? NULL : *Entry;
+    AddressSpace->CachedPage = Page;
+    AddressSpace->CachedRange = Range;
+    AddressSpace->CacheValid = TRUE;
+  }
+
+  if (Range == IO_SHARED_PAGE) {
+    for (Range = mIoRanges; Range != NULL; Range = Range->Next) {
+      if (Range->Space == Space && IoRangeContains (Range, Address, Width)) {
+        return Range;
+      }
+    }
+    return NULL;
+  }
+  if (Range != NULL && IoRangeContains (Range, Address, Width)) {
+    return Range;
+  }
+  return NULL;
+}
+
+RETURN_STATUS
+IoAddRange (
+  IN IO_RANGE  *Range
+  )
+{
+  IO_ADDRESS_SPACE  *AddressSpace;
+  IO_RANGE          **Entry;
+  UINT64            Page;
+  UINT64            LastPage;
+
+  AddressSpace = &mIoSpace[Range->Space];
+  Page = RShiftU64 (Range->Base, IO_PAGE_SHIFT);
+  LastPage = RShiftU64 (Range->Base + Range->Length - 1, IO_PAGE_SHIFT);
+  for (; ; Page++) {
+    Entry = IoGetPageEntry (AddressSpace, Page, TRUE);
+    if (Entry == NULL) {
+      //
+      // Unmap the pages mapped so far, the range is not added to the list.
+      // The pages it shares with other ranges stay shared, which is only
+      // slower.
+      //
+      LastPage = Page;
+      for (Page = RShiftU64 (Range->Base, IO_PAGE_SHIFT); Page != LastPage; Page++) {
+        Entry = IoGetPageEntry (AddressSpace, Page, FALSE);
+        if (*Entry == Range) {
+          *Entry = NULL;
+        }
+      }
+      IoInvalidateCache ();
+      return RETURN_OUT_OF_RESOURCES;
+    }
+    *Entry = (*Entry == NULL) ? Range : IO_SHARED_PAGE;
+    if (Page == LastPage) {
+      break;
+    }
+  }
+
+  Range->Next = mIoRanges;
+  mIoRanges = Range;
+  IoInvalidateCache ();
+  return RETURN_SUCCESS;
+}
+
+IO_RANGE *
+IoCreateRange (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Base,
+  IN UINT64              Length
+  )
+{
+  IO_RANGE  *Range;
+
+  if ((UINTN)Space >= IoEmulationSpaceMax || Length == 0 || Base + Length - 1 < Base) {
+    return NULL;
+  }
+  if (Space == IoEmulationIo && Base + Length - 1 > MAX_UINT16) {
+    return NULL;
+  }
+
+  Range = calloc (1, sizeof (IO_RANGE));
+  if (Range == NULL) {
+    return NULL;
+  }
+  Range->Space = Space;
+  Range->Base = Base;
+  Range->Length = Length;
+  return Range;
+}
+
+/**
+  Map a range to a register file.
+
+  @param[in] Space      The address space of the range.
+  @param[in] Base       The first MMIO address or I/O port of the range.
+  @param[in] Length     The size of the range in bytes.
+  @param[in] Registers  Backing store of Length bytes, NULL to allocate a
+                        zeroed one.
+  @param[in] FromInput  Refresh reads from the fuzz input.
+
+  @retval RETURN_SUCCESS            The range is mapped.
+  @retval RETURN_INVALID_PARAMETER  The range is empty or out of the space.
+  @retval RETURN_OUT_OF_RESOURCES   There is not enough memory.
+
+**/
+RETURN_STATUS
+EFIAPI
+IoEmulationAddRegisters (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Base,
+  IN UINT64              Length,
+  IN VOID                *Registers  OPTIONAL,
+  IN BOOLEAN             FromInput
+  )
+{
+  IO_RANGE       *Range;
+  RETURN_STATUS  Status;
+
+  Range = IoCreateRange (Space, Base, Length);
+  if (Range == NULL) {
+    return RETURN_INVALID_PARAMETER;
+  }
+  if (Registers == NULL) {
+    if (Length > MAX_UINTN || (Registers = calloc (1, (UINTN)Length)) == NULL) {
+      free (Range);
+      return RETURN_OUT_OF_RESOURCES;
+    }
+    Range->OwnRegisters = TRUE;
+  }
+  Range->Registers = Registers;
+  Range->FromInput = FromInput;
+
+  Status = IoAddRange (Range);
+  if (RETURN_ERROR (Status)) {
+    if (Range->OwnRegisters) {
+      free (Range->Registers);
+    }
+    free (Range);
+  }
+  return Status;
+}
+
+/**
+  Map a range to read and write handlers.
+
+  @param[in] Space    The address space of the range.
+  @param[in] Base     The first MMIO address or I/O port of the range.
+  @param[in] Length   The size of the range in bytes.
+  @param[in] Read     Read handler, NULL to read all ones.
+  @param[in] Write    Write handler, NULL to drop writes.
+  @param[in] Context  Passed to the handlers.
+
+  @retval RETURN_SUCCESS            The range is mapped.
+  @retval RETURN_INVALID_PARAMETER  The range is empty or out of the space.
+  @retval RETURN_OUT_OF_RESOURCES   There is not enough memory.
+
+**/
+RETURN_STATUS
+EFIAPI
+IoEmulationAddHandler (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Base,
+  IN UINT64              Length,
+  IN IO_EMULATION_READ   Read     OPTIONAL,
+  IN IO_EMULATION_WRITE  Write    OPTIONAL,
+  IN VOID                *Context OPTIONAL
+  )
+{
+  IO_RANGE       *Range;
+  RETURN_STATUS  Status;
+
+  Range = IoCreateRange (Space, Base, Length);
+  if (Range == NULL) {
+    return RETURN_INVALID_PARAMETER;
+  }
+  Range->Handler = TRUE;
+  Range->Read = Read;
+  Range->Write = Write;
+  Range->Context = Context;
+
+  Status = IoAddRange (Range);
+  if (RETURN_ERROR (Status)) {
+    free (Range);
+  }
+  return Status;
+}
+
+/**
+  Set the fuzz input consumed by register files mapped with FromInput.
+
+  @param[in] Buffer  The input, NULL for none.
+  @param[in] Size    The size of the input in bytes.
+
+**/
+VOID
+EFIAPI
+IoEmulationSetInput (
+  IN CONST VOID  *Buffer  OPTIONAL,
+  IN UINTN       Size
+  )
+{
+  mIoInput = Buffer;
+  mIoInputSize = (Buffer == NULL) ? 0 : Size;
+}
+
+/**
+  Consume bytes of the fuzz input, for handlers.
+
+  @param[out] Buffer  Receives the bytes.
+  @param[in]  Size    The number of bytes wanted.
+
+  @return The number of bytes copied, less than Size if the input is
+          exhausted.
+
+**/
+UINTN
+EFIAPI
+IoEmulationConsumeInput (
+  OUT VOID   *Buffer,
+  IN  UINTN  Size
+  )
+{
+  if (Size > mIoInputSize) {
+    Size = mIoInputSize;
+  }
+  if (Size != 0) {
+    CopyMem (Buffer, mIoInput, Size);
+    mIoInput += Size;
+    mIoInputSize -= Size;
+  }
+  return Size;
+}
+
+/**
+  Set the trace callback. It replaces the trace file of HBFA_IO_TRACE.
+
+  @param[in] Trace  The callback, NULL to stop tracing.
+
+**/
+VOID
+EFIAPI
+IoEmulationSetTrace (
+  IN IO_EMULATION_TRACE  Trace  OPTIONAL
+  )
+{
+  mIoTraceState = IoTraceInitialized;
+  mIoTrace = Trace;
+}
+
+/**
+  Remove all ranges and the fuzz input, for the next test run.
+
+**/
+VOID
+EFIAPI
+IoEmulationReset (
+  VOID
+  )
+{
+  IO_RANGE  *Range;
+
+  while (mIoRanges != NULL) {
+    Range = mIoRanges;
+    mIoRanges = Range->Next;
+    IoClearRangePages (Range);
+    if (Range->OwnRegisters) {
+      free (Range->Registers);
+    }
+    free (Range);
+  }
+  IoInvalidateCache ();
+  IoEmulationSetInput (NULL, 0);
+}
+
+/**
+  Read an emulated register.
+
+  @param[in] Space    The address space of the access.
+  @param[in] Address  The MMIO address or I/O port.
+  @param[in] Width    Size of the access in bytes: 1, 2, 4 or 8.
+
+  @return The value read, zero extended.
+
+**/
+UINT64
+IoEmulationRead (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Address,
+  IN UINTN               Width
+  )
+{
+  IO_RANGE  *Range;
+  UINT64    Value;
+  UINT64    Offset;
+
+  Value = MAX_UINT64;
+  Range = IoLookupRange (Space, Address, Width);
+  if (Range != NULL) {
+    Offset = Address - Range->Base;
+    if (Range->Handler) {
+      if (Range->Read != NULL) {
+        Value = Range->Read (Range->Context, Offset, Width);
+      }
+    } else {
+      if (Range->FromInput) {
+        IoEmulationConsumeInput (Range->Registers + Offset, Width);
+      }
+      Value = 0;
+      CopyMem (&Value, Range->Registers + Offset, Width);
+    }
+  }
+  if (Width < sizeof (UINT64)) {
+    Value &= LShiftU64 (1, Width * 8) - 1;
+  }
+
+  IoTrace (Space, FALSE, Address, Width, Value, (BOOLEAN)(Range != NULL));
+  return Value;
+}
+
+/**
+  Write an emulated register.
+
+  @param[in] Space    The address space of the access.
+  @param[in] Address  The MMIO address or I/O port.
+  @param[in] Width    Size of the access in bytes: 1, 2, 4 or 8.
+  @param[in] Value    The value to write.
+
+**/
+VOID
+IoEmulationWrite (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Address,
+  IN UINTN               Width,
+  IN UINT64              Value
+  )
+{
+  IO_RANGE  *Range;
+  UINT64    Offset;
+
+  Range = IoLookupRange (Space, Address, Width);
+  IoTrace (Space, TRUE, Address, Width, Value, (BOOLEAN)(Range != NULL));
+  if (Range == NULL) {
+    return;
+  }
+
+  Offset = Address - Range->Base;
+  if (Range->Handler) {
+    if (Range->Write != NULL) {
+      Range->Write (Range->Context, Offset, Width, Value);
+    }
+  } else {
+    CopyMem (Range->Registers + Offset, &Value, Width);
+  }
+}
@@ -0,0 +1,52 @@
+/** @file
+  Internal interface of the host IoLib.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _IO_LIB_HOST_H_
+#define _IO_LIB_HOST_H_
+
+#include <Base.h>
+#include <Library/IoLib.h>
+#include <Library/IoEmulationLib.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+
+/**
+  Read an emulated register.
+
+  @param[in] Space    The address space of the access.
+  @param[in] Address  The MMIO address or I/O port.
+  @param[in] Width    Size of the access in bytes: 1, 2, 4 or 8.
+
+  @return The value read, zero extended.
+
+**/
+UINT64
+IoEmulationRead (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Address,
+  IN UINTN               Width
+  );
+
+/**
+  Write an emulated register.
+
+  @param[in] Space    The address space of the access.
+  @param[in] Address  The MMIO address or I/O port.
+  @param[in] Width    Size of the access in bytes: 1, 2, 4 or 8.
+  @param[in] Value    The value to write.
+
+**/
+VOID
+IoEmulationWrite (
+  IN IO_EMULATION_SPACE  Space,
+  IN UINT64              Address,
+  IN UINTN               Width,
+  IN UINT64              Value
+  );
+
+#endif
@@ -6,6 +6,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include <sys/mman.h>
+#include <time.h>
 
 VOID *
 AllocateExecutableMemory (
@@ -43,3 +44,47 @@ FreeExecutableMemory (
 
   munmap (Buffer, FinalSize);
 }
+
+VOID *
+ReserveVirtualMemory (
+  IN UINTN  Size
+  )
+{
+  VOID        *Buffer;
+
+  Buffer = mmap(NULL, Size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+  if (Buffer == MAP_FAILED) {
+    return NULL;
+  }
+
+  return Buffer;
+}
+
+BOOLEAN
+CommitVirtualMemory (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  )
+{
+  return (BOOLEAN)(mprotect (Buffer, Size, PROT_READ | PROT_WRITE) == 0);
+}
+
+VOID
+FreeVirtualMemory (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  )
+{
+  munmap (Buffer, Size);
+}
+
+UINT64
+GetMonotonicTimeInNanoSecond (
+  VOID
+  )
+{
+  struct timespec  Time;
+
+  clock_gettime (CLOCK_MONOTONIC, &Time);
+  return (UINT64)Time.tv_sec * 1000000000 + Time.tv_nsec;
+}
@@ -39,3 +39,43 @@ FreeExecutableMemory (
 {
   VirtualFree(Buffer, 0, MEM_RELEASE);
 }
+
+VOID *
+ReserveVirtualMemory (
+  IN UINTN  Size
+  )
+{
+  return VirtualAlloc(NULL, Size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+BOOLEAN
+CommitVirtualMemory (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  )
+{
+  return (BOOLEAN)(VirtualAlloc(Buffer, Size, MEM_COMMIT, PAGE_READWRITE) != NULL);
+}
+
+VOID
+FreeVirtualMemory (
+  IN VOID   *Buffer,
+  IN UINTN  Size
+  )
+{
+  VirtualFree(Buffer, 0, MEM_RELEASE);
+}
+
+UINT64
+GetMonotonicTimeInNanoSecond (
+  VOID
+  )
+{
+  LARGE_INTEGER  Counter;
+  LARGE_INTEGER  Frequency;
+
+  QueryPerformanceCounter (&Counter);
+  QueryPerformanceFrequency (&Frequency);
+  return (UINT64)(Counter.QuadPart / Frequency.QuadPart) * 1000000000 +
+         (UINT64)(Counter.QuadPart % Frequency.QuadPart) * 1000000000 / Frequency.QuadPart;
+}
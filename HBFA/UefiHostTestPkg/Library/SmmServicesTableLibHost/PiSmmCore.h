@@ -76,7 +76,8 @@ typedef struct {
 
  typedef struct {
   UINTN       Signature;
-  LIST_ENTRY  AllEntries;  // All entries
+  LIST_ENTRY  AllEntries;  // All entries, in registration order
+  LIST_ENTRY  HashLink;    // Link on the bucket of HandlerType
 
   EFI_GUID    HandlerType; // Type of interrupt
   LIST_ENTRY  SmiHandlers; // All handlers
@@ -92,6 +93,7 @@ typedef struct {
   SMI_ENTRY                     *SmiEntry;
   VOID                          *Context;    // for profile
   UINTN                         ContextSize; // for profile
+  BOOLEAN                       ToRemove;    // Unregistered while SmiManage() runs
 } SMI_HANDLER;
 
 //
@@ -0,0 +1,472 @@
+/** @file
+  SMI management.
+
+  Copyright (c) 2009 - 2018, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "PiSmmCore.h"
+
+#include <Library/SmiHandlerRegistryLib.h>
+
+//
+// The SMI entries are hashed by HandlerType, so a fuzzing loop dispatching
+// one SMI per input does not walk every registered type.
+//
+#define SMI_ENTRY_BUCKET_COUNT  32
+
+//
+// mSmiEntryList  - All SMI entries with a HandlerType, in registration order
+// mSmiEntryHash  - The same entries, hashed by HandlerType
+// mRootSmiEntry  - The root SMI handlers, registered with a NULL HandlerType
+//
+LIST_ENTRY  mSmiEntryList = INITIALIZE_LIST_HEAD_VARIABLE (mSmiEntryList);
+LIST_ENTRY  mSmiEntryHash[SMI_ENTRY_BUCKET_COUNT];
+UINTN       mSmiEntryCount;
+
+SMI_ENTRY   mRootSmiEntry = {
+  SMI_ENTRY_SIGNATURE,
+  INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.AllEntries),
+  INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.HashLink),
+  {0},
+  INITIALIZE_LIST_HEAD_VARIABLE (mRootSmiEntry.SmiHandlers),
+};
+
+//
+// Nesting level of SmiManage(). Handlers unregistered while it is not 0 are
+// only marked, and removed when the outermost SmiManage() returns.
+//
+UINTN       mSmiManageCallingDepth;
+BOOLEAN     mSmiHandlerRemovePending;
+
+/**
+  Return the bucket of mSmiEntryHash a handler type is hashed to.
+
+  @param  HandlerType    The handler type.
+
+  @return The list head of the bucket.
+
+**/
+LIST_ENTRY *
+SmmCoreGetSmiEntryBucket (
+  IN CONST EFI_GUID  *HandlerType
+  )
+{
+  UINTN  Index;
+
+  if (mSmiEntryHash[0].ForwardLink == NULL) {
+    for (Index = 0; Index < SMI_ENTRY_BUCKET_COUNT; Index++) {
+      InitializeListHead (&mSmiEntryHash[Index]);
+    }
+  }
+
+  Index = ReadUnaligned32 ((CONST UINT32 *)HandlerType) ^
+          ReadUnaligned32 ((CONST UINT32 *)HandlerType + 1) ^
+          ReadUnaligned32 ((CONST UINT32 *)HandlerType + 2) ^
+          ReadUnaligned32 ((CONST UINT32 *)HandlerType + 3);
+  return &mSmiEntryHash[Index % SMI_ENTRY_BUCKET_COUNT];
+}
+
+/**
+  Finds the SMI entry for the requested handler type.
+
+  @param  HandlerType            The type of the interrupt
+  @param  Create                 Create a new entry if not found
+
+  @return SMI entry
+
+**/
+SMI_ENTRY  *
+SmmCoreFindSmiEntry (
+  IN CONST EFI_GUID  *HandlerType,
+  IN BOOLEAN         Create
+  )
+{
+  LIST_ENTRY  *Bucket;
+  LIST_ENTRY  *Link;
+  SMI_ENTRY   *Item;
+  SMI_ENTRY   *SmiEntry;
+
+  if (HandlerType == NULL) {
+    return &mRootSmiEntry;
+  }
+
+  //
+  // Search the bucket of HandlerType for an entry that matches
+  //
+  SmiEntry = NULL;
+  Bucket = SmmCoreGetSmiEntryBucket (HandlerType);
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Item = CR (Link, SMI_ENTRY, HashLink, SMI_ENTRY_SIGNATURE);
+    if (CompareGuid (&Item->HandlerType, HandlerType)) {
+      //
+      // This is the SMI entry
+      //
+      SmiEntry = Item;
+      break;
+    }
+  }
+
+  //
+  // If the entry does not exist, create one
+  //
+  if (SmiEntry == NULL && Create) {
+    SmiEntry = AllocatePool (sizeof(SMI_ENTRY));
+    if (SmiEntry != NULL) {
+      //
+      // Initialize new SMI entry structure
+      //
+      SmiEntry->Signature = SMI_ENTRY_SIGNATURE;
+      CopyGuid ((VOID *)&SmiEntry->HandlerType, HandlerType);
+      InitializeListHead (&SmiEntry->SmiHandlers);
+
+      //
+      // Add it to the SMI entry list and to its bucket
+      //
+      InsertTailList (&mSmiEntryList, &SmiEntry->AllEntries);
+      InsertTailList (Bucket, &SmiEntry->HashLink);
+      mSmiEntryCount++;
+    }
+  }
+  return SmiEntry;
+}
+
+/**
+  Free an SMI entry that has no handler left.
+
+  @param  SmiEntry       The SMI entry.
+
+**/
+VOID
+SmmCoreFreeEmptySmiEntry (
+  IN SMI_ENTRY  *SmiEntry
+  )
+{
+  if (SmiEntry != &mRootSmiEntry && IsListEmpty (&SmiEntry->SmiHandlers)) {
+    RemoveEntryList (&SmiEntry->AllEntries);
+    RemoveEntryList (&SmiEntry->HashLink);
+    mSmiEntryCount--;
+    FreePool (SmiEntry);
+  }
+}
+
+/**
+  Remove the handlers of an SMI entry unregistered while SmiManage() was
+  running, and free the entry if none is left.
+
+  @param  SmiEntry       The SMI entry.
+
+**/
+VOID
+SmmCoreRemovePendingSmiHandlersOfEntry (
+  IN SMI_ENTRY  *SmiEntry
+  )
+{
+  LIST_ENTRY   *Link;
+  LIST_ENTRY   *NextLink;
+  SMI_HANDLER  *SmiHandler;
+
+  for (Link = SmiEntry->SmiHandlers.ForwardLink; Link != &SmiEntry->SmiHandlers; Link = NextLink) {
+    NextLink = Link->ForwardLink;
+    SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+    if (SmiHandler->ToRemove) {
+      RemoveEntryList (&SmiHandler->Link);
+      FreePool (SmiHandler);
+    }
+  }
+  SmmCoreFreeEmptySmiEntry (SmiEntry);
+}
+
+/**
+  Remove the handlers unregistered while SmiManage() was running.
+
+**/
+VOID
+SmmCoreRemovePendingSmiHandlers (
+  VOID
+  )
+{
+  LIST_ENTRY  *Link;
+  LIST_ENTRY  *NextLink;
+
+  mSmiHandlerRemovePending = FALSE;
+
+  SmmCoreRemovePendingSmiHandlersOfEntry (&mRootSmiEntry);
+  for (Link = mSmiEntryList.ForwardLink; Link != &mSmiEntryList; Link = NextLink) {
+    NextLink = Link->ForwardLink;
+    SmmCoreRemovePendingSmiHandlersOfEntry (CR (Link, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE));
+  }
+}
+
+/**
+  Manage SMI of a particular type.
+
+  @param  HandlerType    Points to the handler type or NULL for root SMI handlers.
+  @param  Context        Points to an optional context buffer.
+  @param  CommBuffer     Points to the optional communication buffer.
+  @param  CommBufferSize Points to the size of the optional communication buffer.
+
+  @retval EFI_WARN_INTERRUPT_SOURCE_PENDING  Interrupt source was processed successfully but not quiesced.
+  @retval EFI_INTERRUPT_PENDING              One or more SMI sources could not be quiesced.
+  @retval EFI_NOT_FOUND                      Interrupt source was not handled or quiesced.
+  @retval EFI_SUCCESS                        Interrupt source was handled and quiesced.
+
+**/
+EFI_STATUS
+EFIAPI
+SmiManage (
+  IN     CONST EFI_GUID           *HandlerType,
+  IN     CONST VOID               *Context         OPTIONAL,
+  IN OUT VOID                     *CommBuffer      OPTIONAL,
+  IN OUT UINTN                    *CommBufferSize  OPTIONAL
+  )
+{
+  LIST_ENTRY   *Link;
+  LIST_ENTRY   *Head;
+  SMI_ENTRY    *SmiEntry;
+  SMI_HANDLER  *SmiHandler;
+  BOOLEAN      SuccessReturn;
+  EFI_STATUS   Status;
+
+  Status = EFI_NOT_FOUND;
+  SuccessReturn = FALSE;
+  SmiEntry = SmmCoreFindSmiEntry (HandlerType, FALSE);
+  if (SmiEntry == NULL) {
+    //
+    // There is no handler registered for this interrupt source
+    //
+    return Status;
+  }
+
+  Head = &SmiEntry->SmiHandlers;
+  mSmiManageCallingDepth++;
+
+  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+    SmiHandler = CR (Link, SMI_HANDLER, Link, SMI_HANDLER_SIGNATURE);
+    if (SmiHandler->ToRemove) {
+      continue;
+    }
+
+    Status = SmiHandler->Handler (
+               (EFI_HANDLE) SmiHandler,
+               Context,
+               CommBuffer,
+               CommBufferSize
+               );
+
+    switch (Status) {
+    case EFI_INTERRUPT_PENDING:
+      //
+      // If a handler returns EFI_INTERRUPT_PENDING and HandlerType is not NULL then
+      // no additional handlers will be processed and EFI_INTERRUPT_PENDING will be returned.
+      //
+      if (HandlerType != NULL) {
+        goto Done;
+      }
+      break;
+
+    case EFI_SUCCESS:
+      //
+      // If at least one of the handlers returns EFI_SUCCESS then the function will return
+      // EFI_SUCCESS. If a handler returns EFI_SUCCESS and HandlerType is not NULL then no
+      // additional handlers will be processed.
+      //
+      if (HandlerType != NULL) {
+        goto Done;
+      }
+      SuccessReturn = TRUE;
+      break;
+
+    case EFI_WARN_INTERRUPT_SOURCE_QUIESCED:
+      //
+      // If at least one of the handlers returns EFI_WARN_INTERRUPT_SOURCE_QUIESCED
+      // then the function will return EFI_SUCCESS.
+      //
+      SuccessReturn = TRUE;
+      break;
+
+    case EFI_WARN_INTERRUPT_SOURCE_PENDING:
+      //
+      // If all the handlers returned EFI_WARN_INTERRUPT_SOURCE_PENDING
+      // then EFI_WARN_INTERRUPT_SOURCE_PENDING will be returned.
+      //
+      break;
+
+    default:
+      //
+      // The SMM core asserts here. Communication handlers return errors for
+      // malformed buffers, which is what a fuzzer feeds them, so only log it.
+      //
+      DEBUG ((DEBUG_INFO, "SmiManage - handler %p returned %r\n", SmiHandler->Handler, Status));
+      break;
+    }
+  }
+
+  if (SuccessReturn) {
+    Status = EFI_SUCCESS;
+  }
+
+Done:
+  mSmiManageCallingDepth--;
+  if (mSmiManageCallingDepth == 0 && mSmiHandlerRemovePending) {
+    SmmCoreRemovePendingSmiHandlers ();
+  }
+  return Status;
+}
+
+/**
+  Registers a handler to execute within SMM.
+
+  @param  Handler        Handler service funtion pointer.
+  @param  HandlerType    Points to the handler type or NULL for root SMI handlers.
+  @param  DispatchHandle On return, contains a unique handle which can be used to later unregister the handler function.
+
+  @retval EFI_SUCCESS           Handler register success.
+  @retval EFI_INVALID_PARAMETER Handler or DispatchHandle is NULL.
+  @retval EFI_OUT_OF_RESOURCES  There is no memory for the handler.
+
+**/
+EFI_STATUS
+EFIAPI
+SmiHandlerRegister (
+  IN  EFI_SMM_HANDLER_ENTRY_POINT2  Handler,
+  IN  CONST EFI_GUID                *HandlerType  OPTIONAL,
+  OUT EFI_HANDLE                    *DispatchHandle
+  )
+{
+  SMI_HANDLER  *SmiHandler;
+  SMI_ENTRY    *SmiEntry;
+
+  if (Handler == NULL || DispatchHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SmiHandler = AllocateZeroPool (sizeof (SMI_HANDLER));
+  if (SmiHandler == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SmiHandler->Signature = SMI_HANDLER_SIGNATURE;
+  SmiHandler->Handler = Handler;
+  SmiHandler->CallerAddr = (UINTN)RETURN_ADDRESS (0);
+
+  SmiEntry = SmmCoreFindSmiEntry (HandlerType, TRUE);
+  if (SmiEntry == NULL) {
+    FreePool (SmiHandler);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SmiHandler->SmiEntry = SmiEntry;
+  InsertTailList (&SmiEntry->SmiHandlers, &SmiHandler->Link);
+
+  *DispatchHandle = (EFI_HANDLE) SmiHandler;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Unregister a handler in SMM.
+
+  @param  DispatchHandle  The handle that was specified when the handler was registered.
+
+  @retval EFI_SUCCESS           Handler function was successfully unregistered.
+  @retval EFI_INVALID_PARAMETER DispatchHandle does not refer to a valid handle.
+
+**/
+EFI_STATUS
+EFIAPI
+SmiHandlerUnRegister (
+  IN EFI_HANDLE  DispatchHandle
+  )
+{
+  SMI_HANDLER  *SmiHandler;
+  SMI_ENTRY    *SmiEntry;
+  LIST_ENTRY   *Link;
+
+  //
+  // Look the handle up in the entry it claims to belong to, so a stale or
+  // forged handle is rejected instead of being freed.
+  //
+  SmiHandler = (SMI_HANDLER *) DispatchHandle;
+  if (SmiHandler == NULL || SmiHandler->Signature != SMI_HANDLER_SIGNATURE || SmiHandler->ToRemove) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  SmiEntry = SmmCoreFindSmiEntry (
+               SmiHandler->SmiEntry == &mRootSmiEntry ? NULL : &SmiHandler->SmiEntry->HandlerType,
+               FALSE
+               );
+  if (SmiEntry != SmiHandler->SmiEntry) {
+    return EFI_INVALID_PARAMETER;
+  }
+  for (Link = SmiEntry->SmiHandlers.ForwardLink; Link != &SmiEntry->SmiHandlers; Link = Link->ForwardLink) {
+    if (Link == &SmiHandler->Link) {
+      break;
+    }
+  }
+  if (Link == &SmiEntry->SmiHandlers) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mSmiManageCallingDepth > 0) {
+    //
+    // SmiManage() may be walking this list, remove the handler when it returns
+    //
+    SmiHandler->ToRemove = TRUE;
+    mSmiHandlerRemovePending = TRUE;
+    return EFI_SUCCESS;
+  }
+
+  RemoveEntryList (&SmiHandler->Link);
+  FreePool (SmiHandler);
+  SmmCoreFreeEmptySmiEntry (SmiEntry);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the number of handler types with at least one handler registered.
+
+  Root SMI handlers, registered with a NULL HandlerType, are not counted.
+
+  @return The number of handler types.
+
+**/
+UINTN
+EFIAPI
+SmiHandlerRegistryGetTypeCount (
+  VOID
+  )
+{
+  return mSmiEntryCount;
+}
+
+/**
+  Return a registered handler type.
+
+  @param[in] Index  The index of the handler type, in registration order.
+
+  @return The handler type, or NULL if Index is not below
+          SmiHandlerRegistryGetTypeCount().
+
+**/
+CONST EFI_GUID *
+EFIAPI
+SmiHandlerRegistryGetType (
+  IN UINTN  Index
+  )
+{
+  LIST_ENTRY  *Link;
+  SMI_ENTRY   *SmiEntry;
+
+  if (Index >= mSmiEntryCount) {
+    return NULL;
+  }
+
+  for (Link = mSmiEntryList.ForwardLink; Index > 0; Link = Link->ForwardLink) {
+    Index--;
+  }
+  SmiEntry = CR (Link, SMI_ENTRY, AllEntries, SMI_ENTRY_SIGNATURE);
+  return &SmiEntry->HandlerType;
+}
@@ -77,36 +77,3 @@ SmmFreePool (
   free (Buffer);
   return EFI_SUCCESS;
 }
-
-EFI_STATUS
-EFIAPI
-SmiManage (
-  IN     CONST EFI_GUID           *HandlerType,
-  IN     CONST VOID               *Context         OPTIONAL,
-  IN OUT VOID                     *CommBuffer      OPTIONAL,
-  IN OUT UINTN                    *CommBufferSize  OPTIONAL
-  )
-{
-  return EFI_NOT_AVAILABLE_YET;
-}
-
-EFI_STATUS
-EFIAPI
-SmiHandlerRegister (
-  IN  EFI_SMM_HANDLER_ENTRY_POINT2  Handler,
-  IN  CONST EFI_GUID                *HandlerType  OPTIONAL,
-  OUT EFI_HANDLE                    *DispatchHandle
-  )
-{
-  return EFI_NOT_AVAILABLE_YET;
-}
-
-EFI_STATUS
-EFIAPI
-SmiHandlerUnRegister (
-  IN EFI_HANDLE  DispatchHandle
-  )
-{
-  return EFI_NOT_AVAILABLE_YET;
-}
-
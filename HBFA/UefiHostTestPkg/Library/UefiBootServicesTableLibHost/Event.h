@@ -88,4 +88,37 @@ CoreInitializeTimer (
   VOID
   );
 
+
+/**
+  Signals the timer check event if the first timer of the queue expired.
+
+**/
+VOID
+CorePollTimers (
+  VOID
+  );
+
+
+/**
+  Moves the virtual clock to the next timer and fires it.
+
+  @retval TRUE   A timer is set.
+  @retval FALSE  No timer is set, the clock moved by HOST_IDLE_PERIOD.
+
+**/
+BOOLEAN
+CoreIdleUntilNextTimer (
+  VOID
+  );
+
+
+/**
+  Cancels all timers.
+
+**/
+VOID
+CoreResetTimers (
+  VOID
+  );
+
 #endif
@@ -29,7 +29,7 @@ CoreNotifyProtocolEntry (
 
   for (Link=ProtEntry->Notify.ForwardLink; Link != &ProtEntry->Notify; Link=Link->ForwardLink) {
     ProtNotify = CR(Link, PROTOCOL_NOTIFY, Link, PROTOCOL_NOTIFY_SIGNATURE);
-    // CoreSignalEvent (ProtNotify->Event);
+    CoreSignalEvent (ProtNotify->Event);
   }
 }
 
@@ -0,0 +1,401 @@
+/** @file
+  Core Timer Services
+
+  There is no timer interrupt on the host. The system time is the virtual
+  clock of TimerLib, and the timer queue is checked against it whenever the
+  TPL is lowered, an event is checked, or Stall() returns.
+
+Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+
+#include "DxeMain.h"
+#include "Event.h"
+
+#include <Library/VirtualClockLib.h>
+
+//
+// Period of a periodic timer set with a TriggerTime of 0, in 100ns units.
+// It stands for the period of the timer architectural protocol.
+//
+#define HOST_TIMER_PERIOD  100000
+
+//
+// Virtual time a wait that no timer can end takes per round, in 100ns units.
+//
+#define HOST_IDLE_PERIOD   10000
+
+//
+// Internal prototypes
+//
+/**
+  Returns the current system time.
+
+  @return The current system time
+
+**/
+UINT64
+CoreCurrentSystemTime (
+  VOID
+  );
+
+/**
+  Checks the sorted timer list against the current system time.
+  Signals any expired event timer.
+
+  @param  CheckEvent             Not used
+  @param  Context                Not used
+
+**/
+VOID
+EFIAPI
+CoreCheckTimers (
+  IN EFI_EVENT            CheckEvent,
+  IN VOID                 *Context
+  );
+
+/**
+  Inserts the timer event.
+
+  @param  Event                  Points to the internal structure of timer event
+                                 to be installed
+
+**/
+VOID
+CoreInsertEventTimer (
+  IN IEVENT       *Event
+  );
+
+//
+// Internal data
+//
+
+LIST_ENTRY      mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+EFI_LOCK        mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
+EFI_EVENT       mEfiCheckTimerEvent = NULL;
+
+//
+// Timer functions
+//
+/**
+  Initializes timer support.
+
+**/
+VOID
+CoreInitializeTimer (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = CoreCreateEventInternal (
+             EVT_NOTIFY_SIGNAL,
+             TPL_HIGH_LEVEL - 1,
+             CoreCheckTimers,
+             NULL,
+             NULL,
+             &mEfiCheckTimerEvent
+             );
+  ASSERT_EFI_ERROR (Status);
+}
+
+
+/**
+  Returns the current system time.
+
+  @return The current system time
+
+**/
+UINT64
+CoreCurrentSystemTime (
+  VOID
+  )
+{
+  return DivU64x32 (VirtualClockGetTime (), 100);
+}
+
+
+/**
+  Signals the timer check event if the first timer of the queue expired.
+
+  This stands for the timer tick of the timer architectural protocol. The
+  check event is dispatched when the TPL drops below TPL_HIGH_LEVEL - 1.
+
+**/
+VOID
+CorePollTimers (
+  VOID
+  )
+{
+  IEVENT          *Event;
+
+  if (mEfiCheckTimerEvent == NULL || IsListEmpty (&mEfiTimerList)) {
+    return;
+  }
+  if (((IEVENT *)mEfiCheckTimerEvent)->SignalCount != 0) {
+    return;
+  }
+
+  Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  if (Event->Timer.TriggerTime <= CoreCurrentSystemTime ()) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
+  }
+}
+
+
+/**
+  Moves the virtual clock to the trigger time of the first timer of the
+  queue and fires it. If no timer is set, moves the clock by
+  HOST_IDLE_PERIOD.
+
+  @retval TRUE   A timer is set.
+  @retval FALSE  No timer is set.
+
+**/
+BOOLEAN
+CoreIdleUntilNextTimer (
+  VOID
+  )
+{
+  IEVENT          *Event;
+  UINT64          SystemTime;
+  UINT64          Delay;
+  BOOLEAN         TimerSet;
+
+  Delay = HOST_IDLE_PERIOD;
+  TimerSet = (BOOLEAN)!IsListEmpty (&mEfiTimerList);
+  if (TimerSet) {
+    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    SystemTime = CoreCurrentSystemTime ();
+    Delay = 0;
+    if (Event->Timer.TriggerTime > SystemTime) {
+      Delay = Event->Timer.TriggerTime - SystemTime;
+    }
+  }
+
+  if (Delay > DivU64x32 (MAX_UINT64, 100)) {
+    VirtualClockAdvance (MAX_UINT64);
+  } else {
+    //
+    // The clock counts in ns. Round up so the trigger time is reached.
+    //
+    VirtualClockAdvance (MultU64x32 (Delay, 100) + 99);
+  }
+  CorePollTimers ();
+  return TimerSet;
+}
+
+
+/**
+  Cancels all timers, for the next test run.
+
+  The timer lock is not taken: releasing it would lower the TPL and dispatch
+  what the caller is about to drop.
+
+**/
+VOID
+CoreResetTimers (
+  VOID
+  )
+{
+  IEVENT          *Event;
+
+  while (!IsListEmpty (&mEfiTimerList)) {
+    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    RemoveEntryList (&Event->Timer.Link);
+    Event->Timer.Link.ForwardLink = NULL;
+    Event->Timer.TriggerTime = 0;
+    Event->Timer.Period = 0;
+  }
+}
+
+
+/**
+  Checks the sorted timer list against the current system time.
+  Signals any expired event timer.
+
+  @param  CheckEvent             Not used
+  @param  Context                Not used
+
+**/
+VOID
+EFIAPI
+CoreCheckTimers (
+  IN EFI_EVENT            CheckEvent,
+  IN VOID                 *Context
+  )
+{
+  UINT64                  SystemTime;
+  IEVENT                  *Event;
+
+  //
+  // Check the timer database for expired timers
+  //
+  CoreAcquireLock (&mEfiTimerLock);
+  SystemTime = CoreCurrentSystemTime ();
+
+  while (!IsListEmpty (&mEfiTimerList)) {
+    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+
+    //
+    // If this timer is not expired, then we're done
+    //
+    if (Event->Timer.TriggerTime > SystemTime) {
+      break;
+    }
+
+    //
+    // Remove this timer from the timer queue
+    //
+
+    RemoveEntryList (&Event->Timer.Link);
+    Event->Timer.Link.ForwardLink = NULL;
+
+    //
+    // Signal it
+    //
+    CoreSignalEvent (Event);
+
+    //
+    // If this is a periodic timer, set it
+    //
+    if (Event->Timer.Period != 0) {
+      //
+      // Compute the timers new trigger time
+      //
+      Event->Timer.TriggerTime = Event->Timer.TriggerTime + Event->Timer.Period;
+
+      //
+      // If that's before now, then reset the timer to start from now
+      //
+      if (Event->Timer.TriggerTime <= SystemTime) {
+        Event->Timer.TriggerTime = SystemTime;
+        CoreSignalEvent (mEfiCheckTimerEvent);
+      }
+
+      //
+      // Add the timer
+      //
+      CoreInsertEventTimer (Event);
+    }
+  }
+
+  CoreReleaseLock (&mEfiTimerLock);
+}
+
+
+/**
+  Inserts the timer event.
+
+  @param  Event                  Points to the internal structure of timer event
+                                 to be installed
+
+**/
+VOID
+CoreInsertEventTimer (
+  IN IEVENT       *Event
+  )
+{
+  UINT64          TriggerTime;
+  LIST_ENTRY      *Link;
+  IEVENT          *Event2;
+
+  ASSERT_LOCKED (&mEfiTimerLock);
+
+  //
+  // Get the timer's trigger time
+  //
+  TriggerTime = Event->Timer.TriggerTime;
+
+  //
+  // Insert the timer into the timer database in assending sorted order
+  //
+  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
+    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+
+    if (Event2->Timer.TriggerTime > TriggerTime) {
+      break;
+    }
+  }
+
+  InsertTailList (Link, &Event->Timer.Link);
+}
+
+
+
+
+/**
+  Sets the type of timer and the trigger time for a timer event.
+
+  @param  UserEvent              The timer event that is to be signaled at the
+                                 specified time
+  @param  Type                   The type of time that is specified in
+                                 TriggerTime
+  @param  TriggerTime            The number of 100ns units until the timer
+                                 expires
+
+  @retval EFI_SUCCESS            The event has been set to be signaled at the
+                                 requested time
+  @retval EFI_INVALID_PARAMETER  Event or Type is not valid
+
+**/
+EFI_STATUS
+EFIAPI
+CoreSetTimer (
+  IN EFI_EVENT            UserEvent,
+  IN EFI_TIMER_DELAY      Type,
+  IN UINT64               TriggerTime
+  )
+{
+  IEVENT      *Event;
+
+  Event = UserEvent;
+
+  if (Event == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Event->Signature != EVENT_SIGNATURE) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((UINT32)Type > TimerRelative  || (Event->Type & EVT_TIMER) == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CoreAcquireLock (&mEfiTimerLock);
+
+  //
+  // If the timer is queued to the timer database, remove it
+  //
+  if (Event->Timer.Link.ForwardLink != NULL) {
+    RemoveEntryList (&Event->Timer.Link);
+    Event->Timer.Link.ForwardLink = NULL;
+  }
+
+  Event->Timer.TriggerTime = 0;
+  Event->Timer.Period = 0;
+
+  if (Type != TimerCancel) {
+
+    if (Type == TimerPeriodic) {
+      if (TriggerTime == 0) {
+        TriggerTime = HOST_TIMER_PERIOD;
+      }
+      Event->Timer.Period = TriggerTime;
+    }
+
+    Event->Timer.TriggerTime = CoreCurrentSystemTime () + TriggerTime;
+    CoreInsertEventTimer (Event);
+
+    if (TriggerTime == 0) {
+      CoreSignalEvent (mEfiCheckTimerEvent);
+    }
+  }
+
+  CoreReleaseLock (&mEfiTimerLock);
+
+  return EFI_SUCCESS;
+}
@@ -7,8 +7,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "DxeMain.h"
-
-#define VALID_TPL(a)            ((a) <= TPL_HIGH_LEVEL)
+#include "Event.h"
 
 EFI_TPL gEfiCurrentTpl = TPL_APPLICATION;
 
@@ -62,6 +61,7 @@ CoreRestoreTpl (
   )
 {
   EFI_TPL     OldTpl;
+  EFI_TPL     PendingTpl;
 
   OldTpl = gEfiCurrentTpl;
   if (NewTpl > OldTpl) {
@@ -70,6 +70,27 @@ CoreRestoreTpl (
   }
   ASSERT (VALID_TPL (NewTpl));
 
+  //
+  // There is no timer interrupt. Fire the expired timers when their notify
+  // functions may run.
+  //
+  if (NewTpl < TPL_HIGH_LEVEL - 1) {
+    CorePollTimers ();
+  }
+
+  //
+  // Dispatch any pending events
+  //
+  while (gEventPending != 0) {
+    PendingTpl = (UINTN) HighBitSet64 (gEventPending);
+    if (PendingTpl <= NewTpl) {
+      break;
+    }
+
+    gEfiCurrentTpl = PendingTpl;
+    CoreDispatchEventNotifies (gEfiCurrentTpl);
+  }
+
   //
   // Set the new value
   //
@@ -13,8 +13,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Uefi.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/TimerLib.h>
 
 #include "DxeMain.h"
+#include "Event.h"
 
 extern EFI_BOOT_SERVICES mBootServices;
 extern EFI_SYSTEM_TABLE mEfiSystemTableTemplate;
@@ -81,6 +83,20 @@ CoreFreePool (
   return EFI_SUCCESS;
 }
 
+EFI_STATUS
+EFIAPI
+CoreStall (
+  IN UINTN            Microseconds
+  )
+{
+  //
+  // Advance the virtual clock of TimerLib instead of sleeping.
+  //
+  MicroSecondDelay (Microseconds);
+  CorePollTimers ();
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 EFIAPI
 CoreEfiNotAvailableYetArg0 (
@@ -181,12 +197,12 @@ EFI_BOOT_SERVICES mBootServices = {
   (EFI_GET_MEMORY_MAP)                          CoreEfiNotAvailableYetArg5,               // GetMemoryMap
   (EFI_ALLOCATE_POOL)                           CoreAllocatePool,                         // AllocatePool
   (EFI_FREE_POOL)                               CoreFreePool,                             // FreePool
-  (EFI_CREATE_EVENT)                            CoreEfiNotAvailableYetArg5,               // CreateEvent
-  (EFI_SET_TIMER)                               CoreEfiNotAvailableYetArg3,               // SetTimer
-  (EFI_WAIT_FOR_EVENT)                          CoreEfiNotAvailableYetArg3,               // WaitForEvent
-  (EFI_SIGNAL_EVENT)                            CoreEfiNotAvailableYetArg1,               // SignalEvent
-  (EFI_CLOSE_EVENT)                             CoreEfiNotAvailableYetArg1,               // CloseEvent
-  (EFI_CHECK_EVENT)                             CoreEfiNotAvailableYetArg1,               // CheckEvent
+  (EFI_CREATE_EVENT)                            CoreCreateEvent,                          // CreateEvent
+  (EFI_SET_TIMER)                               CoreSetTimer,                             // SetTimer
+  (EFI_WAIT_FOR_EVENT)                          CoreWaitForEvent,                         // WaitForEvent
+  (EFI_SIGNAL_EVENT)                            CoreSignalEvent,                          // SignalEvent
+  (EFI_CLOSE_EVENT)                             CoreCloseEvent,                           // CloseEvent
+  (EFI_CHECK_EVENT)                             CoreCheckEvent,                           // CheckEvent
   (EFI_INSTALL_PROTOCOL_INTERFACE)              CoreInstallProtocolInterface,             // InstallProtocolInterface
   (EFI_REINSTALL_PROTOCOL_INTERFACE)            CoreReinstallProtocolInterface,           // ReinstallProtocolInterface
   (EFI_UNINSTALL_PROTOCOL_INTERFACE)            CoreUninstallProtocolInterface,           // UninstallProtocolInterface
@@ -202,7 +218,7 @@ EFI_BOOT_SERVICES mBootServices = {
   (EFI_IMAGE_UNLOAD)                            CoreEfiNotAvailableYetArg1,               // UnloadImage
   (EFI_EXIT_BOOT_SERVICES)                      CoreEfiNotAvailableYetArg2,               // ExitBootServices
   (EFI_GET_NEXT_MONOTONIC_COUNT)                CoreEfiNotAvailableYetArg1,               // GetNextMonotonicCount
-  (EFI_STALL)                                   CoreEfiNotAvailableYetArg1,               // Stall
+  (EFI_STALL)                                   CoreStall,                                // Stall
   (EFI_SET_WATCHDOG_TIMER)                      CoreEfiNotAvailableYetArg4,               // SetWatchdogTimer
   (EFI_CONNECT_CONTROLLER)                      CoreEfiNotAvailableYetArg4,               // ConnectController
   (EFI_DISCONNECT_CONTROLLER)                   CoreEfiNotAvailableYetArg3,               // DisconnectController
@@ -217,7 +233,7 @@ EFI_BOOT_SERVICES mBootServices = {
   (EFI_CALCULATE_CRC32)                         CoreEfiNotAvailableYetArg3,               // CalculateCrc32
   (EFI_COPY_MEM)                                CopyMem,                                  // CopyMem
   (EFI_SET_MEM)                                 SetMem,                                   // SetMem
-  (EFI_CREATE_EVENT_EX)                         CoreEfiNotAvailableYetArg6                // CreateEventEx
+  (EFI_CREATE_EVENT_EX)                         CoreCreateEventEx                         // CreateEventEx
 };
 
 EFI_STATUS
@@ -283,6 +299,8 @@ UefiBootServicesTableLibConstructor (
 {
   EFI_STATUS  Status;
 
+  CoreInitializeEventServices ();
+
   Status = gBS->InstallProtocolInterface (
                   &gImageHandle,
                   &gEfiLoadedImageProtocolGuid,
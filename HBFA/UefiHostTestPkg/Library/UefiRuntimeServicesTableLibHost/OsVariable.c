@@ -10,7 +10,17 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "VariableCommon.h"
 #include "AuthVariable.h"
 
+#include <Library/VariableStoreLib.h>
+
+//
+// mVarListEntry keeps the variables in creation order, the order of
+// GetNextVariableName(). mVarHashBuckets indexes them by GUID and name.
+//
+#define VARIABLE_HASH_BUCKET_COUNT  256
+
 LIST_ENTRY                  mVarListEntry = INITIALIZE_LIST_HEAD_VARIABLE(mVarListEntry);
+LIST_ENTRY                  mVarHashBuckets[VARIABLE_HASH_BUCKET_COUNT];
+BOOLEAN                     mVarStoreInitialized = FALSE;
 
 /**
   Compare two EFI_TIME data.
@@ -109,6 +119,69 @@ Returns:
   }
 }
 
+/**
+  Import the variable store image named by VARIABLE_STORE_IMAGE_ENV, once.
+
+**/
+VOID
+InitializeVariableStore (
+  VOID
+  )
+{
+  CHAR8       *FileName;
+  EFI_STATUS  Status;
+
+  if (mVarStoreInitialized) {
+    return;
+  }
+  mVarStoreInitialized = TRUE;
+
+  FileName = getenv (VARIABLE_STORE_IMAGE_ENV);
+  if (FileName != NULL) {
+    Status = VariableStoreImportFile (FileName);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Import variable store %a - %r\n", FileName, Status));
+    }
+  }
+}
+
+/**
+  Return the bucket of mVarHashBuckets a variable is indexed in.
+
+  @param Name                The variable name.
+  @param Guid                The variable vendor GUID.
+
+  @return The list head of the bucket.
+
+**/
+LIST_ENTRY *
+GetVariableHashBucket (
+  IN  CHAR16         *Name,
+  IN  EFI_GUID       *Guid
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  if (mVarHashBuckets[0].ForwardLink == NULL) {
+    for (Index = 0; Index < VARIABLE_HASH_BUCKET_COUNT; Index++) {
+      InitializeListHead (&mVarHashBuckets[Index]);
+    }
+  }
+
+  //
+  // FNV-1a of the GUID and the name
+  //
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < sizeof (*Guid); Index++) {
+    Hash = (Hash ^ ((UINT8 *)Guid)[Index]) * 0x01000193;
+  }
+  for (Index = 0; Name[Index] != 0; Index++) {
+    Hash = (Hash ^ Name[Index]) * 0x01000193;
+  }
+  return &mVarHashBuckets[Hash % VARIABLE_HASH_BUCKET_COUNT];
+}
+
 LIST_ENTRY *
 FindVariableList (
   IN  LIST_ENTRY     *StorageListHead,
@@ -116,9 +189,24 @@ FindVariableList (
   IN  EFI_GUID       *Guid
   )
 {
+  LIST_ENTRY              *Bucket;
   LIST_ENTRY              *Link;
   VARIABLE_INFO_PRIVATE   *Storage;
 
+  if (StorageListHead == &mVarListEntry) {
+    InitializeVariableStore ();
+
+    Bucket = GetVariableHashBucket (Name, Guid);
+    for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+      Storage = CR (Link, VARIABLE_INFO_PRIVATE, HashLink, VARIABLE_INFO_PRIVATE_SIGNATURE);
+      if ((CompareGuid (&Storage->Guid, Guid)) &&
+          (StrCmp (Storage->Name, Name) == 0)) {
+        return &Storage->Link;
+      }
+    }
+    return NULL;
+  }
+
   if (StorageListHead->ForwardLink != NULL) {
     Link = GetFirstNode (StorageListHead);
     while (!IsNull (StorageListHead, Link)) {
@@ -430,6 +518,9 @@ CreateVariableList (
   }
 
   InsertTailList(StorageListHead, &Storage->Link);
+  if (StorageListHead == &mVarListEntry) {
+    InsertTailList (GetVariableHashBucket (Storage->Name, &Storage->Guid), &Storage->HashLink);
+  }
 
   return EFI_SUCCESS;
 }
@@ -451,6 +542,12 @@ DeleteVariableList (
 
   Storage = VARIABLE_INFO_PRIVATE_FROM_LINK (Link);
   RemoveEntryList (&Storage->Link);
+  if (StorageListHead == &mVarListEntry) {
+    RemoveEntryList (&Storage->HashLink);
+  }
+  free (Storage->Buffer);
+  free (Storage->Name);
+  free (Storage);
 
   return EFI_SUCCESS;
 }
@@ -782,3 +879,80 @@ CoreGetVariable (
 
   return EFI_SUCCESS;
 }
+
+/**
+  Enumerates the current variable names, in the order they were created.
+
+  @param  VariableNameSize       The size of the VariableName buffer.
+  @param  VariableName           On input, supplies the last VariableName that was returned
+                                 by GetNextVariableName(). On output, returns the Nullterminated
+                                 string of the current variable.
+  @param  VendorGuid             On input, supplies the last VendorGuid that was returned by
+                                 GetNextVariableName(). On output, returns the
+                                 VendorGuid of the current variable.
+
+  @retval EFI_SUCCESS            The function completed successfully.
+  @retval EFI_NOT_FOUND          The next variable was not found.
+  @retval EFI_BUFFER_TOO_SMALL   The VariableNameSize is too small for the result.
+  @retval EFI_INVALID_PARAMETER  VariableNameSize, VariableName or VendorGuid is NULL,
+                                 VariableName is not terminated within VariableNameSize,
+                                 or VariableName and VendorGuid do not name a variable.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetNextVariableName (
+  IN OUT UINTN                    *VariableNameSize,
+  IN OUT CHAR16                   *VariableName,
+  IN OUT EFI_GUID                 *VendorGuid
+  )
+{
+  LIST_ENTRY              *Link;
+  VARIABLE_INFO_PRIVATE   *Storage;
+  UINTN                   NameSize;
+
+  if (VariableNameSize == NULL || VariableName == NULL || VendorGuid == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (StrnLenS (VariableName, *VariableNameSize / sizeof (CHAR16)) == *VariableNameSize / sizeof (CHAR16)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  InitializeVariableStore ();
+
+  if (VariableName[0] == 0) {
+    Link = GetFirstNode (&mVarListEntry);
+  } else {
+    Link = FindVariableList (&mVarListEntry, VariableName, VendorGuid);
+    if (Link == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    Link = GetNextNode (&mVarListEntry, Link);
+  }
+
+  //
+  // Skip the variables CoreGetVariable() does not return
+  //
+  Storage = NULL;
+  while (!IsNull (&mVarListEntry, Link)) {
+    Storage = VARIABLE_INFO_PRIVATE_FROM_LINK (Link);
+    if (Storage->Size != 0) {
+      break;
+    }
+    Link = GetNextNode (&mVarListEntry, Link);
+  }
+  if (IsNull (&mVarListEntry, Link)) {
+    return EFI_NOT_FOUND;
+  }
+
+  NameSize = StrSize (Storage->Name);
+  if (*VariableNameSize < NameSize) {
+    *VariableNameSize = NameSize;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  CopyMem (VariableName, Storage->Name, NameSize);
+  CopyGuid (VendorGuid, &Storage->Guid);
+  *VariableNameSize = NameSize;
+
+  return EFI_SUCCESS;
+}
@@ -33,6 +33,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 typedef struct {
   UINTN            Signature;
   LIST_ENTRY       Link;
+  LIST_ENTRY       HashLink;
 
   EFI_GUID         Guid;
   CHAR16           *Name;
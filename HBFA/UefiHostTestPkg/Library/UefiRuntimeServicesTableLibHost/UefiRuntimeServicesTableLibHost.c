@@ -135,6 +135,14 @@ CoreGetVariable (
   OUT    VOID                        *Data           OPTIONAL
   );
 
+EFI_STATUS
+EFIAPI
+CoreGetNextVariableName (
+  IN OUT UINTN                    *VariableNameSize,
+  IN OUT CHAR16                   *VariableName,
+  IN OUT EFI_GUID                 *VendorGuid
+  );
+
 EFI_RUNTIME_SERVICES mEfiRuntimeServicesTableTemplate = {
   {
     EFI_RUNTIME_SERVICES_SIGNATURE,                               // Signature
@@ -150,7 +158,7 @@ EFI_RUNTIME_SERVICES mEfiRuntimeServicesTableTemplate = {
   (EFI_SET_VIRTUAL_ADDRESS_MAP)     CoreEfiNotAvailableYetArg4,   // SetVirtualAddressMap
   (EFI_CONVERT_POINTER)             CoreEfiNotAvailableYetArg2,   // ConvertPointer
   (EFI_GET_VARIABLE)                CoreGetVariable,              // GetVariable
-  (EFI_GET_NEXT_VARIABLE_NAME)      CoreEfiNotAvailableYetArg3,   // GetNextVariableName
+  (EFI_GET_NEXT_VARIABLE_NAME)      CoreGetNextVariableName,      // GetNextVariableName
   (EFI_SET_VARIABLE)                CoreSetVariable,              // SetVariable
   (EFI_GET_NEXT_HIGH_MONO_COUNT)    CoreEfiNotAvailableYetArg1,   // GetNextHighMonotonicCount
   (EFI_RESET_SYSTEM)                CoreEfiNotAvailableYetArg4,   // ResetSystem
@@ -11,6 +11,11 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "Variable.h"
 #include <time.h>
 
+#include <Pi/PiFirmwareVolume.h>
+#include <Library/VariableStoreLib.h>
+
+extern LIST_ENTRY mVarListEntry;
+
 /**
 
   Gets the pointer to the first variable header in given variable store area.
@@ -539,3 +544,255 @@ FindVariableInNv (
   }
   return Variable;
 }
+
+/**
+  Get the next variable of a variable store that lies within the store.
+
+  @param VariableStoreHeader    The variable store, checked by the caller.
+  @param VariableType           The type of the variable headers of the store.
+  @param Variable               The current variable, NULL for the first one.
+
+  @return The next variable, or NULL at the end of the variables.
+**/
+VARIABLE_HEADER *
+GetNextVariableInNv (
+  IN     VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN     VARIABLE_TYPE          VariableType,
+  IN     VARIABLE_HEADER        *Variable
+  )
+{
+  UINT8            *EndOfVariable;
+  UINT8            *Data;
+  UINTN            DataSize;
+
+  if (Variable == NULL) {
+    Variable = GetStartPointer (VariableStoreHeader);
+  } else {
+    Variable = GetNextVariablePtr (Variable, VariableType);
+  }
+  EndOfVariable = (UINT8 *) VariableStoreHeader + VariableStoreHeader->Size;
+  //
+  // Stop at the first header that does not fit, or is not written yet
+  //
+  if ((Variable == NULL) ||
+      ((UINT8 *) Variable + SizeOfVariableHeader (VariableType) > EndOfVariable) ||
+      !IsValidVariableHeader (Variable)) {
+    return NULL;
+  }
+  DataSize = DataSizeOfVariable (Variable, VariableType);
+  Data     = GetVariableDataPtr (Variable, VariableType);
+  if ((Data > EndOfVariable) || (DataSize > (UINTN) (EndOfVariable - Data))) {
+    return NULL;
+  }
+  return Variable;
+}
+
+/**
+  Check whether a variable store holds an added copy of a variable.
+
+  @param VariableStoreHeader    The variable store, checked by the caller.
+  @param VariableType           The type of the variable headers of the store.
+  @param VariableName           The name of the variable.
+  @param VendorGuid             The vendor GUID of the variable.
+
+  @retval TRUE                  The store holds an added copy.
+  @retval FALSE                 The store holds no added copy.
+**/
+BOOLEAN
+IsVariableAddedInNv (
+  IN     VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN     VARIABLE_TYPE          VariableType,
+  IN     CHAR16                 *VariableName,
+  IN     EFI_GUID               *VendorGuid
+  )
+{
+  VARIABLE_HEADER  *Variable;
+
+  for (Variable = GetNextVariableInNv (VariableStoreHeader, VariableType, NULL);
+       Variable != NULL;
+       Variable = GetNextVariableInNv (VariableStoreHeader, VariableType, Variable)) {
+    if ((Variable->Common.State == VAR_ADDED) &&
+        (NameSizeOfVariable (Variable, VariableType) == StrSize (VariableName)) &&
+        CompareGuid (GetVariableGuidPtr (Variable, VariableType), VendorGuid) &&
+        (CompareMem (GetVariableNamePtr (Variable, VariableType), VariableName, StrSize (VariableName)) == 0)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Import the variables of a variable store into the host store.
+
+  The added variables, and the ones in deleted transition the store holds no
+  added copy of, are imported in the order of the store.
+
+  @param VariableStoreHeader    The variable store, checked by the caller.
+  @param VariableType           The type of the variable headers of the store.
+
+  @retval EFI_SUCCESS           The variables are imported.
+  @retval EFI_OUT_OF_RESOURCES  There is no memory for the variables.
+**/
+EFI_STATUS
+ImportVariablesInNv (
+  IN     VARIABLE_STORE_HEADER  *VariableStoreHeader,
+  IN     VARIABLE_TYPE          VariableType
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  CHAR16           *VariableName;
+  EFI_GUID         *VendorGuid;
+  UINT8            *Data;
+  UINTN            NameSize;
+  UINTN            DataSize;
+  UINT8            State;
+  EFI_TIME         *TimeStamp;
+  EFI_STATUS       Status;
+
+  for (Variable = GetNextVariableInNv (VariableStoreHeader, VariableType, NULL);
+       Variable != NULL;
+       Variable = GetNextVariableInNv (VariableStoreHeader, VariableType, Variable)) {
+    NameSize     = NameSizeOfVariable (Variable, VariableType);
+    DataSize     = DataSizeOfVariable (Variable, VariableType);
+    Data         = GetVariableDataPtr (Variable, VariableType);
+    VariableName = GetVariableNamePtr (Variable, VariableType);
+    VendorGuid   = GetVariableGuidPtr (Variable, VariableType);
+    State        = Variable->Common.State;
+    if ((NameSize >= sizeof (CHAR16)) && (NameSize % sizeof (CHAR16) == 0) &&
+        (VariableName[NameSize / sizeof (CHAR16) - 1] == 0) && (DataSize != 0) &&
+        ((State == VAR_ADDED) ||
+         ((State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) &&
+          !IsVariableAddedInNv (VariableStoreHeader, VariableType, VariableName, VendorGuid)))) {
+      TimeStamp = NULL;
+      if (VariableType == VariableTypeTimeBasedAuth) {
+        TimeStamp = &Variable->TimeBasedAuth.TimeStamp;
+      }
+      Status = CreateVariableList (
+                 &mVarListEntry,
+                 VariableName,
+                 VendorGuid,
+                 AttributesOfVariable (Variable, VariableType),
+                 TimeStamp,
+                 DataSize,
+                 Data,
+                 FALSE
+                 );
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Import the variables of a variable store image into the host store.
+
+  The added variables, and the ones in deleted transition that have no added
+  copy in the image, are imported. A variable that is already in the host
+  store is replaced.
+
+  @param[in] Image      The variable store image.
+  @param[in] ImageSize  The size of the image.
+
+  @retval EFI_SUCCESS            The variables are imported.
+  @retval EFI_INVALID_PARAMETER  Image is NULL.
+  @retval EFI_UNSUPPORTED        The store signature is unknown.
+  @retval EFI_VOLUME_CORRUPTED   The store header is not valid.
+  @retval EFI_OUT_OF_RESOURCES   There is no memory for the variables.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableStoreImportImage (
+  IN CONST VOID  *Image,
+  IN UINTN       ImageSize
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+  VARIABLE_STORE_HEADER       *VariableStoreHeader;
+  VARIABLE_TYPE               VariableType;
+
+  if (Image == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Skip the header of a variable firmware volume
+  //
+  VariableStoreHeader = (VARIABLE_STORE_HEADER *) Image;
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) Image;
+  if ((ImageSize >= sizeof (EFI_FIRMWARE_VOLUME_HEADER)) &&
+      (FvHeader->Signature == EFI_FVH_SIGNATURE)) {
+    if (FvHeader->HeaderLength > ImageSize) {
+      return EFI_VOLUME_CORRUPTED;
+    }
+    VariableStoreHeader = (VARIABLE_STORE_HEADER *) ((UINT8 *) Image + FvHeader->HeaderLength);
+    ImageSize -= FvHeader->HeaderLength;
+  }
+
+  if (ImageSize < sizeof (VARIABLE_STORE_HEADER)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+  if (CompareGuid (&VariableStoreHeader->Signature, &gEfiAuthenticatedVariableGuid)) {
+    VariableType = VariableTypeTimeBasedAuth;
+  } else if (CompareGuid (&VariableStoreHeader->Signature, &gEfiVariableGuid)) {
+    VariableType = VariableTypeNormal;
+  } else {
+    return EFI_UNSUPPORTED;
+  }
+  if ((VariableStoreHeader->Format != VARIABLE_STORE_FORMATTED) ||
+      (VariableStoreHeader->State != VARIABLE_STORE_HEALTHY) ||
+      (VariableStoreHeader->Size < sizeof (VARIABLE_STORE_HEADER)) ||
+      (VariableStoreHeader->Size > ImageSize)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  InitializeVariableStore ();
+
+  return ImportVariablesInNv (VariableStoreHeader, VariableType);
+}
+
+/**
+  Import the variables of a variable store image file into the host store.
+
+  The file is read once, the host store keeps its own copy of the variables.
+
+  @param[in] FileName  The name of the image file.
+
+  @retval EFI_SUCCESS      The variables are imported.
+  @retval EFI_NOT_FOUND    The file cannot be read.
+  @return The status of VariableStoreImportImage().
+
+**/
+EFI_STATUS
+EFIAPI
+VariableStoreImportFile (
+  IN CONST CHAR8  *FileName
+  )
+{
+  FILE        *File;
+  UINT8       *Image;
+  long        ImageSize;
+  EFI_STATUS  Status;
+
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  Image = NULL;
+  Status = EFI_NOT_FOUND;
+  if ((fseek (File, 0, SEEK_END) == 0) && ((ImageSize = ftell (File)) > 0) &&
+      (fseek (File, 0, SEEK_SET) == 0)) {
+    Image = malloc (ImageSize);
+    if (Image == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else if (fread (Image, 1, ImageSize, File) == (size_t) ImageSize) {
+      Status = VariableStoreImportImage (Image, ImageSize);
+    }
+  }
+  fclose (File);
+  free (Image);
+  return Status;
+}
@@ -42,6 +42,11 @@ FindVariableList (
   IN  EFI_GUID       *Guid
   );
 
+VOID
+InitializeVariableStore (
+  VOID
+  );
+
 VARIABLE_INFO_PRIVATE*
 FindVariableInfoPtr(
   IN    CHAR16        *VariableName,
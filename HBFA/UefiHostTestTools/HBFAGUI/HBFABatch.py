@@ -0,0 +1,369 @@
+## @file
+# Build and fuzz a list of test cases without the GUI.
+#
+# Test modules are built with the settings of Env.conf, in one parallel build
+# per tool (see Script/BatchBuild.py), then fuzzed headless with a time budget
+# per job, several jobs at a time, and a summary of the batch is written. The
+# fuzzers are set up the way RunAFL.py, RunLibFuzzer.py and RunKLEE.py do.
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import os
+import re
+import sys
+import time
+import signal
+import platform
+import subprocess
+from optparse import OptionParser
+
+try:
+    import ConfigParser as configparser
+except Exception as e:
+    import configparser as configparser
+from plugins.GetTestCase import GetTestCase
+sys.path.append(os.path.dirname(os.path.dirname(os.path.realpath(__file__))))
+sys.path.append(os.path.join(os.path.dirname(os.path.dirname(os.path.realpath(__file__))), 'Script'))
+import RunAFL
+import RunKLEE
+import RunLibFuzzer
+from BatchBuild import BatchBuild, GetModuleFilePath, ReadListFile
+from GenFuzzDict import GenerateModuleDictionary
+from GenPcdDatabase import SetModulePcdDatabase
+from CoreNum import GetCoreNum
+
+__prog__ = 'HBFABatch.py'
+__copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
+__version__ = '{} Version {}'.format(__prog__, '0.1 ')
+
+## Get System type info
+SysType = platform.system()
+
+## Get PYTHON version
+PyVersion = sys.version_info[0]
+
+## HBFAGUI path and HBFA package path
+HBFAGUI_PATH = os.path.dirname(os.path.realpath(__file__))
+HBFA_PATH = os.path.dirname(os.path.dirname(HBFAGUI_PATH))
+
+## Seed mapping list of the test cases
+SeedReadme = os.path.join(HBFA_PATH, 'UefiHostFuzzTestCasePkg', 'Seed', 'readme.txt')
+SeedMappingPattern = re.compile(r'^(Test\w+)\s+HBFA[\\/]+(\S+)\s*$')
+
+## Seconds given to a fuzzer to exit after its budget
+STOP_GRACE_TIME = 30
+
+## Env.conf section, tool chain and environment variables of each tool
+Tools = {
+    'afl': {
+        'Section': 'afl',
+        'ToolChain': 'AFL',
+        'EnvVars': ['AFL_PATH'],
+    },
+    'libfuzzer': {
+        'Section': 'libfuzzer',
+        'ToolChain': 'LIBFUZZER',
+        'EnvVars': ['CLANG_PATH'],
+    },
+    'klee': {
+        'Section': 'klee(stp)',
+        'ToolChain': 'KLEE',
+        'EnvVars': ['KLEE_BIN_PATH'],
+    },
+}
+
+
+class BatchJob(object):
+    """
+    One test case run by one tool.
+    """
+    def __init__(self, Tool, ModuleFilePath, SeedPath):
+        self.Tool = Tool
+        self.ModuleFilePath = ModuleFilePath
+        self.SeedPath = SeedPath
+        self.Case = os.path.splitext(os.path.basename(ModuleFilePath))[0]
+        self.BinPath = None
+        self.BuildResult = 'not built'
+        self.BuildTime = 0
+        self.FuzzResult = 'not run'
+        self.FuzzTime = 0
+        self.Crashes = 0
+        self.Hangs = 0
+
+
+class HBFABatch(object):
+    def __init__(self, OutputPath, TimeBudget, FuzzJobs, BuildJobs, CustomMutator=None):
+        self.conf = configparser.ConfigParser()
+        self.conf.read(os.path.join(HBFAGUI_PATH, 'Env.conf'))
+        self.workspace = os.environ['WORKSPACE']
+        self.TimeBudget = TimeBudget
+        self.FuzzJobs = FuzzJobs
+        self.BuildJobs = BuildJobs
+        self.CustomMutator = CustomMutator
+        self.CustomMutatorBinPath = None
+        self.OutputPath = OutputPath
+        self.LogPath = os.path.join(OutputPath, 'logs')
+        os.makedirs(self.LogPath)
+
+    def GetArch(self, Tool):
+        return self.conf.get(Tools[Tool]['Section'], 'arch').strip()
+
+    def GetBuildTarget(self, Tool):
+        return self.conf.get(Tools[Tool]['Section'], 'BuildTarget').strip()
+
+    def Log(self, Message):
+        print('[{}] {}'.format(time.strftime('%H:%M:%S'), Message))
+        sys.stdout.flush()
+
+    def BuildAll(self, Jobs):
+        #
+        # One build invocation per tool chain builds all its test modules,
+        # the host libraries they share only once.
+        #
+        for Tool in sorted(set(Job.Tool for Job in Jobs)):
+            ToolJobs = [Job for Job in Jobs if Job.Tool == Tool]
+            self.Log('build {}: {} test cases'.format(Tool, len(ToolJobs)))
+            with open(os.path.join(self.LogPath, 'build_{}.log'.format(Tool)), 'w') as LogFile:
+                Results, TotalTime = BatchBuild(Tools[Tool]['ToolChain'], self.GetArch(Tool), self.GetBuildTarget(Tool),
+                                                [Job.ModuleFilePath for Job in ToolJobs], self.BuildJobs, LogFile,
+                                                os.path.join(self.LogPath, 'build_report_{}.txt'.format(Tool)))
+            for Job in ToolJobs:
+                Job.BinPath = Results[Job.ModuleFilePath]
+                Job.BuildResult = 'pass' if Job.BinPath else 'fail'
+                Job.BuildTime = TotalTime
+            self.Log('build {}: {} of {} passed in {:.0f}s'.format(Tool, len([Job for Job in ToolJobs if Job.BinPath]),
+                                                                   len(ToolJobs), TotalTime))
+
+    def GetFuzzCmd(self, Job, JobOutputPath):
+        """
+        :return: (command line, environment, preexec_fn) of the fuzz job
+        """
+        Budget = self.TimeBudget
+        if Job.Tool == 'klee':
+            # KLEE takes one seed file, the first one of the seed directory
+            SeedFiles = sorted(Name for Name in os.listdir(Job.SeedPath) if os.path.isfile(os.path.join(Job.SeedPath, Name)))
+            SeedFile = os.path.join(Job.SeedPath, SeedFiles[0]) if SeedFiles else None
+            return (RunKLEE.GetKLEECmd(Job.BinPath, os.path.join(JobOutputPath, 'klee-out'), SeedFile, ['-max-time={}'.format(Budget)]),
+                    RunKLEE.GetKLEEEnv(), RunKLEE.SetUnlimitedStack)
+        DictPath = GenerateModuleDictionary(Job.BinPath, Job.ModuleFilePath)
+        if Job.Tool == 'afl':
+            FixupRulesPath = None
+            if self.CustomMutator:
+                # All AFL test modules share the build directory of the mutator
+                if not self.CustomMutatorBinPath:
+                    self.CustomMutatorBinPath = RunAFL.BuildCustomMutator(self.GetArch(Job.Tool), Job.BinPath)
+                FixupRulesPath = RunAFL.DumpFixupRules(Job.BinPath)
+            Env = RunAFL.GetAFLEnv(self.CustomMutatorBinPath, self.CustomMutator, FixupRulesPath)
+            # AFL takes its budget from the scheduler, which stops it with SIGINT
+            Cmd = RunAFL.GetAFLCmd(Job.BinPath, Job.SeedPath, JobOutputPath, DictPath)
+        else:
+            CorpusPath = os.path.join(JobOutputPath, 'corpus')
+            os.makedirs(CorpusPath)
+            Env = RunLibFuzzer.GetLibFuzzerEnv()
+            Cmd = RunLibFuzzer.GetLibFuzzerCmd(Job.BinPath, [CorpusPath, Job.SeedPath], JobOutputPath, DictPath,
+                                               ['-max_total_time={}'.format(Budget)])
+        SetModulePcdDatabase(Job.BinPath, Job.ModuleFilePath, Env)
+        return Cmd, Env, None
+
+    def CountFindings(self, Job, JobOutputPath):
+        def CountFiles(Path, Filter):
+            if not os.path.isdir(Path):
+                return 0
+            return len([Name for Name in os.listdir(Path) if Filter(Name)])
+        if Job.Tool == 'afl':
+            Job.Crashes = CountFiles(os.path.join(JobOutputPath, 'crashes'), lambda Name: Name.startswith('id'))
+            Job.Hangs = CountFiles(os.path.join(JobOutputPath, 'hangs'), lambda Name: Name.startswith('id'))
+        elif Job.Tool == 'libfuzzer':
+            Job.Crashes = CountFiles(JobOutputPath, lambda Name: Name.split('-')[0] in ['crash', 'leak', 'oom'])
+            Job.Hangs = CountFiles(JobOutputPath, lambda Name: Name.startswith('timeout-'))
+        else:
+            Job.Crashes = CountFiles(os.path.join(JobOutputPath, 'klee-out'), lambda Name: Name.endswith('.err'))
+
+    def FuzzAll(self, Jobs):
+        Pending = [Job for Job in Jobs if Job.BinPath]
+        Running = []
+        try:
+            while Pending or Running:
+                while Pending and len(Running) < self.FuzzJobs:
+                    Job = Pending.pop(0)
+                    JobOutputPath = os.path.join(self.OutputPath, '{}_{}'.format(Job.Tool, Job.Case))
+                    os.makedirs(JobOutputPath)
+                    Cmd, Env, PreExec = self.GetFuzzCmd(Job, JobOutputPath)
+                    LogFile = open(os.path.join(self.LogPath, 'fuzz_{}_{}.log'.format(Job.Tool, Job.Case)), 'w')
+                    LogFile.write(' '.join(Cmd) + '\n')
+                    LogFile.flush()
+                    Process = subprocess.Popen(Cmd, stdout=LogFile, stderr=subprocess.STDOUT, env=Env, preexec_fn=PreExec)
+                    LogFile.close()
+                    Running.append((Job, Process, JobOutputPath, time.time()))
+                    self.Log('fuzz {} {}: started for {}s'.format(Job.Tool, Job.Case, self.TimeBudget))
+                time.sleep(1)
+                for Item in list(Running):
+                    Job, Process, JobOutputPath, StartTime = Item
+                    Elapsed = time.time() - StartTime
+                    if Process.poll() is None:
+                        if Elapsed >= self.TimeBudget + STOP_GRACE_TIME:
+                            Process.kill()
+                        elif Elapsed >= self.TimeBudget:
+                            Process.send_signal(signal.SIGINT)
+                        continue
+                    Running.remove(Item)
+                    Job.FuzzTime = Elapsed
+                    Job.FuzzResult = 'done' if Elapsed >= self.TimeBudget or Process.returncode == 0 else 'exit {}'.format(Process.returncode)
+                    self.CountFindings(Job, JobOutputPath)
+                    self.Log('fuzz {} {}: {}, {} crashes, {} hangs'.format(Job.Tool, Job.Case, Job.FuzzResult, Job.Crashes, Job.Hangs))
+        finally:
+            for Job, Process, JobOutputPath, StartTime in Running:
+                if Process.poll() is None:
+                    Process.kill()
+                    Process.wait()
+                Job.FuzzResult = 'interrupted'
+                self.CountFindings(Job, JobOutputPath)
+
+    def WriteSummary(self, Jobs):
+        SummaryPath = os.path.join(self.OutputPath, 'batch_summary.csv')
+        with open(SummaryPath, 'w') as f:
+            f.write('Tool,TestCase,Build,BuildTime(s),Fuzz,FuzzTime(s),Crashes,Hangs\n')
+            for Job in Jobs:
+                f.write('{},{},{},{:.0f},{},{:.0f},{},{}\n'.format(Job.Tool, Job.Case, Job.BuildResult, Job.BuildTime,
+                                                                  Job.FuzzResult, Job.FuzzTime, Job.Crashes, Job.Hangs))
+        return SummaryPath
+
+    def run(self, Jobs, BuildOnly):
+        try:
+            self.BuildAll(Jobs)
+            if not BuildOnly:
+                self.FuzzAll(Jobs)
+        except KeyboardInterrupt:
+            self.Log('interrupted')
+        return self.WriteSummary(Jobs)
+
+
+def GetSeedMapping():
+    Mapping = {}
+    if os.path.exists(SeedReadme):
+        with open(SeedReadme, 'r') as f:
+            for line in f:
+                match = SeedMappingPattern.match(line.strip())
+                if match:
+                    SeedPath = os.path.join(HBFA_PATH, *re.split(r'[\\/]+', match.group(2)))
+                    if os.path.isdir(SeedPath):
+                        Mapping[match.group(1)] = SeedPath
+    return Mapping
+
+def GetTestCases(Option, Args):
+    """
+    :return: [(ModuleFilePath, SeedPath or None)]
+    """
+    Entries = []
+    if Option.All:
+        Entries.extend((Path, None) for Path in GetTestCase().get_test_case_name_path())
+    if Option.ListFile:
+        Entries.extend((Fields[0], Fields[1] if len(Fields) > 1 else None) for Fields in ReadListFile(Option.ListFile))
+    Entries.extend((Path, None) for Path in Args)
+
+    Mapping = GetSeedMapping()
+    TestCases = []
+    for Path, SeedPath in Entries:
+        ModuleFilePath = GetModuleFilePath(Path)
+        Case = os.path.splitext(os.path.basename(ModuleFilePath))[0]
+        if not SeedPath:
+            SeedPath = Mapping.get(Case)
+        TestCases.append((ModuleFilePath, os.path.abspath(SeedPath) if SeedPath else None))
+    return TestCases
+
+def GetDefaultSeedPath(OutputPath):
+    # afl-fuzz needs at least one seed
+    SeedPath = os.path.join(OutputPath, 'DefaultSeeds')
+    if not os.path.exists(SeedPath):
+        os.makedirs(SeedPath)
+        with open(os.path.join(SeedPath, 'zero.bin'), 'wb') as f:
+            f.write(b'\0' * 16)
+    return SeedPath
+
+gParamCheck = []
+def SingleCheckCallback(option, opt_str, value, parser):
+    if option not in gParamCheck:
+        setattr(parser.values, option.dest, value)
+        gParamCheck.append(option)
+    else:
+        parser.error("Option %s only allows one instance in command line!" % option)
+
+# Parse command line options
+def MyOptionParser():
+    Parser = OptionParser(description=__copyright__, version=__version__, prog=__prog__, usage="python %prog [options] [TestXxx.inf ...]")
+    Parser.add_option("-l", "--list", action="callback", type="string", dest="ListFile", callback=SingleCheckCallback,
+        help="File listing the test case INFs, one per line, each optionally followed by its seed directory.")
+    Parser.add_option("--all", action="store_true", dest="All", default=False,
+        help="Run all test cases of UefiHostFuzzTestCasePkg.")
+    Parser.add_option("-t", "--tools", action="callback", type="string", dest="Tools", default="afl", callback=SingleCheckCallback,
+        help="Comma separated list of tools among afl, libfuzzer, klee. Default is afl.")
+    Parser.add_option("-T", "--time", action="callback", type="int", dest="TimeBudget", default=3600, callback=SingleCheckCallback,
+        help="Seconds each fuzz job runs. Default is 3600.")
+    Parser.add_option("-j", "--jobs", action="callback", type="int", dest="FuzzJobs", default=0, callback=SingleCheckCallback,
+        help="Fuzz jobs running at the same time. Default is 0, one per core.")
+    Parser.add_option("-J", "--build-jobs", action="callback", type="int", dest="BuildJobs", default=0, callback=SingleCheckCallback,
+        help="Build threads. Default is 0, one per core.")
+    Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
+        help="Output path of the batch. Default is a batch_<time> directory in the OutputPath of Env.conf.")
+    Parser.add_option("-c", "--custom-mutator", action="callback", type="choice", choices=RunAFL.CustomMutatorFormats, dest="CustomMutator", callback=SingleCheckCallback,
+        help="Fuzz with the structure-aware AFL++ custom mutator and the fixup post-processor, as RunAFL.py -c. FORMAT is one of list: auto, udf, gpt, capsule, smmvariable, none. AFL only.")
+    Parser.add_option("--build-only", action="store_true", dest="BuildOnly", default=False,
+        help="Only build the test cases.")
+    (Opt, Args) = Parser.parse_args()
+    return (Opt, Args)
+
+def main():
+    (Option, Args) = MyOptionParser()
+    if SysType != 'Linux':
+        print("HBFABatch.py is only supported on Linux.")
+        os._exit(0)
+    if 'WORKSPACE' not in os.environ:
+        print("Please set system environment variable 'WORKSPACE' before run this script.")
+        os._exit(0)
+
+    ToolList = [Tool.strip() for Tool in Option.Tools.split(',') if Tool.strip()]
+    for Tool in ToolList:
+        if Tool not in Tools:
+            print("Unknown tool: {}, should be one of afl, libfuzzer, klee.".format(Tool))
+            os._exit(0)
+        for Var in Tools[Tool]['EnvVars']:
+            if Var not in os.environ:
+                print("Please set {} in system environment variables.".format(Var))
+                os._exit(0)
+    conf = configparser.ConfigParser()
+    conf.read(os.path.join(HBFAGUI_PATH, 'Env.conf'))
+    # The checks of the Run*.py scripts also set the WORKSPACE they build with
+    if 'afl' in ToolList:
+        RunAFL.CheckTestEnv()
+    if 'libfuzzer' in ToolList:
+        RunLibFuzzer.CheckTestEnv(conf.get(Tools['libfuzzer']['Section'], 'arch').strip())
+    if 'klee' in ToolList:
+        RunKLEE.CheckTestEnv()
+
+    TestCases = GetTestCases(Option, Args)
+    if not TestCases:
+        print("No test case, give INF files, --list LISTFILE or --all.")
+        os._exit(0)
+
+    OutputPath = Option.Output if Option.Output else os.path.join(conf.get('afl', 'OutputPath').strip(),
+                                                                  time.strftime("batch_%Y_%m_%d_%H_%M_%S", time.localtime()))
+    OutputPath = os.path.abspath(OutputPath)
+    if os.path.exists(OutputPath):
+        print("OutputPath:{} is already exists, please change another directory.".format(OutputPath))
+        os._exit(0)
+
+    CoreNum = GetCoreNum()
+    Batch = HBFABatch(OutputPath, Option.TimeBudget, Option.FuzzJobs if Option.FuzzJobs > 0 else CoreNum,
+                      Option.BuildJobs if Option.BuildJobs > 0 else CoreNum, Option.CustomMutator)
+    DefaultSeedPath = GetDefaultSeedPath(OutputPath)
+    Jobs = []
+    for Tool in ToolList:
+        for ModuleFilePath, SeedPath in TestCases:
+            Jobs.append(BatchJob(Tool, ModuleFilePath, SeedPath if SeedPath else DefaultSeedPath))
+    SummaryPath = Batch.run(Jobs, Option.BuildOnly)
+    print("Summary: {}".format(SummaryPath))
+
+if __name__ == "__main__":
+    main()
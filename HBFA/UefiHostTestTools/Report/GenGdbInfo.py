@@ -24,18 +24,8 @@ class GenGdbInfo(object):
         self.__cfgPath = cfgPath
         self.__logPath = os.path.splitext(cfgPath)[0] + ".log"
         self.__infoList = []
-
-    def __CompareList(self, list1, list2):
-        """
-        :param list1: []
-        :param list2: []
-        """
-        if len(list1) != len(list2):
-            return False
-        for index in range(len(list1)):
-            if list1[index] != list2[index]:
-                return False
-        return True
+        self.__cfg = None
+        self.__stackIndex = {}
 
     def __GenerateCommand(self, file):
         """
@@ -85,6 +75,23 @@ class GenGdbInfo(object):
             InfoList = DetailInfo
         return InfoList
 
+    def __LoadCfg(self):
+        """
+        Parse the cfg once and index its stacks, so that each new seed is
+        classified by a dictionary lookup instead of re-reading the file and
+        re-parsing every known stack.
+        """
+        if self.__cfg is not None:
+            return
+        self.__cfg = ConfigParser.ConfigParser()
+        self.__cfg.read(self.__cfgPath)
+        for section in self.__cfg.sections():
+            stack = self.__cfg.get(section, 'stackinfo')
+            key = tuple(self.__GetKeyInfo([stack]))
+            if key and 'no stack' not in key[-1].lower():
+                self.__stackIndex.setdefault(key, section)
+            self.__infoList.append((time.asctime(time.localtime(os.path.getmtime(section))), section, stack))
+
     def __FilterInfoToCfg(self, newInfo, filterSwitch):
         """
         :param newInfo: [seedName, InfoList]
@@ -93,33 +100,27 @@ class GenGdbInfo(object):
         seedName = newInfo[0]
         InfoList = newInfo[-1]
         newStack = self.__GetKeyInfo(InfoList)
-        configPath = self.__cfgPath
 
-        cfg = ConfigParser.ConfigParser()
-        cfg.read(configPath)
+        self.__LoadCfg()
+        cfg = self.__cfg
         searchFlag = False
         if filterSwitch:
             if 'no stack' in newStack[-1].lower():
                 searchFlag = True
             else:
-                for section in cfg.sections():
-                    oldStack = cfg.get(section, 'stackinfo')
-                    oldStack = self.__GetKeyInfo([oldStack])
-                    if self.__CompareList(newStack, oldStack):
-                        searchFlag = True
-                        cfg.set(section, 'TotalSeedsNum', int(cfg.get(section, 'TotalSeedsNum')) + 1)
-                        break
+                section = self.__stackIndex.get(tuple(newStack))
+                if section is not None:
+                    searchFlag = True
+                    cfg.set(section, 'TotalSeedsNum', str(int(cfg.get(section, 'TotalSeedsNum')) + 1))
         if not searchFlag:
             cfg.add_section(seedName)
             if 'no stack' in newStack[-1].lower():
                 cfg.set(seedName, 'stackinfo', InfoList[-1])
             else:
                 cfg.set(seedName, 'stackinfo', InfoList[0])
-            cfg.set(seedName, 'TotalSeedsNum', 1)
-        self.__infoList = []
-        for section in cfg.sections():
-            self.__infoList.append((time.asctime(time.localtime(os.path.getmtime(section))), section, cfg.get(section, 'stackinfo')))
-        cfg.write(open(configPath, 'w'))
+                self.__stackIndex.setdefault(tuple(newStack), seedName)
+            cfg.set(seedName, 'TotalSeedsNum', '1')
+            self.__infoList.append((time.asctime(time.localtime(os.path.getmtime(seedName))), seedName, cfg.get(seedName, 'stackinfo')))
 
     def __ClearRedundantInfo(self, oriInfo):
         """
@@ -142,16 +143,22 @@ class GenGdbInfo(object):
         :param newInputList: []
         :param filterSwitch: True False
         """
+        updated = False
         for newInput in newInputList:
             if os.path.isfile(newInput):
                 errorInfo = self.__CallCommand(self.__GenerateCommand(newInput))
                 errorInfo = self.__ClearRedundantInfo(errorInfo)
                 self.__FilterInfoToCfg([newInput, errorInfo], filterSwitch)
+                updated = True
                 if filterSwitch:
                     self.__GenereteInfoFile([(time.asctime(time.localtime(os.path.getmtime(newInput))), newInput, errorInfo)],
                                             os.path.join(os.path.dirname(newInput), os.path.basename(self.__logPath)))
-                else:
-                    self.__GenereteInfoFile(self.__infoList, self.__logPath)
+        # The cfg and the aggregated log are written once per batch of seeds.
+        if updated:
+            with open(self.__cfgPath, 'w') as f:
+                self.__cfg.write(f)
+            if not filterSwitch:
+                self.__GenereteInfoFile(self.__infoList, self.__logPath)
 
     def __GenereteInfoFile(self, infoList, infoPath):
         """
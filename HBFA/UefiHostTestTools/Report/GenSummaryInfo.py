@@ -113,22 +113,29 @@ class GenSummaryInfo(object):
         return num
 
     def __GetAFLExecTime(self):
-        if os.path.exists(os.path.join(self.__inputPath, 'plot_data')):
-            with open(os.path.join(self.__inputPath, 'plot_data'), 'r') as f:
-                lines = f.readlines()
-                f.close()
-                if len(lines) > 1:
-                    line_last = lines[-1]
-                    time_start = int(lines[1].split(',')[0])
-                    time_start = time.strftime('%m/%d/%Y %H:%M:%S', time.localtime(time_start))
-                    time_start = datetime.datetime.strptime(time_start, '%m/%d/%Y %H:%M:%S')
-                    time_end = int(line_last.split(',')[0])
-                    time_end = time.strftime('%m/%d/%Y %H:%M:%S', time.localtime(time_end))
-                    time_end = datetime.datetime.strptime(time_end, '%m/%d/%Y %H:%M:%S')
-                    execution_time = time_end - time_start
-                    return execution_time
-                else:
-                    return 0
+        # plot_data grows for the whole campaign; only its first record and
+        # its tail are read instead of the complete file.
+        plotData = os.path.join(self.__inputPath, 'plot_data')
+        if os.path.exists(plotData):
+            with open(plotData, 'rb') as f:
+                f.readline()
+                first_line = f.readline()
+                f.seek(0, os.SEEK_END)
+                size = f.tell()
+                f.seek(max(0, size - 4096), os.SEEK_SET)
+                lines = f.read().splitlines()
+            if first_line.strip() and lines:
+                line_last = lines[-1].decode()
+                time_start = int(first_line.decode().split(',')[0])
+                time_start = time.strftime('%m/%d/%Y %H:%M:%S', time.localtime(time_start))
+                time_start = datetime.datetime.strptime(time_start, '%m/%d/%Y %H:%M:%S')
+                time_end = int(line_last.split(',')[0])
+                time_end = time.strftime('%m/%d/%Y %H:%M:%S', time.localtime(time_end))
+                time_end = datetime.datetime.strptime(time_end, '%m/%d/%Y %H:%M:%S')
+                execution_time = time_end - time_start
+                return execution_time
+            else:
+                return 0
 
     def __GetOthersExecTime(self):
         if  self.path.exists(os.path.dirname(self.__inputPath)):
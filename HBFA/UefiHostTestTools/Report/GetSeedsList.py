@@ -7,6 +7,8 @@
 import os
 import sys
 import glob
+import time
+from SeedWatcher import SeedWatcher
 
 # python version
 python_version = sys.version_info[0]
@@ -15,53 +17,59 @@ class GetSeedsList(object):
     def __init__(self, seedsType, inputPath, silence):
         self.__seedsType = seedsType
         self.__inputPath = inputPath
-        self.__seedList = [[],[]] if self.__seedsType.lower() == "afl" else []
+        self.__seedNum = [0, 0] if self.__seedsType.lower() == "afl" else 0
         self.__silence = silence
-
-    def __GetList(self):
-        seedList = []
+        self.__seenPeach = set()
+        self.__watcher = None
         if self.__seedsType.lower() == 'afl':
-            for item in ['crashes', 'hangs']:
-                lists = []
-                subdir = os.path.join(self.__inputPath, item)
-                if os.path.exists(subdir):
-                    lists = glob.glob(os.path.join(subdir, 'id*'))
-                lists.sort(key=lambda fn: os.path.getmtime(fn), reverse=False)
-                seedList.append(lists)
-        elif self.__seedsType.lower() == 'peach':
-            subdir = os.path.join(self.__inputPath, 'Faults')
-            if os.path.exists(subdir):
-                seedList = glob.glob(os.path.join(subdir, '*', '*', '1.Initial.Action.bin'))
-            seedList.sort(key=lambda fn: os.path.getmtime(fn), reverse=False)
+            self.__aflDirs = [os.path.join(self.__inputPath, item) for item in ['crashes', 'hangs']]
+            self.__watcher = SeedWatcher(self.__aflDirs, lambda name: name.startswith('id'))
         elif self.__seedsType.lower() == 'libfuzzer':
-            seedList = [fn for fn in glob.glob(os.path.join(self.__inputPath, '*')) if os.path.isfile(fn)]
-            seedList.sort(key=lambda fn: os.path.getmtime(fn), reverse=False)
-        elif self.__seedsType.lower() == 'peach+sanitizer':
-            pass
+            self.__watcher = SeedWatcher([self.__inputPath])
+
+    def __GetPeachList(self):
+        # Peach faults live two directory levels down, so they are globbed, but
+        # only paths that were not returned before are stat'ed and sorted.
+        seedList = []
+        subdir = os.path.join(self.__inputPath, 'Faults')
+        if os.path.exists(subdir):
+            for fn in glob.glob(os.path.join(subdir, '*', '*', '1.Initial.Action.bin')):
+                if fn not in self.__seenPeach:
+                    self.__seenPeach.add(fn)
+                    seedList.append(fn)
+        seedList.sort(key=lambda fn: os.path.getmtime(fn), reverse=False)
         return seedList
 
+    def Wait(self, timeout):
+        """
+        Sleep up to timeout seconds, returning early when a new seed is written.
+        """
+        if self.__watcher:
+            self.__watcher.Wait(timeout)
+        else:
+            time.sleep(timeout)
+
     def SeekNewSeed(self):
         """
         :return: afl [[crash], [hang]], peach [seed], libfuzzer [seed]
         """
-        newSeedList = self.__GetList()
-        
         if self.__seedsType.lower() == 'afl':
-            newList = [[], []]
-            for index in range(len(self.__seedList)):
-                if len(newSeedList[index]) != len(self.__seedList[index]):
-                    newList[index] = [fn for fn in (newSeedList[index] + self.__seedList[index]) if fn not in self.__seedList[index]]
-                    self.__seedList[index] = newSeedList[index]
-                    if not self.__silence:
-                        print('Current crashes number is %d, hangs number is %d' % (
-                            len(self.__seedList[0]), len(self.__seedList[1])))
+            newFiles = self.__watcher.GetNew()
+            newList = [newFiles[subdir] for subdir in self.__aflDirs]
+            if len(newList[0]) != 0 or len(newList[1]) != 0:
+                self.__seedNum = [self.__seedNum[0] + len(newList[0]), self.__seedNum[1] + len(newList[1])]
+                if not self.__silence:
+                    print('Current crashes number is %d, hangs number is %d' % (
+                        self.__seedNum[0], self.__seedNum[1]))
         elif self.__seedsType.lower() == 'peach' or self.__seedsType.lower() == 'libfuzzer':
-            newList = []
-            if len(newSeedList) != len(self.__seedList):
-                newList = [fn for fn in (newSeedList + self.__seedList) if fn not in self.__seedList]
-                self.__seedList = newSeedList
+            if self.__seedsType.lower() == 'peach':
+                newList = self.__GetPeachList()
+            else:
+                newList = self.__watcher.GetNew()[self.__inputPath]
+            if len(newList) != 0:
+                self.__seedNum += len(newList)
                 if not self.__silence:
-                    print('Current fault number is %d' % (len(self.__seedList)))
+                    print('Current fault number is %d' % (self.__seedNum))
         elif self.__seedsType.lower() == 'peach+sanitizer':
             newList = []
         return newList
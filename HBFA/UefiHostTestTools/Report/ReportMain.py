@@ -30,6 +30,7 @@ class GenerateFinalReport(object):
         self.__methods = methods
         self.__sleep = sleep
         self.__reportType = self.__ReportType()
+        self.__gdbInfo = {}
 
     def __ReportType(self):
         return "gdb" if "gcc5" in self.__execute.lower() else "sanitizer"
@@ -106,8 +107,11 @@ class GenerateFinalReport(object):
         if self.__ReportType() == "gdb":
             cfgPath = os.path.join(self.__output, "HBFA.GDB{}.cfg".format(
                 ("." + aflError.capitalize()) if aflError in ["crashes", "hangs"] else ""))
-            genCfg = GenGdbInfo(self.__execute, cfgPath)
-            genCfg.Run(seedList, False if aflError else True)
+            # Keep one GenGdbInfo per cfg alive for the whole run, so already
+            # classified stacks are not re-parsed for every new seed.
+            if cfgPath not in self.__gdbInfo:
+                self.__gdbInfo[cfgPath] = GenGdbInfo(self.__execute, cfgPath)
+            self.__gdbInfo[cfgPath].Run(seedList, False if aflError else True)
             genHtml = GenGdbHtmlReport(cfgPath, self.__output, aflError)
             genHtml.GenerateHtml()
         elif self.__ReportType() == 'sanitizer':
@@ -125,42 +129,38 @@ class GenerateFinalReport(object):
 
     def GenerateReport(self):
         getSeedsList = GetSeedsList(self.__methods, self.__input, False)
+        firstRound = True
         while True:
+            # Only seeds that appeared since the previous round are replayed,
+            # and the HTML index is rewritten once per round, not once per seed.
             seedsList = getSeedsList.SeekNewSeed()
             if self.__methods.lower() == "afl":
                 aflErrorType = ["crashes", "hangs"]
                 try:
                     for index, subList in enumerate(seedsList):
-                        if len(subList) == 0:
+                        if len(subList) != 0 or firstRound:
                             self.__GenDebugReport(subList, aflErrorType[index])
-                        else:
-                            for seed in subList:
-                                self.__GenDebugReport([seed], aflErrorType[index])
-                        self.__GenSummaryReport()
+                    self.__GenSummaryReport()
                 except Exception as e:
                     print(e)
             elif "peach" in self.__methods.lower():
                 try:
-                    if len(seedsList) == 0:
+                    # Peach+Sanitizer results are produced outside of this loop.
+                    if len(seedsList) != 0 or firstRound or self.__methods.lower() == "peach+sanitizer":
                         self.__GenDebugReport(seedsList, "")
-                    else:
-                        for seed in seedsList:
-                            self.__GenDebugReport([seed], "")
                     self.__GenSummaryReport()
                 except Exception as e:
                     print(e)
             elif self.__methods.lower() == 'libfuzzer':
                 try:
-                    if len(seedsList) == 0:
+                    if len(seedsList) != 0 or firstRound:
                         self.__GenDebugReport(seedsList, "gdb")
-                    else:
-                        for seed in seedsList:
-                            self.__GenDebugReport([seed], "gdb")
                     self.__GenSummaryReport()
                 except Exception as e:
                     print(e)
+            firstRound = False
             if self.__sleep:
-                time.sleep(int(self.__sleep))
+                getSeedsList.Wait(int(self.__sleep))
             else:
                 break
             if not self.__CheckStatus():
@@ -0,0 +1,185 @@
+## @file
+# Track new files in fuzzer output directories without rescanning them
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import os
+import sys
+import struct
+import time
+import select
+import platform
+
+# python version
+python_version = sys.version_info[0]
+
+# inotify event masks, see <sys/inotify.h>
+IN_CLOSE_WRITE = 0x00000008
+IN_MOVED_TO = 0x00000080
+IN_Q_OVERFLOW = 0x00004000
+IN_ISDIR = 0x40000000
+IN_NONBLOCK = 0x00000800
+IN_CLOEXEC = 0x00080000
+
+# struct inotify_event { int wd; uint32_t mask; uint32_t cookie; uint32_t len; char name[]; }
+EVENT_HEADER = struct.Struct('iIII')
+
+
+class Inotify(object):
+    """
+    Minimal ctypes binding of the Linux inotify interface.
+    """
+    def __init__(self):
+        import ctypes
+        import ctypes.util
+        self.__libc = ctypes.CDLL(ctypes.util.find_library('c') or 'libc.so.6', use_errno=True)
+        self.__fd = self.__libc.inotify_init1(IN_NONBLOCK | IN_CLOEXEC)
+        if self.__fd < 0:
+            raise OSError(ctypes.get_errno(), 'inotify_init1 failed')
+        self.__watches = {}
+
+    def AddWatch(self, path, mask):
+        import ctypes
+        wd = self.__libc.inotify_add_watch(self.__fd, path.encode() if python_version == 3 else path, mask)
+        if wd < 0:
+            raise OSError(ctypes.get_errno(), 'inotify_add_watch failed: %s' % path)
+        self.__watches[wd] = path
+        return wd
+
+    def Wait(self, timeout):
+        """
+        :param timeout: seconds to block, None to block forever
+        :return: True if events are pending
+        """
+        ready, _, _ = select.select([self.__fd], [], [], timeout)
+        return len(ready) != 0
+
+    def Read(self):
+        """
+        :return: [(dirPath, fileName, mask)] for all pending events
+        """
+        events = []
+        while True:
+            try:
+                data = os.read(self.__fd, 64 * 1024)
+            except OSError:
+                break
+            if not data:
+                break
+            offset = 0
+            while offset + EVENT_HEADER.size <= len(data):
+                wd, mask, cookie, length = EVENT_HEADER.unpack_from(data, offset)
+                offset += EVENT_HEADER.size
+                name = data[offset:offset + length].rstrip(b'\0')
+                offset += length
+                if python_version == 3:
+                    name = name.decode(errors='surrogateescape')
+                events.append((self.__watches.get(wd), name, mask))
+        return events
+
+    def Close(self):
+        os.close(self.__fd)
+
+
+class SeedWatcher(object):
+    """
+    Report files that appear in a set of directories, each of them exactly once.
+
+    Files already handed out are remembered by (st_dev, st_ino), so renames and
+    repeated scans never report the same input twice. On Linux the directories
+    are watched with inotify and only event names are stat'ed; elsewhere, or if
+    inotify is unavailable, a directory scan is used, which still skips known
+    inodes without sorting or comparing whole lists.
+    """
+    def __init__(self, directories, filterFunc=None):
+        self.__directories = directories
+        self.__filter = filterFunc if filterFunc else (lambda name: True)
+        self.__seen = set()
+        self.__watched = set()
+        self.__pending = []
+        self.__inotify = None
+        if platform.system() == 'Linux':
+            try:
+                self.__inotify = Inotify()
+            except Exception:
+                self.__inotify = None
+        self.__needScan = True
+
+    def __AddWatches(self):
+        if not self.__inotify:
+            return
+        for directory in self.__directories:
+            if directory in self.__watched or not os.path.isdir(directory):
+                continue
+            try:
+                self.__inotify.AddWatch(directory, IN_CLOSE_WRITE | IN_MOVED_TO)
+                self.__watched.add(directory)
+                # Files created before the watch was armed are picked up by one scan.
+                self.__needScan = True
+            except OSError:
+                self.__inotify.Close()
+                self.__inotify = None
+                return
+
+    def __Accept(self, path):
+        try:
+            st = os.stat(path)
+        except OSError:
+            return False
+        if not os.path.isfile(path):
+            return False
+        key = (st.st_dev, st.st_ino)
+        if key in self.__seen:
+            return False
+        self.__seen.add(key)
+        self.__pending.append((st.st_mtime, path))
+        return True
+
+    def __Scan(self):
+        for directory in self.__directories:
+            if not os.path.isdir(directory):
+                continue
+            for name in os.listdir(directory):
+                if self.__filter(name):
+                    self.__Accept(os.path.join(directory, name))
+
+    def __Drain(self):
+        for directory, name, mask in self.__inotify.Read():
+            if mask & IN_Q_OVERFLOW:
+                self.__needScan = True
+                continue
+            if directory is None or mask & IN_ISDIR or not self.__filter(name):
+                continue
+            self.__Accept(os.path.join(directory, name))
+
+    def Wait(self, timeout):
+        """
+        Block until a watched directory changes or timeout seconds elapse.
+        """
+        self.__AddWatches()
+        if self.__inotify:
+            self.__inotify.Wait(timeout)
+        else:
+            time.sleep(timeout)
+
+    def GetNew(self):
+        """
+        :return: {directory: [path]} of files not returned before, oldest first
+        """
+        self.__AddWatches()
+        if self.__inotify:
+            self.__Drain()
+        if self.__needScan or not self.__inotify:
+            self.__needScan = False
+            self.__Scan()
+        self.__pending.sort(key=lambda item: item[0])
+        newFiles = dict((directory, []) for directory in self.__directories)
+        for _, path in self.__pending:
+            newFiles.setdefault(os.path.dirname(path), []).append(path)
+        self.__pending = []
+        return newFiles
+
+    def SeenNum(self):
+        return len(self.__seen)
@@ -6,11 +6,18 @@
 
 import os
 import sys
+import time
 import shutil
 import platform
 import subprocess
 from optparse import OptionParser
 
+sys.path.append(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'Script'))
+from GenFuzzDict import GenerateModuleDictionary
+from GenPcdDatabase import SetModulePcdDatabase
+from DistillCorpus import DistillCorpus
+from CoreNum import GetCoreNum
+
 __prog__ = 'RunAFL.py'
 __copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
 __version__ = '{} Version {}'.format(__prog__, '0.1 ')
@@ -39,6 +46,18 @@ Conf_Path = os.path.join(HBFA_PATH, 'UefiHostFuzzTestPkg', 'Conf')
 ## Get PYTHON version
 PyVersion = sys.version_info[0]
 
+## Structure-aware AFL++ custom mutator, see UefiHostFuzzTestPkg/Library/CustomMutatorLib
+CustomMutatorPath = os.path.join(HBFA_PATH, 'UefiHostFuzzTestPkg', 'Library', 'CustomMutatorLib')
+CustomMutatorFormats = ['auto', 'udf', 'gpt', 'capsule', 'smmvariable', 'none']
+HarnessFixupSource = os.path.join(HBFA_PATH, 'UefiHostFuzzTestPkg', 'Library', 'ToolChainHarnessLib', 'HarnessFixup.c')
+
+## Power schedules rotated over the secondary instances of a campaign, see afl-fuzz -p
+PowerSchedules = ['explore', 'coe', 'lin', 'quad', 'exploit', 'rare', 'fast']
+
+## Aggregated status of a campaign, and seconds between two updates of it
+CampaignStatusFile = 'campaign_stats'
+CampaignStatusInterval = 10
+
 def CheckTestEnv():
     # Check EDKII BUILD WORKSPACE whether be set in system environment variable
     if 'WORKSPACE' not in os.environ:
@@ -134,24 +153,91 @@ def Build(Arch, Target, ModuleFilePath):
     CheckBuildResult(ModuleBinAbsPath)
     return ModuleBinAbsPath
 
-def RunAFL(TestModuleBinPath, InputPath, OutputPath):
+def BuildCustomMutator(Arch, ModuleBinPath):
+    CustomMutatorBinPath = os.path.join(os.path.dirname(ModuleBinPath), 'HBFACustomMutator.so')
+    Sources = [os.path.join(CustomMutatorPath, f) for f in sorted(os.listdir(CustomMutatorPath)) if f.endswith('.c')]
+    Sources.append(HarnessFixupSource)
+    IncludeList = [os.path.join(workspace, 'MdePkg', 'Include'),
+                   os.path.join(workspace, 'MdePkg', 'Include', Arch),
+                   os.path.join(workspace, 'MdeModulePkg', 'Include'),
+                   os.path.join(HBFA_PATH, 'UefiHostFuzzTestPkg', 'Include')]
+    BuildCmd = 'cc -shared -fPIC -O2 -fshort-wchar -DNO_MSABI_VA_FUNCS=TRUE {} {} {} -o {}'.format(
+        '-m32' if Arch == 'IA32' else '-m64',
+        ' '.join('-I {}'.format(inc) for inc in IncludeList),
+        ' '.join(Sources),
+        CustomMutatorBinPath)
+    print("Start build custom mutator:")
+    print(BuildCmd)
+    proccess = subprocess.Popen(BuildCmd,
+                                stdout=subprocess.PIPE,
+                                stderr=subprocess.STDOUT,
+                                shell=True)
+    msg = proccess.communicate()[0]
+    if PyVersion == 3:
+        msg = msg.decode()
+    if proccess.returncode != 0 or not os.path.exists(CustomMutatorBinPath):
+        print(msg)
+        print("Build failure, can not build custom mutator: {}".format(CustomMutatorBinPath))
+        os._exit(0)
+    return CustomMutatorBinPath
+
+def DumpFixupRules(ModuleBinPath):
+    FixupRulesPath = ModuleBinPath + '.fixup'
+    if os.path.exists(FixupRulesPath):
+        os.remove(FixupRulesPath)
+    subprocess.call([ModuleBinPath, '--dump-fixup-rules', FixupRulesPath])
+    if not os.path.exists(FixupRulesPath):
+        print("Can not dump fixup rules of {}, post-processor applies format fixups only.".format(ModuleBinPath))
+        return None
+    return FixupRulesPath
+
+def GetAFLCmd(TestModuleBinPath, InputPath, OutputPath, DictPath=None, Options=None):
+    # Headless afl-fuzz command line, Options go before the dictionary
+    Cmd = ['afl-fuzz', '-i', InputPath, '-o', OutputPath]
+    if Options:
+        Cmd += Options
+    if DictPath:
+        Cmd += ['-x', DictPath]
+    return Cmd + ['--', TestModuleBinPath, '@@']
+
+def GetAFLEnv(CustomMutatorBinPath=None, CustomMutatorFormat='auto', FixupRulesPath=None):
+    # Headless afl-fuzz environment
+    Env = os.environ.copy()
+    Env['PATH'] = Env['PATH'] + os.pathsep + os.environ['AFL_PATH']
+    Env['AFL_NO_UI'] = '1'
+    if CustomMutatorBinPath:
+        Env['AFL_CUSTOM_MUTATOR_LIBRARY'] = CustomMutatorBinPath
+        if CustomMutatorFormat != 'auto':
+            Env['HBFA_CUSTOM_MUTATOR'] = CustomMutatorFormat
+        if FixupRulesPath:
+            Env['HBFA_FIXUP_RULES'] = FixupRulesPath
+    return Env
+
+def RunAFL(TestModuleBinPath, InputPath, OutputPath, CustomMutatorBinPath=None, CustomMutatorFormat='auto', FixupRulesPath=None, DictPath=None):
     SetEnvCmd = "export PATH=$PATH:$AFL_PATH\n"
+    if CustomMutatorBinPath:
+        SetEnvCmd += "export AFL_CUSTOM_MUTATOR_LIBRARY={}\n".format(CustomMutatorBinPath)
+        if CustomMutatorFormat != 'auto':
+            SetEnvCmd += "export HBFA_CUSTOM_MUTATOR={}\n".format(CustomMutatorFormat)
+        if FixupRulesPath:
+            SetEnvCmd += "export HBFA_FIXUP_RULES={}\n".format(FixupRulesPath)
     TestModuleName = TestModuleBinPath.split('\\')[-1]
+    DictOption = "-x {} ".format(DictPath) if DictPath else ''
     if SysType == "Windows":
         if "IA32" in TestModuleBinPath:
             AFL_PATH = os.path.join(os.environ["AFL_PATH"], "bin32")
             # Copy xxx.exe and xxx.pdb to the same dir as winafl\bin32 or winafl\bin64
             CopyFile(TestModuleBinPath, os.path.join(AFL_PATH, TestModuleName))
             CopyFile(TestModuleBinPath, os.path.join(AFL_PATH, TestModuleName.replace('.exe', '.pdb')))
-            AFL_CMD = "afl-fuzz.exe -i {} -o {} -D %DRIO_PATH%\\bin32 -t 20000 -- -coverage_module {} -fuzz_iterations 1000 -target_module {} -target_method main -nargs 2 -- {} @@".format(InputPath, OutputPath, TestModuleName, TestModuleName,TestModuleName)
+            AFL_CMD = "afl-fuzz.exe -i {} -o {} {}-D %DRIO_PATH%\\bin32 -t 20000 -- -coverage_module {} -fuzz_iterations 1000 -target_module {} -target_method main -nargs 2 -- {} @@".format(InputPath, OutputPath, DictOption, TestModuleName, TestModuleName,TestModuleName)
         elif "X64" in TestModuleBinPath:
             AFL_PATH = os.path.join(os.environ["AFL_PATH"], "bin64")
             # Copy xxx.exe and xxx.pdb to the same dir as winafl\bin32 or winafl\bin64
             CopyFile(TestModuleBinPath, os.path.join(AFL_PATH, TestModuleName))
             CopyFile(TestModuleBinPath, os.path.join(AFL_PATH, TestModuleName.replace('.exe', '.pdb')))
-            AFL_CMD = "afl-fuzz.exe -i {} -o {} -D %DRIO_PATH%\\bin64 -t 20000 -- -coverage_module {} -fuzz_iterations 1000 -target_module {} -target_method main -nargs 2 -- {} @@".format(InputPath, OutputPath, TestModuleName, TestModuleName,TestModuleName)
+            AFL_CMD = "afl-fuzz.exe -i {} -o {} {}-D %DRIO_PATH%\\bin64 -t 20000 -- -coverage_module {} -fuzz_iterations 1000 -target_module {} -target_method main -nargs 2 -- {} @@".format(InputPath, OutputPath, DictOption, TestModuleName, TestModuleName,TestModuleName)
     elif SysType == "Linux":
-        AFL_CMD = "afl-fuzz -i {} -o {} {} @@".format(InputPath, OutputPath, TestModuleBinPath)
+        AFL_CMD = "afl-fuzz -i {} -o {} {}{} @@".format(InputPath, OutputPath, DictOption, TestModuleBinPath)
     print("Start run AFL test:")
     print(AFL_CMD)
     if SysType == "Windows":
@@ -163,6 +249,117 @@ def RunAFL(TestModuleBinPath, InputPath, OutputPath):
                      stderr=subprocess.STDOUT,
                      shell=True)
 
+def IsAFLPlusPlus(Env):
+    # -p and -b only exist in AFL++
+    try:
+        proccess = subprocess.Popen(['afl-fuzz', '-h'], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, env=Env)
+    except OSError:
+        return False
+    msg = proccess.communicate()[0]
+    if PyVersion == 3:
+        msg = msg.decode(errors='replace')
+    return '-p schedule' in msg
+
+def ReadFuzzerStats(StatsPath):
+    Stats = {}
+    try:
+        with open(StatsPath, 'r') as f:
+            for line in f:
+                if ':' in line:
+                    Key, Value = line.split(':', 1)
+                    Stats[Key.strip()] = Value.strip()
+    except IOError:
+        pass
+    return Stats
+
+def GetStatsNumber(Stats, Keys):
+    # AFL++ renamed some keys of fuzzer_stats, e.g. unique_crashes to saved_crashes
+    for Key in Keys:
+        if Key in Stats:
+            try:
+                return float(Stats[Key].rstrip('%'))
+            except ValueError:
+                pass
+    return 0
+
+def FormatCampaignStatus(Prefix, Values):
+    return ['{:<32}: {}'.format(Prefix + 'execs_done', int(Values['execs_done'])),
+            '{:<32}: {:.2f}'.format(Prefix + 'execs_per_sec', Values['execs_per_sec']),
+            '{:<32}: {}'.format(Prefix + 'corpus_count', int(Values['corpus_count'])),
+            '{:<32}: {:.2f}%'.format(Prefix + 'bitmap_cvg', Values['bitmap_cvg']),
+            '{:<32}: {}'.format(Prefix + 'saved_crashes', int(Values['saved_crashes'])),
+            '{:<32}: {}'.format(Prefix + 'saved_hangs', int(Values['saved_hangs']))]
+
+def WriteCampaignStatus(OutputPath, Instances):
+    Alive = 0
+    Total = {'execs_done': 0, 'execs_per_sec': 0, 'corpus_count': 0, 'bitmap_cvg': 0, 'saved_crashes': 0, 'saved_hangs': 0}
+    Lines = []
+    for Name, Process in Instances:
+        Stats = ReadFuzzerStats(os.path.join(OutputPath, Name, 'fuzzer_stats'))
+        Running = Process.poll() is None
+        Alive += 1 if Running else 0
+        Values = {'execs_done': GetStatsNumber(Stats, ['execs_done']),
+                  'execs_per_sec': GetStatsNumber(Stats, ['execs_per_sec']),
+                  'corpus_count': GetStatsNumber(Stats, ['corpus_count', 'paths_total']),
+                  'bitmap_cvg': GetStatsNumber(Stats, ['bitmap_cvg']),
+                  'saved_crashes': GetStatsNumber(Stats, ['saved_crashes', 'unique_crashes']),
+                  'saved_hangs': GetStatsNumber(Stats, ['saved_hangs', 'unique_hangs'])}
+        for Key in ['execs_done', 'execs_per_sec', 'saved_crashes', 'saved_hangs']:
+            Total[Key] += Values[Key]
+        # Instances share their queues through the sync directory, keep the best one
+        for Key in ['corpus_count', 'bitmap_cvg']:
+            Total[Key] = max(Total[Key], Values[Key])
+        Lines += FormatCampaignStatus(Name + '.', Values)
+        Lines.append('{:<32}: {}'.format(Name + '.running', 1 if Running else 0))
+    Header = ['{:<32}: {}'.format('last_update', int(time.time())),
+              '{:<32}: {}'.format('instances', len(Instances)),
+              '{:<32}: {}'.format('instances_alive', Alive)]
+    Header += FormatCampaignStatus('', Total)
+    StatusPath = os.path.join(OutputPath, CampaignStatusFile)
+    with open(StatusPath + '.tmp', 'w') as f:
+        f.write('\n'.join(Header + Lines) + '\n')
+    os.rename(StatusPath + '.tmp', StatusPath)
+    return Alive
+
+def RunAFLCampaign(TestModuleBinPath, InputPath, OutputPath, InstanceNum, CustomMutatorBinPath=None, CustomMutatorFormat='auto', FixupRulesPath=None, DictPath=None):
+    Env = GetAFLEnv(CustomMutatorBinPath, CustomMutatorFormat, FixupRulesPath)
+    CoreNum = GetCoreNum()
+    if InstanceNum > CoreNum:
+        print("{} instances on {} cores, instances will share cores.".format(InstanceNum, CoreNum))
+    AFLPlusPlus = IsAFLPlusPlus(Env)
+
+    print("Start run AFL campaign, status in {}:".format(os.path.join(OutputPath, CampaignStatusFile)))
+    Instances = []
+    try:
+        for Index in range(InstanceNum):
+            if Index == 0:
+                Name = 'main'
+                Options = ['-M', Name]
+            else:
+                Name = 'secondary{}'.format(Index)
+                Options = ['-S', Name]
+                if AFLPlusPlus:
+                    Options += ['-p', PowerSchedules[(Index - 1) % len(PowerSchedules)]]
+            # AFL binds each instance to a free core by itself, AFL++ is told which one
+            if AFLPlusPlus:
+                Options += ['-b', str(Index % CoreNum)]
+            Cmd = GetAFLCmd(TestModuleBinPath, InputPath, OutputPath, DictPath, Options)
+            print(' '.join(Cmd))
+            LogFile = open(os.path.join(OutputPath, Name + '.log'), 'w')
+            Instances.append((Name, subprocess.Popen(Cmd, stdout=LogFile, stderr=subprocess.STDOUT, env=Env)))
+            LogFile.close()
+        while WriteCampaignStatus(OutputPath, Instances) != 0:
+            time.sleep(CampaignStatusInterval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for Name, Process in Instances:
+            if Process.poll() is None:
+                Process.terminate()
+                Process.wait()
+        if Instances:
+            WriteCampaignStatus(OutputPath, Instances)
+
 gParamCheck = []
 def SingleCheckCallback(option, opt_str, value, parser):
     if option not in gParamCheck:
@@ -184,6 +381,12 @@ def MyOptionParser():
         help="Test input seed path.")
     Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
         help="Test output path for AFL.")
+    Parser.add_option("-c", "--custom-mutator", action="callback", type="choice", choices=CustomMutatorFormats, dest="CustomMutator", callback=SingleCheckCallback,
+        help="Use the structure-aware AFL++ custom mutator and the fixup post-processor. FORMAT is one of list: auto, udf, gpt, capsule, smmvariable, none. 'none' only post-processes. Linux only.")
+    Parser.add_option("-n", "--instances", action="callback", type="int", dest="InstanceNum", callback=SingleCheckCallback,
+        help="Run a headless campaign of one main and INSTANCENUM-1 secondary AFL instances sharing OUTPUT, with aggregated status in OUTPUT/campaign_stats. 0 means one instance per core. Linux only.")
+    Parser.add_option("--distill", action="store_true", dest="Distill", default=False,
+        help="Distill the input seeds with afl-showmap and afl-tmin into OUTPUT/distilled_input and fuzz from there. Linux only.")
     (Opt, Args) = Parser.parse_args()
     return (Opt, Args)
 
@@ -230,12 +433,40 @@ def main():
                 os.makedirs(OutputSeedPath)
             except Exception as err:
                 print(err)
-        elif os.path.exists(os.path.join(OutputSeedPath, 'fuzzer_stats')):
+        elif os.path.exists(os.path.join(OutputSeedPath, 'fuzzer_stats')) or os.path.exists(os.path.join(OutputSeedPath, CampaignStatusFile)):
             print("OutputSeedPath:{} is already exists, please change another directory.".format(OutputSeedPath))
             os._exit(0)
 
     TestModuleBinPath = Build(TargetArch, BuildTarget, ModuleFilePath)
-    RunAFL(TestModuleBinPath, InputSeedPath, OutputSeedPath)
+    DictPath = GenerateModuleDictionary(TestModuleBinPath, ModuleFilePath)
+    SetModulePcdDatabase(TestModuleBinPath, ModuleFilePath)
+    if Option.Distill:
+        if SysType != "Linux":
+            print("Seed distillation is only supported on Linux.")
+            os._exit(0)
+        DistilledPath = os.path.join(OutputSeedPath, 'distilled_input')
+        if os.path.exists(DistilledPath):
+            shutil.rmtree(DistilledPath)
+        Total, Kept = DistillCorpus('afl', TestModuleBinPath, [InputSeedPath], DistilledPath)
+        print("Distilled {} of {} input seeds into {}".format(Kept, Total, DistilledPath))
+        if Kept:
+            InputSeedPath = DistilledPath
+    CustomMutatorBinPath = None
+    FixupRulesPath = None
+    if Option.CustomMutator:
+        if SysType != "Linux":
+            print("Custom mutator is only supported with AFL++ on Linux.")
+            os._exit(0)
+        CustomMutatorBinPath = BuildCustomMutator(TargetArch, TestModuleBinPath)
+        FixupRulesPath = DumpFixupRules(TestModuleBinPath)
+    if Option.InstanceNum is not None:
+        if SysType != "Linux":
+            print("AFL campaign is only supported on Linux.")
+            os._exit(0)
+        RunAFLCampaign(TestModuleBinPath, InputSeedPath, OutputSeedPath, Option.InstanceNum if Option.InstanceNum > 0 else GetCoreNum(),
+                       CustomMutatorBinPath, Option.CustomMutator, FixupRulesPath, DictPath)
+        return
+    RunAFL(TestModuleBinPath, InputSeedPath, OutputSeedPath, CustomMutatorBinPath, Option.CustomMutator, FixupRulesPath, DictPath)
 
 if __name__ == "__main__":
     main()
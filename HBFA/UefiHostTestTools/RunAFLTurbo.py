@@ -11,6 +11,10 @@ import platform
 import subprocess
 from optparse import OptionParser
 
+sys.path.append(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'Script'))
+from GenFuzzDict import GenerateModuleDictionary
+from GenPcdDatabase import SetModulePcdDatabase
+
 __prog__ = 'RunAFLTurbo.py'
 __copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
 __version__ = '{} Version {}'.format(__prog__, '0.1 ')
@@ -130,9 +134,9 @@ def Build(Arch, Target, ModuleFilePath):
     CheckBuildResult(ModuleBinAbsPath)
     return ModuleBinAbsPath
 
-def RunAFLTurbo(TestModuleBinPath, InputPath, OutputPath):
+def RunAFLTurbo(TestModuleBinPath, InputPath, OutputPath, DictPath=None):
     SetEnvCmd = "export PATH=$PATH:$AFL_PATH\n"
-    AFL_CMD = "afl-turbo-fuzz -i {} -o {} {} @@".format(InputPath, OutputPath, TestModuleBinPath)
+    AFL_CMD = "afl-turbo-fuzz -i {} -o {} {}{} @@".format(InputPath, OutputPath, "-x {} ".format(DictPath) if DictPath else '', TestModuleBinPath)
     print("Start run AFLTurbo test:")
     print(AFL_CMD)
     ExecCmd = "gnome-terminal --geometry=90x30 -e 'bash -c \"{};exec bash\" ' ".format(SetEnvCmd + AFL_CMD)
@@ -213,7 +217,9 @@ def main():
             os._exit(0)
 
     TestModuleBinPath = Build(TargetArch, BuildTarget, ModuleFilePath)
-    RunAFLTurbo(TestModuleBinPath, InputSeedPath, OutputSeedPath)
+    DictPath = GenerateModuleDictionary(TestModuleBinPath, ModuleFilePath)
+    SetModulePcdDatabase(TestModuleBinPath, ModuleFilePath)
+    RunAFLTurbo(TestModuleBinPath, InputSeedPath, OutputSeedPath, DictPath)
 
 if __name__ == "__main__":
     main()
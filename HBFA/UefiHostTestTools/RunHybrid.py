@@ -0,0 +1,380 @@
+## @file
+# Run a fuzzer and KLEE side by side on one test module.
+#
+# AFL (or libFuzzer) runs without interruption. Whenever it has found no new
+# path for a while, the queue entries that never produced offspring are
+# replayed by KLEE, each one as concrete seed of the symbolic regions of the
+# harness (see GetHarnessSymbolicRegions in ToolChainHarnessLib.h). Every
+# .ktest KLEE writes is put back into an input and dropped into the AFL sync
+# directory, or the libFuzzer corpus, as soon as it is closed.
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import os
+import re
+import sys
+import time
+import platform
+import subprocess
+from optparse import OptionParser
+
+sys.path.append(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'Script'))
+sys.path.append(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'Report'))
+import RunAFL
+import RunKLEE
+import RunLibFuzzer
+import TransferKtestToSeed
+from GenFuzzDict import GenerateModuleDictionary
+from GenPcdDatabase import SetModulePcdDatabase
+from SeedWatcher import SeedWatcher
+
+__prog__ = 'RunHybrid.py'
+__copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
+__version__ = '{} Version {}'.format(__prog__, '0.1 ')
+
+## Get System type info
+SysType = platform.system()
+
+## HBFA package path
+HBFA_PATH = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
+
+## Name of the AFL main instance, and of the fake instance KLEE inputs are synced from
+AFL_MAIN_NAME = 'main'
+AFL_KLEE_NAME = 'klee'
+
+## Seconds between two looks at the fuzzer and KLEE
+POLL_INTERVAL = 5
+
+## Bounds of the KLEE time budget per queue entry, in seconds
+KLEE_MIN_TIME = 30
+KLEE_MAX_TIME = 1800
+
+## AFL queue entry names: id:000012,src:000003+000007,op:splice,...
+AFL_ID_PATTERN = re.compile(r'^id[:_](\d+)')
+AFL_SRC_PATTERN = re.compile(r'src[:_](\d+)(?:\+(\d+))?')
+
+
+class AFLFuzzer(object):
+    """
+    AFL main instance. KLEE inputs are written as the queue of a fake
+    secondary instance, which afl-fuzz imports at each sync.
+    """
+    def __init__(self, BinPath, InputPath, OutputPath, DictPath):
+        self.BinPath = BinPath
+        self.InputPath = InputPath
+        self.OutputPath = OutputPath
+        self.DictPath = DictPath
+        self.QueuePath = os.path.join(OutputPath, AFL_MAIN_NAME, 'queue')
+        self.StatsPath = os.path.join(OutputPath, AFL_MAIN_NAME, 'fuzzer_stats')
+        self.SyncQueuePath = os.path.join(OutputPath, AFL_KLEE_NAME, 'queue')
+        self.SyncId = 0
+        if not os.path.exists(self.SyncQueuePath):
+            os.makedirs(self.SyncQueuePath)
+
+    def Start(self, LogFile):
+        Cmd = ['afl-fuzz', '-i', self.InputPath, '-o', self.OutputPath, '-M', AFL_MAIN_NAME]
+        if self.DictPath:
+            Cmd += ['-x', self.DictPath]
+        Cmd += ['--', self.BinPath, '@@']
+        Env = os.environ.copy()
+        Env['PATH'] = Env['PATH'] + os.pathsep + os.environ['AFL_PATH']
+        Env['AFL_NO_UI'] = '1'
+        print(' '.join(Cmd))
+        return subprocess.Popen(Cmd, stdout=LogFile, stderr=subprocess.STDOUT, env=Env)
+
+    def GetLastFind(self):
+        Stats = {}
+        try:
+            with open(self.StatsPath, 'r') as f:
+                for line in f:
+                    if ':' in line:
+                        Key, Value = line.split(':', 1)
+                        Stats[Key.strip()] = Value.strip()
+        except IOError:
+            return None
+        for Key in ['last_find', 'last_path', 'start_time']:
+            if Stats.get(Key, '0') != '0':
+                return int(Stats[Key])
+        return None
+
+    def GetStaleEntries(self):
+        # Entries no other entry was derived from, oldest first
+        Entries = {}
+        Parents = set()
+        for Name in os.listdir(self.QueuePath):
+            Match = AFL_ID_PATTERN.match(Name)
+            if not Match:
+                continue
+            Entries[int(Match.group(1))] = os.path.join(self.QueuePath, Name)
+            Match = AFL_SRC_PATTERN.search(Name)
+            if Match and 'sync' not in Name:
+                Parents.update(int(Id) for Id in Match.groups() if Id)
+        return [Entries[Id] for Id in sorted(Entries) if Id not in Parents]
+
+    def CountImported(self):
+        return len([Name for Name in os.listdir(self.QueuePath) if 'sync:' + AFL_KLEE_NAME in Name or 'sync_' + AFL_KLEE_NAME in Name])
+
+    def AddInput(self, Data, Origin):
+        Name = 'id:{:06d},src:{}'.format(self.SyncId, Origin)
+        self.SyncId += 1
+        TmpPath = os.path.join(os.path.dirname(self.SyncQueuePath), '.' + Name)
+        with open(TmpPath, 'wb') as f:
+            f.write(Data)
+        os.rename(TmpPath, os.path.join(self.SyncQueuePath, Name))
+
+
+class LibFuzzer(object):
+    """
+    libFuzzer instance. KLEE inputs are written to its corpus, which it
+    reloads periodically.
+    """
+    def __init__(self, BinPath, InputPath, OutputPath, DictPath):
+        self.BinPath = BinPath
+        self.InputPath = InputPath
+        self.OutputPath = OutputPath
+        self.DictPath = DictPath
+        self.QueuePath = os.path.join(OutputPath, 'corpus')
+        self.SyncId = 0
+        self.Added = set()
+        if not os.path.exists(self.QueuePath):
+            os.makedirs(self.QueuePath)
+
+    def Start(self, LogFile):
+        Cmd = [self.BinPath, self.QueuePath, self.InputPath, '-rss_limit_mb=0', '-reload=1',
+               '-artifact_prefix=' + self.OutputPath + os.sep]
+        if self.DictPath:
+            Cmd.append('-dict=' + self.DictPath)
+        Env = os.environ.copy()
+        if 'CLANG_PATH' in os.environ:
+            Env['PATH'] = os.environ['CLANG_PATH'] + os.pathsep + Env['PATH']
+        print(' '.join(Cmd))
+        return subprocess.Popen(Cmd, stdout=LogFile, stderr=subprocess.STDOUT, env=Env)
+
+    def GetLastFind(self):
+        Times = [os.path.getmtime(os.path.join(self.QueuePath, Name)) for Name in os.listdir(self.QueuePath) if Name not in self.Added]
+        return int(max(Times)) if Times else None
+
+    def GetStaleEntries(self):
+        # libFuzzer keeps no lineage: oldest units first
+        Paths = [os.path.join(self.QueuePath, Name) for Name in os.listdir(self.QueuePath) if Name not in self.Added]
+        return sorted(Paths, key=os.path.getmtime)
+
+    def CountImported(self):
+        return None
+
+    def AddInput(self, Data, Origin):
+        Name = 'klee-{:06d}'.format(self.SyncId)
+        self.SyncId += 1
+        self.Added.add(Name)
+        with open(os.path.join(self.QueuePath, Name), 'wb') as f:
+            f.write(Data)
+
+
+class KleeReplay(object):
+    """
+    One concolic KLEE run over a queue entry, whose .ktest files are streamed
+    back to the fuzzer.
+    """
+    def __init__(self, BinPath, EntryPath, OutputPath, MaxTime, LogFile):
+        self.EntryPath = EntryPath
+        self.OutputPath = OutputPath
+        self.Inputs = 0
+        with open(EntryPath, 'rb') as f:
+            self.Seed = f.read()
+        KLEE_CMD = "klee --only-output-states-covering-new -max-time={} -output-dir={} {} {}".format(MaxTime, OutputPath, BinPath, EntryPath)
+        print(KLEE_CMD)
+        self.Process = subprocess.Popen("export PATH=$KLEE_BIN_PATH:$PATH\nulimit -s unlimited\n" + KLEE_CMD,
+                                        stdout=LogFile,
+                                        stderr=subprocess.STDOUT,
+                                        shell=True)
+        self.Watcher = SeedWatcher([OutputPath], lambda Name: Name.endswith('.ktest'))
+
+    def Stream(self, Fuzzer):
+        for Paths in self.Watcher.GetNew().values():
+            for Path in Paths:
+                ObjectList = TransferKtestToSeed.analyseFile(Path)
+                RegionList = [Object for Object in ObjectList if TransferKtestToSeed.isRegionObject(Object[1])]
+                #
+                # Without symbolic regions the ktest holds the whole input of
+                # GetMaxBufferSize() bytes, too large for the fuzzer queue.
+                #
+                if not RegionList:
+                    continue
+                Data = TransferKtestToSeed.assembleSeed(RegionList, self.Seed)
+                Fuzzer.AddInput(Data, AFL_KLEE_NAME)
+                self.Inputs += 1
+
+    def Done(self):
+        return self.Process.poll() is not None
+
+    def Stop(self):
+        if self.Process.poll() is None:
+            self.Process.terminate()
+            self.Process.wait()
+
+
+def RunHybrid(Fuzzer, KleeBinPath, OutputPath, StallTime, KleeTime, EntryNum, Duration):
+    LogFile = open(os.path.join(OutputPath, 'fuzzer.log'), 'a')
+    KleeLogFile = open(os.path.join(OutputPath, 'klee.log'), 'a')
+    KleeOutputPath = os.path.join(OutputPath, 'klee-out')
+    if not os.path.exists(KleeOutputPath):
+        os.makedirs(KleeOutputPath)
+
+    FuzzerProcess = Fuzzer.Start(LogFile)
+    StartTime = time.time()
+    RoundEnd = StartTime
+    Replayed = set()
+    Pending = []
+    Replay = None
+    ReplayNum = 0
+    RoundInputs = 0
+    RoundImported = None
+    try:
+        while FuzzerProcess.poll() is None:
+            Now = time.time()
+            if Duration and Now - StartTime >= Duration:
+                break
+            if Replay:
+                Replay.Stream(Fuzzer)
+                if Replay.Done():
+                    Replay.Stream(Fuzzer)
+                    RoundInputs += Replay.Inputs
+                    print("KLEE: {} new inputs from {}".format(Replay.Inputs, os.path.basename(Replay.EntryPath)))
+                    Replay = None
+                    if not Pending:
+                        #
+                        # Spend more time in KLEE while its inputs are kept by
+                        # the fuzzer, less while they are not.
+                        #
+                        Imported = Fuzzer.CountImported()
+                        Useful = (Imported - RoundImported) > 0 if Imported is not None else RoundInputs > 0
+                        KleeTime = min(KleeTime * 2, KLEE_MAX_TIME) if Useful else max(KleeTime // 2, KLEE_MIN_TIME)
+                        RoundEnd = time.time()
+                        print("KLEE round done, next budget {}s per entry".format(KleeTime))
+            elif Pending:
+                EntryPath = Pending.pop(0)
+                Replay = KleeReplay(KleeBinPath, EntryPath, os.path.join(KleeOutputPath, str(ReplayNum)), KleeTime, KleeLogFile)
+                ReplayNum += 1
+            else:
+                LastFind = Fuzzer.GetLastFind()
+                if LastFind is not None and Now - max(LastFind, RoundEnd) >= StallTime:
+                    Pending = [Path for Path in Fuzzer.GetStaleEntries() if Path not in Replayed][:EntryNum]
+                    Replayed.update(Pending)
+                    RoundInputs = 0
+                    RoundImported = Fuzzer.CountImported()
+                    if Pending:
+                        print("Fuzzer stalled for {}s, replaying {} entries with KLEE".format(int(Now - max(LastFind, RoundEnd)), len(Pending)))
+                    else:
+                        RoundEnd = Now
+            time.sleep(POLL_INTERVAL)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if Replay:
+            Replay.Stop()
+        if FuzzerProcess.poll() is None:
+            FuzzerProcess.terminate()
+            FuzzerProcess.wait()
+        LogFile.close()
+        KleeLogFile.close()
+
+gParamCheck = []
+def SingleCheckCallback(option, opt_str, value, parser):
+    if option not in gParamCheck:
+        setattr(parser.values, option.dest, value)
+        gParamCheck.append(option)
+    else:
+        parser.error("Option %s only allows one instance in command line!" % option)
+
+# Parse command line options
+def MyOptionParser():
+    Parser = OptionParser(description=__copyright__, version=__version__, prog=__prog__, usage="python %prog [options][argument]")
+    Parser.add_option("-a", "--arch", action="callback", type="choice", choices=['IA32', 'X64', 'ARM', 'AARCH64'], dest="TargetArch", default="IA32", callback=SingleCheckCallback,
+        help="ARCHS is one of list: IA32, X64, ARM or AARCH64, which overrides target.txt's TARGET_ARCH definition.")
+    Parser.add_option("-b", "--buildtarget", action="callback", type="string", dest="BuildTarget", default="DEBUG", callback=SingleCheckCallback,
+        help="Using the TARGET to build the platform, overriding target.txt's TARGET definition.")
+    Parser.add_option("-m", "--module", action="callback", type="string", dest="ModuleFile", callback=SingleCheckCallback,
+        help="Build the module specified by the INF file name argument.")
+    Parser.add_option("-i", "--input", action="callback", type="string", dest="InputSeed", callback=SingleCheckCallback,
+        help="Test input seed path.")
+    Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
+        help="Test output path, shared by the fuzzer and KLEE.")
+    Parser.add_option("-f", "--fuzzer", action="callback", type="choice", choices=['afl', 'libfuzzer'], dest="Fuzzer", default="afl", callback=SingleCheckCallback,
+        help="FUZZER is one of list: afl, libfuzzer. Default is afl.")
+    Parser.add_option("-s", "--stall-time", action="callback", type="int", dest="StallTime", default=300, callback=SingleCheckCallback,
+        help="Seconds without new path after which KLEE replays queue entries. Default is 300.")
+    Parser.add_option("-k", "--klee-time", action="callback", type="int", dest="KleeTime", default=120, callback=SingleCheckCallback,
+        help="Initial KLEE time budget per queue entry in seconds, adapted after each round. Default is 120.")
+    Parser.add_option("-n", "--entries", action="callback", type="int", dest="EntryNum", default=4, callback=SingleCheckCallback,
+        help="Number of queue entries replayed by KLEE per round. Default is 4.")
+    Parser.add_option("-d", "--duration", action="callback", type="int", dest="Duration", default=0, callback=SingleCheckCallback,
+        help="Stop the campaign after DURATION seconds. Default is 0, run until interrupted.")
+    (Opt, Args) = Parser.parse_args()
+    return (Opt, Args)
+
+def main():
+    (Option, Target) = MyOptionParser()
+    TargetArch = Option.TargetArch
+    BuildTarget = Option.BuildTarget
+
+    if SysType != 'Linux':
+        print("KLEE is not supported in Windows currently.")
+        os._exit(0)
+
+    if Option.Fuzzer == 'afl':
+        RunAFL.CheckTestEnv()
+    else:
+        RunLibFuzzer.CheckTestEnv(TargetArch)
+    RunKLEE.CheckTestEnv()
+
+    if not Option.ModuleFile:
+        print("ModuleFile should be set once by command -m MODULEFILE, --module=MODULEFILE.")
+        os._exit(0)
+    elif os.path.isabs(Option.ModuleFile):
+        if Option.ModuleFile.startswith(HBFA_PATH):
+            ModuleFilePath = os.path.relpath(Option.ModuleFile, HBFA_PATH)
+        else:
+            print("ModuleFile path: {} should be start with {}.".format(Option.ModuleFile, HBFA_PATH))
+            os._exit(0)
+    elif not os.path.exists(os.path.join(HBFA_PATH, Option.ModuleFile)):
+        print("ModuleFile path: {} is no exits or not the relative path for HBFA".format(Option.ModuleFile))
+        os._exit(0)
+    else:
+        ModuleFilePath = Option.ModuleFile
+
+    if not Option.InputSeed:
+        print("InputSeed path should be set once by command -i INPUTSEED, --input=INPUTSEED.")
+        os._exit(0)
+    elif not os.path.exists(Option.InputSeed):
+        print("InputSeed path: {} is no exists".format(os.path.abspath(Option.InputSeed)))
+        os._exit(0)
+    else:
+        InputSeedPath = os.path.abspath(Option.InputSeed)
+
+    if not Option.Output:
+        print("OutputSeed path should be set once by command -o OUTPUT, --output=OUTPUT.")
+        os._exit(0)
+    else:
+        OutputSeedPath = os.path.abspath(Option.Output)
+        if os.path.exists(os.path.join(OutputSeedPath, 'klee-out')):
+            print("OutputSeedPath:{} is already exists, please change another directory.".format(OutputSeedPath))
+            os._exit(0)
+        if not os.path.exists(OutputSeedPath):
+            os.makedirs(OutputSeedPath)
+
+    if Option.Fuzzer == 'afl':
+        FuzzerBinPath = RunAFL.Build(TargetArch, BuildTarget, ModuleFilePath)
+        SetModulePcdDatabase(FuzzerBinPath, ModuleFilePath)
+        Fuzzer = AFLFuzzer(FuzzerBinPath, InputSeedPath, OutputSeedPath, GenerateModuleDictionary(FuzzerBinPath, ModuleFilePath))
+    else:
+        FuzzerBinPath = RunLibFuzzer.Build(TargetArch, BuildTarget, ModuleFilePath)
+        SetModulePcdDatabase(FuzzerBinPath, ModuleFilePath)
+        Fuzzer = LibFuzzer(FuzzerBinPath, InputSeedPath, OutputSeedPath, GenerateModuleDictionary(FuzzerBinPath, ModuleFilePath))
+    KleeBinPath = RunKLEE.Build(TargetArch, BuildTarget, ModuleFilePath)
+
+    RunHybrid(Fuzzer, KleeBinPath, OutputSeedPath, Option.StallTime, Option.KleeTime, Option.EntryNum, Option.Duration)
+
+if __name__ == "__main__":
+    main()
@@ -120,10 +120,31 @@ def Build(Arch, Target, ModuleFilePath):
     CheckBuildResult(ModuleBinAbsPath)
     return ModuleBinAbsPath
 
-def RunKLEE(TestModuleBinPath, OutPutPath):
+def GetKLEECmd(TestModuleBinPath, OutPutPath, SeedFile, Options=None):
+    Cmd = ['klee', '--only-output-states-covering-new', '-output-dir={}'.format(OutPutPath)]
+    if Options:
+        Cmd += Options
+    Cmd.append(TestModuleBinPath)
+    # The seed gives the concrete bytes around the symbolic regions of the harness
+    if SeedFile:
+        Cmd.append(SeedFile)
+    return Cmd
+
+def GetKLEEEnv():
+    Env = os.environ.copy()
+    Env['PATH'] = os.environ['KLEE_BIN_PATH'] + os.pathsep + Env['PATH']
+    return Env
+
+def SetUnlimitedStack():
+    # ulimit -s unlimited, for a KLEE started without a shell
+    import resource
+    Soft, Hard = resource.getrlimit(resource.RLIMIT_STACK)
+    resource.setrlimit(resource.RLIMIT_STACK, (Hard, Hard))
+
+def RunKLEE(TestModuleBinPath, OutPutPath, SeedFile):
     SetEnvCmd = "export PATH=$KLEE_BIN_PATH:$PATH\n"
     SetLimit = "ulimit -s unlimited\n"
-    KLEE_CMD = "klee --only-output-states-covering-new -output-dir={}  {}".format(OutPutPath, TestModuleBinPath)
+    KLEE_CMD = ' '.join(GetKLEECmd(TestModuleBinPath, OutPutPath, SeedFile))
     print("Start run KLEE test:")
     print(KLEE_CMD)
     subprocess.Popen("gnome-terminal --geometry=90x30 -e 'bash -c \"{};exec bash\" ' ".format(SetEnvCmd + SetLimit + KLEE_CMD), 
@@ -150,6 +171,8 @@ def MyOptionParser():
         help="Build the module specified by the INF file name argument.")
     Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
         help="Test output path for Klee.")
+    Parser.add_option("-s", "--seed", action="callback", type="string", dest="SeedFile", callback=SingleCheckCallback,
+        help="Seed file giving the concrete input bytes outside the symbolic regions of the harness.")
     (Opt, Args) = Parser.parse_args()
     return (Opt, Args)
 
@@ -188,8 +211,15 @@ def main():
                 os.makedirs(os.path.dirname(OutputSeedPath))
                 
 
+    SeedFile = None
+    if Option.SeedFile:
+        if not os.path.isfile(Option.SeedFile):
+            print("Seed file: {} is not exists.".format(Option.SeedFile))
+            os._exit(0)
+        SeedFile = os.path.abspath(Option.SeedFile)
+
     TestModuleBinPath = Build(TargetArch, BuildTarget, ModuleFilePath)
-    RunKLEE(TestModuleBinPath, OutputSeedPath)
+    RunKLEE(TestModuleBinPath, OutputSeedPath, SeedFile)
 
 if __name__ == "__main__":
     main()
@@ -5,11 +5,19 @@
 #
 
 import os
+import re
 import sys
+import time
 import platform
 import subprocess
 from optparse import OptionParser
 
+sys.path.append(os.path.join(os.path.dirname(os.path.realpath(__file__)), 'Script'))
+from GenFuzzDict import GenerateModuleDictionary
+from GenPcdDatabase import SetModulePcdDatabase
+from DistillCorpus import DistillCorpus
+from CoreNum import GetCoreNum
+
 __prog__ = 'RunLibFuzzer.py'
 __copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
 __version__ = '{} Version {}'.format(__prog__, '0.1 ')
@@ -38,6 +46,14 @@ if SysType == "Windows":
 elif SysType == "Linux":
     ToolChain = "LIBFUZZER"
 
+## Aggregated status of a campaign, and seconds between two updates of it
+CampaignStatusFile = 'campaign_stats'
+CampaignStatusInterval = 10
+
+## libFuzzer status line: #1234\tNEW    cov: 56 ft: 78 corp: 9/1024b ... exec/s: 100 rss: 30Mb
+StatusLinePattern = re.compile(r'^#(\d+)\s+\w+\s+cov: (\d+) ft: (\d+) corp: (\d+)/.*?exec/s: (\d+)')
+ArtifactPrefixes = ['crash-', 'leak-', 'timeout-', 'oom-']
+
 def CheckTestEnv(Arch):
     # Check whether EDKII BUILD WORKSPACE is set in system environment variable
     if 'WORKSPACE' not in os.environ:
@@ -137,8 +153,24 @@ def Build(Arch, Target, ModuleFilePath):
     CheckBuildResult(ModuleBinAbsPath)
     return ModuleBinAbsPath
 
-def RunLibFuzzer(TestModuleBinPath, InputPath, OutputPath):
-    LibFuzzer_CMD = "{} {} -rss_limit_mb=0 -artifact_prefix={}".format(TestModuleBinPath, InputPath if InputPath else '', OutputPath + ('/' if SysType == "Linux" else '\\'))
+def GetLibFuzzerCmd(TestModuleBinPath, InputPaths, OutputPath, DictPath=None, Options=None):
+    # libFuzzer command line, the first input path is the corpus new inputs go to
+    Cmd = [TestModuleBinPath] + [Path for Path in InputPaths if Path]
+    Cmd += ['-rss_limit_mb=0', '-artifact_prefix=' + OutputPath + os.sep]
+    if Options:
+        Cmd += Options
+    if DictPath:
+        Cmd.append('-dict=' + DictPath)
+    return Cmd
+
+def GetLibFuzzerEnv():
+    Env = os.environ.copy()
+    if SysType == "Linux":
+        Env['PATH'] = os.environ['CLANG_PATH'] + os.pathsep + Env['PATH']
+    return Env
+
+def RunLibFuzzer(TestModuleBinPath, InputPath, OutputPath, DictPath=None):
+    LibFuzzer_CMD = ' '.join(GetLibFuzzerCmd(TestModuleBinPath, [InputPath], OutputPath, DictPath))
     print("Start run LibFuzzer test:")
     print(LibFuzzer_CMD)
     if SysType == "Windows":
@@ -150,6 +182,74 @@ def RunLibFuzzer(TestModuleBinPath, InputPath, OutputPath):
                      stderr=subprocess.STDOUT,
                      shell=True)
 
+def ReadLastStatus(LogPath):
+    # Only the tail of the log is needed
+    try:
+        with open(LogPath, 'rb') as f:
+            f.seek(0, os.SEEK_END)
+            f.seek(max(0, f.tell() - 64 * 1024))
+            Lines = f.read().decode('utf-8', 'replace').splitlines()
+    except IOError:
+        return None
+    for Line in reversed(Lines):
+        Match = StatusLinePattern.match(Line)
+        if Match:
+            return [int(Value) for Value in Match.groups()]
+    return None
+
+def WriteCampaignStatus(OutputPath, InstanceNum, Alive):
+    Execs = ExecsPerSec = Cov = Features = Corpus = 0
+    Lines = []
+    for Index in range(InstanceNum):
+        Status = ReadLastStatus(os.path.join(OutputPath, 'fuzz-{}.log'.format(Index)))
+        if not Status:
+            continue
+        Execs += Status[0]
+        ExecsPerSec += Status[4]
+        # Jobs share the corpus directory, keep the best one
+        Cov = max(Cov, Status[1])
+        Features = max(Features, Status[2])
+        Corpus = max(Corpus, Status[3])
+        Lines.append('{:<24}: {}'.format('job{}.execs_done'.format(Index), Status[0]))
+        Lines.append('{:<24}: {}'.format('job{}.execs_per_sec'.format(Index), Status[4]))
+        Lines.append('{:<24}: {}'.format('job{}.cov'.format(Index), Status[1]))
+    Artifacts = [Name for Name in os.listdir(OutputPath) if any(Name.startswith(Prefix) for Prefix in ArtifactPrefixes)]
+    Header = ['{:<24}: {}'.format('last_update', int(time.time())),
+              '{:<24}: {}'.format('instances', InstanceNum),
+              '{:<24}: {}'.format('instances_alive', InstanceNum if Alive else 0),
+              '{:<24}: {}'.format('execs_done', Execs),
+              '{:<24}: {}'.format('execs_per_sec', ExecsPerSec),
+              '{:<24}: {}'.format('cov', Cov),
+              '{:<24}: {}'.format('ft', Features),
+              '{:<24}: {}'.format('corpus_count', Corpus),
+              '{:<24}: {}'.format('saved_crashes', len([Name for Name in Artifacts if not Name.startswith('timeout-')])),
+              '{:<24}: {}'.format('saved_hangs', len([Name for Name in Artifacts if Name.startswith('timeout-')]))]
+    StatusPath = os.path.join(OutputPath, CampaignStatusFile)
+    with open(StatusPath + '.tmp', 'w') as f:
+        f.write('\n'.join(Header + Lines) + '\n')
+    if os.path.exists(StatusPath):
+        os.remove(StatusPath)
+    os.rename(StatusPath + '.tmp', StatusPath)
+
+def RunLibFuzzerCampaign(TestModuleBinPath, InputPath, OutputPath, InstanceNum, DictPath=None):
+    # The jobs write fuzz-<N>.log to the current directory and reload the shared corpus
+    Cmd = GetLibFuzzerCmd(TestModuleBinPath, [InputPath], OutputPath, DictPath,
+                          ['-jobs={}'.format(InstanceNum), '-workers={}'.format(InstanceNum), '-reload=1'])
+    Env = GetLibFuzzerEnv()
+    print("Start run LibFuzzer campaign, status in {}:".format(os.path.join(OutputPath, CampaignStatusFile)))
+    print(' '.join(Cmd))
+    LogFile = open(os.path.join(OutputPath, 'campaign.log'), 'w')
+    proccess = subprocess.Popen(Cmd, stdout=LogFile, stderr=subprocess.STDOUT, cwd=OutputPath, env=Env)
+    LogFile.close()
+    try:
+        while proccess.poll() is None:
+            WriteCampaignStatus(OutputPath, InstanceNum, True)
+            time.sleep(CampaignStatusInterval)
+    except KeyboardInterrupt:
+        proccess.terminate()
+        proccess.wait()
+    WriteCampaignStatus(OutputPath, InstanceNum, False)
+
 gParamCheck = []
 def SingleCheckCallback(option, opt_str, value, parser):
     if option not in gParamCheck:
@@ -171,6 +271,10 @@ def MyOptionParser():
         help="Test input seed path.")
     Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
         help="Test output path for LibFuzzer.")
+    Parser.add_option("-n", "--instances", action="callback", type="int", dest="InstanceNum", callback=SingleCheckCallback,
+        help="Run a headless campaign of INSTANCENUM libFuzzer jobs and workers sharing the input corpus, with aggregated status in OUTPUT/campaign_stats. 0 means one job per core.")
+    Parser.add_option("--distill", action="store_true", dest="Distill", default=False,
+        help="Distill the input seeds with -merge=1 into OUTPUT/distilled_input and fuzz from there.")
     (Opt, Args) = Parser.parse_args()
     return (Opt, Args)
 
@@ -224,7 +328,20 @@ def main():
             print(err)
 
     TestModuleBinPath = Build(TargetArch, BuildTarget, ModuleFilePath)
-    RunLibFuzzer(TestModuleBinPath, InputSeedPath, OutputPath)
+    DictPath = GenerateModuleDictionary(TestModuleBinPath, ModuleFilePath)
+    SetModulePcdDatabase(TestModuleBinPath, ModuleFilePath)
+    if Option.Distill:
+        DistilledPath = os.path.join(OutputPath, 'distilled_input')
+        if os.path.exists(DistilledPath):
+            shutil.rmtree(DistilledPath)
+        Total, Kept = DistillCorpus('libfuzzer', TestModuleBinPath, [InputSeedPath], DistilledPath)
+        print("Distilled {} of {} input seeds into {}".format(Kept, Total, DistilledPath))
+        if Kept:
+            InputSeedPath = DistilledPath
+    if Option.InstanceNum is not None:
+        RunLibFuzzerCampaign(TestModuleBinPath, InputSeedPath, OutputPath, Option.InstanceNum if Option.InstanceNum > 0 else GetCoreNum(), DictPath)
+        return
+    RunLibFuzzer(TestModuleBinPath, InputSeedPath, OutputPath, DictPath)
 
 if __name__ == "__main__":
     main()
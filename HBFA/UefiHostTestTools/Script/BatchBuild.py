@@ -0,0 +1,326 @@
+## @file
+# Build many test modules for one tool chain in a single build invocation
+#
+# The build -m of the Run*.py scripts parses the DSC and DEC files and checks
+# the host libraries again for every test module. Here the requested test
+# modules of a package are kept in a copy of the package DSC, all other test
+# modules removed, and the copy is built once with -n threads. The copy has
+# the OUTPUT_DIRECTORY of the package DSC, so the libraries are shared with
+# the Run*.py builds and the binaries land where those scripts expect them.
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import os
+import re
+import sys
+import time
+import platform
+import subprocess
+from optparse import OptionParser
+
+sys.path.append(os.path.dirname(os.path.realpath(__file__)))
+from CoreNum import GetCoreNum
+
+__prog__ = 'BatchBuild.py'
+__copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
+__version__ = '{} Version {}'.format(__prog__, '0.1 ')
+
+## Get System type info
+SysType = platform.system()
+
+## Get PYTHON version
+PyVersion = sys.version_info[0]
+
+## HBFA package path
+HBFA_PATH = os.path.dirname(os.path.dirname(os.path.dirname(os.path.realpath(__file__))))
+
+## Conf directory
+Conf_Path = os.path.join(HBFA_PATH, 'UefiHostFuzzTestPkg', 'Conf')
+
+## Build options and environment of each tool chain, as the Run*.py scripts use them
+ToolChains = {
+    'AFL': {
+        'BuildOptions': ['-t GCC5'] if SysType == 'Linux' else [],
+        'SetEnvCmd': 'export PATH=$PATH:$AFL_PATH\n',
+    },
+    'LIBFUZZER': {
+        'BuildOptions': [],
+        'SetEnvCmd': 'export PATH=$CLANG_PATH:$PATH\n',
+    },
+    'KLEE': {
+        'BuildOptions': ['-DTEST_WITH_KLEE', '--disable-include-path-check'],
+        'SetEnvCmd': 'export PATH=$KLEE_BIN_PATH:$PATH\nexport SCRIPT_PATH={}\nexport LLVM_COMPILER=clang\n'.format(
+            os.path.join(Conf_Path, 'LLVMLink.py')),
+    },
+    'GCC5': {
+        'BuildOptions': [],
+        'SetEnvCmd': '',
+    },
+    'CLANG8': {
+        'BuildOptions': [],
+        'SetEnvCmd': 'export PATH=$CLANG_PATH:$PATH\n',
+    },
+    'VS2015x86': {
+        'BuildOptions': [],
+        'SetEnvCmd': '',
+    },
+    'CLANGWIN': {
+        'BuildOptions': [],
+        'SetEnvCmd': '',
+    },
+}
+
+## Component line of a DSC: the INF path, and "{" if module scoped sections follow
+ComponentPattern = re.compile(r'^\s*([^\s{#!]+\.inf)\s*(\{)?', re.IGNORECASE)
+
+## Message of build when it starts on a module
+BuildingPattern = re.compile(r'Building \.\.\. (\S+\.inf) \[(\w+)\]', re.IGNORECASE)
+
+
+def NormPath(Path):
+    return Path.replace('\\', '/')
+
+def GetPkgName(path):
+    return NormPath(path).split('/')[0]
+
+def GetModuleBinName(ModuleInfPath):
+    with open(ModuleInfPath, 'r') as f:
+        for line in f:
+            if 'BASE_NAME' in line:
+                if SysType == "Windows":
+                    return line.split('=')[1].strip() + ".exe"
+                else:
+                    return line.split('=')[1].strip()
+
+def IsTestModule(InfPath):
+    return os.path.basename(InfPath).startswith('Test') and '/TestCase/' in NormPath(InfPath)
+
+def GenerateBatchDsc(PkgName, ModuleFilePaths, BatchDscPath):
+    """
+    Copy the DSC of PkgName without the test modules not in ModuleFilePaths.
+
+    :return: [ModuleFilePath] of ModuleFilePaths not in the DSC
+    """
+    Requested = set(NormPath(Path) for Path in ModuleFilePaths)
+    Found = set()
+    Lines = []
+    InComponents = False
+    SkipDepth = 0
+    with open(os.path.join(HBFA_PATH, PkgName, PkgName + '.dsc'), 'r') as f:
+        for line in f:
+            if SkipDepth:
+                SkipDepth += line.count('{') - line.count('}')
+                continue
+            Stripped = line.strip()
+            if Stripped.startswith('['):
+                InComponents = Stripped.lower().startswith('[components')
+            elif InComponents:
+                match = ComponentPattern.match(line)
+                if match and IsTestModule(match.group(1)):
+                    InfPath = NormPath(match.group(1))
+                    if InfPath in Requested:
+                        Found.add(InfPath)
+                    else:
+                        SkipDepth = line.count('{') - line.count('}')
+                        continue
+            Lines.append(line)
+    with open(BatchDscPath, 'w') as f:
+        f.writelines(Lines)
+    return [Path for Path in ModuleFilePaths if NormPath(Path) not in Found]
+
+def WriteReport(ReportPath, ToolChain, Arch, Target, Threads, TotalTime, Status, Modules):
+    with open(ReportPath, 'w') as f:
+        f.write('Tool chain: {}  Arch: {}  Target: {}  Threads: {}\n'.format(ToolChain, Arch, Target, Threads))
+        f.write('Build: {}  Total time: {:.1f}s\n\n'.format('pass' if Status else 'fail', TotalTime))
+        f.write('{:<40} {:<10} {:>10} {:>10} {:>10}\n'.format('Module', 'Result', 'Start(s)', 'Done(s)', 'Time(s)'))
+        for Module in sorted(Modules, key=lambda Module: (Module['Done'] is None, Module['Done'], Module['Name'])):
+            Start = '{:.1f}'.format(Module['Start']) if Module['Start'] is not None else '-'
+            Done = '{:.1f}'.format(Module['Done']) if Module['Done'] is not None else '-'
+            Time = '{:.1f}'.format(Module['Done'] - Module['Start']) if Module['Start'] is not None and Module['Done'] is not None else '-'
+            f.write('{:<40} {:<10} {:>10} {:>10} {:>10}\n'.format(Module['Name'], Module['Result'], Start, Done, Time))
+
+def BatchBuild(ToolChain, Arch, Target, ModuleFilePaths, Threads=0, LogFile=None, ReportPath=None, Defines=None):
+    """
+    Build the test modules with one build invocation per package.
+
+    :param ToolChain: one of ToolChains
+    :param ModuleFilePaths: test module INFs, relative to the HBFA package path
+    :param Threads: build -n, 0 for one per core
+    :param LogFile: file object receiving the build output, stdout if None
+    :param ReportPath: build time report, <Build>/<Pkg>/<Target>_<ToolChain>/BatchBuildReport.txt
+                       of the first package if None
+    :param Defines: extra -D macros, e.g. ['TEST_WITH_INSTRUMENT']
+    :return: ({ModuleFilePath: binary path, None if not built}, total seconds)
+    """
+    workspace = os.environ['WORKSPACE']
+    if Threads <= 0:
+        Threads = GetCoreNum()
+    if LogFile is None:
+        LogFile = sys.stdout
+    Results = dict((Path, None) for Path in ModuleFilePaths)
+    Modules = []
+    AllStatus = True
+    StartTime = time.time()
+
+    Packages = []
+    for Path in ModuleFilePaths:
+        if GetPkgName(Path) not in Packages:
+            Packages.append(GetPkgName(Path))
+    for PkgName in Packages:
+        PkgModules = [Path for Path in ModuleFilePaths if GetPkgName(Path) == PkgName]
+        OutputPath = os.path.join(workspace, 'Build', PkgName)
+        if not os.path.exists(OutputPath):
+            os.makedirs(OutputPath)
+        # The DSC is given relative to WORKSPACE, build looks for it there
+        BatchDscPath = os.path.join(OutputPath, '{}Batch_{}.dsc'.format(PkgName, ToolChain))
+        Missing = GenerateBatchDsc(PkgName, PkgModules, BatchDscPath)
+        for Path in Missing:
+            LogFile.write('{} is not a component of {}.dsc, skipped\n'.format(Path, PkgName))
+
+        BuildCmdList = []
+        BuildCmdList.append('-p {}'.format(os.path.relpath(BatchDscPath, workspace)))
+        BuildCmdList.append('-a {}'.format(Arch))
+        BuildCmdList.append('-b {}'.format(Target))
+        BuildCmdList.append('-t {}'.format(ToolChain))
+        BuildCmdList.append('-n {}'.format(Threads))
+        BuildCmdList.append('--conf {}'.format(Conf_Path))
+        BuildCmdList.extend(ToolChains[ToolChain]['BuildOptions'])
+        BuildCmdList.extend('-D{}'.format(Define) for Define in Defines or [])
+        BuildCmd = 'build ' + ' '.join(BuildCmdList)
+        LogFile.write(BuildCmd + '\n')
+        LogFile.flush()
+
+        BuildModules = {}
+        for Path in PkgModules:
+            if Path in Missing:
+                continue
+            BinPath = os.path.join(workspace, 'Build', PkgName, Target + '_' + ToolChain, Arch,
+                                   GetModuleBinName(os.path.join(HBFA_PATH, Path)))
+            BuildModules[NormPath(Path)] = {'Path': Path, 'Name': os.path.splitext(os.path.basename(Path))[0],
+                                            'BinPath': BinPath, 'Start': None, 'Done': None, 'Result': 'fail'}
+        PkgStartTime = time.time()
+        ExecCmd = ToolChains[ToolChain]['SetEnvCmd'] + BuildCmd if SysType == 'Linux' else BuildCmd
+        Process = subprocess.Popen(ExecCmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, shell=True)
+        Output = []
+        for line in iter(Process.stdout.readline, b''):
+            if PyVersion == 3:
+                line = line.decode(errors='replace')
+            Output.append(line)
+            LogFile.write(line)
+            match = BuildingPattern.search(line)
+            if match:
+                for Key, Module in BuildModules.items():
+                    if NormPath(match.group(1)).endswith(Key) and Module['Start'] is None:
+                        Module['Start'] = time.time() - StartTime
+        Process.wait()
+        LogFile.flush()
+        Status = Process.returncode == 0 and any('- Done -' in line for line in Output)
+        AllStatus = AllStatus and Status
+
+        for Module in BuildModules.values():
+            if os.path.exists(Module['BinPath']):
+                Mtime = os.path.getmtime(Module['BinPath'])
+                if Mtime >= PkgStartTime:
+                    Module['Result'] = 'built'
+                    Module['Done'] = Mtime - StartTime
+                    Results[Module['Path']] = Module['BinPath']
+                elif Status:
+                    Module['Result'] = 'up to date'
+                    Results[Module['Path']] = Module['BinPath']
+            Modules.append(Module)
+        if ReportPath is None:
+            ReportPath = os.path.join(workspace, 'Build', PkgName, Target + '_' + ToolChain, 'BatchBuildReport.txt')
+            if not os.path.exists(os.path.dirname(ReportPath)):
+                os.makedirs(os.path.dirname(ReportPath))
+
+    TotalTime = time.time() - StartTime
+    if ReportPath:
+        WriteReport(ReportPath, ToolChain, Arch, Target, Threads, TotalTime, AllStatus, Modules)
+        LogFile.write('Build time report: {}\n'.format(ReportPath))
+    return (Results, TotalTime)
+
+def GetAllTestModules():
+    ModuleFilePaths = []
+    for root, dirs, files in os.walk(os.path.join(HBFA_PATH, 'UefiHostFuzzTestCasePkg', 'TestCase')):
+        for file in files:
+            if file.endswith('.inf') and file.startswith('Test'):
+                ModuleFilePaths.append(os.path.relpath(os.path.join(root, file), HBFA_PATH))
+    return sorted(ModuleFilePaths, key=lambda Path: os.path.basename(Path))
+
+# The fields of the lines of a list file, without '#' comments and empty lines.
+# The first field is the path of a test module INF.
+def ReadListFile(ListFile):
+    Lines = []
+    with open(ListFile, 'r') as f:
+        for line in f:
+            Fields = line.split('#')[0].split()
+            if Fields:
+                Lines.append(Fields)
+    return Lines
+
+def GetModuleFilePath(Path):
+    if not os.path.isabs(Path):
+        Path = os.path.join(HBFA_PATH, Path) if os.path.exists(os.path.join(HBFA_PATH, Path)) else os.path.abspath(Path)
+    if not Path.startswith(HBFA_PATH) or not os.path.isfile(Path):
+        print("ModuleFile path: {} is no exits or not in {}".format(Path, HBFA_PATH))
+        os._exit(0)
+    return os.path.relpath(Path, HBFA_PATH)
+
+gParamCheck = []
+def SingleCheckCallback(option, opt_str, value, parser):
+    if option not in gParamCheck:
+        setattr(parser.values, option.dest, value)
+        gParamCheck.append(option)
+    else:
+        parser.error("Option %s only allows one instance in command line!" % option)
+
+# Parse command line options
+def MyOptionParser():
+    Parser = OptionParser(description=__copyright__, version=__version__, prog=__prog__, usage="python %prog [options] [TestXxx.inf ...]")
+    Parser.add_option("-t", "--toolchain", action="callback", type="choice", choices=sorted(ToolChains.keys()), dest="ToolChain", default="AFL", callback=SingleCheckCallback,
+        help="TOOLCHAIN is one of list: {}. Default is AFL.".format(', '.join(sorted(ToolChains.keys()))))
+    Parser.add_option("-a", "--arch", action="callback", type="choice", choices=['IA32', 'X64', 'ARM', 'AARCH64'], dest="TargetArch", default="IA32", callback=SingleCheckCallback,
+        help="ARCHS is one of list: IA32, X64, ARM or AARCH64, which overrides the TARGET_ARCH in Conf/target.txt.")
+    Parser.add_option("-b", "--buildtarget", action="callback", type="string", dest="BuildTarget", default="DEBUG", callback=SingleCheckCallback,
+        help="Using the TARGET to build the platform, overriding target.txt's TARGET definition.")
+    Parser.add_option("-n", "--threads", action="callback", type="int", dest="Threads", default=0, callback=SingleCheckCallback,
+        help="Build threads. Default is 0, one per core.")
+    Parser.add_option("-l", "--list", action="callback", type="string", dest="ListFile", callback=SingleCheckCallback,
+        help="File listing the test module INFs, one per line.")
+    Parser.add_option("--all", action="store_true", dest="All", default=False,
+        help="Build all test modules of UefiHostFuzzTestCasePkg.")
+    Parser.add_option("-r", "--report", action="callback", type="string", dest="Report", callback=SingleCheckCallback,
+        help="Path of the build time report. Default is BatchBuildReport.txt in the build output directory.")
+    Parser.add_option("-D", "--define", action="append", type="string", dest="Defines", default=[],
+        help="Macro passed to build, e.g. -D TEST_WITH_INSTRUMENT.")
+    (Opt, Args) = Parser.parse_args()
+    return (Opt, Args)
+
+def main():
+    (Option, Args) = MyOptionParser()
+    if 'WORKSPACE' not in os.environ:
+        print("Please set system environment variable 'WORKSPACE' before run this script.")
+        os._exit(0)
+
+    ModuleFilePaths = []
+    if Option.All:
+        ModuleFilePaths.extend(GetAllTestModules())
+    if Option.ListFile:
+        ModuleFilePaths.extend(Fields[0] for Fields in ReadListFile(Option.ListFile))
+    ModuleFilePaths.extend(Args)
+    ModuleFilePaths = [GetModuleFilePath(Path) for Path in ModuleFilePaths]
+    if not ModuleFilePaths:
+        print("No test module, give INF files, --list LISTFILE or --all.")
+        os._exit(0)
+
+    Results, TotalTime = BatchBuild(Option.ToolChain, Option.TargetArch, Option.BuildTarget, ModuleFilePaths,
+                                    Option.Threads, None, Option.Report, Option.Defines)
+    Failed = [Path for Path in ModuleFilePaths if not Results[Path]]
+    print("{} of {} test modules built in {:.1f}s".format(len(ModuleFilePaths) - len(Failed), len(ModuleFilePaths), TotalTime))
+    for Path in Failed:
+        print("Build failed: {}".format(Path))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,14 @@
+## @file
+# Number of processors of the host, the default number of parallel jobs
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import multiprocessing
+
+def GetCoreNum():
+    try:
+        return multiprocessing.cpu_count()
+    except NotImplementedError:
+        return 1
@@ -0,0 +1,255 @@
+## @file
+# Distill a seed corpus to the smallest set of inputs with the same coverage
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import os
+import sys
+import shutil
+import hashlib
+import tempfile
+import subprocess
+from optparse import OptionParser
+
+sys.path.append(os.path.dirname(os.path.realpath(__file__)))
+from CoreNum import GetCoreNum
+
+__prog__ = 'DistillCorpus.py'
+__copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
+__version__ = '{} Version {}'.format(__prog__, '0.1 ')
+
+## Get PYTHON version
+PyVersion = sys.version_info[0]
+
+## Milliseconds an input may run under afl-showmap and afl-tmin
+DEFAULT_TIMEOUT = 1000
+
+## Directories of an AFL output directory that are not inputs worth keeping
+AFL_SKIP_DIRS = ['.state', '.synced', 'crashes', 'hangs', '.traces']
+
+## Status files of AFL and of the fuzzing campaigns, next to the inputs
+AFL_SKIP_FILES = ['fuzzer_stats', 'plot_data', 'fuzz_bitmap', 'cmdline', 'fuzzer_setup', 'campaign_stats', 'README.txt']
+
+def GetAFLEnv():
+    Env = os.environ.copy()
+    if 'AFL_PATH' in os.environ:
+        Env['PATH'] = Env['PATH'] + os.pathsep + os.environ['AFL_PATH']
+    return Env
+
+def IsAFLInstance(Path):
+    return os.path.isdir(os.path.join(Path, 'queue'))
+
+def GetInputDirs(InputPath):
+    """
+    :return: [path] of the queue/ of the AFL instance InputPath or of the AFL
+             instances in InputPath, else [InputPath]
+    """
+    if IsAFLInstance(InputPath):
+        return [os.path.join(InputPath, 'queue')]
+    Instances = [os.path.join(InputPath, d) for d in sorted(os.listdir(InputPath))]
+    Queues = [os.path.join(Instance, 'queue') for Instance in Instances if IsAFLInstance(Instance)]
+    return Queues if Queues else [InputPath]
+
+def IsInputFile(Name):
+    return not Name.startswith('.') and Name not in AFL_SKIP_FILES and not Name.endswith('.log')
+
+def CollectInputs(InputPaths):
+    """
+    :return: [path] of the distinct inputs under InputPaths, smallest first.
+             Only the queue/ of an AFL output directory holds inputs.
+    """
+    Inputs = {}
+    for InputPath in InputPaths:
+        if os.path.isfile(InputPath):
+            Files = [InputPath]
+        else:
+            Files = []
+            for InputDir in GetInputDirs(InputPath):
+                for root, dirs, files in os.walk(InputDir):
+                    dirs[:] = sorted(d for d in dirs if d not in AFL_SKIP_DIRS)
+                    Files.extend(os.path.join(root, name) for name in sorted(files) if IsInputFile(name))
+        for File in Files:
+            with open(File, 'rb') as f:
+                Digest = hashlib.sha1(f.read()).hexdigest()
+            Inputs.setdefault(Digest, File)
+    return sorted(Inputs.values(), key=lambda File: (os.path.getsize(File), File))
+
+def ShowMap(Args):
+    """
+    Worker of the pool: the AFL tuples (edge id and hit count bucket) of one
+    input, None if it crashes or times out.
+    """
+    BinPath, InputPath, Timeout = Args
+    fd, MapPath = tempfile.mkstemp(suffix='.map')
+    os.close(fd)
+    try:
+        Cmd = ['afl-showmap', '-q', '-m', 'none', '-t', str(Timeout), '-o', MapPath, '--', BinPath, InputPath]
+        with open(os.devnull, 'w') as Null:
+            Status = subprocess.call(Cmd, stdout=Null, stderr=Null, env=GetAFLEnv())
+        if Status != 0:
+            return None
+        Tuples = []
+        with open(MapPath, 'r') as f:
+            for line in f:
+                Edge, Count = line.strip().split(':')
+                Tuples.append(int(Edge) << 8 | int(Count))
+        return Tuples
+    finally:
+        os.remove(MapPath)
+
+def Trim(Args):
+    """
+    Worker of the pool: afl-tmin an input, keeping its path through the binary.
+    """
+    BinPath, InputPath, OutputPath, Timeout = Args
+    Cmd = ['afl-tmin', '-m', 'none', '-t', str(Timeout), '-i', InputPath, '-o', OutputPath, '--', BinPath, '@@']
+    with open(os.devnull, 'w') as Null:
+        Status = subprocess.call(Cmd, stdout=Null, stderr=Null, env=GetAFLEnv())
+    if Status != 0 or not os.path.isfile(OutputPath):
+        shutil.copyfile(InputPath, OutputPath)
+
+def RunPool(Function, ArgsList, Jobs):
+    if Jobs <= 1 or len(ArgsList) <= 1:
+        return [Function(Args) for Args in ArgsList]
+    import multiprocessing
+    Pool = multiprocessing.Pool(Jobs)
+    try:
+        # map_async().get() with a timeout lets Ctrl+C through on python 2
+        return Pool.map_async(Function, ArgsList).get(0x7FFFFFFF)
+    finally:
+        Pool.terminate()
+        Pool.join()
+
+def SelectInputs(Inputs, TuplesList):
+    """
+    afl-cmin selection: the rarest tuples first, each covered by the smallest
+    input that has it, until all tuples are covered.
+    """
+    Frequency = {}
+    for Tuples in TuplesList:
+        for Tuple in Tuples or []:
+            Frequency[Tuple] = Frequency.get(Tuple, 0) + 1
+    Smallest = {}
+    for Index, Tuples in enumerate(TuplesList):
+        for Tuple in Tuples or []:
+            # Inputs are sorted by size, the first one is the smallest
+            Smallest.setdefault(Tuple, Index)
+    Covered = set()
+    Selected = []
+    for Tuple in sorted(Frequency, key=lambda Tuple: (Frequency[Tuple], Tuple)):
+        if Tuple in Covered:
+            continue
+        Index = Smallest[Tuple]
+        Selected.append(Inputs[Index])
+        Covered.update(TuplesList[Index])
+    return Selected
+
+def DistillAFL(BinPath, Inputs, OutputPath, Jobs, Timeout, TrimInputs):
+    TuplesList = RunPool(ShowMap, [(BinPath, Input, Timeout) for Input in Inputs], Jobs)
+    Selected = SelectInputs(Inputs, TuplesList)
+    Skipped = len([Tuples for Tuples in TuplesList if Tuples is None])
+    if Skipped:
+        print("{} inputs crash or time out and are left out.".format(Skipped))
+    ArgsList = []
+    for Input in Selected:
+        with open(Input, 'rb') as f:
+            OutputFile = os.path.join(OutputPath, hashlib.sha1(f.read()).hexdigest())
+        if TrimInputs:
+            ArgsList.append((BinPath, Input, OutputFile, Timeout))
+        else:
+            shutil.copyfile(Input, OutputFile)
+    RunPool(Trim, ArgsList, Jobs)
+    return len(Selected)
+
+def DistillLibFuzzer(BinPath, Inputs, OutputPath, Timeout):
+    # -merge=1 reads directories, so the distinct inputs are copied into one first
+    StagePath = tempfile.mkdtemp(prefix='distill')
+    try:
+        for Index, Input in enumerate(Inputs):
+            shutil.copyfile(Input, os.path.join(StagePath, '{:08d}'.format(Index)))
+        Cmd = [BinPath, '-merge=1', '-rss_limit_mb=0', '-timeout={}'.format(max(1, Timeout // 1000)), OutputPath, StagePath]
+        with open(os.devnull, 'w') as Null:
+            subprocess.call(Cmd, stdout=Null, stderr=Null)
+    finally:
+        shutil.rmtree(StagePath)
+    return len(os.listdir(OutputPath))
+
+def DistillCorpus(Engine, BinPath, InputPaths, OutputPath, Jobs=0, Timeout=DEFAULT_TIMEOUT, TrimInputs=True):
+    """
+    Write to OutputPath the smallest subset of the inputs under InputPaths that
+    keeps their coverage of the test binary.
+
+    :param Engine: 'afl' for a binary of the AFL tool chain, measured with
+                   afl-showmap and trimmed with afl-tmin, in parallel.
+                   'libfuzzer' for a LIBFUZZER binary, distilled with -merge=1.
+    :param BinPath: test binary
+    :param InputPaths: seed files or directories, e.g. AFL output directories
+    :param OutputPath: directory of the distilled corpus, created if needed
+    :param Jobs: parallel afl-showmap/afl-tmin runs, 0 for one per core
+    :param Timeout: milliseconds an input may run
+    :param TrimInputs: afl-tmin each input kept
+    :return: (number of distinct inputs, number of inputs kept)
+    """
+    Inputs = CollectInputs(InputPaths)
+    if not os.path.exists(OutputPath):
+        os.makedirs(OutputPath)
+    if not Inputs:
+        return (0, 0)
+    if Engine == 'afl':
+        Kept = DistillAFL(BinPath, Inputs, OutputPath, Jobs if Jobs > 0 else GetCoreNum(), Timeout, TrimInputs)
+    else:
+        Kept = DistillLibFuzzer(BinPath, Inputs, OutputPath, Timeout)
+    return (len(Inputs), Kept)
+
+gParamCheck = []
+def SingleCheckCallback(option, opt_str, value, parser):
+    if option not in gParamCheck:
+        setattr(parser.values, option.dest, value)
+        gParamCheck.append(option)
+    else:
+        parser.error("Option %s only allows one instance in command line!" % option)
+
+# Parse command line options
+def MyOptionParser():
+    Parser = OptionParser(description=__copyright__, version=__version__, prog=__prog__, usage="python %prog [options] <seed file or directory> ...")
+    Parser.add_option("-e", "--exec", action="callback", type="string", dest="ModuleBin", callback=SingleCheckCallback,
+        help="Test binary the coverage is measured on.")
+    Parser.add_option("-f", "--fuzzer", action="callback", type="choice", choices=['afl', 'libfuzzer'], dest="Engine", default="afl", callback=SingleCheckCallback,
+        help="ENGINE is one of list: afl, libfuzzer, the tool chain the test binary is built with. Default is afl.")
+    Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
+        help="Directory of the distilled corpus.")
+    Parser.add_option("-j", "--jobs", action="callback", type="int", dest="Jobs", default=0, callback=SingleCheckCallback,
+        help="Parallel afl-showmap and afl-tmin runs. Default is 0, one per core.")
+    Parser.add_option("-t", "--timeout", action="callback", type="int", dest="Timeout", default=DEFAULT_TIMEOUT, callback=SingleCheckCallback,
+        help="Milliseconds an input may run. Default is {}.".format(DEFAULT_TIMEOUT))
+    Parser.add_option("--no-trim", action="store_true", dest="NoTrim", default=False,
+        help="Copy the inputs kept instead of trimming them with afl-tmin.")
+    (Opt, Args) = Parser.parse_args()
+    return (Opt, Args)
+
+def main():
+    (Option, Target) = MyOptionParser()
+    if not Option.ModuleBin or not os.path.isfile(Option.ModuleBin):
+        print("Test binary should be set once by command -e MODULEBIN, --exec=MODULEBIN.")
+        os._exit(0)
+    if not Option.Output:
+        print("Output path should be set once by command -o OUTPUT, --output=OUTPUT.")
+        os._exit(0)
+    if os.path.isdir(Option.Output) and os.listdir(Option.Output):
+        print("Output path: {} is not empty, please change another directory.".format(Option.Output))
+        os._exit(0)
+    if not Target:
+        print("At least one seed file or directory should be given.")
+        os._exit(0)
+    for InputPath in Target:
+        if not os.path.exists(InputPath):
+            print("Seed path: {} does not exist.".format(InputPath))
+            os._exit(0)
+
+    Total, Kept = DistillCorpus(Option.Engine, Option.ModuleBin, Target, Option.Output, Option.Jobs, Option.Timeout, not Option.NoTrim)
+    print("{} of {} distinct inputs kept in {}".format(Kept, Total, Option.Output))
+
+if __name__ == "__main__":
+    main()
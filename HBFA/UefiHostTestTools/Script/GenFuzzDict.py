@@ -0,0 +1,477 @@
+## @file
+# Generate an AFL/libFuzzer dictionary for a test module from its build output
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import os
+import re
+import sys
+import time
+import struct
+import tempfile
+import subprocess
+from optparse import OptionParser
+
+__prog__ = 'GenFuzzDict.py'
+__copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
+__version__ = '{} Version {}'.format(__prog__, '0.1 ')
+
+## Get PYTHON version
+PyVersion = sys.version_info[0]
+
+## Environment variable read by CmpLogLibHost
+CMPLOG_DICT_ENV = 'HBFA_CMPLOG_DICT'
+
+## Seconds a CMPLOG replay of one seed may take
+CMPLOG_TIMEOUT = 10
+
+## Seeds replayed to collect CMPLOG tokens
+CMPLOG_MAX_SEEDS = 256
+
+## Tokens shorter than this are useless to AFL and libFuzzer
+MIN_TOKEN_SIZE = 2
+
+GuidValue = r'\{\s*(0x[0-9a-fA-F]+)\s*,\s*(0x[0-9a-fA-F]+)\s*,\s*(0x[0-9a-fA-F]+)\s*,\s*\{([^}]*)\}\s*\}'
+GuidPattern = re.compile(r'EFI_GUID\s+(\w+)\s*=\s*' + GuidValue)
+DecGuidPattern = re.compile(r'^\s*(\w+)\s*=\s*' + GuidValue, re.M)
+SignaturePattern = re.compile(r'SIGNATURE_(16|32|64)\s*\(([^()]*)\)')
+DefineSignaturePattern = re.compile(r'^\s*#\s*define\s+(\w+)\s+SIGNATURE_(16|32|64)\s*\(([^()]*)\)', re.M)
+DefineHexPattern = re.compile(r'^\s*#\s*define\s+(\w+)\s+\(?\s*0x([0-9a-fA-F]+)[uUlL]*\s*\)?\s*$', re.M)
+EnumPattern = re.compile(r'\benum\b[^{};]*\{([^}]*)\}')
+EnumMemberPattern = re.compile(r'(\w+)\s*=\s*(0x[0-9a-fA-F]+|\d+)[uUlL]*\s*(?:,|$)')
+ComparedNamePattern = re.compile(r'(?:==|!=)\s*\(?\s*([A-Za-z_]\w*)|([A-Za-z_]\w*)\s*\)?\s*(?=[=!]=)|\bcase\s+([A-Za-z_]\w*)\s*:')
+GuidNamePattern = re.compile(r'\b(g\w+Guid)\b')
+CommentPattern = re.compile(r'/\*.*?\*/|//[^\n]*', re.S)
+CharPattern = re.compile(r"'(\\x[0-9a-fA-F]+|\\[0-7]+|\\.|[^'\\])'")
+MakefileVarPattern = re.compile(r'^(\w+)\s*=[ \t]*((?:[^\n]*\\\n)*[^\n]*)$', re.M)
+IncludeOptionPattern = re.compile(r'(?:^|\s)[-/]I\s*("[^"]+"|\S+)')
+DictLinePattern = re.compile(r'^\s*(?:\w+\s*=\s*)?"(.*)"\s*$')
+
+## Source text and constants parsed so far, shared by the libraries of a module
+FileCache = {}
+
+class FuzzDictionary(object):
+    """
+    Ordered set of dictionary tokens.
+    """
+    def __init__(self):
+        self.__tokens = []
+        self.__known = set()
+
+    def Add(self, name, token):
+        token = bytes(bytearray(token))
+        if len(token) < MIN_TOKEN_SIZE or token in self.__known:
+            return
+        self.__known.add(token)
+        self.__tokens.append((re.sub(r'\W', '_', name), token))
+
+    def __len__(self):
+        return len(self.__tokens)
+
+    def Write(self, path):
+        with open(path, 'w') as f:
+            for name, token in self.__tokens:
+                f.write('{}="{}"\n'.format(name, EscapeToken(token)))
+
+def EscapeToken(token):
+    text = ''
+    for byte in bytearray(token):
+        if 0x20 <= byte < 0x7F and chr(byte) not in '"\\':
+            text += chr(byte)
+        else:
+            text += '\\x%02X' % byte
+    return text
+
+def UnescapeToken(text):
+    token = bytearray()
+    index = 0
+    while index < len(text):
+        if text[index] == '\\' and text[index + 1:index + 2] == 'x':
+            token.append(int(text[index + 2:index + 4], 16))
+            index += 4
+        elif text[index] == '\\':
+            token.append(ord(text[index + 1]))
+            index += 2
+        else:
+            token.append(ord(text[index]))
+            index += 1
+    return token
+
+def ParseCharLiteral(text):
+    match = CharPattern.match(text.strip())
+    if not match:
+        return None
+    char = match.group(1)
+    if char.startswith('\\x'):
+        return int(char[2:], 16)
+    if char.startswith('\\') and char[1:].isdigit():
+        return int(char[1:], 8)
+    if char.startswith('\\'):
+        return {'0': 0, 'n': 10, 'r': 13, 't': 9}.get(char[1], ord(char[1]))
+    return ord(char)
+
+def GetModuleBuildDirs(ModuleBuildDir):
+    """
+    :return: the build directory of the module and of all libraries linked to it
+    """
+    BuildDirs = [ModuleBuildDir]
+    LibListFile = os.path.join(ModuleBuildDir, 'OUTPUT', 'static_library_files.lst')
+    if os.path.exists(LibListFile):
+        with open(LibListFile, 'r') as f:
+            for line in f:
+                LibPath = line.strip()
+                if LibPath:
+                    BuildDirs.append(os.path.dirname(os.path.dirname(LibPath)))
+    return BuildDirs
+
+def ParseMakefile(BuildDir):
+    """
+    :return: {name: value} of the variables of the module makefile
+    """
+    for MakefileName in ['GNUmakefile', 'Makefile']:
+        Makefile = os.path.join(BuildDir, MakefileName)
+        if os.path.exists(Makefile):
+            with open(Makefile, 'r') as f:
+                Content = f.read().replace('\r\n', '\n')
+            return dict((match.group(1), match.group(2).replace('\\\n', ' ')) for match in MakefileVarPattern.finditer(Content))
+    return {}
+
+def ExpandMakefilePath(Path, Variables):
+    Path = Path.strip().strip('"')
+    for name in ['WORKSPACE', 'MODULE_DIR', 'DEBUG_DIR', 'OUTPUT_DIR']:
+        Value = os.environ.get(name, '') if name == 'WORKSPACE' else Variables.get(name, '').strip()
+        Path = Path.replace('$({})'.format(name), Value)
+    if '$(' in Path:
+        return None
+    return os.path.normpath(Path)
+
+def GetModuleSourceDir(Variables):
+    if 'MODULE_DIR' not in Variables:
+        return None
+    ModuleDir = ExpandMakefilePath(Variables['MODULE_DIR'], Variables)
+    if ModuleDir and os.path.isdir(ModuleDir):
+        return ModuleDir
+    return None
+
+def GetIncludeDirs(Variables, ModuleDir):
+    """
+    :return: the package include directories of the module
+    """
+    IncludeDirs = []
+    for match in IncludeOptionPattern.finditer(Variables.get('INC', '')):
+        IncludeDir = ExpandMakefilePath(match.group(1), Variables)
+        if IncludeDir and os.path.isdir(IncludeDir) and IncludeDir != ModuleDir and 'Build' not in IncludeDir.split(os.path.sep):
+            IncludeDirs.append(IncludeDir)
+    return IncludeDirs
+
+def GetPackageRoots():
+    Roots = [os.environ.get('WORKSPACE', '')]
+    Roots.extend(os.environ.get('PACKAGES_PATH', '').split(os.pathsep))
+    return [Root for Root in Roots if Root]
+
+def GetModulePackages(InfPath):
+    """
+    :return: the DEC files in the [Packages] section of an INF
+    """
+    Packages = []
+    InSection = False
+    with open(InfPath, 'r') as f:
+        for line in f:
+            line = line.split('#')[0].strip()
+            if line.startswith('['):
+                InSection = line.lower().startswith('[packages')
+            elif InSection and line:
+                for Root in GetPackageRoots():
+                    DecPath = os.path.join(Root, line)
+                    if os.path.exists(DecPath):
+                        Packages.append(DecPath)
+                        break
+    return Packages
+
+def GetModuleSources(ModuleDir):
+    """
+    :return: the C sources of the module, without the ones of nested modules
+    """
+    Sources = []
+    for root, dirs, files in os.walk(ModuleDir):
+        if root != ModuleDir and any(name.lower().endswith('.inf') for name in files):
+            del dirs[:]
+            continue
+        for name in files:
+            if name.lower().endswith(('.c', '.h')):
+                Sources.append(os.path.join(root, name))
+    return Sources
+
+def GetHeaders(IncludeDirs):
+    Headers = []
+    for IncludeDir in IncludeDirs:
+        for root, dirs, files in os.walk(IncludeDir):
+            Headers.extend(os.path.join(root, name) for name in files if name.lower().endswith('.h'))
+    return Headers
+
+def ReadSource(SourceFile):
+    """
+    :return: the content of a C file without comments
+    """
+    if ('text', SourceFile) not in FileCache:
+        try:
+            with open(SourceFile, 'rb') as f:
+                Content = f.read().decode('latin-1')
+        except (IOError, OSError):
+            Content = ''
+        FileCache[('text', SourceFile)] = CommentPattern.sub('', Content)
+    return FileCache[('text', SourceFile)]
+
+def PackGuid(match, first):
+    Data4 = [int(value, 16) for value in match.group(first + 3).split(',') if value.strip()]
+    if len(Data4) != 8:
+        return None
+    return struct.pack('<IHH8B', int(match.group(first), 16), int(match.group(first + 1), 16), int(match.group(first + 2), 16), *Data4)
+
+def PackSignature(Width, Args):
+    Chars = [ParseCharLiteral(arg) for arg in Args.split(',')]
+    if None in Chars or len(Chars) != int(Width) // 8:
+        return None
+    return bytearray(Chars)
+
+def PackInteger(Value, Size):
+    if Value == 0 or Value >= (1 << (Size * 8)):
+        return None
+    return struct.pack({2: '<H', 4: '<I', 8: '<Q'}[Size], Value)
+
+def GetIntegerSize(Value):
+    for Size in [2, 4, 8]:
+        if Value < (1 << (Size * 8)):
+            return Size
+    return None
+
+def GetConstants(SourceFile):
+    """
+    :return: {name: token} of the signature, hex and enum constants defined in a C file
+    """
+    if ('constants', SourceFile) in FileCache:
+        return FileCache[('constants', SourceFile)]
+    Content = ReadSource(SourceFile)
+    Constants = {}
+    for match in DefineSignaturePattern.finditer(Content):
+        Token = PackSignature(match.group(2), match.group(3))
+        if Token:
+            Constants[match.group(1)] = Token
+    for match in DefineHexPattern.finditer(Content):
+        Digits = len(match.group(2).lstrip('0'))
+        Size = 2 if Digits <= 4 else 4 if Digits <= 8 else 8
+        Token = PackInteger(int(match.group(2), 16), Size)
+        if Token:
+            Constants[match.group(1)] = Token
+    for enum in EnumPattern.finditer(Content):
+        for match in EnumMemberPattern.finditer(enum.group(1)):
+            Value = int(match.group(2), 0) if match.group(2).lower().startswith('0x') else int(match.group(2))
+            Size = GetIntegerSize(Value)
+            Token = PackInteger(Value, Size) if Size else None
+            if Token:
+                Constants[match.group(1)] = Token
+    FileCache[('constants', SourceFile)] = Constants
+    return Constants
+
+def GetDecGuids(DecPath):
+    """
+    :return: {name: GUID} of the GUIDs, protocols and PPIs declared in a DEC file
+    """
+    if ('guids', DecPath) not in FileCache:
+        Guids = {}
+        with open(DecPath, 'r') as f:
+            for match in DecGuidPattern.finditer(f.read()):
+                Guid = PackGuid(match, 2)
+                if Guid:
+                    Guids[match.group(1)] = Guid
+        FileCache[('guids', DecPath)] = Guids
+    return FileCache[('guids', DecPath)]
+
+def AddAutoGenGuids(Dictionary, BuildDir):
+    AutoGen = os.path.join(BuildDir, 'DEBUG', 'AutoGen.c')
+    if not os.path.exists(AutoGen):
+        return
+    with open(AutoGen, 'r') as f:
+        for match in GuidPattern.finditer(f.read()):
+            Guid = PackGuid(match, 2)
+            if Guid:
+                Dictionary.Add('guid_' + match.group(1), Guid)
+
+def AddSourceSignatures(Dictionary, SourceFile):
+    for match in SignaturePattern.finditer(ReadSource(SourceFile)):
+        Token = PackSignature(match.group(1), match.group(2))
+        if Token:
+            Dictionary.Add('sig_' + ''.join(chr(c) if chr(c).isalnum() else '_' for c in Token), Token)
+
+def RunWithTimeout(Cmd, Env, Timeout):
+    proc = subprocess.Popen(Cmd, env=Env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    Deadline = time.time() + Timeout
+    while proc.poll() is None:
+        if time.time() > Deadline:
+            proc.kill()
+            break
+        time.sleep(0.01)
+    proc.communicate()
+
+def AddCmpLogTokens(Dictionary, ModuleBinPath, SeedPath):
+    """
+    Replay the seeds on a binary built with TEST_WITH_CMPLOG and collect the
+    constant operands of the failed comparisons.
+    """
+    Seeds = []
+    if os.path.isdir(SeedPath):
+        for root, dirs, files in os.walk(SeedPath):
+            Seeds.extend(os.path.join(root, name) for name in sorted(files))
+    elif os.path.isfile(SeedPath):
+        Seeds.append(SeedPath)
+    if not Seeds:
+        return
+
+    fd, CmpLogFile = tempfile.mkstemp(suffix='.dict')
+    os.close(fd)
+    Env = dict(os.environ)
+    Env[CMPLOG_DICT_ENV] = CmpLogFile
+    try:
+        for Seed in Seeds[:CMPLOG_MAX_SEEDS]:
+            RunWithTimeout([ModuleBinPath, Seed], Env, CMPLOG_TIMEOUT)
+        with open(CmpLogFile, 'r') as f:
+            for index, line in enumerate(f):
+                match = DictLinePattern.match(line)
+                if match:
+                    Dictionary.Add('cmplog_{}'.format(index), UnescapeToken(match.group(1)))
+    finally:
+        os.remove(CmpLogFile)
+
+def GenerateDictionary(ModuleBuildDir, OutputPath, ModuleBinPath=None, CmpLogBinPath=None, SeedPath=None):
+    """
+    Write the dictionary of a test module. It holds:
+    - the GUIDs of the AutoGen.c of the module and of its libraries
+    - the GUIDs declared in the DEC files of these modules, if they are
+      referenced by name in the sources or found in the test binary
+    - the SIGNATURE_xx() values used in the sources
+    - the signature, hex and enum constants of the sources and package
+      headers that the sources compare against (==, !=, case)
+    - the operands of failed comparisons of a CMPLOG binary on the seeds
+
+    :param ModuleBuildDir: build directory of the test module, containing DEBUG and OUTPUT
+    :param OutputPath: dictionary file to write
+    :param ModuleBinPath: test binary scanned for GUIDs, optional
+    :param CmpLogBinPath: test binary built with TEST_WITH_CMPLOG, optional
+    :param SeedPath: seeds replayed on CmpLogBinPath
+    :return: the number of tokens
+    """
+    Dictionary = FuzzDictionary()
+    Sources = []
+    Headers = []
+    DecFiles = []
+    for BuildDir in GetModuleBuildDirs(ModuleBuildDir):
+        AddAutoGenGuids(Dictionary, BuildDir)
+        Variables = ParseMakefile(BuildDir)
+        ModuleDir = GetModuleSourceDir(Variables)
+        if not ModuleDir:
+            continue
+        Sources.extend(GetModuleSources(ModuleDir))
+        Headers.extend(GetHeaders(GetIncludeDirs(Variables, ModuleDir)))
+        InfPath = os.path.join(ModuleDir, Variables.get('MODULE_FILE', '').strip())
+        if os.path.isfile(InfPath):
+            DecFiles.extend(GetModulePackages(InfPath))
+
+    ComparedNames = set()
+    GuidNames = set()
+    for SourceFile in Sources:
+        AddSourceSignatures(Dictionary, SourceFile)
+        Content = ReadSource(SourceFile)
+        for match in ComparedNamePattern.finditer(Content):
+            ComparedNames.update(name for name in match.groups() if name)
+        GuidNames.update(GuidNamePattern.findall(Content))
+
+    Constants = {}
+    for SourceFile in sorted(set(Headers)) + Sources:
+        Constants.update(GetConstants(SourceFile))
+    for Name in sorted(ComparedNames):
+        if Name in Constants:
+            Dictionary.Add('const_' + Name, Constants[Name])
+
+    Binary = b''
+    if ModuleBinPath and os.path.isfile(ModuleBinPath):
+        with open(ModuleBinPath, 'rb') as f:
+            Binary = f.read()
+    for DecPath in sorted(set(DecFiles)):
+        for Name, Guid in sorted(GetDecGuids(DecPath).items()):
+            if Name in GuidNames or (Binary and Guid in Binary):
+                Dictionary.Add('guid_' + Name, Guid)
+
+    if CmpLogBinPath and SeedPath:
+        AddCmpLogTokens(Dictionary, CmpLogBinPath, SeedPath)
+    Dictionary.Write(OutputPath)
+    return len(Dictionary)
+
+def GenerateModuleDictionary(ModuleBinPath, ModuleFilePath):
+    """
+    Build step of the Run*.py scripts: write <ModuleBinPath>.dict for a test
+    module built in <Build>/<Target>_<ToolChain>/<Arch>.
+
+    :param ModuleBinPath: test binary
+    :param ModuleFilePath: test INF, relative to its package path
+    :return: the dictionary path, None if there is no token
+    """
+    BaseName = os.path.splitext(os.path.basename(ModuleBinPath))[0]
+    ModuleBuildDir = os.path.join(os.path.dirname(ModuleBinPath), os.path.dirname(ModuleFilePath), BaseName)
+    DictPath = os.path.splitext(ModuleBinPath)[0] + '.dict'
+    if not os.path.isdir(ModuleBuildDir):
+        print("Can not find module build directory {}, no dictionary generated.".format(ModuleBuildDir))
+        return None
+    try:
+        Count = GenerateDictionary(ModuleBuildDir, DictPath, ModuleBinPath)
+    except Exception as err:
+        print("Can not generate dictionary: {}".format(err))
+        return None
+    if Count == 0:
+        return None
+    print("Dictionary with {} tokens: {}".format(Count, DictPath))
+    return DictPath
+
+gParamCheck = []
+def SingleCheckCallback(option, opt_str, value, parser):
+    if option not in gParamCheck:
+        setattr(parser.values, option.dest, value)
+        gParamCheck.append(option)
+    else:
+        parser.error("Option %s only allows one instance in command line!" % option)
+
+# Parse command line options
+def MyOptionParser():
+    Parser = OptionParser(description=__copyright__, version=__version__, prog=__prog__, usage="python %prog [options][argument]")
+    Parser.add_option("-d", "--builddir", action="callback", type="string", dest="BuildDir", callback=SingleCheckCallback,
+        help="Build directory of the test module, e.g. Build/UefiHostFuzzTestCasePkg/DEBUG_AFL/X64/UefiHostFuzzTestCasePkg/TestCase/.../TestXxx")
+    Parser.add_option("-b", "--binary", action="callback", type="string", dest="ModuleBin", callback=SingleCheckCallback,
+        help="Test binary, scanned for the GUIDs declared in the DEC files of the module.")
+    Parser.add_option("-e", "--exec", action="callback", type="string", dest="CmpLogBin", callback=SingleCheckCallback,
+        help="Test binary built with -D TEST_WITH_CMPLOG=TRUE, replayed on the seeds to collect comparison operands.")
+    Parser.add_option("-i", "--input", action="callback", type="string", dest="InputSeed", callback=SingleCheckCallback,
+        help="Seed file or directory for --exec.")
+    Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
+        help="Dictionary file to generate.")
+    (Opt, Args) = Parser.parse_args()
+    return (Opt, Args)
+
+def main():
+    (Option, Target) = MyOptionParser()
+    if not Option.BuildDir or not os.path.isdir(Option.BuildDir):
+        print("Module build directory should be set once by command -d BUILDDIR, --builddir=BUILDDIR.")
+        os._exit(0)
+    if not Option.Output:
+        print("Dictionary file should be set once by command -o OUTPUT, --output=OUTPUT.")
+        os._exit(0)
+    for BinPath in [Option.ModuleBin, Option.CmpLogBin]:
+        if BinPath and not os.path.exists(BinPath):
+            print("Test binary: {} does not exist.".format(BinPath))
+            os._exit(0)
+
+    Count = GenerateDictionary(Option.BuildDir, Option.Output, Option.ModuleBin, Option.CmpLogBin, Option.InputSeed)
+    print("{} tokens written to {}".format(Count, Option.Output))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,298 @@
+## @file
+# Generate the PCD database file of a test module, loaded by BasePcdLibHost
+#
+# Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+#
+
+import os
+import re
+import sys
+import struct
+from optparse import OptionParser
+
+sys.path.append(os.path.dirname(os.path.realpath(__file__)))
+from GenFuzzDict import GetModuleBuildDirs, ParseMakefile, GetModuleSourceDir, GetModulePackages, GetPackageRoots, GuidPattern, DecGuidPattern, PackGuid
+
+__prog__ = 'GenPcdDatabase.py'
+__copyright__ = 'Copyright (c) 2019, Intel Corporation. All rights reserved.'
+__version__ = '{} Version {}'.format(__prog__, '0.1 ')
+
+## Environment variable read by BasePcdLibHost, see UefiHostTestPkg/Include/Library/PcdDatabaseLib.h
+PCD_DATABASE_ENV = 'HBFA_PCD_DATABASE'
+
+## Datum type of the _PCD_GET_MODE_<Type>_<Name> macros of AutoGen.h
+DatumTypes = {'BOOL': 'BOOLEAN', '8': 'UINT8', '16': 'UINT16', '32': 'UINT32', '64': 'UINT64', 'PTR': 'VOID*'}
+DatumSizes = {'BOOLEAN': 1, 'UINT8': 1, 'UINT16': 2, 'UINT32': 4, 'UINT64': 8}
+
+DefinePattern = re.compile(r'^[ \t]*#[ \t]*define[ \t]+(\w+)[ \t]+([^\r\n]*?)[ \t]*\r?$', re.M)
+GetModePattern = re.compile(r'^_PCD_GET_MODE_(BOOL|8|16|32|64|PTR)_(\w+)$')
+ExGuidPattern = re.compile(r'LibPcdGetEx\w*\s*\(\s*&\s*(\w+)\s*,')
+TokenValuePattern = re.compile(r'^\(?\s*(0x[0-9a-fA-F]+|\d+)[uU]?\s*\)?$')
+SectionPattern = re.compile(r'^\s*\[([^\]]*)\]')
+PcdEntryPattern = re.compile(r'^\s*(\w+)\.(\w+)\s*\|\s*(L?"(?:[^"\\]|\\.)*"|\{[^}]*\}|[^|#]*)')
+StringEscapes = {'n': '\n', 'r': '\r', 't': '\t', '0': '\0', '\\': '\\', '"': '"', "'": "'"}
+
+## DSC sections holding the value of a dynamic PCD
+DscDynamicSections = ['pcdsdynamic', 'pcdsdynamicdefault', 'pcdsdynamicex', 'pcdsdynamicexdefault']
+
+def GetAutoGenDefines(BuildDir):
+    """
+    :return: {name: value} of the macros of AutoGen.h and AutoGen.c of a module
+    """
+    Defines = {}
+    for Name in ['AutoGen.h', 'AutoGen.c']:
+        AutoGen = os.path.join(BuildDir, 'DEBUG', Name)
+        if os.path.exists(AutoGen):
+            with open(AutoGen, 'r') as f:
+                for match in DefinePattern.finditer(f.read()):
+                    Defines.setdefault(match.group(1), match.group(2))
+    return Defines
+
+def GetDynamicPcds(Defines):
+    """
+    :return: {PcdName: (TokenNumber, DatumType, TokenSpaceGuidName or None)} of
+             the dynamic PCDs read through LibPcdGet*() by a module
+    """
+    Pcds = {}
+    for Name, Value in Defines.items():
+        match = GetModePattern.match(Name)
+        if not match or 'LibPcdGet' not in Value:
+            continue
+        PcdName = match.group(2)
+        Token = Defines.get('_PCD_TOKEN_' + PcdName)
+        while Token in Defines:
+            Token = Defines[Token]
+        TokenMatch = TokenValuePattern.match(Token or '')
+        if not TokenMatch:
+            continue
+        GuidMatch = ExGuidPattern.search(Value)
+        Pcds[PcdName] = (int(TokenMatch.group(1), 0), DatumTypes[match.group(1)], GuidMatch.group(1) if GuidMatch else None)
+    return Pcds
+
+def GetPcdEntries(FilePath, SectionFilter):
+    """
+    :return: {(TokenSpaceGuidName, PcdName): value} of the PCD entries of a
+             DSC or DEC file, in the sections accepted by SectionFilter
+    """
+    Entries = {}
+    InSection = False
+    with open(FilePath, 'r') as f:
+        for line in f:
+            match = SectionPattern.match(line)
+            if match:
+                InSection = any(SectionFilter(name.strip().split('.')[0].lower()) for name in match.group(1).split(','))
+                continue
+            if not InSection or line.lstrip().startswith(('#', '!')):
+                continue
+            match = PcdEntryPattern.match(line)
+            if match and '$(' not in match.group(3):
+                Entries[(match.group(1), match.group(2))] = match.group(3).strip()
+    return Entries
+
+def UnescapeString(Text):
+    Chars = []
+    index = 0
+    while index < len(Text):
+        if Text[index] == '\\' and index + 1 < len(Text):
+            Chars.append(StringEscapes.get(Text[index + 1], Text[index + 1]))
+            index += 2
+        else:
+            Chars.append(Text[index])
+            index += 1
+    return ''.join(Chars)
+
+def FormatValue(DatumType, Text):
+    """
+    :return: the value of a DSC or DEC PCD entry in PCD database format, None if it is not supported
+    """
+    if DatumType == 'VOID*':
+        if Text.startswith('L"') and Text.endswith('"'):
+            Data = bytearray((UnescapeString(Text[2:-1]) + '\0').encode('utf-16-le'))
+        elif Text.startswith('"') and Text.endswith('"'):
+            Data = bytearray((UnescapeString(Text[1:-1]) + '\0').encode('latin-1'))
+        elif Text.startswith('{') and Text.endswith('}'):
+            Data = bytearray()
+            for Item in Text[1:-1].split(','):
+                try:
+                    Data.append(int(Item.strip(), 0) & 0xFF)
+                except ValueError:
+                    return None
+        else:
+            return None
+        if not Data:
+            return None
+        return '{' + ', '.join('0x%02X' % Byte for Byte in Data) + '}'
+
+    if Text.upper() in ['TRUE', 'FALSE']:
+        Value = 1 if Text.upper() == 'TRUE' else 0
+    else:
+        try:
+            Value = int(Text, 0)
+        except ValueError:
+            try:
+                Value = int(Text, 10)
+            except ValueError:
+                return None
+    if DatumType == 'BOOLEAN':
+        Value = 1 if Value else 0
+    return '0x%X' % (Value & ((1 << (DatumSizes[DatumType] * 8)) - 1))
+
+def FormatGuid(Guid):
+    Fields = struct.unpack('<IHH8B', Guid)
+    return '%08X-%04X-%04X-%02X%02X-%s' % (Fields[0], Fields[1], Fields[2], Fields[3], Fields[4], ''.join('%02X' % Byte for Byte in Fields[5:]))
+
+def GeneratePcdDatabase(ModuleBuildDir, DscPath, OutputPath):
+    """
+    Write the PCD database of a test module. It holds the dynamic and
+    dynamic-ex PCDs the module and its libraries read with LibPcdGet*(), with
+    their token numbers from AutoGen.h and their values from the
+    [PcdsDynamic*] sections of the platform DSC, or else from the DEC files.
+
+    :param ModuleBuildDir: build directory of the test module, containing DEBUG and OUTPUT
+    :param DscPath: platform DSC of the build, optional
+    :param OutputPath: PCD database file to write
+    :return: the number of PCDs
+    """
+    Pcds = {}
+    Guids = {}
+    DecFiles = []
+    for BuildDir in GetModuleBuildDirs(ModuleBuildDir):
+        for PcdName, Pcd in GetDynamicPcds(GetAutoGenDefines(BuildDir)).items():
+            Pcds.setdefault(PcdName, Pcd)
+        AutoGen = os.path.join(BuildDir, 'DEBUG', 'AutoGen.c')
+        if os.path.exists(AutoGen):
+            with open(AutoGen, 'r') as f:
+                for match in GuidPattern.finditer(f.read()):
+                    Guids.setdefault(match.group(1), PackGuid(match, 2))
+        Variables = ParseMakefile(BuildDir)
+        ModuleDir = GetModuleSourceDir(Variables)
+        if not ModuleDir:
+            continue
+        InfPath = os.path.join(ModuleDir, Variables.get('MODULE_FILE', '').strip())
+        if os.path.isfile(InfPath):
+            DecFiles.extend(GetModulePackages(InfPath))
+
+    DecEntries = {}
+    for DecPath in sorted(set(DecFiles)):
+        DecEntries.update(GetPcdEntries(DecPath, lambda name: name.startswith('pcds')))
+        with open(DecPath, 'r') as f:
+            for match in DecGuidPattern.finditer(f.read()):
+                Guids.setdefault(match.group(1), PackGuid(match, 2))
+    DscEntries = {}
+    if DscPath and os.path.isfile(DscPath):
+        DscEntries = GetPcdEntries(DscPath, lambda name: name in DscDynamicSections)
+
+    Lines = []
+    for PcdName, (Token, DatumType, GuidName) in sorted(Pcds.items(), key=lambda item: (item[1][2] or '', item[1][0])):
+        Keys = [Key for Key in list(DscEntries) + list(DecEntries) if Key[1] == PcdName and (GuidName is None or Key[0] == GuidName)]
+        if not Keys:
+            print("Can not find the value of PCD {}.".format(PcdName))
+            continue
+        Key = Keys[0]
+        Value = FormatValue(DatumType, DscEntries.get(Key, DecEntries.get(Key, '')))
+        if Value is None:
+            print("Can not convert the value of PCD {}.{}.".format(*Key))
+            continue
+        if GuidName is not None and not Guids.get(GuidName):
+            print("Can not find the token space GUID of PCD {}.{}.".format(*Key))
+            continue
+        Guid = FormatGuid(Guids[GuidName]) if GuidName is not None else ''
+        Lines.append('0x{:X}|{}|{}|{}  # {}.{}\n'.format(Token, Guid, DatumType, Value, *Key))
+
+    with open(OutputPath, 'w') as f:
+        f.write('## @file\n')
+        f.write('#  PCD database of {}, generated by {}.\n'.format(os.path.basename(ModuleBuildDir), __prog__))
+        f.write('#\n')
+        f.write('#  TokenNumber|TokenSpaceGuid|DatumType|Value\n')
+        f.write('##\n')
+        f.writelines(Lines)
+    return len(Lines)
+
+def GenerateModulePcdDatabase(ModuleBinPath, ModuleFilePath):
+    """
+    Build step of the Run*.py scripts: write <ModuleBinPath>.pcd for a test
+    module built in <Build>/<Target>_<ToolChain>/<Arch> from <Pkg>/<Pkg>.dsc.
+
+    :param ModuleBinPath: test binary
+    :param ModuleFilePath: test INF, relative to its package path
+    :return: the PCD database path, None if the module reads no dynamic PCD
+    """
+    BaseName = os.path.splitext(os.path.basename(ModuleBinPath))[0]
+    ModuleBuildDir = os.path.join(os.path.dirname(ModuleBinPath), os.path.dirname(ModuleFilePath), BaseName)
+    PcdDatabasePath = os.path.splitext(ModuleBinPath)[0] + '.pcd'
+    if not os.path.isdir(ModuleBuildDir):
+        print("Can not find module build directory {}, no PCD database generated.".format(ModuleBuildDir))
+        return None
+    PkgName = ModuleFilePath.replace('\\', '/').split('/')[0]
+    DscPath = None
+    for Root in GetPackageRoots():
+        if os.path.isfile(os.path.join(Root, PkgName, PkgName + '.dsc')):
+            DscPath = os.path.join(Root, PkgName, PkgName + '.dsc')
+            break
+    try:
+        Count = GeneratePcdDatabase(ModuleBuildDir, DscPath, PcdDatabasePath)
+    except Exception as err:
+        print("Can not generate PCD database: {}".format(err))
+        return None
+    if Count == 0:
+        os.remove(PcdDatabasePath)
+        return None
+    print("PCD database with {} PCDs: {}".format(Count, PcdDatabasePath))
+    return PcdDatabasePath
+
+def SetModulePcdDatabase(ModuleBinPath, ModuleFilePath, Env=None):
+    """
+    Generate the PCD database of a test module and export it to the test runs,
+    unless PCD_DATABASE_ENV is already set by the user.
+
+    :param Env: environment of the test runs, os.environ if None
+    :return: the PCD database path, None if there is none
+    """
+    if Env is None:
+        Env = os.environ
+    if os.environ.get(PCD_DATABASE_ENV):
+        Env[PCD_DATABASE_ENV] = os.environ[PCD_DATABASE_ENV]
+        return os.environ[PCD_DATABASE_ENV]
+    PcdDatabasePath = GenerateModulePcdDatabase(ModuleBinPath, ModuleFilePath)
+    if PcdDatabasePath:
+        Env[PCD_DATABASE_ENV] = PcdDatabasePath
+    return PcdDatabasePath
+
+gParamCheck = []
+def SingleCheckCallback(option, opt_str, value, parser):
+    if option not in gParamCheck:
+        setattr(parser.values, option.dest, value)
+        gParamCheck.append(option)
+    else:
+        parser.error("Option %s only allows one instance in command line!" % option)
+
+# Parse command line options
+def MyOptionParser():
+    Parser = OptionParser(description=__copyright__, version=__version__, prog=__prog__, usage="python %prog [options][argument]")
+    Parser.add_option("-d", "--builddir", action="callback", type="string", dest="BuildDir", callback=SingleCheckCallback,
+        help="Build directory of the test module, e.g. Build/UefiHostFuzzTestCasePkg/DEBUG_AFL/X64/UefiHostFuzzTestCasePkg/TestCase/.../TestXxx")
+    Parser.add_option("-p", "--platform", action="callback", type="string", dest="Dsc", callback=SingleCheckCallback,
+        help="Platform DSC of the build. Without it the values are the DEC defaults.")
+    Parser.add_option("-o", "--output", action="callback", type="string", dest="Output", callback=SingleCheckCallback,
+        help="PCD database file to generate.")
+    (Opt, Args) = Parser.parse_args()
+    return (Opt, Args)
+
+def main():
+    (Option, Target) = MyOptionParser()
+    if not Option.BuildDir or not os.path.isdir(Option.BuildDir):
+        print("Module build directory should be set once by command -d BUILDDIR, --builddir=BUILDDIR.")
+        os._exit(0)
+    if not Option.Output:
+        print("PCD database file should be set once by command -o OUTPUT, --output=OUTPUT.")
+        os._exit(0)
+    if Option.Dsc and not os.path.isfile(Option.Dsc):
+        print("Platform DSC: {} does not exist.".format(Option.Dsc))
+        os._exit(0)
+
+    Count = GeneratePcdDatabase(Option.BuildDir, Option.Dsc, Option.Output)
+    print("{} PCDs written to {}".format(Count, Option.Output))
+
+if __name__ == "__main__":
+    main()
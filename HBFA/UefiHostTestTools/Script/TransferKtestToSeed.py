@@ -11,9 +11,9 @@ import sys
 # python version
 python_version = sys.version_info[0]
 
-def getPath():
+def getPath(pathList):
     fileList = []
-    for path in sys.argv[1:]:
+    for path in pathList:
         if not os.path.exists(path):
             continue
         if os.path.isfile(path):
@@ -62,6 +62,39 @@ def analyseFile(file):
     return objectList
 
 
+def isRegionObject(objectName):
+    return objectName.startswith('Buffer@') or objectName.startswith('Field@') or objectName == 'BufferSize'
+
+# Put the symbolic regions of a ktest back into the seed they were laid over
+# (see RunKLEE.py -s), or into zeros without seed: "Buffer@<Offset>" holds
+# bytes, "Field@<Offset>:<Width>" a little endian integer and "BufferSize" the
+# size of the input.
+def assembleSeed(objectList, seedData=None):
+    data = bytearray(seedData) if seedData is not None else bytearray()
+    size = None
+    for object in objectList:
+        objectName = object[1]
+        objectData = bytearray(object[2])
+        if objectName == 'BufferSize':
+            size = 0
+            for byte in reversed(objectData):
+                size = (size << 8) | byte
+            continue
+        elif objectName.startswith('Field@'):
+            offset, width = objectName[len('Field@'):].split(':')
+            offset = int(offset, 16)
+            objectData = objectData[:int(width)]
+        else:
+            offset = int(objectName[len('Buffer@'):], 16)
+        if len(data) < offset + len(objectData):
+            data.extend(bytearray(offset + len(objectData) - len(data)))
+        data[offset:offset + len(objectData)] = objectData
+    if size is not None:
+        if len(data) < size:
+            data.extend(bytearray(size - len(data)))
+        del data[size:]
+    return bytes(data)
+
 def genNewName(file, objectIndex, objectName):
     return os.path.join(os.path.dirname(file),
                         objectName + str(objectIndex + 1).zfill(6),
@@ -76,8 +109,11 @@ def genSeed(file, data):
     seed.close()
 
 def printUsage():
-    print("Usage: python TransferKtestToSeed.py [Argument]")
+    print("Usage: python TransferKtestToSeed.py [-s <SeedFile>] [Argument]")
     print("Remove header of ktest format file, and save the new binary file as .seed file.\n")
+    print("Option:")
+    print("-s <SeedFile>                        the seed given to KLEE with RunKLEE.py -s, the symbolic")
+    print("                                     regions of each ktest are put back into it.\n")
     print("Argument:")
     print("<KtestFile>                          the path of .ktest file.")
     print("<KtestFile1> <KtestFile2> ...        the paths of .ktest files.")
@@ -90,10 +126,26 @@ if __name__ == '__main__':
     elif sys.argv[1] == '-h' or sys.argv[1] == 'help' or sys.argv[1] == '--help':
         printUsage()
     else:
-        fileList = getPath()
+        pathList = sys.argv[1:]
+        seedData = None
+        if pathList[0] == '-s':
+            if len(pathList) < 3:
+                printUsage()
+                sys.exit(1)
+            seedFile = open(pathList[1], 'rb')
+            seedData = seedFile.read()
+            seedFile.close()
+            pathList = pathList[2:]
+        fileList = getPath(pathList)
 
         for file in fileList:
             objectList = analyseFile(file)
+            regionList = [object for object in objectList if isRegionObject(object[1])]
+            if regionList:
+                NewFileName = genNewName(file, 0, 'Buffer')
+                genSeed(NewFileName, assembleSeed(regionList, seedData))
+                print('generate %s done.' % NewFileName)
+                continue
             for object in objectList:
                 NewFileName = genNewName(file, object[0], object[1])
                 genSeed(NewFileName, object[2])
@@ -22,6 +22,12 @@
 
 #define MAX_STRING_SIZE  1025
 
+//
+// A bus without registered devices, for the devices backed by input.
+//
+#define TEST_INPUT_BUS           0x80
+#define TEST_CONFIG_SPACE_SIZE   0x100
+
 VOID
 EFIAPI
 ProcessLibraryConstructorList (
@@ -274,6 +280,56 @@ TestPciBusDxe (
   return UNIT_TEST_PASSED;
 }
 
+UNIT_TEST_STATUS
+EFIAPI
+TestPciConfigSpaceInput (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINT8       Input[TEST_CONFIG_SPACE_SIZE * 2 + 4];
+  PCI_TYPE00  *Pci;
+
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 0, 0, PCI_VENDOR_ID_OFFSET)), 0xFFFF);
+
+  //
+  // The input holds a device, an absent device, and the first 4 bytes of a
+  // device. The functions of TEST_INPUT_BUS take them in access order.
+  //
+  ZeroMem (Input, sizeof (Input));
+  Pci = (PCI_TYPE00 *)Input;
+  Pci->Hdr.VendorId   = 0x1234;
+  Pci->Hdr.DeviceId   = 0x5678;
+  Pci->Hdr.HeaderType = HEADER_TYPE_DEVICE;
+  Pci = (PCI_TYPE00 *)(Input + TEST_CONFIG_SPACE_SIZE);
+  Pci->Hdr.VendorId   = 0xFFFF;
+  Pci = (PCI_TYPE00 *)(Input + TEST_CONFIG_SPACE_SIZE * 2);
+  Pci->Hdr.VendorId   = 0x1234;
+  Pci->Hdr.DeviceId   = 0x9ABC;
+  RegisterPciConfigSpaceInput (Input, sizeof (Input));
+
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 0, 0, PCI_VENDOR_ID_OFFSET)), 0x1234);
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 0, 0, PCI_DEVICE_ID_OFFSET)), 0x5678);
+  PciSegmentWrite32 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 0, 0, 0x40), 0xA5A5A5A5);
+
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 1, 0, PCI_VENDOR_ID_OFFSET)), 0xFFFF);
+
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 2, 0, PCI_DEVICE_ID_OFFSET)), 0x9ABC);
+  UT_ASSERT_EQUAL (PciSegmentRead32 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 2, 0, PCI_REVISION_ID_OFFSET)), 0xFFFFFFFF);
+
+  //
+  // The input is used up, and the devices keep their config space.
+  //
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 3, 0, PCI_VENDOR_ID_OFFSET)), 0xFFFF);
+  UT_ASSERT_EQUAL (PciSegmentRead32 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 0, 0, 0x40)), 0xA5A5A5A5);
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, 0, 0, 0, PCI_VENDOR_ID_OFFSET)), 0x8086);
+
+  RegisterPciConfigSpaceInput (NULL, 0);
+  UT_ASSERT_EQUAL (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, TEST_INPUT_BUS, 0, 0, PCI_VENDOR_ID_OFFSET)), 0xFFFF);
+
+  return UNIT_TEST_PASSED;
+}
+
 /**
   The main() function for setting up and running the tests.
 
@@ -307,6 +363,7 @@ int main()
   }
 
   AddTestCase(TestSuite, L"Test PciBus", L"Common.PciBus.Basic.ResourceAllocation", TestPciBusDxe, NULL, NULL, NULL);
+  AddTestCase(TestSuite, L"Test config space input", L"Common.PciBus.Basic.ConfigSpaceInput", TestPciConfigSpaceInput, NULL, NULL, NULL);
 
   //
   // Execute the tests.
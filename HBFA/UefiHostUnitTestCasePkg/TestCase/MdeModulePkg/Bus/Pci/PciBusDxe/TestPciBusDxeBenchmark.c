@@ -0,0 +1,376 @@
+/** @file
+  Benchmark of a full PciBusDxe enumeration of hundreds of devices on
+  PciSegmentStubLib, and of the config accesses it is made of.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/PciHostBridgeStubLib.h>
+#include <Library/PciSegmentStubLib.h>
+#include <Library/PciSegmentLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OsServiceLib.h>
+
+#include <UnitTestTypes.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestAssertLib.h>
+#include <Library/UnitTestLogLib.h>
+#include <Library/UnitTestBenchmarkLib.h>
+
+#include "PciBus.h"
+
+#define UNIT_TEST_NAME        L"PciBus Benchmark"
+#define UNIT_TEST_VERSION     L"0.1"
+
+#define MAX_STRING_SIZE  1025
+
+//
+// A host bridge, BENCHMARK_BRIDGE_COUNT bridges on bus 0, and a device at
+// each device number of the secondary bus of each bridge.
+//
+#define BENCHMARK_BRIDGE_COUNT     8
+#define BENCHMARK_DEVICE_COUNT     (1 + BENCHMARK_BRIDGE_COUNT * (1 + PCI_MAX_DEVICE + 1))
+
+//
+// An iteration of the config access benchmark reads the vendor ID of every
+// function of every bus.
+//
+#define BENCHMARK_SWEEP_READS      ((PCI_MAX_BUS + 1) * (PCI_MAX_DEVICE + 1) * (PCI_MAX_FUNC + 1))
+
+#define BENCHMARK_WARMUP           1
+#define BENCHMARK_ITERATIONS       10
+
+VOID
+EFIAPI
+ProcessLibraryConstructorList (
+  IN EFI_HANDLE         ImageHandle,
+  IN EFI_SYSTEM_TABLE   *SystemTable
+  );
+
+EFI_STATUS
+EFIAPI
+PciBusEntryPoint (
+  IN EFI_HANDLE         ImageHandle,
+  IN EFI_SYSTEM_TABLE   *SystemTable
+  );
+
+typedef struct {
+  ACPI_HID_DEVICE_PATH      PciRootBridge;
+  PCI_DEVICE_PATH           PciDevice;
+  EFI_DEVICE_PATH_PROTOCOL  End;
+} TEST_PCI_DEVICE_PATH;
+
+typedef struct {
+  ACPI_HID_DEVICE_PATH      PciRootBridge;
+  PCI_DEVICE_PATH           PciBridge;
+  PCI_DEVICE_PATH           PciDevice;
+  EFI_DEVICE_PATH_PROTOCOL  End;
+} TEST_PCI2_DEVICE_PATH;
+
+TEST_PCI_DEVICE_PATH         *mTestPciDevicePath;
+TEST_PCI2_DEVICE_PATH        *mTestPci2DevicePath;
+REGISTER_PCI_DEVICE_STRUCT   *mTestPciDevices;
+
+//
+// The enumeration runs once, in the suite setup, so every test of the suite
+// sees the enumerated buses.
+//
+EFI_STATUS                   mEnumerationStatus;
+UINT64                       mEnumerationTime;
+
+/**
+  Initialize a PCI device path node.
+
+  @param[out] Node      The device path node.
+  @param[in]  Device    The device number.
+  @param[in]  Function  The function number.
+**/
+VOID
+InitPciNode (
+  OUT PCI_DEVICE_PATH  *Node,
+  IN  UINT8            Device,
+  IN  UINT8            Function
+  )
+{
+  Node->Header.Type = HARDWARE_DEVICE_PATH;
+  Node->Header.SubType = HW_PCI_DP;
+  SetDevicePathNodeLength (&Node->Header, sizeof (PCI_DEVICE_PATH));
+  Node->Device = Device;
+  Node->Function = Function;
+}
+
+/**
+  Initialize a root bridge device path node and the end node after it.
+
+  @param[out] RootBridge  The root bridge device path node.
+  @param[out] End         The end node.
+**/
+VOID
+InitRootBridgeNode (
+  OUT ACPI_HID_DEVICE_PATH      *RootBridge,
+  OUT EFI_DEVICE_PATH_PROTOCOL  *End
+  )
+{
+  RootBridge->Header.Type = ACPI_DEVICE_PATH;
+  RootBridge->Header.SubType = ACPI_DP;
+  SetDevicePathNodeLength (&RootBridge->Header, sizeof (ACPI_HID_DEVICE_PATH));
+  RootBridge->HID = EISA_PNP_ID (0x0A03);
+  RootBridge->UID = 0;
+  SetDevicePathEndNode (End);
+}
+
+/**
+  Initialize the registration of a device with one 32-bit memory BAR, or of a
+  bridge with a memory window.
+
+  @param[out] PciDevice   The registration of the device.
+  @param[in]  DevicePath  The device path of the device.
+  @param[in]  Device      The device number.
+  @param[in]  Bridge      TRUE for a PCI to PCI bridge.
+**/
+VOID
+InitPciDevice (
+  OUT REGISTER_PCI_DEVICE_STRUCT  *PciDevice,
+  IN  EFI_DEVICE_PATH_PROTOCOL    *DevicePath,
+  IN  UINT8                       Device,
+  IN  BOOLEAN                     Bridge
+  )
+{
+  UINTN  Index;
+
+  PciDevice->DevicePath = DevicePath;
+  PciDevice->Address.Bits.Device = Device;
+  PciDevice->PciId.VendorId = 0x8086;
+  if (Bridge) {
+    PciDevice->PciId.DeviceId = 0xABCE;
+    PciDevice->PciId.HeaderType = HEADER_TYPE_PCI_TO_PCI_BRIDGE;
+    PciDevice->PciId.ClassCode[0] = PCI_IF_BRIDGE_P2P;
+    PciDevice->PciId.ClassCode[1] = PCI_CLASS_BRIDGE_P2P;
+    PciDevice->PciId.ClassCode[2] = PCI_CLASS_BRIDGE;
+    for (Index = 0; Index < ARRAY_SIZE (PciDevice->PciConfig.BridgeConfig.Bar); Index++) {
+      PciDevice->PciConfig.BridgeConfig.Bar[Index].BarType = PCI_BAR_TYPE_INVALID;
+    }
+    PciDevice->PciConfig.BridgeConfig.IoBaseLimit.BaseLimitType = PCI_BASE_LIMIT_TYPE_INVALID;
+    PciDevice->PciConfig.BridgeConfig.MemBaseLimit.BaseLimitType = PCI_BASE_LIMIT_TYPE_MEM;
+    PciDevice->PciConfig.BridgeConfig.PMemBaseLimit.BaseLimitType = PCI_BASE_LIMIT_TYPE_INVALID;
+    PciDevice->PciConfig.BridgeConfig.ExpansionRomBar.BarType = PCI_BAR_TYPE_INVALID;
+  } else {
+    PciDevice->PciId.DeviceId = 0xABDE;
+    PciDevice->PciId.HeaderType = HEADER_TYPE_DEVICE;
+    PciDevice->PciId.ClassCode[1] = PCI_CLASS_MASS_STORAGE_OTHER;
+    PciDevice->PciId.ClassCode[2] = PCI_CLASS_MASS_STORAGE;
+    for (Index = 0; Index < ARRAY_SIZE (PciDevice->PciConfig.DeviceConfig.Bar); Index++) {
+      PciDevice->PciConfig.DeviceConfig.Bar[Index].BarType = PCI_BAR_TYPE_INVALID;
+    }
+    PciDevice->PciConfig.DeviceConfig.Bar[0].BarType = PCI_BAR_TYPE_32BIT_MEM;
+    PciDevice->PciConfig.DeviceConfig.Bar[0].BarSize = 0x1000;
+    PciDevice->PciConfig.DeviceConfig.ExpansionRomBar.BarType = PCI_BAR_TYPE_INVALID;
+  }
+}
+
+/**
+  Enumerate and start the PCI devices of every root bridge.
+
+  @retval EFI_SUCCESS  The devices are enumerated.
+  @retval Other        There is no root bridge.
+**/
+EFI_STATUS
+EnumeratePciRootBridges (
+  VOID
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_HANDLE                      *Handles;
+  UINTN                           Index;
+  UINTN                           HandleNum;
+  EFI_HANDLE                      Controller;
+  EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *PciRootBridgeIo;
+
+  Status = gBS->LocateHandleBuffer (
+                  ByProtocol,
+                  &gEfiPciRootBridgeIoProtocolGuid,
+                  NULL,
+                  &HandleNum,
+                  &Handles
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Index = 0; Index < HandleNum; Index++) {
+    Status = gBS->HandleProtocol (Handles[Index], &gEfiPciRootBridgeIoProtocolGuid, (VOID **)&PciRootBridgeIo);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+    Controller = Handles[Index];
+
+    PciEnumerator (Controller, PciRootBridgeIo->ParentHandle);
+    StartPciDevices (Controller);
+  }
+  FreePool (Handles);
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+PciBusBenchmarkSuiteSetup (
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework
+  )
+{
+  UINTN                  Count;
+  UINTN                  Bridge;
+  UINTN                  Device;
+  TEST_PCI2_DEVICE_PATH  *DevicePath;
+  UINT64                 Start;
+
+  mTestPciDevicePath  = AllocateZeroPool (sizeof (TEST_PCI_DEVICE_PATH) * (1 + BENCHMARK_BRIDGE_COUNT));
+  mTestPci2DevicePath = AllocateZeroPool (sizeof (TEST_PCI2_DEVICE_PATH) * BENCHMARK_BRIDGE_COUNT * (PCI_MAX_DEVICE + 1));
+  mTestPciDevices     = AllocateZeroPool (sizeof (REGISTER_PCI_DEVICE_STRUCT) * BENCHMARK_DEVICE_COUNT);
+  ASSERT ((mTestPciDevicePath != NULL) && (mTestPci2DevicePath != NULL) && (mTestPciDevices != NULL));
+
+  //
+  // The host bridge is device 0 of bus 0, the bridges are the next devices.
+  //
+  Count = 0;
+  for (Bridge = 0; Bridge <= BENCHMARK_BRIDGE_COUNT; Bridge++) {
+    InitRootBridgeNode (&mTestPciDevicePath[Bridge].PciRootBridge, &mTestPciDevicePath[Bridge].End);
+    InitPciNode (&mTestPciDevicePath[Bridge].PciDevice, (UINT8)Bridge, 0);
+    InitPciDevice (
+      &mTestPciDevices[Count++],
+      (EFI_DEVICE_PATH_PROTOCOL *)&mTestPciDevicePath[Bridge],
+      (UINT8)Bridge,
+      (BOOLEAN)(Bridge != 0)
+      );
+  }
+
+  for (Bridge = 1; Bridge <= BENCHMARK_BRIDGE_COUNT; Bridge++) {
+    for (Device = 0; Device <= PCI_MAX_DEVICE; Device++) {
+      DevicePath = &mTestPci2DevicePath[(Bridge - 1) * (PCI_MAX_DEVICE + 1) + Device];
+      InitRootBridgeNode (&DevicePath->PciRootBridge, &DevicePath->End);
+      InitPciNode (&DevicePath->PciBridge, (UINT8)Bridge, 0);
+      InitPciNode (&DevicePath->PciDevice, (UINT8)Device, 0);
+      InitPciDevice (&mTestPciDevices[Count++], (EFI_DEVICE_PATH_PROTOCOL *)DevicePath, (UINT8)Device, FALSE);
+    }
+  }
+  ASSERT (Count == BENCHMARK_DEVICE_COUNT);
+
+  RegisterPciDevices (BENCHMARK_DEVICE_COUNT, mTestPciDevices);
+
+  ProcessLibraryConstructorList (gImageHandle, gST);
+
+  InitializePciHostBridge (gImageHandle, gST);
+
+  PciBusEntryPoint (gImageHandle, gST);
+
+  Start = GetMonotonicTimeInNanoSecond ();
+  mEnumerationStatus = EnumeratePciRootBridges ();
+  mEnumerationTime = GetMonotonicTimeInNanoSecond () - Start;
+
+  return ;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestPciBusEnumerationBenchmark (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN                           Index;
+
+  UT_ASSERT_NOT_EFI_ERROR (mEnumerationStatus);
+
+  //
+  // Every device behind the bridges is found on the bus the enumeration gave its bridge.
+  //
+  for (Index = 1; Index <= BENCHMARK_BRIDGE_COUNT; Index++) {
+    UT_ASSERT_NOT_EQUAL (PciSegmentRead8 (PCI_SEGMENT_LIB_ADDRESS (0, 0, Index, 0, PCI_BRIDGE_SECONDARY_BUS_REGISTER_OFFSET)), 0);
+  }
+
+  UT_LOG_INFO ("%ld devices: enumeration %ld us\n", (UINT64)BENCHMARK_DEVICE_COUNT, DivU64x32 (mEnumerationTime, 1000));
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkPciConfigAccess (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN   Bus;
+  UINTN   Device;
+  UINTN   Function;
+  UINTN   Found;
+
+  //
+  // Probe every function of every bus, like a bus scan does.
+  //
+  Found = 0;
+  for (Bus = 0; Bus <= PCI_MAX_BUS; Bus++) {
+    for (Device = 0; Device <= PCI_MAX_DEVICE; Device++) {
+      for (Function = 0; Function <= PCI_MAX_FUNC; Function++) {
+        if (PciSegmentRead16 (PCI_SEGMENT_LIB_ADDRESS (0, Bus, Device, Function, PCI_VENDOR_ID_OFFSET)) != 0xFFFF) {
+          Found++;
+        }
+      }
+    }
+  }
+  UT_ASSERT_EQUAL (Found, BENCHMARK_DEVICE_COUNT);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The main() function for setting up and running the tests.
+
+  @retval EFI_SUCCESS on successful running.
+  @retval Other error code on failure.
+**/
+int main()
+{
+  EFI_STATUS                Status;
+  UNIT_TEST_FRAMEWORK       *Fw;
+  UNIT_TEST_SUITE           *TestSuite;
+  CHAR16                    ShortName[MAX_STRING_SIZE];
+
+  Fw = NULL;
+  TestSuite = NULL;
+
+  AsciiStrToUnicodeStrS (gEfiCallerBaseName, ShortName, sizeof(ShortName)/sizeof(ShortName[0]));
+  DEBUG((DEBUG_INFO, "%s v%s\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_NAME, ShortName, UNIT_TEST_VERSION);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TestSuite, Fw, L"PciBus Benchmark Test Suite", L"Common.PciBus.Benchmark", PciBusBenchmarkSuiteSetup, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PciBus Benchmark Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase(TestSuite, L"Benchmark PciBus enumeration", L"Common.PciBus.Benchmark.Enumeration", TestPciBusEnumerationBenchmark, NULL, NULL, NULL);
+  AddBenchmarkCase(TestSuite, L"Benchmark PCI config access", L"Common.PciBus.Benchmark.ConfigAccess", BenchmarkPciConfigAccess, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, BENCHMARK_SWEEP_READS * sizeof (UINT16));
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites(Fw);
+
+EXIT:
+  if (Fw != NULL) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  return Status;
+}
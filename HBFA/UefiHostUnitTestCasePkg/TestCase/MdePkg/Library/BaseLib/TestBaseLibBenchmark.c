@@ -0,0 +1,217 @@
+/** @file
+  Benchmark of the SafeString and checksum routines of BaseLib.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+
+#include <UnitTestTypes.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestAssertLib.h>
+#include <Library/UnitTestBenchmarkLib.h>
+
+#define UNIT_TEST_NAME        L"BaseLib Benchmark"
+#define UNIT_TEST_VERSION     L"0.1"
+
+#define MAX_STRING_SIZE  1025
+
+#define BENCHMARK_WARMUP      10
+#define BENCHMARK_ITERATIONS  1000
+
+//
+// Length of the benchmarked strings, with the null terminator, and number of
+// copies of a string per iteration, so an iteration takes microseconds.
+//
+#define STRING_LENGTH         2048
+#define STRING_COPIES         16
+
+#define CHECKSUM_BUFFER_SIZE  SIZE_64KB
+
+CHAR8   mAsciiSource[STRING_LENGTH];
+CHAR8   mAsciiDestination[STRING_LENGTH];
+CHAR16  mUnicodeSource[STRING_LENGTH];
+CHAR16  mUnicodeDestination[STRING_LENGTH];
+
+UINT8   mChecksumBuffer[CHECKSUM_BUFFER_SIZE];
+UINT32  mExpectedCrc32;
+UINT8   mExpectedSum8;
+
+VOID
+EFIAPI
+BaseLibBenchmarkSuiteSetup (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < STRING_LENGTH - 1; Index++) {
+    mAsciiSource[Index]   = (CHAR8)('!' + Index % ('~' - '!'));
+    mUnicodeSource[Index] = (CHAR16)mAsciiSource[Index];
+  }
+  mAsciiSource[Index]   = '\0';
+  mUnicodeSource[Index] = L'\0';
+
+  for (Index = 0; Index < CHECKSUM_BUFFER_SIZE; Index++) {
+    mChecksumBuffer[Index] = (UINT8)(Index * 31 + (Index >> 8));
+  }
+  mExpectedCrc32 = CalculateCrc32 (mChecksumBuffer, CHECKSUM_BUFFER_SIZE);
+  mExpectedSum8  = CalculateSum8 (mChecksumBuffer, CHECKSUM_BUFFER_SIZE);
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkStrCpyS (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  Copy;
+
+  for (Copy = 0; Copy < STRING_COPIES; Copy++) {
+    UT_ASSERT_NOT_EFI_ERROR (StrCpyS (mUnicodeDestination, STRING_LENGTH, mUnicodeSource));
+  }
+  UT_ASSERT_EQUAL (mUnicodeDestination[STRING_LENGTH - 2], mUnicodeSource[STRING_LENGTH - 2]);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkAsciiStrCpyS (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  Copy;
+
+  for (Copy = 0; Copy < STRING_COPIES; Copy++) {
+    UT_ASSERT_NOT_EFI_ERROR (AsciiStrCpyS (mAsciiDestination, STRING_LENGTH, mAsciiSource));
+  }
+  UT_ASSERT_EQUAL (mAsciiDestination[STRING_LENGTH - 2], mAsciiSource[STRING_LENGTH - 2]);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkAsciiStrToUnicodeStrS (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  Copy;
+
+  for (Copy = 0; Copy < STRING_COPIES; Copy++) {
+    UT_ASSERT_NOT_EFI_ERROR (AsciiStrToUnicodeStrS (mAsciiSource, mUnicodeDestination, STRING_LENGTH));
+  }
+  UT_ASSERT_EQUAL (mUnicodeDestination[STRING_LENGTH - 2], mUnicodeSource[STRING_LENGTH - 2]);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkStrnLenS (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  Copy;
+
+  for (Copy = 0; Copy < STRING_COPIES; Copy++) {
+    UT_ASSERT_EQUAL (StrnLenS (mUnicodeSource, STRING_LENGTH), STRING_LENGTH - 1);
+  }
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkCalculateCrc32 (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UT_ASSERT_EQUAL (CalculateCrc32 (mChecksumBuffer, CHECKSUM_BUFFER_SIZE), mExpectedCrc32);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkCalculateSum8 (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UT_ASSERT_EQUAL (CalculateSum8 (mChecksumBuffer, CHECKSUM_BUFFER_SIZE), mExpectedSum8);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The main() function for setting up and running the tests.
+
+  @retval EFI_SUCCESS on successful running.
+  @retval Other error code on failure.
+**/
+int main()
+{
+  EFI_STATUS                Status;
+  UNIT_TEST_FRAMEWORK       *Fw;
+  UNIT_TEST_SUITE           *StringSuite;
+  UNIT_TEST_SUITE           *ChecksumSuite;
+  CHAR16                    ShortName[MAX_STRING_SIZE];
+
+  Fw = NULL;
+  StringSuite = NULL;
+  ChecksumSuite = NULL;
+
+  AsciiStrToUnicodeStrS (gEfiCallerBaseName, ShortName, sizeof(ShortName)/sizeof(ShortName[0]));
+  DEBUG((DEBUG_INFO, "%s v%s\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_NAME, ShortName, UNIT_TEST_VERSION);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&StringSuite, Fw, L"SafeString Benchmark Test Suite", L"Common.BaseLib.SafeString.Benchmark", BaseLibBenchmarkSuiteSetup, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SafeString Benchmark Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddBenchmarkCase(StringSuite, L"Benchmark StrCpyS", L"Common.BaseLib.SafeString.Benchmark.StrCpyS", BenchmarkStrCpyS, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, STRING_COPIES * STRING_LENGTH * sizeof (CHAR16));
+  AddBenchmarkCase(StringSuite, L"Benchmark AsciiStrCpyS", L"Common.BaseLib.SafeString.Benchmark.AsciiStrCpyS", BenchmarkAsciiStrCpyS, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, STRING_COPIES * STRING_LENGTH);
+  AddBenchmarkCase(StringSuite, L"Benchmark AsciiStrToUnicodeStrS", L"Common.BaseLib.SafeString.Benchmark.AsciiStrToUnicodeStrS", BenchmarkAsciiStrToUnicodeStrS, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, STRING_COPIES * STRING_LENGTH);
+  AddBenchmarkCase(StringSuite, L"Benchmark StrnLenS", L"Common.BaseLib.SafeString.Benchmark.StrnLenS", BenchmarkStrnLenS, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, STRING_COPIES * STRING_LENGTH * sizeof (CHAR16));
+
+  Status = CreateUnitTestSuite (&ChecksumSuite, Fw, L"CheckSum Benchmark Test Suite", L"Common.BaseLib.CheckSum.Benchmark", BaseLibBenchmarkSuiteSetup, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for CheckSum Benchmark Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddBenchmarkCase(ChecksumSuite, L"Benchmark CalculateCrc32", L"Common.BaseLib.CheckSum.Benchmark.CalculateCrc32", BenchmarkCalculateCrc32, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, CHECKSUM_BUFFER_SIZE);
+  AddBenchmarkCase(ChecksumSuite, L"Benchmark CalculateSum8", L"Common.BaseLib.CheckSum.Benchmark.CalculateSum8", BenchmarkCalculateSum8, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, CHECKSUM_BUFFER_SIZE);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites(Fw);
+
+EXIT:
+  if (Fw != NULL) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  return Status;
+}
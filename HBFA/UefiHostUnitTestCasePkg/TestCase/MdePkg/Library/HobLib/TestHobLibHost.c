@@ -0,0 +1,379 @@
+/** @file
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+
+#include <PiPei.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/HobLib.h>
+#include <Library/HobListLib.h>
+
+#include <UnitTestTypes.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestAssertLib.h>
+
+#define UNIT_TEST_NAME        L"HobLibHost Unit Test"
+#define UNIT_TEST_VERSION     L"0.1"
+
+#define MAX_STRING_SIZE  1025
+
+//
+// The GUID HOBs built to grow the list, enough for several commits of the
+// 64KB steps of HobLibHost.
+//
+#define TEST_HOB_COUNT       1024
+#define TEST_HOB_DATA_SIZE   0x100
+#define TEST_HOB_GUID_COUNT  3
+
+#define TEST_HOB_LIST_FILE   "TestHobLibHost.hob"
+
+EFI_GUID mTestHobGuid[TEST_HOB_GUID_COUNT + 1] = {
+  {0x6d3f5e1a, 0x8c47, 0x4b29, {0xa1, 0x5e, 0x3f, 0x90, 0x2c, 0x7d, 0x64, 0x01}},
+  {0x6d3f5e1a, 0x8c47, 0x4b29, {0xa1, 0x5e, 0x3f, 0x90, 0x2c, 0x7d, 0x64, 0x02}},
+  {0x6d3f5e1a, 0x8c47, 0x4b29, {0xa1, 0x5e, 0x3f, 0x90, 0x2c, 0x7d, 0x64, 0x03}},
+  //
+  // Never built.
+  //
+  {0x6d3f5e1a, 0x8c47, 0x4b29, {0xa1, 0x5e, 0x3f, 0x90, 0x2c, 0x7d, 0x64, 0x04}},
+};
+
+EFI_GUID mTestImageGuid = {0x6d3f5e1a, 0x8c47, 0x4b29, {0xa1, 0x5e, 0x3f, 0x90, 0x2c, 0x7d, 0x64, 0x10}};
+
+//
+// A HOB list image as handed off by a PEI core.
+//
+typedef struct {
+  EFI_HOB_HANDOFF_INFO_TABLE  HandOff;
+  EFI_HOB_GUID_TYPE           GuidHob;
+  UINT64                      GuidData;
+  EFI_HOB_GENERIC_HEADER      End;
+} TEST_HOB_LIST_IMAGE;
+
+VOID  *mTestHobData[TEST_HOB_COUNT];
+
+/**
+  Return the size of the host HOB list, up to its end of HOB list HOB.
+
+  @return The size of the HOB list.
+**/
+UINTN
+GetHobListSize (
+  VOID
+  )
+{
+  EFI_HOB_HANDOFF_INFO_TABLE  *HandOffHob;
+
+  HandOffHob = GetHobList ();
+  return (UINTN) HandOffHob->EfiEndOfHobList - (UINTN) HandOffHob;
+}
+
+/**
+  Find the next GUID HOB by walking the HOB list.
+
+  @param[in] Guid      The GUID to match with in the HOB list.
+  @param[in] HobStart  The HOB to start from.
+
+  @return The next instance of the matched GUID HOB from HobStart, or NULL.
+**/
+VOID *
+FindGuidHobInList (
+  IN CONST EFI_GUID  *Guid,
+  IN CONST VOID      *HobStart
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+
+  Hob.Raw = (UINT8 *) HobStart;
+  while (!END_OF_HOB_LIST (Hob)) {
+    if ((Hob.Header->HobType == EFI_HOB_TYPE_GUID_EXTENSION) && CompareGuid (Guid, &Hob.Guid->Name)) {
+      return Hob.Raw;
+    }
+    Hob.Raw = GET_NEXT_HOB (Hob);
+  }
+  return NULL;
+}
+
+/**
+  Fill a HOB list image with a PHIT HOB, a GUID HOB and the end HOB.
+
+  @param[out] Image  The image.
+**/
+VOID
+InitHobListImage (
+  OUT TEST_HOB_LIST_IMAGE  *Image
+  )
+{
+  ZeroMem (Image, sizeof (*Image));
+  Image->HandOff.Header.HobType   = EFI_HOB_TYPE_HANDOFF;
+  Image->HandOff.Header.HobLength = sizeof (Image->HandOff);
+  Image->HandOff.Version          = EFI_HOB_HANDOFF_TABLE_VERSION;
+  Image->HandOff.BootMode         = BOOT_WITH_FULL_CONFIGURATION;
+  Image->GuidHob.Header.HobType   = EFI_HOB_TYPE_GUID_EXTENSION;
+  Image->GuidHob.Header.HobLength = sizeof (Image->GuidHob) + sizeof (Image->GuidData);
+  CopyGuid (&Image->GuidHob.Name, &mTestImageGuid);
+  Image->GuidData                 = 0x5A5A5A5A5A5A5A5AULL;
+  Image->End.HobType              = EFI_HOB_TYPE_END_OF_HOB_LIST;
+  Image->End.HobLength            = sizeof (Image->End);
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestGrowHobList (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  VOID    *HobList;
+  UINTN   Index;
+  UINTN   Check;
+
+  HobList = GetHobList ();
+  UT_ASSERT_NOT_NULL(HobList);
+
+  for (Index = 0; Index < TEST_HOB_COUNT; Index++) {
+    mTestHobData[Index] = BuildGuidHob (&mTestHobGuid[Index % TEST_HOB_GUID_COUNT], TEST_HOB_DATA_SIZE);
+    UT_ASSERT_NOT_NULL(mTestHobData[Index]);
+    SetMem (mTestHobData[Index], TEST_HOB_DATA_SIZE, (UINT8) Index);
+
+    //
+    // Look the GUIDs up while the list grows, so the index is updated in
+    // steps across the commits of the list.
+    //
+    if (Index % 100 == 0) {
+      for (Check = 0; Check <= TEST_HOB_GUID_COUNT; Check++) {
+        UT_ASSERT_TRUE(GetFirstGuidHob (&mTestHobGuid[Check]) == FindGuidHobInList (&mTestHobGuid[Check], GetHobList ()));
+      }
+    }
+  }
+  UT_ASSERT_TRUE(GetHobListSize () > TEST_HOB_COUNT * TEST_HOB_DATA_SIZE);
+
+  //
+  // The list grows in place: it does not move and the HOBs keep their data.
+  //
+  UT_ASSERT_TRUE(GetHobList () == HobList);
+  for (Index = 0; Index < TEST_HOB_COUNT; Index++) {
+    UT_ASSERT_TRUE(CompareGuid (&((EFI_HOB_GUID_TYPE *) mTestHobData[Index] - 1)->Name, &mTestHobGuid[Index % TEST_HOB_GUID_COUNT]));
+    UT_ASSERT_EQUAL(*(UINT8 *) mTestHobData[Index], (UINT8) Index);
+    UT_ASSERT_EQUAL(*((UINT8 *) mTestHobData[Index] + TEST_HOB_DATA_SIZE - 1), (UINT8) Index);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestGuidHobIndex (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  EFI_PEI_HOB_POINTERS  Hob;
+  EFI_HOB_GUID_TYPE     *GuidHob;
+  UINTN                 Index;
+
+  //
+  // GetNextGuidHob() finds the HOB a walk of the list finds, from every HOB
+  //
+  for (Hob.Raw = GetHobList (); !END_OF_HOB_LIST (Hob); Hob.Raw = GET_NEXT_HOB (Hob)) {
+    for (Index = 0; Index <= TEST_HOB_GUID_COUNT; Index++) {
+      UT_ASSERT_TRUE(GetNextGuidHob (&mTestHobGuid[Index], Hob.Raw) == FindGuidHobInList (&mTestHobGuid[Index], Hob.Raw));
+    }
+  }
+
+  //
+  // A GUID HOB that is no longer one is not returned
+  //
+  GuidHob = GetFirstGuidHob (&mTestHobGuid[0]);
+  UT_ASSERT_NOT_NULL(GuidHob);
+  GuidHob->Header.HobType = EFI_HOB_TYPE_UNUSED;
+  UT_ASSERT_TRUE(GetFirstGuidHob (&mTestHobGuid[0]) != GuidHob);
+  UT_ASSERT_TRUE(GetFirstGuidHob (&mTestHobGuid[0]) == FindGuidHobInList (&mTestHobGuid[0], GetHobList ()));
+  GuidHob->Header.HobType = EFI_HOB_TYPE_GUID_EXTENSION;
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestLoadHobListImage (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  TEST_HOB_LIST_IMAGE         Image;
+  EFI_HOB_HANDOFF_INFO_TABLE  *HandOffHob;
+  EFI_PHYSICAL_ADDRESS        EndOfHobList;
+  EFI_STATUS                  Status;
+  UINTN                       Size;
+  VOID                        *Data;
+  VOID                        *GuidHob;
+
+  HandOffHob = GetHobList ();
+  EndOfHobList = HandOffHob->EfiEndOfHobList;
+  InitHobListImage (&Image);
+
+  Status = HobListLoadImage (NULL, sizeof (Image));
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
+
+  //
+  // Truncated images, down to no image
+  //
+  for (Size = 0; Size < sizeof (Image); Size++) {
+    Status = HobListLoadImage (&Image, Size);
+    UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+  }
+
+  //
+  // Corrupt images: no PHIT HOB first, HOB lengths of zero or past the end
+  // of the image, no end of HOB list HOB
+  //
+  Image.HandOff.Header.HobType = EFI_HOB_TYPE_GUID_EXTENSION;
+  Status = HobListLoadImage (&Image, sizeof (Image));
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+  InitHobListImage (&Image);
+  Image.HandOff.Header.HobLength = sizeof (EFI_HOB_GENERIC_HEADER);
+  Status = HobListLoadImage (&Image, sizeof (Image));
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+  InitHobListImage (&Image);
+  Image.GuidHob.Header.HobLength = 0;
+  Status = HobListLoadImage (&Image, sizeof (Image));
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+  InitHobListImage (&Image);
+  Image.GuidHob.Header.HobLength = 0xFFF8;
+  Status = HobListLoadImage (&Image, sizeof (Image));
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+  InitHobListImage (&Image);
+  Image.End.HobType = EFI_HOB_TYPE_UNUSED;
+  Status = HobListLoadImage (&Image, sizeof (Image));
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+
+  //
+  // The host list is left as it was
+  //
+  UT_ASSERT_TRUE(GetHobList () == HandOffHob);
+  UT_ASSERT_EQUAL(HandOffHob->EfiEndOfHobList, EndOfHobList);
+
+  //
+  // A valid image replaces the HOBs of the list, in place
+  //
+  InitHobListImage (&Image);
+  Status = HobListLoadImage (&Image, sizeof (Image));
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_TRUE(GetHobList () == HandOffHob);
+  UT_ASSERT_EQUAL(GetHobListSize (), OFFSET_OF (TEST_HOB_LIST_IMAGE, End));
+  GuidHob = GetFirstGuidHob (&mTestImageGuid);
+  UT_ASSERT_TRUE(GuidHob == (UINT8 *) HandOffHob + OFFSET_OF (TEST_HOB_LIST_IMAGE, GuidHob));
+  UT_ASSERT_EQUAL(*(UINT64 *) GET_GUID_HOB_DATA (GuidHob), Image.GuidData);
+  UT_ASSERT_TRUE(GetFirstGuidHob (&mTestHobGuid[0]) == NULL);
+
+  //
+  // HOBs built afterwards follow the ones of the image
+  //
+  Data = BuildGuidHob (&mTestHobGuid[0], sizeof (UINT64));
+  UT_ASSERT_NOT_NULL(Data);
+  UT_ASSERT_TRUE(GetFirstGuidHob (&mTestHobGuid[0]) == (EFI_HOB_GUID_TYPE *) Data - 1);
+  UT_ASSERT_TRUE(GetNextGuidHob (&mTestImageGuid, GET_NEXT_HOB (GuidHob)) == NULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestLoadHobListFile (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  TEST_HOB_LIST_IMAGE  Image;
+  FILE                 *File;
+  EFI_STATUS           Status;
+  UINTN                Written;
+
+  remove (TEST_HOB_LIST_FILE);
+  Status = HobListLoadFile (TEST_HOB_LIST_FILE);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_NOT_FOUND);
+
+  //
+  // A file cut in the middle of its GUID HOB
+  //
+  InitHobListImage (&Image);
+  File = fopen (TEST_HOB_LIST_FILE, "wb");
+  UT_ASSERT_NOT_NULL(File);
+  Written = fwrite (&Image, 1, OFFSET_OF (TEST_HOB_LIST_IMAGE, GuidData), File);
+  fclose (File);
+  UT_ASSERT_EQUAL(Written, OFFSET_OF (TEST_HOB_LIST_IMAGE, GuidData));
+  Status = HobListLoadFile (TEST_HOB_LIST_FILE);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+
+  File = fopen (TEST_HOB_LIST_FILE, "wb");
+  UT_ASSERT_NOT_NULL(File);
+  Written = fwrite (&Image, 1, sizeof (Image), File);
+  fclose (File);
+  UT_ASSERT_EQUAL(Written, sizeof (Image));
+  Status = HobListLoadFile (TEST_HOB_LIST_FILE);
+  remove (TEST_HOB_LIST_FILE);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_TRUE(GetFirstGuidHob (&mTestImageGuid) == (UINT8 *) GetHobList () + OFFSET_OF (TEST_HOB_LIST_IMAGE, GuidHob));
+  UT_ASSERT_EQUAL(GetHobListSize (), OFFSET_OF (TEST_HOB_LIST_IMAGE, End));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The main() function for setting up and running the tests.
+
+  @retval EFI_SUCCESS on successful running.
+  @retval Other error code on failure.
+**/
+int main()
+{
+  EFI_STATUS                Status;
+  UNIT_TEST_FRAMEWORK       *Fw;
+  UNIT_TEST_SUITE           *TestSuite;
+  CHAR16                    ShortName[MAX_STRING_SIZE];
+
+  Fw = NULL;
+  TestSuite = NULL;
+
+  AsciiStrToUnicodeStrS (gEfiCallerBaseName, ShortName, sizeof(ShortName)/sizeof(ShortName[0]));
+  DEBUG((DEBUG_INFO, "%s v%s\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_NAME, ShortName, UNIT_TEST_VERSION);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TestSuite, Fw, L"HobLibHost Test Suite", L"Common.HobLib", NULL, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for HobLibHost Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // The cases share the host HOB list and run in this order.
+  //
+  AddTestCase(TestSuite, L"Test HOB list growth", L"Common.HobLib.Grow", TestGrowHobList, NULL, NULL, NULL);
+  AddTestCase(TestSuite, L"Test GUID HOB index", L"Common.HobLib.GuidIndex", TestGuidHobIndex, NULL, NULL, NULL);
+  AddTestCase(TestSuite, L"Test HOB list image", L"Common.HobLib.LoadImage", TestLoadHobListImage, NULL, NULL, NULL);
+  AddTestCase(TestSuite, L"Test HOB list file", L"Common.HobLib.LoadFile", TestLoadHobListFile, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites(Fw);
+
+EXIT:
+  if (Fw != NULL) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  return Status;
+}
@@ -0,0 +1,231 @@
+/** @file
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IoLib.h>
+#include <Library/IoEmulationLib.h>
+
+#include <UnitTestTypes.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestAssertLib.h>
+
+#define UNIT_TEST_NAME        L"IoLibHost Unit Test"
+#define UNIT_TEST_VERSION     L"0.1"
+
+#define MAX_STRING_SIZE  1025
+
+#define TEST_MMIO_BASE   0xFED00000
+#define TEST_IO_PORT     0xCF8
+
+UINT64  mLastWrite;
+UINT64  mLastWriteOffset;
+
+UINT64
+EFIAPI
+TestHandlerRead (
+  IN VOID    *Context,
+  IN UINT64  Offset,
+  IN UINTN   Width
+  )
+{
+  return 0x1000 + Offset;
+}
+
+VOID
+EFIAPI
+TestHandlerWrite (
+  IN VOID    *Context,
+  IN UINT64  Offset,
+  IN UINTN   Width,
+  IN UINT64  Value
+  )
+{
+  mLastWriteOffset = Offset;
+  mLastWrite = Value;
+}
+
+VOID
+EFIAPI
+TestCleanup (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  IoEmulationReset ();
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestUnmapped (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  MmioWrite32 (TEST_MMIO_BASE, 0);
+  UT_ASSERT_EQUAL (MmioRead32 (TEST_MMIO_BASE), 0xFFFFFFFF);
+  UT_ASSERT_EQUAL (IoRead8 (TEST_IO_PORT), 0xFF);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestRegisterFile (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  RETURN_STATUS  Status;
+
+  Status = IoEmulationAddRegisters (IoEmulationMmio, TEST_MMIO_BASE, 0x20, NULL, FALSE);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  MmioWrite32 (TEST_MMIO_BASE + 4, 0xDEADBEEF);
+  UT_ASSERT_EQUAL (MmioRead32 (TEST_MMIO_BASE + 4), 0xDEADBEEF);
+  UT_ASSERT_EQUAL (MmioRead8 (TEST_MMIO_BASE + 5), 0xBE);
+
+  MmioOr32 (TEST_MMIO_BASE + 4, 0x10);
+  UT_ASSERT_EQUAL (MmioRead32 (TEST_MMIO_BASE + 4), 0xDEADBEFF);
+  UT_ASSERT_EQUAL (MmioBitFieldRead32 (TEST_MMIO_BASE + 4, 28, 31), 0xD);
+
+  //
+  // An access crossing the end of the range is not mapped.
+  //
+  UT_ASSERT_EQUAL (MmioRead32 (TEST_MMIO_BASE + 0x1E), 0xFFFFFFFF);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestRegisterInput (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  STATIC CONST UINT8  Input[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+  RETURN_STATUS       Status;
+
+  Status = IoEmulationAddRegisters (IoEmulationMmio, TEST_MMIO_BASE, 0x10, NULL, TRUE);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  IoEmulationSetInput (Input, sizeof (Input));
+
+  UT_ASSERT_EQUAL (MmioRead32 (TEST_MMIO_BASE), 0x04030201);
+  UT_ASSERT_EQUAL (MmioRead16 (TEST_MMIO_BASE), 0x0605);
+
+  //
+  // Once the input is exhausted, the register keeps its last value.
+  //
+  UT_ASSERT_EQUAL (MmioRead32 (TEST_MMIO_BASE), 0x04030605);
+  MmioWrite8 (TEST_MMIO_BASE, 0x77);
+  UT_ASSERT_EQUAL (MmioRead32 (TEST_MMIO_BASE), 0x04030677);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestHandler (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  RETURN_STATUS  Status;
+
+  Status = IoEmulationAddHandler (IoEmulationIo, TEST_IO_PORT, 8, TestHandlerRead, TestHandlerWrite, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  IoWrite32 (TEST_IO_PORT, 0x80000000);
+  UT_ASSERT_EQUAL (mLastWriteOffset, 0);
+  UT_ASSERT_EQUAL (mLastWrite, 0x80000000);
+  UT_ASSERT_EQUAL (IoRead16 (TEST_IO_PORT + 4), 0x1004);
+
+  Status = IoEmulationAddHandler (IoEmulationIo, 0xFFF0, 0x20, TestHandlerRead, TestHandlerWrite, NULL);
+  UT_ASSERT_STATUS_EQUAL (Status, RETURN_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestReset (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  STATIC CONST UINT8  Input[] = {0x5A};
+  RETURN_STATUS       Status;
+
+  Status = IoEmulationAddRegisters (IoEmulationMmio, TEST_MMIO_BASE, 0x10, NULL, TRUE);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  IoEmulationSetInput (Input, sizeof (Input));
+
+  IoEmulationReset ();
+  UT_ASSERT_EQUAL (MmioRead8 (TEST_MMIO_BASE), 0xFF);
+
+  //
+  // The input is dropped with the ranges.
+  //
+  Status = IoEmulationAddRegisters (IoEmulationMmio, TEST_MMIO_BASE, 0x10, NULL, TRUE);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (MmioRead8 (TEST_MMIO_BASE), 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The main() function for setting up and running the tests.
+
+  @retval EFI_SUCCESS on successful running.
+  @retval Other error code on failure.
+**/
+int main()
+{
+  EFI_STATUS                Status;
+  UNIT_TEST_FRAMEWORK       *Fw;
+  UNIT_TEST_SUITE           *TestSuite;
+  CHAR16                    ShortName[MAX_STRING_SIZE];
+
+  Fw = NULL;
+  TestSuite = NULL;
+
+  AsciiStrToUnicodeStrS (gEfiCallerBaseName, ShortName, sizeof(ShortName)/sizeof(ShortName[0]));
+  DEBUG((DEBUG_INFO, "%s v%s\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_NAME, ShortName, UNIT_TEST_VERSION);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TestSuite, Fw, L"IoEmulation Test Suite", L"Common.IoEmulation", NULL, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IoEmulation Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase(TestSuite, L"Test unmapped accesses", L"Common.IoEmulation.Unmapped", TestUnmapped, NULL, TestCleanup, NULL);
+  AddTestCase(TestSuite, L"Test register file", L"Common.IoEmulation.RegisterFile", TestRegisterFile, NULL, TestCleanup, NULL);
+  AddTestCase(TestSuite, L"Test register file from input", L"Common.IoEmulation.RegisterInput", TestRegisterInput, NULL, TestCleanup, NULL);
+  AddTestCase(TestSuite, L"Test handler", L"Common.IoEmulation.Handler", TestHandler, NULL, TestCleanup, NULL);
+  AddTestCase(TestSuite, L"Test reset", L"Common.IoEmulation.Reset", TestReset, NULL, TestCleanup, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites(Fw);
+
+EXIT:
+  if (Fw != NULL) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  return Status;
+}
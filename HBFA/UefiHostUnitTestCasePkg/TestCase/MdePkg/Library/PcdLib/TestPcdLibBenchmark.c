@@ -0,0 +1,253 @@
+/** @file
+  Benchmark of the get and set cost of dynamic PCDs in BasePcdLibHost, for
+  PCD databases of a few to thousands of entries.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
+
+#include <UnitTestTypes.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestAssertLib.h>
+#include <Library/UnitTestBenchmarkLib.h>
+
+#define UNIT_TEST_NAME        L"PCD Benchmark"
+#define UNIT_TEST_VERSION     L"0.1"
+
+#define MAX_STRING_SIZE  1025
+
+#define BENCHMARK_WARMUP      10
+#define BENCHMARK_ITERATIONS  1000
+
+//
+// PCD accesses per iteration, so an iteration takes microseconds. It is a
+// multiple of the PCD counts: an iteration walks all the PCDs of a database
+// the same number of times.
+//
+#define PCD_ACCESSES  4096
+
+//
+// Token numbers of the benchmarked PCDs. They are not declared in a DEC
+// file: BasePcdLibHost creates a PCD the first time it is set.
+//
+#define BENCHMARK_TOKEN_BASE     0x1
+#define BENCHMARK_TOKEN_EX_BASE  0x80050000
+
+//
+// Number of PCDs in the database of each benchmark.
+//
+UINTN  mPcdCount[] = {16, 256, 4096};
+
+/**
+  Set the PCDs of a benchmark, and the Ex PCDs with the same index, to their
+  index.
+
+  @param[in] Framework  The unit test framework.
+  @param[in] Context    The number of PCDs.
+
+  @retval UNIT_TEST_PASSED                The PCDs are set.
+  @retval UNIT_TEST_ERROR_PREREQ_NOT_MET  A PCD cannot be set.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SetBenchmarkPcds (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  PcdCount;
+  UINTN  Index;
+
+  PcdCount = *(UINTN *)Context;
+  for (Index = 0; Index < PcdCount; Index++) {
+    if (RETURN_ERROR (LibPcdSet32S (BENCHMARK_TOKEN_BASE + Index, (UINT32)Index))) {
+      return UNIT_TEST_ERROR_PREREQ_NOT_MET;
+    }
+    if (RETURN_ERROR (LibPcdSetEx32S (&gTestCasePkgTokenSpaceGuid, BENCHMARK_TOKEN_EX_BASE + Index, (UINT32)Index))) {
+      return UNIT_TEST_ERROR_PREREQ_NOT_MET;
+    }
+  }
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Return the sum of the PCD values read by one iteration of a get benchmark.
+
+  @param[in] PcdCount  The number of PCDs.
+
+  @return The sum of the PCD indexes over PCD_ACCESSES accesses.
+**/
+UINT32
+GetExpectedSum (
+  IN UINTN  PcdCount
+  )
+{
+  return (UINT32)((PCD_ACCESSES / PcdCount) * (PcdCount * (PcdCount - 1) / 2));
+}
+
+//
+// Walk all the PCDs, like code reading its configuration in a loop.
+//
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkPcdGet (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN   PcdCount;
+  UINTN   Index;
+  UINTN   Access;
+  UINT32  Sum;
+
+  PcdCount = *(UINTN *)Context;
+  Sum = 0;
+  for (Access = 0, Index = 0; Access < PCD_ACCESSES; Access++) {
+    Sum += LibPcdGet32 (BENCHMARK_TOKEN_BASE + Index);
+    Index = (Index + 1 == PcdCount) ? 0 : Index + 1;
+  }
+  UT_ASSERT_EQUAL (Sum, GetExpectedSum (PcdCount));
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkPcdGetEx (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN   PcdCount;
+  UINTN   Index;
+  UINTN   Access;
+  UINT32  Sum;
+
+  PcdCount = *(UINTN *)Context;
+  Sum = 0;
+  for (Access = 0, Index = 0; Access < PCD_ACCESSES; Access++) {
+    Sum += LibPcdGetEx32 (&gTestCasePkgTokenSpaceGuid, BENCHMARK_TOKEN_EX_BASE + Index);
+    Index = (Index + 1 == PcdCount) ? 0 : Index + 1;
+  }
+  UT_ASSERT_EQUAL (Sum, GetExpectedSum (PcdCount));
+  return UNIT_TEST_PASSED;
+}
+
+//
+// The set benchmarks write the index of each PCD, so the values the get
+// benchmarks expect do not change.
+//
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkPcdSet (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  PcdCount;
+  UINTN  Index;
+  UINTN  Access;
+
+  PcdCount = *(UINTN *)Context;
+  for (Access = 0, Index = 0; Access < PCD_ACCESSES; Access++) {
+    UT_ASSERT_NOT_EFI_ERROR (LibPcdSet32S (BENCHMARK_TOKEN_BASE + Index, (UINT32)Index));
+    Index = (Index + 1 == PcdCount) ? 0 : Index + 1;
+  }
+  UT_ASSERT_EQUAL (LibPcdGet32 (BENCHMARK_TOKEN_BASE + PcdCount - 1), PcdCount - 1);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkPcdSetEx (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  PcdCount;
+  UINTN  Index;
+  UINTN  Access;
+
+  PcdCount = *(UINTN *)Context;
+  for (Access = 0, Index = 0; Access < PCD_ACCESSES; Access++) {
+    UT_ASSERT_NOT_EFI_ERROR (LibPcdSetEx32S (&gTestCasePkgTokenSpaceGuid, BENCHMARK_TOKEN_EX_BASE + Index, (UINT32)Index));
+    Index = (Index + 1 == PcdCount) ? 0 : Index + 1;
+  }
+  UT_ASSERT_EQUAL (LibPcdGetEx32 (&gTestCasePkgTokenSpaceGuid, BENCHMARK_TOKEN_EX_BASE + PcdCount - 1), PcdCount - 1);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The main() function for setting up and running the tests.
+
+  @retval EFI_SUCCESS on successful running.
+  @retval Other error code on failure.
+**/
+int main()
+{
+  EFI_STATUS                Status;
+  UNIT_TEST_FRAMEWORK       *Fw;
+  UNIT_TEST_SUITE           *TestSuite;
+  CHAR16                    ShortName[MAX_STRING_SIZE];
+
+  Fw = NULL;
+  TestSuite = NULL;
+
+  AsciiStrToUnicodeStrS (gEfiCallerBaseName, ShortName, sizeof(ShortName)/sizeof(ShortName[0]));
+  DEBUG((DEBUG_INFO, "%s v%s\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_NAME, ShortName, UNIT_TEST_VERSION);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TestSuite, Fw, L"PCD Benchmark Test Suite", L"Common.PCD.Benchmark", NULL, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PCD Benchmark Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddBenchmarkCase(TestSuite, L"Benchmark Get of 16 PCDs", L"Common.PCD.Benchmark.Pcd16.Get", BenchmarkPcdGet, SetBenchmarkPcds, NULL, &mPcdCount[0],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark Set of 16 PCDs", L"Common.PCD.Benchmark.Pcd16.Set", BenchmarkPcdSet, SetBenchmarkPcds, NULL, &mPcdCount[0],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark GetEx of 16 PCDs", L"Common.PCD.Benchmark.Pcd16.GetEx", BenchmarkPcdGetEx, SetBenchmarkPcds, NULL, &mPcdCount[0],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark SetEx of 16 PCDs", L"Common.PCD.Benchmark.Pcd16.SetEx", BenchmarkPcdSetEx, SetBenchmarkPcds, NULL, &mPcdCount[0],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark Get of 256 PCDs", L"Common.PCD.Benchmark.Pcd256.Get", BenchmarkPcdGet, SetBenchmarkPcds, NULL, &mPcdCount[1],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark Set of 256 PCDs", L"Common.PCD.Benchmark.Pcd256.Set", BenchmarkPcdSet, SetBenchmarkPcds, NULL, &mPcdCount[1],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark GetEx of 256 PCDs", L"Common.PCD.Benchmark.Pcd256.GetEx", BenchmarkPcdGetEx, SetBenchmarkPcds, NULL, &mPcdCount[1],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark SetEx of 256 PCDs", L"Common.PCD.Benchmark.Pcd256.SetEx", BenchmarkPcdSetEx, SetBenchmarkPcds, NULL, &mPcdCount[1],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark Get of 4096 PCDs", L"Common.PCD.Benchmark.Pcd4096.Get", BenchmarkPcdGet, SetBenchmarkPcds, NULL, &mPcdCount[2],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark Set of 4096 PCDs", L"Common.PCD.Benchmark.Pcd4096.Set", BenchmarkPcdSet, SetBenchmarkPcds, NULL, &mPcdCount[2],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark GetEx of 4096 PCDs", L"Common.PCD.Benchmark.Pcd4096.GetEx", BenchmarkPcdGetEx, SetBenchmarkPcds, NULL, &mPcdCount[2],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark SetEx of 4096 PCDs", L"Common.PCD.Benchmark.Pcd4096.SetEx", BenchmarkPcdSetEx, SetBenchmarkPcds, NULL, &mPcdCount[2],
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites(Fw);
+
+EXIT:
+  if (Fw != NULL) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  return Status;
+}
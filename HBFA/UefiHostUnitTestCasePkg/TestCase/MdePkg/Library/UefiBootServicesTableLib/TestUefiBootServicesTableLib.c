@@ -9,6 +9,7 @@
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/EventQueueLib.h>
 
 #include <UnitTestTypes.h>
 #include <Library/UnitTestLib.h>
@@ -20,6 +21,17 @@
 #define MAX_STRING_SIZE  1025
 
 EFI_GUID gTestProtocolGuid = {0x21a474cf, 0x7044, 0x4199, {0xa3, 0x4d, 0x82, 0xc4, 0xf1, 0xc, 0x9e, 0xc3}};
+EFI_GUID gTestEventGroupGuid = {0x6c1f3a52, 0x0b8e, 0x4d27, {0x9a, 0x61, 0x3e, 0xd4, 0x27, 0x85, 0xb0, 0x1c}};
+
+VOID
+EFIAPI
+TestCountNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  (*(UINTN *)Context)++;
+}
 
 UNIT_TEST_STATUS
 EFIAPI
@@ -42,6 +54,81 @@ TestProtocolDatabase (
   return UNIT_TEST_PASSED;
 }
 
+UNIT_TEST_STATUS
+EFIAPI
+TestWaitForEvent (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   Event;
+  UINTN       Index;
+
+  Status = gBS->CreateEvent (EVT_TIMER, 0, NULL, NULL, &Event);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  Status = gBS->SetTimer (Event, TimerRelative, 10000);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Status = gBS->WaitForEvent (1, &Event, &Index);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(Index, 0);
+
+  //
+  // No timer is set any more, so nothing can end the wait.
+  //
+  Status = gBS->WaitForEvent (1, &Event, &Index);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_NOT_READY);
+
+  gBS->CloseEvent (Event);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestEventQueueReset (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   TimerEvent;
+  EFI_EVENT   GroupEvent;
+  EFI_EVENT   SignalEvent;
+  UINTN       Count;
+
+  Count = 0;
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, TestCountNotify, &Count, &TimerEvent);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Status = gBS->CreateEventEx (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, TestCountNotify, &Count, &gTestEventGroupGuid, &GroupEvent);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Status = gBS->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, TestCountNotify, &Count, &SignalEvent);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  Status = gBS->SetTimer (TimerEvent, TimerPeriodic, 10000);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  gBS->Stall (1500);
+  UT_ASSERT_EQUAL(Count, 1);
+
+  //
+  // Drop the periodic timer, the group and a notification pending at
+  // TPL_NOTIFY.
+  //
+  gBS->RaiseTPL (TPL_NOTIFY);
+  gBS->SignalEvent (SignalEvent);
+  EventQueueReset ();
+
+  gBS->Stall (5000);
+  gBS->RaiseTPL (TPL_CALLBACK);
+  gBS->RestoreTPL (TPL_APPLICATION);
+  UT_ASSERT_EQUAL(Count, 1);
+
+  gBS->CloseEvent (TimerEvent);
+  gBS->CloseEvent (GroupEvent);
+  gBS->CloseEvent (SignalEvent);
+  return UNIT_TEST_PASSED;
+}
+
 /**
   The main() function for setting up and running the tests.
 
@@ -75,6 +162,8 @@ int main()
   }
 
   AddTestCase(TestSuite, L"Test ProtocolDatabase", L"Common.UefiBootServices.Basic.ProtocolDatabase", TestProtocolDatabase, NULL, NULL, NULL);
+  AddTestCase(TestSuite, L"Test WaitForEvent", L"Common.UefiBootServices.Basic.WaitForEvent", TestWaitForEvent, NULL, NULL, NULL);
+  AddTestCase(TestSuite, L"Test EventQueueReset", L"Common.UefiBootServices.Basic.EventQueueReset", TestEventQueueReset, NULL, NULL, NULL);
 
   //
   // Execute the tests.
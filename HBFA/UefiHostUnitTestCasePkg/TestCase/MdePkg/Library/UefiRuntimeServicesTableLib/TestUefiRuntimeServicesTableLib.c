@@ -6,9 +6,12 @@
 **/
 
 #include <PiDxe.h>
+#include <Guid/VariableFormat.h>
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
+#include <Library/VariableStoreLib.h>
 
 #include <UnitTestTypes.h>
 #include <Library/UnitTestLib.h>
@@ -22,6 +25,172 @@
 #define  TEST_VAR_NAME L"TestVar"
 EFI_GUID gTestVariableGuid = {0x82f9e117, 0x543f, 0x4638, {0xab, 0x7d, 0xc4, 0xe8, 0x5f, 0xde, 0x86, 0x8c}};
 
+#define TEST_VAR_ATTRIBUTES  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+//
+// Variable store images built by the tests: a store of TEST_STORE_SIZE bytes,
+// after the header of a variable firmware volume or not.
+//
+#define TEST_STORE_SIZE  0x1000
+#define TEST_IMAGE_SIZE  (TEST_STORE_SIZE + 0x100)
+
+typedef struct {
+  CHAR16  *Name;
+  UINT8   State;
+  UINT32  Data;
+} TEST_STORE_VARIABLE;
+
+typedef struct {
+  EFI_GUID  *VendorGuid;
+  BOOLEAN   Authenticated;
+  BOOLEAN   FirmwareVolume;
+} TEST_STORE_CONTEXT;
+
+EFI_GUID gTestNormalStoreGuid  = {0x1c1f4a4e, 0x3b5d, 0x4c2a, {0x9e, 0x61, 0x0d, 0x8a, 0x52, 0x7b, 0x36, 0x01}};
+EFI_GUID gTestNormalFvGuid     = {0x1c1f4a4e, 0x3b5d, 0x4c2a, {0x9e, 0x61, 0x0d, 0x8a, 0x52, 0x7b, 0x36, 0x02}};
+EFI_GUID gTestAuthStoreGuid    = {0x1c1f4a4e, 0x3b5d, 0x4c2a, {0x9e, 0x61, 0x0d, 0x8a, 0x52, 0x7b, 0x36, 0x03}};
+EFI_GUID gTestAuthFvGuid       = {0x1c1f4a4e, 0x3b5d, 0x4c2a, {0x9e, 0x61, 0x0d, 0x8a, 0x52, 0x7b, 0x36, 0x04}};
+EFI_GUID gTestEnumerationGuid  = {0x1c1f4a4e, 0x3b5d, 0x4c2a, {0x9e, 0x61, 0x0d, 0x8a, 0x52, 0x7b, 0x36, 0x05}};
+
+TEST_STORE_CONTEXT  mTestNormalStore = {&gTestNormalStoreGuid, FALSE, FALSE};
+TEST_STORE_CONTEXT  mTestNormalFv    = {&gTestNormalFvGuid,    FALSE, TRUE};
+TEST_STORE_CONTEXT  mTestAuthStore   = {&gTestAuthStoreGuid,   TRUE,  FALSE};
+TEST_STORE_CONTEXT  mTestAuthFv      = {&gTestAuthFvGuid,      TRUE,  TRUE};
+TEST_STORE_CONTEXT  mTestEnumeration = {&gTestEnumerationGuid, FALSE, FALSE};
+
+//
+// "Moved" was being updated: its old copy is in deleted transition and the
+// new one follows. The update of "Orphan" stopped before its new copy was
+// written, so the copy in deleted transition is the current one.
+//
+TEST_STORE_VARIABLE  mTestImportVariables[] = {
+  {L"Added",   VAR_ADDED,                             1},
+  {L"Moved",   VAR_IN_DELETED_TRANSITION & VAR_ADDED, 2},
+  {L"Deleted", VAR_DELETED & VAR_ADDED,               3},
+  {L"Orphan",  VAR_IN_DELETED_TRANSITION & VAR_ADDED, 4},
+  {L"Moved",   VAR_ADDED,                             5},
+};
+
+TEST_STORE_VARIABLE  mTestEnumerationVariables[] = {
+  {L"First",          VAR_ADDED, 1},
+  {L"SecondVariable", VAR_ADDED, 2},
+  {L"Third",          VAR_ADDED, 3},
+};
+
+UINT8  mTestImage[TEST_IMAGE_SIZE];
+
+/**
+  Build a variable store image in mTestImage.
+
+  @param[in] StoreContext   The type of the store and the GUID of its variables.
+  @param[in] Variables      The variables of the store, in store order.
+  @param[in] VariableCount  The number of variables.
+
+  @return The size of the image.
+**/
+UINTN
+BuildVariableStoreImage (
+  IN CONST TEST_STORE_CONTEXT   *StoreContext,
+  IN CONST TEST_STORE_VARIABLE  *Variables,
+  IN UINTN                      VariableCount
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER     *FvHeader;
+  VARIABLE_STORE_HEADER          *StoreHeader;
+  VARIABLE_HEADER                *Variable;
+  AUTHENTICATED_VARIABLE_HEADER  *AuthVariable;
+  UINTN                          HeaderSize;
+  UINTN                          NameSize;
+  UINT8                          *Next;
+  UINTN                          Index;
+
+  SetMem (mTestImage, sizeof (mTestImage), 0xFF);
+
+  StoreHeader = (VARIABLE_STORE_HEADER *) mTestImage;
+  if (StoreContext->FirmwareVolume) {
+    FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) mTestImage;
+    ZeroMem (FvHeader, sizeof (*FvHeader) + sizeof (EFI_FV_BLOCK_MAP_ENTRY));
+    FvHeader->HeaderLength           = sizeof (*FvHeader) + sizeof (EFI_FV_BLOCK_MAP_ENTRY);
+    FvHeader->FvLength               = FvHeader->HeaderLength + TEST_STORE_SIZE;
+    FvHeader->Signature              = EFI_FVH_SIGNATURE;
+    FvHeader->Revision               = EFI_FVH_REVISION;
+    FvHeader->BlockMap[0].NumBlocks  = 1;
+    FvHeader->BlockMap[0].Length     = (UINT32) FvHeader->FvLength;
+    StoreHeader = (VARIABLE_STORE_HEADER *) (mTestImage + FvHeader->HeaderLength);
+  }
+
+  ZeroMem (StoreHeader, sizeof (*StoreHeader));
+  if (StoreContext->Authenticated) {
+    CopyGuid (&StoreHeader->Signature, &gEfiAuthenticatedVariableGuid);
+    HeaderSize = sizeof (AUTHENTICATED_VARIABLE_HEADER);
+  } else {
+    CopyGuid (&StoreHeader->Signature, &gEfiVariableGuid);
+    HeaderSize = sizeof (VARIABLE_HEADER);
+  }
+  StoreHeader->Size   = TEST_STORE_SIZE;
+  StoreHeader->Format = VARIABLE_STORE_FORMATTED;
+  StoreHeader->State  = VARIABLE_STORE_HEALTHY;
+
+  Next = (UINT8 *) HEADER_ALIGN (StoreHeader + 1);
+  for (Index = 0; Index < VariableCount; Index++) {
+    NameSize = StrSize (Variables[Index].Name);
+    ZeroMem (Next, HeaderSize);
+    if (StoreContext->Authenticated) {
+      AuthVariable = (AUTHENTICATED_VARIABLE_HEADER *) Next;
+      AuthVariable->StartId    = VARIABLE_DATA;
+      AuthVariable->State      = Variables[Index].State;
+      AuthVariable->Attributes = TEST_VAR_ATTRIBUTES;
+      AuthVariable->NameSize   = (UINT32) NameSize;
+      AuthVariable->DataSize   = sizeof (Variables[Index].Data);
+      CopyGuid (&AuthVariable->VendorGuid, StoreContext->VendorGuid);
+    } else {
+      Variable = (VARIABLE_HEADER *) Next;
+      Variable->StartId    = VARIABLE_DATA;
+      Variable->State      = Variables[Index].State;
+      Variable->Attributes = TEST_VAR_ATTRIBUTES;
+      Variable->NameSize   = (UINT32) NameSize;
+      Variable->DataSize   = sizeof (Variables[Index].Data);
+      CopyGuid (&Variable->VendorGuid, StoreContext->VendorGuid);
+    }
+    Next += HeaderSize;
+    CopyMem (Next, Variables[Index].Name, NameSize);
+    Next += NameSize + GET_PAD_SIZE (NameSize);
+    CopyMem (Next, &Variables[Index].Data, sizeof (Variables[Index].Data));
+    Next = (UINT8 *) HEADER_ALIGN (Next + sizeof (Variables[Index].Data));
+  }
+
+  return (UINT8 *) StoreHeader - mTestImage + TEST_STORE_SIZE;
+}
+
+/**
+  Read a variable set by the tests.
+
+  @param[in]  Name        The name of the variable.
+  @param[in]  VendorGuid  The vendor GUID of the variable.
+  @param[out] Data        The data of the variable.
+
+  @retval EFI_VOLUME_CORRUPTED  The attributes or the size of the variable are not the ones set.
+  @return The status of gRT->GetVariable().
+**/
+EFI_STATUS
+GetTestVariable (
+  IN  CHAR16    *Name,
+  IN  EFI_GUID  *VendorGuid,
+  OUT UINT32    *Data
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+  UINT32      Attributes;
+
+  Size = sizeof (*Data);
+  Status = gRT->GetVariable (Name, VendorGuid, &Attributes, &Size, Data);
+  if (!EFI_ERROR (Status) && ((Attributes != TEST_VAR_ATTRIBUTES) || (Size != sizeof (*Data)))) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+  return Status;
+}
+
 UNIT_TEST_STATUS
 EFIAPI
 TestVariable (
@@ -59,6 +228,141 @@ TestVariable (
   return UNIT_TEST_PASSED;
 }
 
+UNIT_TEST_STATUS
+EFIAPI
+TestImportVariableStore (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  TEST_STORE_CONTEXT  *StoreContext;
+  EFI_STATUS          Status;
+  UINTN               ImageSize;
+  UINT32              Data;
+
+  StoreContext = (TEST_STORE_CONTEXT *) Context;
+
+  //
+  // The image replaces the variables already in the host store, including
+  // the ones it only holds in deleted transition
+  //
+  Data = 0;
+  Status = gRT->SetVariable (L"Added", StoreContext->VendorGuid, TEST_VAR_ATTRIBUTES, sizeof (Data), &Data);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  Status = gRT->SetVariable (L"Orphan", StoreContext->VendorGuid, TEST_VAR_ATTRIBUTES, sizeof (Data), &Data);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  ImageSize = BuildVariableStoreImage (StoreContext, mTestImportVariables, sizeof (mTestImportVariables) / sizeof (mTestImportVariables[0]));
+  Status = VariableStoreImportImage (mTestImage, ImageSize);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  Status = GetTestVariable (L"Added", StoreContext->VendorGuid, &Data);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(Data, 1);
+
+  Status = GetTestVariable (L"Moved", StoreContext->VendorGuid, &Data);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(Data, 5);
+
+  Status = GetTestVariable (L"Orphan", StoreContext->VendorGuid, &Data);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(Data, 4);
+
+  Status = GetTestVariable (L"Deleted", StoreContext->VendorGuid, &Data);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_NOT_FOUND);
+
+  //
+  // A store with an unknown signature or not formatted is rejected
+  //
+  ((VARIABLE_STORE_HEADER *) (mTestImage + ImageSize - TEST_STORE_SIZE))->Format = 0xFF;
+  Status = VariableStoreImportImage (mTestImage, ImageSize);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_VOLUME_CORRUPTED);
+
+  ZeroMem (&((VARIABLE_STORE_HEADER *) (mTestImage + ImageSize - TEST_STORE_SIZE))->Signature, sizeof (EFI_GUID));
+  Status = VariableStoreImportImage (mTestImage, ImageSize);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_UNSUPPORTED);
+
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+TestGetNextVariableName (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  TEST_STORE_CONTEXT  *StoreContext;
+  EFI_STATUS          Status;
+  UINTN               ImageSize;
+  CHAR16              Name[MAX_STRING_SIZE];
+  EFI_GUID            Guid;
+  UINTN               Size;
+  UINTN               Index;
+
+  StoreContext = (TEST_STORE_CONTEXT *) Context;
+
+  ImageSize = BuildVariableStoreImage (StoreContext, mTestEnumerationVariables, sizeof (mTestEnumerationVariables) / sizeof (mTestEnumerationVariables[0]));
+  Status = VariableStoreImportImage (mTestImage, ImageSize);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+
+  //
+  // The variables are enumerated in the order they were created
+  //
+  Index = 0;
+  Name[0] = 0;
+  ZeroMem (&Guid, sizeof (Guid));
+  while (TRUE) {
+    Size = sizeof (Name);
+    Status = gRT->GetNextVariableName (&Size, Name, &Guid);
+    if (Status == EFI_NOT_FOUND) {
+      break;
+    }
+    UT_ASSERT_NOT_EFI_ERROR(Status);
+    UT_ASSERT_EQUAL(Size, StrSize (Name));
+    if (CompareGuid (&Guid, StoreContext->VendorGuid)) {
+      UT_ASSERT_TRUE(Index < sizeof (mTestEnumerationVariables) / sizeof (mTestEnumerationVariables[0]));
+      UT_ASSERT_EQUAL(StrCmp (Name, mTestEnumerationVariables[Index].Name), 0);
+      Index++;
+    }
+  }
+  UT_ASSERT_EQUAL(Index, sizeof (mTestEnumerationVariables) / sizeof (mTestEnumerationVariables[0]));
+
+  //
+  // A buffer too small for the next name gets the size it needs
+  //
+  StrCpyS (Name, sizeof (Name) / sizeof (Name[0]), L"First");
+  CopyGuid (&Guid, StoreContext->VendorGuid);
+  Size = StrSize (L"First");
+  Status = gRT->GetNextVariableName (&Size, Name, &Guid);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_BUFFER_TOO_SMALL);
+  UT_ASSERT_EQUAL(Size, StrSize (L"SecondVariable"));
+  UT_ASSERT_EQUAL(StrCmp (Name, L"First"), 0);
+
+  Size = StrSize (L"SecondVariable");
+  Status = gRT->GetNextVariableName (&Size, Name, &Guid);
+  UT_ASSERT_NOT_EFI_ERROR(Status);
+  UT_ASSERT_EQUAL(StrCmp (Name, L"SecondVariable"), 0);
+  UT_ASSERT_TRUE(CompareGuid (&Guid, StoreContext->VendorGuid));
+
+  //
+  // The name and GUID passed in must name a variable
+  //
+  StrCpyS (Name, sizeof (Name) / sizeof (Name[0]), L"Unknown");
+  CopyGuid (&Guid, StoreContext->VendorGuid);
+  Size = sizeof (Name);
+  Status = gRT->GetNextVariableName (&Size, Name, &Guid);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
+
+  StrCpyS (Name, sizeof (Name) / sizeof (Name[0]), L"First");
+  CopyGuid (&Guid, &gTestVariableGuid);
+  Size = sizeof (Name);
+  Status = gRT->GetNextVariableName (&Size, Name, &Guid);
+  UT_ASSERT_STATUS_EQUAL(Status, EFI_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
 /**
   The main() function for setting up and running the tests.
 
@@ -70,10 +374,12 @@ int main()
   EFI_STATUS                Status;
   UNIT_TEST_FRAMEWORK       *Fw;
   UNIT_TEST_SUITE           *TestSuite;
+  UNIT_TEST_SUITE           *StoreTestSuite;
   CHAR16                    ShortName[MAX_STRING_SIZE];
 
   Fw = NULL;
   TestSuite = NULL;
+  StoreTestSuite = NULL;
 
   AsciiStrToUnicodeStrS (gEfiCallerBaseName, ShortName, sizeof(ShortName)/sizeof(ShortName[0]));
   DEBUG((DEBUG_INFO, "%s v%s\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
@@ -93,6 +399,19 @@ int main()
 
   AddTestCase(TestSuite, L"Test Variable", L"Common.UefiBootServices.Variable.GetSecVar", TestVariable, NULL, NULL, NULL);
 
+  Status = CreateUnitTestSuite (&StoreTestSuite, Fw, L"UefiRuntimeServices Variable Store Test Suite", L"Common.UefiRuntimeServices.VariableStore", NULL, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for UefiRuntimeServices Variable Store Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase(StoreTestSuite, L"Import Normal Variable Store", L"Common.UefiRuntimeServices.VariableStore.ImportNormalStore", TestImportVariableStore, NULL, NULL, &mTestNormalStore);
+  AddTestCase(StoreTestSuite, L"Import Normal Variable FV", L"Common.UefiRuntimeServices.VariableStore.ImportNormalFv", TestImportVariableStore, NULL, NULL, &mTestNormalFv);
+  AddTestCase(StoreTestSuite, L"Import Authenticated Variable Store", L"Common.UefiRuntimeServices.VariableStore.ImportAuthStore", TestImportVariableStore, NULL, NULL, &mTestAuthStore);
+  AddTestCase(StoreTestSuite, L"Import Authenticated Variable FV", L"Common.UefiRuntimeServices.VariableStore.ImportAuthFv", TestImportVariableStore, NULL, NULL, &mTestAuthFv);
+  AddTestCase(StoreTestSuite, L"Enumerate Variables", L"Common.UefiRuntimeServices.VariableStore.GetNextVariableName", TestGetNextVariableName, NULL, NULL, &mTestEnumeration);
+
   //
   // Execute the tests.
   //
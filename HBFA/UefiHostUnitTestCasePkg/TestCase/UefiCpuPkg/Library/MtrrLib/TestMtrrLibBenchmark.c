@@ -0,0 +1,182 @@
+/** @file
+  Benchmark of the MtrrLib routines that program and look up memory ranges,
+  on the MTRRs of MtrrStubLib.
+
+  Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MtrrLib.h>
+#include <Library/MtrrStubLib.h>
+
+#include <UnitTestTypes.h>
+#include <Library/UnitTestLib.h>
+#include <Library/UnitTestAssertLib.h>
+#include <Library/UnitTestBenchmarkLib.h>
+
+#define UNIT_TEST_NAME        L"MtrrLib Benchmark"
+#define UNIT_TEST_VERSION     L"0.1"
+
+#define MAX_STRING_SIZE  1025
+
+#define BENCHMARK_WARMUP      10
+#define BENCHMARK_ITERATIONS  1000
+
+#define BENCHMARK_VARIABLE_MTRR_COUNT     10
+#define BENCHMARK_PHYSICAL_ADDRESS_BITS   36
+#define BENCHMARK_SCRATCH_SIZE            SIZE_16KB
+
+//
+// Number of lookups of every range per iteration, so an iteration takes
+// microseconds.
+//
+#define LOOKUP_REPEAT         16
+
+//
+// A typical layout over an uncacheable default: write-back memory below and
+// above 4GB, and the MMIO ranges a platform sets up. The first range is not
+// a power of 2 in size, so it takes two variable MTRRs.
+//
+GLOBAL_REMOVE_IF_UNREFERENCED CONST MTRR_MEMORY_RANGE mBenchmarkRanges[] = {
+  { 0x0,         0x7F800000,  CacheWriteBack },
+  { 0x90000000,  0x10000000,  CacheWriteThrough },
+  { 0xC0000000,  0x1000000,   CacheWriteCombining },
+  { 0xFF000000,  0x1000000,   CacheWriteProtected },
+  { 0x100000000, 0x100000000, CacheWriteBack },
+};
+
+UINT8  mScratch[BENCHMARK_SCRATCH_SIZE];
+
+/**
+  Reset the MTRRs of MtrrStubLib to an uncacheable default.
+**/
+VOID
+ResetBenchmarkMtrrs (
+  VOID
+  )
+{
+  InitializeMtrrRegs (CacheUncacheable, BENCHMARK_VARIABLE_MTRR_COUNT, BENCHMARK_PHYSICAL_ADDRESS_BITS);
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SetBenchmarkRanges (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  ScratchSize;
+
+  ResetBenchmarkMtrrs ();
+  ScratchSize = sizeof (mScratch);
+  UT_ASSERT_NOT_EFI_ERROR (
+    MtrrSetMemoryAttributesInMtrrSettings (NULL, mScratch, &ScratchSize, mBenchmarkRanges, ARRAY_SIZE (mBenchmarkRanges))
+    );
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkMtrrSetMemoryAttributesInMtrrSettings (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  return SetBenchmarkRanges (Framework, Context);
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkMtrrSetMemoryAttribute (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN  Index;
+
+  ResetBenchmarkMtrrs ();
+  for (Index = 0; Index < ARRAY_SIZE (mBenchmarkRanges); Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (
+      MtrrSetMemoryAttribute (mBenchmarkRanges[Index].BaseAddress, mBenchmarkRanges[Index].Length, mBenchmarkRanges[Index].Type)
+      );
+  }
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+BenchmarkMtrrGetMemoryAttribute (
+  IN UNIT_TEST_FRAMEWORK_HANDLE  Framework,
+  IN UNIT_TEST_CONTEXT           Context
+  )
+{
+  UINTN                    Repeat;
+  UINTN                    Index;
+  CONST MTRR_MEMORY_RANGE  *Range;
+
+  for (Repeat = 0; Repeat < LOOKUP_REPEAT; Repeat++) {
+    for (Index = 0; Index < ARRAY_SIZE (mBenchmarkRanges); Index++) {
+      Range = &mBenchmarkRanges[Index];
+      UT_ASSERT_EQUAL (MtrrGetMemoryAttribute (Range->BaseAddress), Range->Type);
+      UT_ASSERT_EQUAL (MtrrGetMemoryAttribute (Range->BaseAddress + Range->Length - 1), Range->Type);
+    }
+  }
+  UT_ASSERT_EQUAL (MtrrGetMemoryAttribute (mBenchmarkRanges[0].Length), CacheUncacheable);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The main() function for setting up and running the tests.
+
+  @retval EFI_SUCCESS on successful running.
+  @retval Other error code on failure.
+**/
+int main()
+{
+  EFI_STATUS                Status;
+  UNIT_TEST_FRAMEWORK       *Fw;
+  UNIT_TEST_SUITE           *TestSuite;
+  CHAR16                    ShortName[MAX_STRING_SIZE];
+
+  Fw = NULL;
+  TestSuite = NULL;
+
+  AsciiStrToUnicodeStrS (gEfiCallerBaseName, ShortName, sizeof(ShortName)/sizeof(ShortName[0]));
+  DEBUG((DEBUG_INFO, "%s v%s\n", UNIT_TEST_NAME, UNIT_TEST_VERSION));
+
+  Status = InitUnitTestFramework (&Fw, UNIT_TEST_NAME, ShortName, UNIT_TEST_VERSION);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TestSuite, Fw, L"MtrrLib Benchmark Test Suite", L"Common.MtrrLib.Benchmark", NULL, NULL);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "Failed in CreateUnitTestSuite for MtrrLib Benchmark Test Suite\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddBenchmarkCase(TestSuite, L"Benchmark MtrrSetMemoryAttributesInMtrrSettings", L"Common.MtrrLib.Benchmark.SetMemoryAttributesInMtrrSettings", BenchmarkMtrrSetMemoryAttributesInMtrrSettings, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark MtrrSetMemoryAttribute", L"Common.MtrrLib.Benchmark.SetMemoryAttribute", BenchmarkMtrrSetMemoryAttribute, NULL, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+  AddBenchmarkCase(TestSuite, L"Benchmark MtrrGetMemoryAttribute", L"Common.MtrrLib.Benchmark.GetMemoryAttribute", BenchmarkMtrrGetMemoryAttribute, SetBenchmarkRanges, NULL, NULL,
+    BENCHMARK_WARMUP, BENCHMARK_ITERATIONS, 0);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites(Fw);
+
+EXIT:
+  if (Fw != NULL) {
+    FreeUnitTestFramework(Fw);
+  }
+
+  return Status;
+}
@@ -96,4 +96,24 @@ RegisterPciDevices (
   IN REGISTER_PCI_DEVICE_STRUCT   *PciDevices
   );
 
+/**
+  Back the config space of the addresses without a registered device with
+  input, typically the input of a fuzzer.
+
+  The first access to such an address creates a device whose 256 byte config
+  space is the next 256 bytes of the input, or reads all 1 once the input is
+  used up. Its registers are read/write; a VendorId of 0xFFFF in the input
+  leaves the address without a device.
+
+  @param  Input      The config space data. It is copied.
+  @param  InputSize  The size of the config space data. 0 removes the devices
+                     backed by input.
+**/
+VOID
+EFIAPI
+RegisterPciConfigSpaceInput (
+  IN VOID                         *Input,
+  IN UINTN                        InputSize
+  );
+
 #endif
\ No newline at end of file
@@ -34,6 +34,34 @@ UINTN                        mPciDevicesCount;
 REGISTER_PCI_DEVICE_STRUCT   *mPciDevices;
 PCI_DEVICE_BUFFER            *mPciDevicesBuffer;
 
+//
+// ECAM style lookup of the device at a segment/bus/device/function: each
+// segment has a table per bus, with a slot per device/function. A slot is 0
+// if there is no device, the index + 1 of a registered device, or
+// mPciDevicesCount + the index + 1 of a device backed by input.
+//
+#define PCI_DEVICE_FUNCTION_COUNT  ((PCI_MAX_DEVICE + 1) * (PCI_MAX_FUNC + 1))
+
+typedef struct {
+  UINT32     Segment;
+  UINT32     *Bus[PCI_MAX_BUS + 1];
+} PCI_SEGMENT_TABLE;
+
+UINTN                        mPciSegmentTableCount;
+PCI_SEGMENT_TABLE            *mPciSegmentTables;
+
+//
+// Config space of the devices backed by the input of RegisterPciConfigSpaceInput().
+//
+#define PCI_INPUT_CONFIG_SPACE_SIZE  0x100
+
+UINT8                        *mPciConfigSpaceInput;
+UINTN                        mPciConfigSpaceInputSize;
+UINTN                        mPciInputDevicesCount;
+UINT64                       *mPciInputDevicesAddress;
+PCI_DEVICE_BUFFER            *mPciInputDevicesBuffer;
+UINT8                        *mPciInputDevicesData;
+
 PCI_DEVICE_BUFFER *
 GetPciDeviceBuffer (
   IN UINT64                    Address
@@ -1407,48 +1435,186 @@ PciSegmentWriteBuffer (
   return ReturnValue;
 }
 
-REGISTER_PCI_DEVICE_STRUCT *
-GetPciDevice (
+UINT32 *
+GetPciBusTable (
+  IN UINT32                    Segment,
+  IN UINT8                     Bus,
+  IN BOOLEAN                   Create
+  )
+{
+  PCI_SEGMENT_TABLE               *SegmentTable;
+  UINTN                           Index;
+
+  SegmentTable = NULL;
+  for (Index = 0; Index < mPciSegmentTableCount; Index++) {
+    if (mPciSegmentTables[Index].Segment == Segment) {
+      SegmentTable = &mPciSegmentTables[Index];
+      break;
+    }
+  }
+
+  if (SegmentTable == NULL) {
+    if (!Create) {
+      return NULL;
+    }
+    SegmentTable = ReallocatePool (
+                     sizeof(PCI_SEGMENT_TABLE) * mPciSegmentTableCount,
+                     sizeof(PCI_SEGMENT_TABLE) * (mPciSegmentTableCount + 1),
+                     mPciSegmentTables
+                     );
+    if (SegmentTable == NULL) {
+      return NULL;
+    }
+    mPciSegmentTables = SegmentTable;
+    SegmentTable = &mPciSegmentTables[mPciSegmentTableCount++];
+    ZeroMem (SegmentTable, sizeof(PCI_SEGMENT_TABLE));
+    SegmentTable->Segment = Segment;
+  }
+
+  if ((SegmentTable->Bus[Bus] == NULL) && Create) {
+    SegmentTable->Bus[Bus] = AllocateZeroPool (sizeof(UINT32) * PCI_DEVICE_FUNCTION_COUNT);
+  }
+  return SegmentTable->Bus[Bus];
+}
+
+UINT32
+GetPciDeviceSlot (
   IN UINT64                    Address
   )
 {
   PCI_SEGMENT_LIB_ADDRESS_STRUCT  LibAddress;
-  UINTN                           Index;
+  UINT32                          *BusTable;
 
   LibAddress.Data = Address;
 
-  for (Index = 0; Index < mPciDevicesCount; Index++) {
-    if ((LibAddress.Bits.Segment == mPciDevices[Index].Address.Bits.Segment) &&
-        (LibAddress.Bits.Bus == mPciDevices[Index].Address.Bits.Bus) &&
-        (LibAddress.Bits.Device == mPciDevices[Index].Address.Bits.Device) &&
-        (LibAddress.Bits.Function == mPciDevices[Index].Address.Bits.Function) ) {
-      return &mPciDevices[Index];
+  BusTable = GetPciBusTable (LibAddress.Bits.Segment, (UINT8)LibAddress.Bits.Bus, FALSE);
+  if (BusTable == NULL) {
+    return 0;
+  }
+  return BusTable[LibAddress.Bits.Device * (PCI_MAX_FUNC + 1) + LibAddress.Bits.Function];
+}
+
+VOID
+SetPciDeviceSlot (
+  IN UINT64                    Address,
+  IN UINT32                    Slot
+  )
+{
+  PCI_SEGMENT_LIB_ADDRESS_STRUCT  LibAddress;
+  UINT32                          *BusTable;
+  UINTN                           DeviceFunction;
+
+  LibAddress.Data = Address;
+
+  BusTable = GetPciBusTable (LibAddress.Bits.Segment, (UINT8)LibAddress.Bits.Bus, TRUE);
+  ASSERT (BusTable != NULL);
+  if (BusTable == NULL) {
+    return;
+  }
+
+  //
+  // The first device at an address wins, like a search of the devices in order.
+  //
+  DeviceFunction = LibAddress.Bits.Device * (PCI_MAX_FUNC + 1) + LibAddress.Bits.Function;
+  if (BusTable[DeviceFunction] == 0) {
+    BusTable[DeviceFunction] = Slot;
+  }
+}
+
+VOID
+BuildPciDeviceTable (
+  VOID
+  )
+{
+  UINTN                           Index;
+  UINTN                           Bus;
+
+  for (Index = 0; Index < mPciSegmentTableCount; Index++) {
+    for (Bus = 0; Bus <= PCI_MAX_BUS; Bus++) {
+      if (mPciSegmentTables[Index].Bus[Bus] != NULL) {
+        ZeroMem (mPciSegmentTables[Index].Bus[Bus], sizeof(UINT32) * PCI_DEVICE_FUNCTION_COUNT);
+      }
     }
   }
 
-  return NULL;
+  for (Index = 0; Index < mPciDevicesCount; Index++) {
+    SetPciDeviceSlot (mPciDevices[Index].Address.Data, (UINT32)(Index + 1));
+  }
+  for (Index = 0; Index < mPciInputDevicesCount; Index++) {
+    SetPciDeviceSlot (mPciInputDevicesAddress[Index], (UINT32)(mPciDevicesCount + Index + 1));
+  }
 }
 
 PCI_DEVICE_BUFFER *
-GetPciDeviceBuffer (
+CreatePciInputDevice (
   IN UINT64                    Address
   )
 {
   PCI_SEGMENT_LIB_ADDRESS_STRUCT  LibAddress;
-  UINTN                           Index;
+  PCI_DEVICE_BUFFER               *PciDeviceBuffer;
+  UINTN                           Offset;
+  UINTN                           Size;
+
+  Offset = mPciInputDevicesCount * PCI_INPUT_CONFIG_SPACE_SIZE;
+  if (Offset >= mPciConfigSpaceInputSize) {
+    return NULL;
+  }
+  Size = MIN (mPciConfigSpaceInputSize - Offset, PCI_INPUT_CONFIG_SPACE_SIZE);
 
   LibAddress.Data = Address;
-  
-  for (Index = 0; Index < mPciDevicesCount; Index++) {
-    if ((LibAddress.Bits.Segment == mPciDevices[Index].Address.Bits.Segment) &&
-        (LibAddress.Bits.Bus == mPciDevices[Index].Address.Bits.Bus) &&
-        (LibAddress.Bits.Device == mPciDevices[Index].Address.Bits.Device) &&
-        (LibAddress.Bits.Function == mPciDevices[Index].Address.Bits.Function) ) {
-      return &mPciDevicesBuffer[Index];
-    }
+  LibAddress.Bits.Register = 0;
+  mPciInputDevicesAddress[mPciInputDevicesCount] = LibAddress.Data;
+
+  //
+  // The config space is read/write, and reads all 1 past the end of the input.
+  //
+  PciDeviceBuffer = &mPciInputDevicesBuffer[mPciInputDevicesCount];
+  PciDeviceBuffer->Discoverable = TRUE;
+  PciDeviceBuffer->BufferSize   = PCI_INPUT_CONFIG_SPACE_SIZE;
+  PciDeviceBuffer->Buffer       = mPciInputDevicesData + PCI_INPUT_CONFIG_SPACE_SIZE * 3 * mPciInputDevicesCount;
+  PciDeviceBuffer->OrBuffer     = PciDeviceBuffer->Buffer + PCI_INPUT_CONFIG_SPACE_SIZE;
+  PciDeviceBuffer->AndBuffer    = PciDeviceBuffer->Buffer + PCI_INPUT_CONFIG_SPACE_SIZE * 2;
+  SetMem (PciDeviceBuffer->Buffer, PCI_INPUT_CONFIG_SPACE_SIZE, 0xFF);
+  CopyMem (PciDeviceBuffer->Buffer, mPciConfigSpaceInput + Offset, Size);
+  ZeroMem (PciDeviceBuffer->OrBuffer, PCI_INPUT_CONFIG_SPACE_SIZE);
+  SetMem (PciDeviceBuffer->AndBuffer, PCI_INPUT_CONFIG_SPACE_SIZE, 0xFF);
+
+  mPciInputDevicesCount++;
+  SetPciDeviceSlot (LibAddress.Data, (UINT32)(mPciDevicesCount + mPciInputDevicesCount));
+  return PciDeviceBuffer;
+}
+
+REGISTER_PCI_DEVICE_STRUCT *
+GetPciDevice (
+  IN UINT64                    Address
+  )
+{
+  UINT32                          Slot;
+
+  Slot = GetPciDeviceSlot (Address);
+  if ((Slot == 0) || (Slot > mPciDevicesCount)) {
+    return NULL;
+  }
+
+  return &mPciDevices[Slot - 1];
+}
+
+PCI_DEVICE_BUFFER *
+GetPciDeviceBuffer (
+  IN UINT64                    Address
+  )
+{
+  UINT32                          Slot;
+
+  Slot = GetPciDeviceSlot (Address);
+  if (Slot == 0) {
+    return CreatePciInputDevice (Address);
+  }
+  if (Slot > mPciDevicesCount) {
+    return &mPciInputDevicesBuffer[Slot - mPciDevicesCount - 1];
   }
 
-  return NULL;
+  return &mPciDevicesBuffer[Slot - 1];
 }
 
 VOID
@@ -1763,6 +1929,8 @@ MakePciDiscoverability (
       }
     }
   }
+
+  BuildPciDeviceTable ();
 }
 
 VOID
@@ -1780,6 +1948,13 @@ PciSegmentLibWriteHook (
   PciDeviceBuffer = GetPciDeviceBuffer (Address);
   ASSERT (PciDeviceBuffer != NULL);
 
+  //
+  // A device backed by input has no devices registered under it.
+  //
+  if (GetPciDevice (Address) == NULL) {
+    return;
+  }
+
   Pci = (PCI_TYPE_GENERIC *)PciDeviceBuffer->Buffer;
   if (IS_PCI_P2P ((PCI_TYPE00 *)Pci)) {
     if ((LibAddress.Bits.Register <= PCI_BRIDGE_SECONDARY_BUS_REGISTER_OFFSET) &&
@@ -1854,4 +2029,39 @@ RegisterPciDevices (
 
     ProgramPciDevice (&mPciDevices[Index], &mPciDevicesBuffer[Index]);
   }
+
+  BuildPciDeviceTable ();
+}
+
+VOID
+EFIAPI
+RegisterPciConfigSpaceInput (
+  IN VOID                         *Input,
+  IN UINTN                        InputSize
+  )
+{
+  UINTN  MaxCount;
+
+  if (mPciConfigSpaceInput != NULL) {
+    FreePool (mPciConfigSpaceInput);
+    FreePool (mPciInputDevicesAddress);
+    FreePool (mPciInputDevicesBuffer);
+    FreePool (mPciInputDevicesData);
+  }
+  mPciConfigSpaceInput     = NULL;
+  mPciConfigSpaceInputSize = 0;
+  mPciInputDevicesCount    = 0;
+
+  MaxCount = (InputSize + PCI_INPUT_CONFIG_SPACE_SIZE - 1) / PCI_INPUT_CONFIG_SPACE_SIZE;
+  if (MaxCount != 0) {
+    mPciConfigSpaceInput    = AllocateCopyPool (InputSize, Input);
+    mPciInputDevicesAddress = AllocateZeroPool (sizeof(UINT64) * MaxCount);
+    mPciInputDevicesBuffer  = AllocateZeroPool (sizeof(PCI_DEVICE_BUFFER) * MaxCount);
+    mPciInputDevicesData    = AllocatePool (PCI_INPUT_CONFIG_SPACE_SIZE * 3 * MaxCount);
+    ASSERT ((mPciConfigSpaceInput != NULL) && (mPciInputDevicesAddress != NULL) &&
+            (mPciInputDevicesBuffer != NULL) && (mPciInputDevicesData != NULL));
+    mPciConfigSpaceInputSize = InputSize;
+  }
+
+  BuildPciDeviceTable ();
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+/** @file
+  Benchmark tests of the host unit test framework of UnitTestLibHost.
+
+  A benchmark test is added to a suite like a test, and its function is
+  called like a test function: Warmup times untimed, then Iterations times,
+  each call timed with the monotonic clock of the host. The minimum, median
+  and 99th percentile time of a call, and the throughput at the median time,
+  are logged and written as properties of the test case in the JUnit report.
+  The test fails with the first call that does not pass.
+
+  A call should take well above a microsecond so the clock overhead does not
+  show. A function measuring short code repeats it in a loop and counts the
+  bytes of all the repetitions in BytesPerIteration.
+
+  Benchmarks run in parallel with the tests of other suites when
+  HBFA_UNIT_TEST_JOBS is set, so their timings are only comparable between
+  serial runs.
+
+  UnitTestLibcmocka runs a benchmark test as a test, calling its function
+  once.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _UNIT_TEST_BENCHMARK_LIB_H_
+#define _UNIT_TEST_BENCHMARK_LIB_H_
+
+/**
+  Add a benchmark test to a suite.
+
+  @param[in] Suite              The suite to add the test to.
+  @param[in] Description        The description of the test. It is copied.
+  @param[in] ClassName          The name of the test. It is copied.
+  @param[in] Func               The function measured, called once per iteration.
+  @param[in] PreReq             Called once before the warmup.
+  @param[in] CleanUp            Called once after the last iteration.
+  @param[in] Context            Passed to the functions of the test.
+  @param[in] Warmup             The number of untimed calls of Func.
+  @param[in] Iterations         The number of timed calls of Func.
+  @param[in] BytesPerIteration  The bytes processed by one call of Func, or 0
+                                if the throughput does not apply.
+
+  @retval EFI_SUCCESS            The test is added.
+  @retval EFI_INVALID_PARAMETER  A parameter is NULL, or Iterations is 0.
+  @retval EFI_OUT_OF_RESOURCES   There is no memory for the test.
+
+**/
+EFI_STATUS
+EFIAPI
+AddBenchmarkCase (
+  IN UNIT_TEST_SUITE      *Suite,
+  IN CHAR16               *Description,
+  IN CHAR16               *ClassName,
+  IN UNIT_TEST_FUNCTION   Func,
+  IN UNIT_TEST_PREREQ     PreReq    OPTIONAL,
+  IN UNIT_TEST_CLEANUP    CleanUp   OPTIONAL,
+  IN UNIT_TEST_CONTEXT    Context   OPTIONAL,
+  IN UINT32               Warmup,
+  IN UINT32               Iterations,
+  IN UINT64               BytesPerIteration
+  );
+
+#endif
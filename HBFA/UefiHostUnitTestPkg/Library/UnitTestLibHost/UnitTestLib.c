@@ -16,6 +16,8 @@ Copyright (c) Microsoft
 #include <Library/UnitTestLogLib.h>
 #include <Library/UnitTestPersistenceLib.h>
 #include <Library/UnitTestResultReportLib.h>
+#include <Library/UnitTestBenchmarkLib.h>
+#include <Library/OsServiceLib.h>
 
 #include "Md5.h"
 
@@ -31,6 +33,11 @@ FrameworkResetSystem (
   IN EFI_RESET_TYPE             ResetType
   );
 
+EFI_STATUS
+RunTestsInWorkers (
+  IN UNIT_TEST_FRAMEWORK        *Framework
+  );
+
 // Prototyped here so that it can be included near the functions that
 // it logically goes with.
 STATIC
@@ -445,12 +452,269 @@ Exit:
 }
 
 
+EFI_STATUS
+EFIAPI
+AddBenchmarkCase (
+  IN UNIT_TEST_SUITE      *Suite,
+  IN CHAR16               *Description,
+  IN CHAR16               *ClassName,
+  IN UNIT_TEST_FUNCTION   Func,
+  IN UNIT_TEST_PREREQ     PreReq    OPTIONAL,
+  IN UNIT_TEST_CLEANUP    CleanUp   OPTIONAL,
+  IN UNIT_TEST_CONTEXT    Context   OPTIONAL,
+  IN UINT32               Warmup,
+  IN UINT32               Iterations,
+  IN UINT64               BytesPerIteration
+  )
+{
+  EFI_STATUS            Status;
+  UNIT_TEST_BENCHMARK   *Benchmark;
+  UNIT_TEST_LIST_ENTRY  *NewTestEntry;
+
+  if (Suite == NULL || Iterations == 0)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Benchmark = AllocateZeroPool( sizeof( UNIT_TEST_BENCHMARK ) );
+  if (Benchmark == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Benchmark->Warmup             = Warmup;
+  Benchmark->Iterations         = Iterations;
+  Benchmark->BytesPerIteration  = BytesPerIteration;
+
+  Status = AddTestCase( Suite, Description, ClassName, Func, PreReq, CleanUp, Context );
+  if (EFI_ERROR( Status ))
+  {
+    FreePool( Benchmark );
+    return Status;
+  }
+
+  //
+  // AddTestCase() puts the new test at the tail of the suite.
+  NewTestEntry = (UNIT_TEST_LIST_ENTRY*)GetPreviousNode( &(Suite->TestCaseList), &(Suite->TestCaseList) );
+  NewTestEntry->UT.Benchmark = Benchmark;
+
+  return EFI_SUCCESS;
+}
+
+
 //=============================================================================
 //
 // ----------------  TEST EXECUTION FUNCTIONS ---------------------------------
 //
 //=============================================================================
 
+/**
+  Sort the call times of a benchmark in increasing order, with a heap sort.
+
+  @param[in, out] Samples  The call times.
+  @param[in]      Count    The number of call times.
+
+**/
+STATIC
+VOID
+SortBenchmarkSamples (
+  IN OUT UINT64   *Samples,
+  IN     UINT32   Count
+  )
+{
+  UINT32  Start;
+  UINT32  End;
+  UINT32  Root;
+  UINT32  Child;
+  UINT64  Sample;
+
+  //
+  // Build a max heap, then move its root behind the heap until it is empty.
+  for (Start = Count / 2, End = Count; End > 1;)
+  {
+    if (Start > 0)
+    {
+      Start--;
+    }
+    else
+    {
+      End--;
+      Sample        = Samples[End];
+      Samples[End]  = Samples[0];
+      Samples[0]    = Sample;
+    }
+
+    for (Root = Start; (Child = 2 * Root + 1) < End; Root = Child)
+    {
+      if (Child + 1 < End && Samples[Child + 1] > Samples[Child])
+      {
+        Child++;
+      }
+      if (Samples[Root] >= Samples[Child])
+      {
+        break;
+      }
+      Sample          = Samples[Root];
+      Samples[Root]   = Samples[Child];
+      Samples[Child]  = Sample;
+    }
+  }
+}
+
+/**
+  Call the function of a benchmark test Warmup times, then time Iterations
+  calls and record the statistics in the Benchmark of the test.
+
+  @param[in]      Suite  The suite of the test.
+  @param[in, out] Test   The benchmark test.
+
+  @return The result of the first call that does not pass, or UNIT_TEST_PASSED.
+
+**/
+STATIC
+UNIT_TEST_STATUS
+RunBenchmark (
+  IN     UNIT_TEST_SUITE  *Suite,
+  IN OUT UNIT_TEST        *Test
+  )
+{
+  UNIT_TEST_BENCHMARK   *Benchmark = Test->Benchmark;
+  UNIT_TEST_STATUS      Result;
+  UINT64                *Samples;
+  UINT64                Start;
+  UINT32                Index;
+
+  for (Index = 0; Index < Benchmark->Warmup; Index++)
+  {
+    Result = Test->RunTest( Suite->ParentFramework, Test->Context );
+    if (Result != UNIT_TEST_PASSED)
+    {
+      return Result;
+    }
+  }
+
+  Samples = AllocatePool( Benchmark->Iterations * sizeof( UINT64 ) );
+  if (Samples == NULL)
+  {
+    Test->FailureType = FAILURETYPE_OTHER;
+    StrCpyS( &Test->FailureMessage[0], UNIT_TEST_TESTFAILUREMSG_LENGTH, L"No memory for the benchmark samples" );
+    return UNIT_TEST_ERROR_TEST_FAILED;
+  }
+
+  for (Index = 0; Index < Benchmark->Iterations; Index++)
+  {
+    Start   = GetMonotonicTimeInNanoSecond();
+    Result  = Test->RunTest( Suite->ParentFramework, Test->Context );
+    Samples[Index] = GetMonotonicTimeInNanoSecond() - Start;
+    if (Result != UNIT_TEST_PASSED)
+    {
+      FreePool( Samples );
+      return Result;
+    }
+  }
+
+  //
+  // Nearest rank percentiles of the call times.
+  SortBenchmarkSamples( Samples, Benchmark->Iterations );
+  Benchmark->MinNs    = Samples[0];
+  Benchmark->MedianNs = Samples[(Benchmark->Iterations - 1) / 2];
+  Benchmark->P99Ns    = Samples[(UINT32)DivU64x32( MultU64x32( Benchmark->Iterations, 99 ) + 99, 100 ) - 1];
+  FreePool( Samples );
+
+  Benchmark->BytesPerSecond = 0;
+  if (Benchmark->BytesPerIteration != 0)
+  {
+    Benchmark->BytesPerSecond = DivU64x64Remainder( MultU64x32( Benchmark->BytesPerIteration, 1000000000 ), MAX( Benchmark->MedianNs, 1 ), NULL );
+  }
+
+  UnitTestLog(
+    Suite->ParentFramework,
+    DEBUG_INFO,
+    "%d iterations: min %ld ns, median %ld ns, p99 %ld ns, %ld bytes/s\n",
+    Benchmark->Iterations,
+    Benchmark->MinNs,
+    Benchmark->MedianNs,
+    Benchmark->P99Ns,
+    Benchmark->BytesPerSecond
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Run one test of a suite whose Setup has been called.
+
+  Also called by the worker processes of RunTestsInWorkers().
+
+  @param[in]      Suite  The suite of the test.
+  @param[in, out] Test   The test. Its Result is updated.
+
+**/
+VOID
+RunTestInSuite (
+  IN     UNIT_TEST_SUITE  *Suite,
+  IN OUT UNIT_TEST        *Test
+  )
+{
+  UNIT_TEST_FRAMEWORK   *ParentFramework = (UNIT_TEST_FRAMEWORK*)Suite->ParentFramework;
+
+  ParentFramework->CurrentTest  = Test;
+
+  DEBUG((DEBUG_VERBOSE, "*********************************************************\n"));
+  DEBUG((DEBUG_VERBOSE, " RUNNING TEST: %s:\n", Test->Description));
+  DEBUG((DEBUG_VERBOSE, "**********************************************************\n"));
+
+  //
+  // First, check to see whether the test has already been run.
+  // NOTE: This would generally only be the case if a saved state was detected and loaded.
+  if (Test->Result != UNIT_TEST_PENDING && Test->Result != UNIT_TEST_RUNNING)
+  {
+    DEBUG(( DEBUG_VERBOSE, "Test was run on a previous pass. Skipping.\n" ));
+    ParentFramework->CurrentTest  = NULL;
+    return;
+  }
+
+  //
+  // Next, if we're still running, make sure that our test prerequisites are in place.
+  if (Test->Result == UNIT_TEST_PENDING && Test->PreReq != NULL)
+  {
+    DEBUG(( DEBUG_VERBOSE, "PREREQ\n" ));
+    if (Test->PreReq( Suite->ParentFramework, Test->Context ) != UNIT_TEST_PASSED)
+    {
+      DEBUG(( DEBUG_ERROR, "PreReq Not Met\n" ));
+      Test->Result = UNIT_TEST_ERROR_PREREQ_NOT_MET;
+      ParentFramework->CurrentTest  = NULL;
+      return;
+    }
+  }
+
+  //
+  // Now we should be ready to call the actual test.
+  // We set the status to UNIT_TEST_RUNNING in case the test needs to reboot
+  // or quit. The UNIT_TEST_RUNNING state will allow the test to resume
+  // but will prevent the PreReq from being dispatched a second time.
+  Test->Result = UNIT_TEST_RUNNING;
+  if (Test->Benchmark != NULL)
+  {
+    Test->Result = RunBenchmark( Suite, Test );
+  }
+  else
+  {
+    Test->Result = Test->RunTest( Suite->ParentFramework, Test->Context );
+  }
+
+  //
+  // Finally, clean everything up, if need be.
+  if (Test->CleanUp != NULL)
+  {
+    DEBUG(( DEBUG_VERBOSE, "CLEANUP\n" ));
+    Test->CleanUp( Suite->ParentFramework, Test->Context );
+  }
+
+  //
+  // End the test.
+  ParentFramework->CurrentTest  = NULL;
+}
+
 STATIC
 EFI_STATUS
 RunTestSuite (
@@ -458,8 +722,6 @@ RunTestSuite (
   )
 {
   UNIT_TEST_LIST_ENTRY  *TestEntry = NULL;
-  UNIT_TEST             *Test;
-  UNIT_TEST_FRAMEWORK   *ParentFramework = (UNIT_TEST_FRAMEWORK*)Suite->ParentFramework;
 
   if (Suite == NULL)
   {
@@ -482,65 +744,45 @@ RunTestSuite (
        (LIST_ENTRY*)TestEntry != &(Suite->TestCaseList);                                                  // Go until you loop back to the head.
        TestEntry = (UNIT_TEST_LIST_ENTRY*)GetNextNode( &(Suite->TestCaseList), (LIST_ENTRY*)TestEntry) )  // Always get the next test.
   {
-    Test                          = &TestEntry->UT;
-    ParentFramework->CurrentTest  = Test;
+    RunTestInSuite( Suite, &TestEntry->UT );
+  } // End Test iteration
 
-    DEBUG((DEBUG_VERBOSE, "*********************************************************\n"));
-    DEBUG((DEBUG_VERBOSE, " RUNNING TEST: %s:\n", Test->Description));
-    DEBUG((DEBUG_VERBOSE, "**********************************************************\n"));
 
-    //
-    // First, check to see whether the test has already been run.
-    // NOTE: This would generally only be the case if a saved state was detected and loaded.
-    if (Test->Result != UNIT_TEST_PENDING && Test->Result != UNIT_TEST_RUNNING)
-    {
-      DEBUG(( DEBUG_VERBOSE, "Test was run on a previous pass. Skipping.\n" ));
-      ParentFramework->CurrentTest  = NULL;
-      continue;
-    }
+  if (Suite->Teardown != NULL)
+  {
+    Suite->Teardown( Suite->ParentFramework );
+  }
 
-    //
-    // Next, if we're still running, make sure that our test prerequisites are in place.
-    if (Test->Result == UNIT_TEST_PENDING && Test->PreReq != NULL)
-    {
-      DEBUG(( DEBUG_VERBOSE, "PREREQ\n" ));
-      if (Test->PreReq( Suite->ParentFramework, Test->Context ) != UNIT_TEST_PASSED)
-      {
-        DEBUG(( DEBUG_ERROR, "PreReq Not Met\n" ));
-        Test->Result = UNIT_TEST_ERROR_PREREQ_NOT_MET;
-        ParentFramework->CurrentTest  = NULL;
-        continue;
-      }
-    }
+  return EFI_SUCCESS;
+}
 
-    //
-    // Now we should be ready to call the actual test.
-    // We set the status to UNIT_TEST_RUNNING in case the test needs to reboot
-    // or quit. The UNIT_TEST_RUNNING state will allow the test to resume
-    // but will prevent the PreReq from being dispatched a second time.
-    Test->Result = UNIT_TEST_RUNNING;
-    Test->Result = Test->RunTest( Suite->ParentFramework, Test->Context );
+/**
+  Check whether a suite has tests that have not run.
 
-    //
-    // Finally, clean everything up, if need be.
-    if (Test->CleanUp != NULL)
-    {
-      DEBUG(( DEBUG_VERBOSE, "CLEANUP\n" ));
-      Test->CleanUp( Suite->ParentFramework, Test->Context );
-    }
+  @param[in]  Suite  The suite.
 
-    //
-    // End the test.
-    ParentFramework->CurrentTest  = NULL;
-  } // End Test iteration
+  @retval TRUE   Some tests of the suite are pending.
+  @retval FALSE  All the tests of the suite have run.
 
+**/
+STATIC
+BOOLEAN
+HasPendingTests (
+  IN UNIT_TEST_SUITE      *Suite
+  )
+{
+  UNIT_TEST_LIST_ENTRY  *TestEntry = NULL;
 
-  if (Suite->Teardown != NULL)
+  for (TestEntry = (UNIT_TEST_LIST_ENTRY*)GetFirstNode( &(Suite->TestCaseList) );
+       (LIST_ENTRY*)TestEntry != &(Suite->TestCaseList);
+       TestEntry = (UNIT_TEST_LIST_ENTRY*)GetNextNode( &(Suite->TestCaseList), (LIST_ENTRY*)TestEntry) )
   {
-    Suite->Teardown( Suite->ParentFramework );
+    if (TestEntry->UT.Result == UNIT_TEST_PENDING || TestEntry->UT.Result == UNIT_TEST_RUNNING)
+    {
+      return TRUE;
+    }
   }
-
-  return EFI_SUCCESS;
+  return FALSE;
 }
 
 EFI_STATUS
@@ -562,18 +804,38 @@ RunAllTestSuites(
   DEBUG((DEBUG_VERBOSE, "---------------------------------------------------------\n"));
 
   //
-  // Iterate all suites
+  // Run the tests in worker processes if the host is asked to.
+  // If they cannot be used, the suites with pending tests are run here.
   //
-  for (Suite = (UNIT_TEST_SUITE_LIST_ENTRY*)GetFirstNode(&Framework->TestSuiteList);
-    (LIST_ENTRY*)Suite != &Framework->TestSuiteList;
-    Suite = (UNIT_TEST_SUITE_LIST_ENTRY*)GetNextNode(&Framework->TestSuiteList, (LIST_ENTRY*)Suite))
+  Status = RunTestsInWorkers(Framework);
+  if (EFI_ERROR(Status) && Status != EFI_UNSUPPORTED)
+  {
+    DEBUG((DEBUG_ERROR, "Test Workers Failed with Error.  %r\n", Status));
+  }
+
+  if (EFI_ERROR(Status))
   {
-    Status = RunTestSuite(&(Suite->UTS));
-    if (EFI_ERROR(Status))
+    //
+    // Iterate all suites
+    //
+    for (Suite = (UNIT_TEST_SUITE_LIST_ENTRY*)GetFirstNode(&Framework->TestSuiteList);
+      (LIST_ENTRY*)Suite != &Framework->TestSuiteList;
+      Suite = (UNIT_TEST_SUITE_LIST_ENTRY*)GetNextNode(&Framework->TestSuiteList, (LIST_ENTRY*)Suite))
     {
-      DEBUG((DEBUG_ERROR, "Test Suite Failed with Error.  %r\n", Status));
-    }
-  } // End Suite iteration
+      //
+      // Skip the suites the workers have run, and their Setup and Teardown.
+      //
+      if (!HasPendingTests(&(Suite->UTS)))
+      {
+        continue;
+      }
+      Status = RunTestSuite(&(Suite->UTS));
+      if (EFI_ERROR(Status))
+      {
+        DEBUG((DEBUG_ERROR, "Test Suite Failed with Error.  %r\n", Status));
+      }
+    } // End Suite iteration
+  }
 
   //Save current state so if test is started again it doesn't have to run.  It will just report
   SaveFrameworkState(Framework, NULL, 0);
@@ -0,0 +1,711 @@
+/** @file
+  Run the tests of a unit test framework in forked worker processes.
+
+  When the UNIT_TEST_JOBS_ENV environment variable is set to a number above
+  one, RunAllTestSuites() forks that many workers once all the suites are
+  created. The parent hands the suites with pending tests out in order, one at
+  a time, to the idle workers. A worker calls the Setup of the suite, runs its
+  tests in order and calls its Teardown, like a serial run, and sends the
+  result, the failure and the log of every test back over a pipe. The parent
+  copies them to the framework, so the saved state and the report are the same
+  as for a serial run.
+
+  A test that crashes or exits its worker fails with FAILURETYPE_OTHER, and the
+  tests after it in its suite run in a new worker, after the Setup of the suite.
+  So does a test whose worker sends nothing for UNIT_TEST_TIMEOUT_ENV seconds,
+  600 by default or no limit for 0: the worker is killed. Suites run in
+  parallel, so suites that share state must be run serially.
+
+  Workers leave with exit(), so a module built with coverage writes the
+  coverage counts of every worker. A worker that crashes in a test, or exits
+  with _exit(), loses the counts of the suite it was running.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <Uefi.h>
+#include <UnitTestTypes.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLogLib.h>
+
+//
+// Number of worker processes running the tests.
+//
+#define UNIT_TEST_JOBS_ENV  "HBFA_UNIT_TEST_JOBS"
+#define UNIT_TEST_MAX_JOBS  256
+
+//
+// Seconds a worker may take to send the result of a test.
+//
+#define UNIT_TEST_TIMEOUT_ENV      "HBFA_UNIT_TEST_TIMEOUT"
+#define UNIT_TEST_DEFAULT_TIMEOUT  600
+
+#define UNIT_TEST_NO_TEST   MAX_UINT32
+
+//
+// Sent by a worker for every test, followed by LogSize bytes of log.
+//
+typedef struct {
+  UINT32               Index;
+  UNIT_TEST_STATUS     Result;
+  FAILURE_TYPE         FailureType;
+  UINT32               LogSize;
+  CHAR16               FailureMessage[UNIT_TEST_TESTFAILUREMSG_LENGTH];
+  UNIT_TEST_BENCHMARK  Benchmark;
+} UNIT_TEST_WORKER_RESULT;
+
+typedef struct {
+  pid_t             Pid;
+  int               Command;    // Write end of the pipe of suites.
+  int               Result;     // Read end of the pipe of results.
+  UINT32            Suite;      // Suite being run, or UNIT_TEST_NO_TEST.
+  UINT32            Test;       // Test whose result is next.
+  UINT32            End;        // End of the tests of the suite given out.
+  UINT64            Deadline;   // Time in ms the next result is due by, 0 for none.
+} UNIT_TEST_WORKER;
+
+//
+// The pending tests of a suite are Tests[Next] to Tests[End - 1].
+//
+typedef struct {
+  UINT32            Next;
+  UINT32            End;
+  BOOLEAN           Running;
+} UNIT_TEST_WORKER_SUITE;
+
+VOID
+RunTestInSuite (
+  IN     UNIT_TEST_SUITE  *Suite,
+  IN OUT UNIT_TEST        *Test
+  );
+
+STATIC
+BOOLEAN
+ReadPipe (
+  IN  int    Fd,
+  OUT VOID   *Buffer,
+  IN  UINTN  Size
+  )
+{
+  ssize_t  Count;
+
+  while (Size > 0) {
+    Count = read (Fd, Buffer, Size);
+    if (Count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (Count <= 0) {
+      return FALSE;
+    }
+    Buffer = (UINT8 *)Buffer + Count;
+    Size  -= Count;
+  }
+  return TRUE;
+}
+
+STATIC
+BOOLEAN
+WritePipe (
+  IN int         Fd,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Size
+  )
+{
+  ssize_t  Count;
+
+  while (Size > 0) {
+    Count = write (Fd, Buffer, Size);
+    if (Count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (Count <= 0) {
+      return FALSE;
+    }
+    Buffer = (CONST UINT8 *)Buffer + Count;
+    Size  -= Count;
+  }
+  return TRUE;
+}
+
+/**
+  Return the time of the monotonic clock in milliseconds.
+**/
+STATIC
+UINT64
+GetTimeInMs (
+  VOID
+  )
+{
+  struct timespec  Now;
+
+  clock_gettime (CLOCK_MONOTONIC, &Now);
+  return (UINT64)Now.tv_sec * 1000 + Now.tv_nsec / 1000000;
+}
+
+/**
+  Run the suites the parent sends until it closes the command pipe.
+
+  The parent sends the first and the end index of the tests of a suite. The
+  worker calls the Setup of the suite, sends the result of every test, calls
+  the Teardown and sends the end index back.
+**/
+STATIC
+VOID
+RunWorker (
+  IN UNIT_TEST  **Tests,
+  IN UINT32     TestCount,
+  IN int        Command,
+  IN int        Result
+  )
+{
+  UNIT_TEST_SUITE          *Suite;
+  UNIT_TEST                *Test;
+  UNIT_TEST_WORKER_RESULT  Record;
+  UINT32                   Range[2];
+  UINT32                   Index;
+
+  while (ReadPipe (Command, Range, sizeof (Range)) && Range[0] < Range[1] && Range[1] <= TestCount) {
+    Suite = Tests[Range[0]]->ParentSuite;
+    if (Suite->Setup != NULL) {
+      Suite->Setup (Suite->ParentFramework);
+    }
+
+    for (Index = Range[0]; Index < Range[1]; Index++) {
+      Test = Tests[Index];
+      RunTestInSuite (Suite, Test);
+
+      ZeroMem (&Record, sizeof (Record));
+      Record.Index       = Index;
+      Record.Result      = Test->Result;
+      Record.FailureType = Test->FailureType;
+      CopyMem (Record.FailureMessage, Test->FailureMessage, sizeof (Record.FailureMessage));
+      if (Test->Log != NULL) {
+        Record.LogSize = (UINT32)((StrLen (Test->Log) + 1) * sizeof (CHAR16));
+      }
+      if (Test->Benchmark != NULL) {
+        CopyMem (&Record.Benchmark, Test->Benchmark, sizeof (Record.Benchmark));
+      }
+      if (!WritePipe (Result, &Record, sizeof (Record)) ||
+          !WritePipe (Result, Test->Log, Record.LogSize)) {
+        break;
+      }
+    }
+
+    if (Suite->Teardown != NULL) {
+      Suite->Teardown (Suite->ParentFramework);
+    }
+    if (Index < Range[1] || !WritePipe (Result, &Range[1], sizeof (Range[1]))) {
+      break;
+    }
+  }
+
+  //
+  // exit() and not _exit(), so a module built with coverage writes the counts
+  // of the worker. libgcov resets them in fork(), and merges them with the
+  // counts of the parent and of the other workers.
+  //
+  exit (0);
+}
+
+/**
+  Fork a worker. The worker never returns from this function.
+
+  @retval TRUE   The worker is running.
+  @retval FALSE  The pipes or the process cannot be created.
+**/
+STATIC
+BOOLEAN
+StartWorker (
+  IN     UNIT_TEST         **Tests,
+  IN     UINT32            TestCount,
+  IN OUT UNIT_TEST_WORKER  *Workers,
+  IN     UINTN             WorkerCount,
+  IN OUT UNIT_TEST_WORKER  *Worker
+  )
+{
+  int    CommandPipe[2];
+  int    ResultPipe[2];
+  UINTN  Index;
+
+  if (pipe (CommandPipe) != 0) {
+    return FALSE;
+  }
+  if (pipe (ResultPipe) != 0) {
+    close (CommandPipe[0]);
+    close (CommandPipe[1]);
+    return FALSE;
+  }
+
+  //
+  // Output buffered so far must not be written again by the worker.
+  //
+  fflush (NULL);
+  Worker->Pid = fork ();
+  if (Worker->Pid == 0) {
+    //
+    // Drop the parent ends of the pipes of the other workers, so they see
+    // the end of their command pipe when the parent closes it.
+    //
+    for (Index = 0; Index < WorkerCount; Index++) {
+      if (&Workers[Index] != Worker && Workers[Index].Pid > 0) {
+        close (Workers[Index].Command);
+        close (Workers[Index].Result);
+      }
+    }
+    close (CommandPipe[1]);
+    close (ResultPipe[0]);
+    signal (SIGPIPE, SIG_DFL);
+    RunWorker (Tests, TestCount, CommandPipe[0], ResultPipe[1]);
+  }
+
+  close (CommandPipe[0]);
+  close (ResultPipe[1]);
+  if (Worker->Pid < 0) {
+    close (CommandPipe[1]);
+    close (ResultPipe[0]);
+    return FALSE;
+  }
+  Worker->Command = CommandPipe[1];
+  Worker->Result  = ResultPipe[0];
+  Worker->Suite   = UNIT_TEST_NO_TEST;
+  return TRUE;
+}
+
+/**
+  Close the pipes of a worker and wait for it to exit.
+
+  @return The wait status of the worker.
+**/
+STATIC
+int
+StopWorker (
+  IN OUT UNIT_TEST_WORKER  *Worker
+  )
+{
+  int  WaitStatus;
+
+  close (Worker->Command);
+  close (Worker->Result);
+  WaitStatus = 0;
+  while (waitpid (Worker->Pid, &WaitStatus, 0) < 0 && errno == EINTR) {
+  }
+  Worker->Pid = 0;
+  return WaitStatus;
+}
+
+/**
+  Copy the result a worker sends for its test to the framework.
+
+  @retval TRUE   The result is copied.
+  @retval FALSE  The worker died before sending all of it.
+**/
+STATIC
+BOOLEAN
+ReceiveResult (
+  IN     UNIT_TEST_WORKER  *Worker,
+  IN OUT UNIT_TEST         *Test
+  )
+{
+  UNIT_TEST_WORKER_RESULT  Record;
+  UINT8                    *Log;
+  BOOLEAN                  Received;
+
+  if (!ReadPipe (Worker->Result, &Record, sizeof (Record)) ||
+      Record.Index != Worker->Test) {
+    return FALSE;
+  }
+
+  Log = NULL;
+  if (Record.LogSize > 0) {
+    Log = AllocatePool (Record.LogSize);
+    if (Log == NULL) {
+      return FALSE;
+    }
+  }
+  Received = ReadPipe (Worker->Result, Log, Record.LogSize);
+  if (Received) {
+    Test->Result      = Record.Result;
+    Test->FailureType = Record.FailureType;
+    CopyMem (Test->FailureMessage, Record.FailureMessage, sizeof (Test->FailureMessage));
+    Test->FailureMessage[UNIT_TEST_TESTFAILUREMSG_LENGTH - 1] = L'\0';
+    if (Log != NULL) {
+      UnitTestLogInit (Test, Log, Record.LogSize);
+    }
+    if (Test->Benchmark != NULL) {
+      CopyMem (Test->Benchmark, &Record.Benchmark, sizeof (Record.Benchmark));
+    }
+  }
+  if (Log != NULL) {
+    FreePool (Log);
+  }
+  return Received;
+}
+
+/**
+  Fail the test a worker was running when it died.
+**/
+STATIC
+VOID
+FailCrashedTest (
+  IN OUT UNIT_TEST  *Test,
+  IN     int        WaitStatus
+  )
+{
+  if (WIFSIGNALED (WaitStatus)) {
+    UnicodeSPrint (
+      Test->FailureMessage,
+      sizeof (Test->FailureMessage),
+      L"Test worker killed by signal %d",
+      WTERMSIG (WaitStatus)
+      );
+  } else {
+    UnicodeSPrint (
+      Test->FailureMessage,
+      sizeof (Test->FailureMessage),
+      L"Test worker exited with status %d",
+      WEXITSTATUS (WaitStatus)
+      );
+  }
+  DEBUG ((DEBUG_ERROR, "%s: %s\n", Test->Description, Test->FailureMessage));
+  Test->Result      = UNIT_TEST_ERROR_TEST_FAILED;
+  Test->FailureType = FAILURETYPE_OTHER;
+}
+
+/**
+  Fail the test a worker was running when it was killed for taking too long.
+**/
+STATIC
+VOID
+FailHungTest (
+  IN OUT UNIT_TEST  *Test,
+  IN     UINTN      Timeout
+  )
+{
+  UnicodeSPrint (
+    Test->FailureMessage,
+    sizeof (Test->FailureMessage),
+    L"Test timed out after %d seconds",
+    (UINT32)Timeout
+    );
+  DEBUG ((DEBUG_ERROR, "%s: %s\n", Test->Description, Test->FailureMessage));
+  Test->Result      = UNIT_TEST_ERROR_TEST_FAILED;
+  Test->FailureType = FAILURETYPE_OTHER;
+}
+
+/**
+  Find a suite with pending tests that no worker is running.
+
+  @return The index of the suite, or UNIT_TEST_NO_TEST.
+**/
+STATIC
+UINT32
+FindPendingSuite (
+  IN UNIT_TEST_WORKER_SUITE  *Suites,
+  IN UINT32                  SuiteCount
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < SuiteCount; Index++) {
+    if (!Suites[Index].Running && Suites[Index].Next < Suites[Index].End) {
+      return Index;
+    }
+  }
+  return UNIT_TEST_NO_TEST;
+}
+
+/**
+  Run the pending tests of a framework in UNIT_TEST_JOBS_ENV worker processes.
+
+  @param[in]  Framework  The framework, with all its suites created.
+
+  @retval EFI_SUCCESS           All the pending tests were run.
+  @retval EFI_UNSUPPORTED       Workers are not asked for. No test was run.
+  @retval EFI_OUT_OF_RESOURCES  No worker can be started. The tests that are
+                                still pending must be run by the caller.
+**/
+EFI_STATUS
+RunTestsInWorkers (
+  IN UNIT_TEST_FRAMEWORK  *Framework
+  )
+{
+  CONST CHAR8             *Jobs;
+  CONST CHAR8             *TimeoutValue;
+  UINTN                   WorkerCount;
+  UINTN                   Timeout;
+  UINT64                  Now;
+  UINT64                  NextDeadline;
+  int                     PollTimeout;
+  UNIT_TEST_WORKER        *Workers;
+  UNIT_TEST_WORKER_SUITE  *Suites;
+  struct pollfd           *PollFds;
+  UNIT_TEST               **Tests;
+  UINT32                  TestCount;
+  UINT32                  SuiteCount;
+  UINT32                  PendingSuite;
+  UINT32                  Range[2];
+  UINT32                  End;
+  LIST_ENTRY              *Suite;
+  LIST_ENTRY              *Test;
+  LIST_ENTRY              *TestList;
+  UNIT_TEST               *UnitTest;
+  UNIT_TEST_WORKER        *Worker;
+  UINTN                   Index;
+  UINTN                   PollCount;
+  UINTN                   Running;
+  int                     WaitStatus;
+  void                    (*PreviousSigPipe) (int);
+  EFI_STATUS              Status;
+
+  Jobs = getenv (UNIT_TEST_JOBS_ENV);
+  if (Jobs == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  WorkerCount = AsciiStrDecimalToUintn (Jobs);
+  if (WorkerCount <= 1) {
+    return EFI_UNSUPPORTED;
+  }
+  WorkerCount = MIN (WorkerCount, UNIT_TEST_MAX_JOBS);
+
+  TimeoutValue = getenv (UNIT_TEST_TIMEOUT_ENV);
+  Timeout = UNIT_TEST_DEFAULT_TIMEOUT;
+  if (TimeoutValue != NULL) {
+    Timeout = AsciiStrDecimalToUintn (TimeoutValue);
+  }
+
+  //
+  // List the tests that have not run in a previous pass, by suite.
+  //
+  TestCount  = 0;
+  SuiteCount = 0;
+  for (Suite = GetFirstNode (&Framework->TestSuiteList); Suite != &Framework->TestSuiteList; Suite = GetNextNode (&Framework->TestSuiteList, Suite)) {
+    SuiteCount++;
+    TestList = &((UNIT_TEST_SUITE_LIST_ENTRY *)Suite)->UTS.TestCaseList;
+    for (Test = GetFirstNode (TestList); Test != TestList; Test = GetNextNode (TestList, Test)) {
+      UnitTest = &((UNIT_TEST_LIST_ENTRY *)Test)->UT;
+      if (UnitTest->Result == UNIT_TEST_PENDING || UnitTest->Result == UNIT_TEST_RUNNING) {
+        TestCount++;
+      }
+    }
+  }
+  if (TestCount == 0) {
+    return EFI_SUCCESS;
+  }
+  Tests  = AllocatePool (TestCount * sizeof (UNIT_TEST *));
+  Suites = AllocateZeroPool (SuiteCount * sizeof (UNIT_TEST_WORKER_SUITE));
+  if (Tests == NULL || Suites == NULL) {
+    Workers = NULL;
+    PollFds = NULL;
+    Status  = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+  TestCount  = 0;
+  SuiteCount = 0;
+  for (Suite = GetFirstNode (&Framework->TestSuiteList); Suite != &Framework->TestSuiteList; Suite = GetNextNode (&Framework->TestSuiteList, Suite)) {
+    Suites[SuiteCount].Next = TestCount;
+    TestList = &((UNIT_TEST_SUITE_LIST_ENTRY *)Suite)->UTS.TestCaseList;
+    for (Test = GetFirstNode (TestList); Test != TestList; Test = GetNextNode (TestList, Test)) {
+      UnitTest = &((UNIT_TEST_LIST_ENTRY *)Test)->UT;
+      if (UnitTest->Result == UNIT_TEST_PENDING || UnitTest->Result == UNIT_TEST_RUNNING) {
+        Tests[TestCount++] = UnitTest;
+      }
+    }
+    Suites[SuiteCount++].End = TestCount;
+  }
+  WorkerCount = MIN (WorkerCount, SuiteCount);
+
+  Workers = AllocateZeroPool (WorkerCount * sizeof (UNIT_TEST_WORKER));
+  PollFds = AllocateZeroPool (WorkerCount * sizeof (struct pollfd));
+  if (Workers == NULL || PollFds == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  DEBUG ((DEBUG_INFO, "Running %d tests of %d suites in %d workers\n", TestCount, SuiteCount, (UINT32)WorkerCount));
+
+  //
+  // A write to a worker that died fails instead of killing the parent.
+  //
+  PreviousSigPipe = signal (SIGPIPE, SIG_IGN);
+
+  Status = EFI_SUCCESS;
+  while (TRUE) {
+    //
+    // Start the workers that are missing and give every idle worker a suite.
+    //
+    Running = 0;
+    for (Index = 0; Index < WorkerCount; Index++) {
+      Worker       = &Workers[Index];
+      PendingSuite = FindPendingSuite (Suites, SuiteCount);
+      if (Worker->Pid == 0 && PendingSuite != UNIT_TEST_NO_TEST &&
+          !StartWorker (Tests, TestCount, Workers, WorkerCount, Worker)) {
+        DEBUG ((DEBUG_ERROR, "Failed to start a test worker\n"));
+        Worker->Pid = 0;
+      }
+      if (Worker->Pid == 0) {
+        continue;
+      }
+      if (Worker->Suite == UNIT_TEST_NO_TEST && PendingSuite != UNIT_TEST_NO_TEST) {
+        Suites[PendingSuite].Running = TRUE;
+        Worker->Suite = PendingSuite;
+        Worker->Test  = Suites[PendingSuite].Next;
+        Worker->End   = Suites[PendingSuite].End;
+        Range[0]      = Worker->Test;
+        Range[1]      = Worker->End;
+        if (Timeout != 0) {
+          Worker->Deadline = GetTimeInMs () + Timeout * 1000;
+        }
+        //
+        // If the worker is gone, reading its result fails below.
+        //
+        WritePipe (Worker->Command, Range, sizeof (Range));
+      }
+      if (Worker->Suite != UNIT_TEST_NO_TEST) {
+        Running++;
+      }
+    }
+    if (Running == 0) {
+      //
+      // Leave the tests that are not given out to the caller.
+      //
+      if (FindPendingSuite (Suites, SuiteCount) != UNIT_TEST_NO_TEST) {
+        Status = EFI_OUT_OF_RESOURCES;
+      }
+      break;
+    }
+
+    //
+    // Wait for results, until the first deadline.
+    //
+    PollCount    = 0;
+    NextDeadline = 0;
+    for (Index = 0; Index < WorkerCount; Index++) {
+      if (Workers[Index].Pid != 0 && Workers[Index].Suite != UNIT_TEST_NO_TEST) {
+        PollFds[PollCount].fd     = Workers[Index].Result;
+        PollFds[PollCount].events = POLLIN;
+        PollCount++;
+        if (Workers[Index].Deadline != 0 && (NextDeadline == 0 || Workers[Index].Deadline < NextDeadline)) {
+          NextDeadline = Workers[Index].Deadline;
+        }
+      }
+    }
+    PollTimeout = -1;
+    if (NextDeadline != 0) {
+      Now = GetTimeInMs ();
+      PollTimeout = (NextDeadline > Now) ? (int)MIN (NextDeadline - Now, MAX_INT32) : 0;
+    }
+    if (poll (PollFds, PollCount, PollTimeout) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      Status = EFI_DEVICE_ERROR;
+      break;
+    }
+
+    Now       = GetTimeInMs ();
+    PollCount = 0;
+    for (Index = 0; Index < WorkerCount; Index++) {
+      Worker = &Workers[Index];
+      if (Worker->Pid == 0 || Worker->Suite == UNIT_TEST_NO_TEST) {
+        continue;
+      }
+      if (PollFds[PollCount++].revents == 0) {
+        if (Worker->Deadline == 0 || Now < Worker->Deadline) {
+          continue;
+        }
+        //
+        // The worker hangs. The tests after the one it was running, if any,
+        // run in a new worker, after the Setup of their suite.
+        //
+        kill (Worker->Pid, SIGKILL);
+        StopWorker (Worker);
+        if (Worker->Test < Worker->End) {
+          FailHungTest (Tests[Worker->Test], Timeout);
+          Suites[Worker->Suite].Next = Worker->Test + 1;
+        } else {
+          DEBUG ((DEBUG_ERROR, "Test worker timed out in a suite Teardown\n"));
+        }
+        Suites[Worker->Suite].Running = FALSE;
+        Worker->Suite = UNIT_TEST_NO_TEST;
+        continue;
+      }
+
+      if (Worker->Test == Worker->End) {
+        //
+        // All the tests of the suite are done, the Teardown is next.
+        //
+        if (!ReadPipe (Worker->Result, &End, sizeof (End)) || End != Worker->End) {
+          DEBUG ((DEBUG_ERROR, "Test worker failed in a suite Teardown\n"));
+          StopWorker (Worker);
+        }
+        Suites[Worker->Suite].Running = FALSE;
+        Worker->Suite = UNIT_TEST_NO_TEST;
+        continue;
+      }
+
+      UnitTest = Tests[Worker->Test];
+      if (ReceiveResult (Worker, UnitTest)) {
+        Worker->Test++;
+        Suites[Worker->Suite].Next = Worker->Test;
+        if (Timeout != 0) {
+          Worker->Deadline = GetTimeInMs () + Timeout * 1000;
+        }
+        continue;
+      }
+
+      //
+      // The tests after the one that crashed run in a new worker, after
+      // the Setup of their suite.
+      //
+      WaitStatus = StopWorker (Worker);
+      FailCrashedTest (UnitTest, WaitStatus);
+      Suites[Worker->Suite].Next    = Worker->Test + 1;
+      Suites[Worker->Suite].Running = FALSE;
+      Worker->Suite = UNIT_TEST_NO_TEST;
+    }
+  }
+
+  //
+  // The workers exit once their command pipe is closed.
+  //
+  for (Index = 0; Index < WorkerCount; Index++) {
+    if (Workers[Index].Pid != 0) {
+      WaitStatus = StopWorker (&Workers[Index]);
+      if (!WIFEXITED (WaitStatus) || WEXITSTATUS (WaitStatus) != 0) {
+        DEBUG ((DEBUG_ERROR, "Test worker failed to exit\n"));
+      }
+    }
+  }
+  signal (SIGPIPE, PreviousSigPipe);
+
+Exit:
+  if (Workers != NULL) {
+    FreePool (Workers);
+  }
+  if (PollFds != NULL) {
+    FreePool (PollFds);
+  }
+  if (Suites != NULL) {
+    FreePool (Suites);
+  }
+  if (Tests != NULL) {
+    FreePool (Tests);
+  }
+  return Status;
+}
@@ -0,0 +1,37 @@
+/** @file
+  Worker processes are not supported on Windows hosts, so RunAllTestSuites()
+  runs all the tests in the test process.
+
+Copyright (c) 2019, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdlib.h>
+
+#include <Uefi.h>
+#include <UnitTestTypes.h>
+#include <Library/DebugLib.h>
+
+//
+// Number of worker processes running the tests.
+//
+#define UNIT_TEST_JOBS_ENV  "HBFA_UNIT_TEST_JOBS"
+
+/**
+  Run the pending tests of a framework in UNIT_TEST_JOBS_ENV worker processes.
+
+  @param[in]  Framework  The framework, with all its suites created.
+
+  @retval EFI_UNSUPPORTED  Always. No test was run.
+**/
+EFI_STATUS
+RunTestsInWorkers (
+  IN UNIT_TEST_FRAMEWORK  *Framework
+  )
+{
+  if (getenv (UNIT_TEST_JOBS_ENV) != NULL) {
+    DEBUG ((DEBUG_INFO, "%a is not supported on this host, running the tests serially\n", UNIT_TEST_JOBS_ENV));
+  }
+  return EFI_UNSUPPORTED;
+}
@@ -19,6 +19,7 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DebugLib.h>
 #include <Library/OsServiceLib.h>
+#include <Library/UnitTestBenchmarkLib.h>
 
 #define MAX_STRING_SIZE  1025
 
@@ -419,6 +420,33 @@ Exit:
   return Status;
 }
 
+/**
+  cmocka has no benchmark, so a benchmark test runs as a test: its function
+  is called once and not timed.
+**/
+EFI_STATUS
+EFIAPI
+AddBenchmarkCase (
+  IN UNIT_TEST_SUITE      *Suite,
+  IN CHAR16               *Description,
+  IN CHAR16               *ClassName,
+  IN UNIT_TEST_FUNCTION   Func,
+  IN UNIT_TEST_PREREQ     PreReq    OPTIONAL,
+  IN UNIT_TEST_CLEANUP    CleanUp   OPTIONAL,
+  IN UNIT_TEST_CONTEXT    Context   OPTIONAL,
+  IN UINT32               Warmup,
+  IN UINT32               Iterations,
+  IN UINT64               BytesPerIteration
+  )
+{
+  if (Iterations == 0)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return AddTestCase( Suite, Description, ClassName, Func, PreReq, CleanUp, Context );
+}
+
 
 //=============================================================================
 //
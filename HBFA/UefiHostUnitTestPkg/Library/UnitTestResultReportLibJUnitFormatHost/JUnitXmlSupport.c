@@ -93,7 +93,7 @@ New_TestSuiteNodeInList(
 
 
   //Create the testsuite node with no parent
-  Status = AddNode(NULL, TESTSUITE_ELEMENT_NAME, NULL, &NewSuiteNode);
+  Status = CreateNodeForTree(RootNode, TESTSUITE_ELEMENT_NAME, NULL, &NewSuiteNode);
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "%a - AddNode for test suite Failed.  Status %r\n", __FUNCTION__, Status));
@@ -181,7 +181,7 @@ New_TestCaseInSuite(
 
 
   //Create the tesetCase node with no parent
-  Status = AddNode(NULL, TESTCASE_ELEMENT_NAME, NULL, &NewTestNode);
+  Status = CreateNodeForTree(TestSuite, TESTCASE_ELEMENT_NAME, NULL, &NewTestNode);
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "%a - AddNode for test case Failed.  Status %r\n", __FUNCTION__, Status));
@@ -302,7 +302,7 @@ New_FailureForTestCase(
 
 
   //Create the failure node with no parent
-  Status = AddNode(NULL, TESTCASE_FAILURE_ELEMENT_NAME, NULL, &NewFailureNode);
+  Status = CreateNodeForTree(TestCase, TESTCASE_FAILURE_ELEMENT_NAME, NULL, &NewFailureNode);
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "%a - AddNode for failure node Failed.  Status %r\n", __FUNCTION__, Status));
@@ -341,6 +341,92 @@ ERROR_EXIT:
 }
 
 
+/**
+Creates a new XmlNode for the properties of a Test case, with a property
+element for each name and value, and adds it to the test case
+
+Return NULL if error occurs. Otherwise return a pointer to the properties Node.
+**/
+XmlNode *
+EFIAPI
+New_PropertiesForTestCase(
+  IN CONST  XmlNode*  TestCase,
+  IN CONST  CHAR8**     Names,
+  IN CONST  UINT64*     Values,
+  IN        UINTN       Count
+)
+{
+  XmlNode* PropertiesNode = NULL;
+  XmlNode* PropertyNode = NULL;
+  EFI_STATUS Status;
+  CHAR8  IntString[30];
+  UINTN  Index;
+
+  //1 - confirm good TestCase node
+  if (TestCase == NULL)
+  {
+    DEBUG((DEBUG_ERROR, "%a - TestCase is NULL\n", __FUNCTION__));
+    return NULL;
+  }
+
+  if (AsciiStrnCmp(TestCase->Name, TESTCASE_ELEMENT_NAME, sizeof(TESTCASE_ELEMENT_NAME)) != 0)
+  {
+    DEBUG((DEBUG_ERROR, "%a - TestCase is not a testcase\n", __FUNCTION__));
+    return NULL;
+  }
+  //TestCase Node is good. 
+
+  //Create the properties node with no parent
+  Status = CreateNodeForTree(TestCase, TESTCASE_PROPERTIES_ELEMENT_NAME, NULL, &PropertiesNode);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "%a - AddNode for properties node Failed.  Status %r\n", __FUNCTION__, Status));
+    goto ERROR_EXIT;
+  }
+
+  for (Index = 0; Index < Count; Index++)
+  {
+    Status = AddNode(PropertiesNode, TESTCASE_PROPERTY_ELEMENT_NAME, NULL, &PropertyNode);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "%a - AddNode for property element failed.  Status = %r\n", __FUNCTION__, Status));
+      goto ERROR_EXIT;
+    }
+
+    //Create the name attribute
+    Status = AddAttributeToNode(PropertyNode, "name", Names[Index]);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "%a - AddAttribute for name Failed.  Status %r\n", __FUNCTION__, Status));
+      goto ERROR_EXIT;
+    }
+
+    //Create the value attribute
+    //Convert the unsigned 64 bit value to string
+    AsciiSPrint(IntString, sizeof(IntString), "%lu", Values[Index]);
+    Status = AddAttributeToNode(PropertyNode, "value", IntString);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "%a - AddAttribute for value Failed.  Status %r\n", __FUNCTION__, Status));
+      goto ERROR_EXIT;
+    }
+  }
+
+  // Add the properties to the end of the testcase children
+  Status = AddChildTree((XmlNode*)TestCase, PropertiesNode);
+  if (EFI_ERROR(Status))
+  {
+    DEBUG((DEBUG_ERROR, "%a - Can't add new properties to test case.  Status %r\n", __FUNCTION__, Status));
+    goto ERROR_EXIT;
+  }
+
+  return PropertiesNode;
+
+ERROR_EXIT:
+  if (PropertiesNode != NULL) { FreeXmlTree(&PropertiesNode); }
+  return NULL;
+}
+
 
 EFI_STATUS
 EFIAPI
@@ -97,6 +97,8 @@ http://help.catchsoftware.com/display/ET/JUnit+Format
 #define TESTCASE_FAILURE_ELEMENT_NAME "failure"
 #define TESTCASE_LOG_ELEMENT_NAME "system-out"
 #define TESTCASE_SKIPPED_ELEMENT_NAME "skipped"
+#define TESTCASE_PROPERTIES_ELEMENT_NAME "properties"
+#define TESTCASE_PROPERTY_ELEMENT_NAME "property"
 
 
 /**
@@ -167,6 +169,21 @@ New_FailureForTestCase(
   IN CONST  CHAR8*      Type OPTIONAL
 );
 
+/**
+Creates a new XmlNode for the properties of a Test case, with a property
+element for each name and value, and adds it to the test case
+
+Return NULL if error occurs. Otherwise return a pointer to the properties Node.
+**/
+XmlNode *
+EFIAPI
+New_PropertiesForTestCase(
+  IN CONST  XmlNode*  TestCase,
+  IN CONST  CHAR8**     Names,
+  IN CONST  UINT64*     Values,
+  IN        UINTN       Count
+);
+
 EFI_STATUS
 EFIAPI
 AddTestSuiteStats(
@@ -67,6 +67,49 @@ GetStringForFailureType(
   return Result;
 }
 
+/**
+  Add the timings of a benchmark test to its test case, as properties.
+**/
+STATIC
+VOID
+AddBenchmarkProperties(
+  IN XmlNode              *TestNode,
+  IN UNIT_TEST_BENCHMARK  *Benchmark
+)
+{
+  CONST CHAR8 *Names[] = {
+    "benchmark.warmup",
+    "benchmark.iterations",
+    "benchmark.min_ns",
+    "benchmark.median_ns",
+    "benchmark.p99_ns",
+    "benchmark.bytes_per_iteration",
+    "benchmark.bytes_per_second"
+  };
+  UINT64 Values[] = {
+    Benchmark->Warmup,
+    Benchmark->Iterations,
+    Benchmark->MinNs,
+    Benchmark->MedianNs,
+    Benchmark->P99Ns,
+    Benchmark->BytesPerIteration,
+    Benchmark->BytesPerSecond
+  };
+  UINTN Count;
+
+  //the throughput only applies if the test counts bytes
+  Count = sizeof(Names) / sizeof(Names[0]);
+  if (Benchmark->BytesPerIteration == 0)
+  {
+    Count -= 2;
+  }
+
+  if (New_PropertiesForTestCase(TestNode, Names, Values, Count) == NULL)
+  {
+    DEBUG((DEBUG_ERROR, "%a Failed to add benchmark properties\n", __FUNCTION__));
+  }
+}
+
 /**
   Caller must free returned buffer if not NULL
 **/
@@ -102,6 +145,24 @@ ConvertAndAllocateUnicodeStringToAsciiString(
   return AsciiString;
 }
 
+/**
+  XML_TREE_WRITE_CALLBACK writing the report to the open log file.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+WriteXmlToFile(
+  IN       VOID    *Context,
+  IN CONST CHAR8   *Data,
+  IN       UINTN   Length
+)
+{
+  if (fwrite (Data, 1, (size_t)Length, (FILE *)Context) != (size_t)Length) {
+    return EFI_DEVICE_ERROR;
+  }
+  return EFI_SUCCESS;
+}
+
 STATIC
 EFI_STATUS
 WriteXmlNodeToLogFile(
@@ -115,8 +176,6 @@ WriteXmlNodeToLogFile(
   CHAR8                          *LogFileAsciiName = NULL;
   CHAR16                         *LogFileNameSuffix = L"_JUNIT.XML";
   FILE                           *FileHandle;
-  UINTN                          StringSize = 0;
-  CHAR8*                         XmlString = NULL;
 
   if (Framework == NULL)
   {
@@ -150,36 +209,22 @@ WriteXmlNodeToLogFile(
 
   UnicodeStrToAsciiStrS (LogFileName, LogFileAsciiName, FileNameLen);
 
-  //Write XML
-  Status = XmlTreeToString(Doc, TRUE, &StringSize, &XmlString);
-  if (EFI_ERROR(Status))
-  {
-    DEBUG((DEBUG_ERROR, "XmlTreeToString failed.  %r\n", Status));
-    goto Exit;
-  }
-
-  if (StringSize == 0)
-  {
-    Status = EFI_OUT_OF_RESOURCES;
-    DEBUG((DEBUG_ERROR, "StringSize equal 0.\n"));
-    goto Exit;
-  }
-
-  //
-  // subtract 1 from string size to avoid writing the NULL terminator
-  //
-  StringSize--;
-
   FileHandle = fopen (LogFileAsciiName, "w");
   if (FileHandle == NULL) {
     DEBUG((DEBUG_ERROR, "Failed to open %s file for create. Status = %r\n", LogFileName, Status));
     goto Exit;
   }
-  else
+
+  //
+  // Write XML straight to the file, the report is never held in memory as a whole
+  //
+  DEBUG((DEBUG_INFO, "Writing XML to file %s\n", LogFileName));
+  Status = XmlTreeWrite(Doc, TRUE, WriteXmlToFile, FileHandle);
+  fclose (FileHandle);
+  if (EFI_ERROR(Status))
   {
-    DEBUG((DEBUG_INFO, "Writing XML to file %s\n", LogFileName));
-    StringSize = fwrite (XmlString, (size_t)StringSize, 1, FileHandle);
-    fclose (FileHandle);
+    DEBUG((DEBUG_ERROR, "XmlTreeWrite failed.  %r\n", Status));
+    goto Exit;
   }
 
   //success
@@ -188,7 +233,6 @@ WriteXmlNodeToLogFile(
 Exit:
   if (LogFileName != NULL) {FreePool(LogFileName); }
   if (LogFileAsciiName != NULL) {FreePool(LogFileAsciiName); }
-  if (XmlString != NULL) { FreePool(XmlString); }
   return Status;
 }
 
@@ -303,6 +347,10 @@ OutputUnitTestFrameworkReport(
       XmlNode* TestNode = NULL;
       //TODO:  need to handle timing.  Right now its hard coded to 1 second. 
       TestNode = New_TestCaseInSuite(SuiteNode, Name, ClassName, 1, Log, FailureMsg, GetStringForFailureType(Test->UT.FailureType), Skipped);
+      if (TestNode != NULL && Test->UT.Benchmark != NULL && Test->UT.Result == UNIT_TEST_PASSED)
+      {
+        AddBenchmarkProperties(TestNode, Test->UT.Benchmark);
+      }
 
       if (Name != NULL) { FreePool(Name); }
       if (Log != NULL) { FreePool(Log); }
@@ -143,12 +143,12 @@ New_NodeInList(
   if (DigestCount > 0) 
   {
   //Create the event node with no parent
-  Status = AddNode(NULL, EVENT_ENTRY_ELEMENT_NAME, NULL, &NewEventNode);
+  Status = CreateNodeForTree(RootNode, EVENT_ENTRY_ELEMENT_NAME, NULL, &NewEventNode);
   }
   else
   {
     //Create the header node with no parent
-    Status = AddNode(NULL, HEADER_ENTRY_ELEMENT_NAME, NULL, &NewEventNode);
+    Status = CreateNodeForTree(RootNode, HEADER_ENTRY_ELEMENT_NAME, NULL, &NewEventNode);
   }
 
   if (EFI_ERROR(Status))
@@ -229,7 +229,7 @@ New_VariableNodeInList(
   //RootNode is good. 
 
   //Create the var node with no parent
-  Status = AddNode(NULL, VARIABLE_ENTRY_ELEMENT_NAME, NULL, &NewVarNode);
+  Status = CreateNodeForTree(RootNode, VARIABLE_ENTRY_ELEMENT_NAME, NULL, &NewVarNode);
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "%a - AddNode for Var Failed.  Status %r\n", __FUNCTION__, Status));
@@ -114,6 +114,19 @@ VOID
 ///================================================================================================
 
 
+//
+// Settings and timings of a benchmark test. All the times are in nanoseconds.
+//
+typedef struct {
+  UINT32                    Warmup;             // Untimed calls of the test function.
+  UINT32                    Iterations;         // Timed calls of the test function.
+  UINT64                    BytesPerIteration;  // Bytes processed by one call, or 0.
+  UINT64                    MinNs;
+  UINT64                    MedianNs;
+  UINT64                    P99Ns;
+  UINT64                    BytesPerSecond;     // At the median time, or 0.
+} UNIT_TEST_BENCHMARK;
+
 typedef struct {
   CHAR16                    *Description;
   CHAR16                    *ClassName;  //can't have spaces and should be short
@@ -127,6 +140,7 @@ typedef struct {
   UNIT_TEST_CLEANUP         CleanUp;
   UNIT_TEST_CONTEXT         Context;
   UNIT_TEST_SUITE_HANDLE    ParentSuite;
+  UNIT_TEST_BENCHMARK       *Benchmark;  // NULL if the test is not a benchmark.
 } UNIT_TEST;
 
 typedef struct {
@@ -36,6 +36,10 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /**
 This function will create a xml tree given an XML document as a ascii string.
 
+The tree is allocated from an arena owned by RootNode.  Nodes later added
+below it with AddNode, AddAttributeToNode or CreateNodeForTree use the same
+arena, and FreeXmlTree(RootNode) releases all of them in a few calls.
+
 @param   XmlDocument     -- XML document to create the node list for.
 @param   SizeXmlDocument -- Length of the document.
 @param   RootNode        -- The root node that contains the node list.
@@ -51,9 +55,104 @@ CreateXmlTree(
   OUT       XmlNode**   RootNode
 );
 
+//
+// Piece of the document given to the XmlParse callbacks.  It points into the
+// document itself: it is not NULL terminated and values are still XML escaped
+// (see XmlUnEscape).
+//
+typedef struct
+{
+  CONST CHAR8*  Data;
+  UINTN         Length;
+} XML_SLICE;
+
+/**
+Called by XmlParse with the XML declaration, "<?xml ... ?>".
+**/
+typedef
+EFI_STATUS
+(EFIAPI *XML_PARSE_DECLARATION_CALLBACK)(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Declaration
+);
+
+/**
+Called by XmlParse when an element starts, and when it ends.
+For an empty element, "<Name />", EndElement is given the Name of StartElement.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *XML_PARSE_ELEMENT_CALLBACK)(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Name
+);
+
+/**
+Called by XmlParse for each attribute of the element that just started.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *XML_PARSE_ATTRIBUTE_CALLBACK)(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Name,
+  IN CONST XML_SLICE*  Value
+);
+
+/**
+Called by XmlParse with the text between two tags, whitespace included.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *XML_PARSE_TEXT_CALLBACK)(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Text
+);
+
+//
+// Callbacks of XmlParse.  Any of them can be NULL to skip those events.
+// A callback returning an error stops the parse with that error.
+//
+typedef struct
+{
+  XML_PARSE_DECLARATION_CALLBACK  Declaration;
+  XML_PARSE_ELEMENT_CALLBACK      StartElement;
+  XML_PARSE_ATTRIBUTE_CALLBACK    Attribute;
+  XML_PARSE_TEXT_CALLBACK         Text;
+  XML_PARSE_ELEMENT_CALLBACK      EndElement;
+} XML_PARSE_CALLBACKS;
+
+/**
+This function parses an XML document in a single pass and reports what it finds
+through callbacks, in document order, without building a tree.  Memory use does
+not depend on the size of the document.
+
+It checks the document is well formed for the tokenizer, not that each end
+element matches its start element: a caller that cares tracks the names.
+
+@param[in]   XmlDocument     -- XML document to parse.
+@param[in]   SizeXmlDocument -- Length of the document.
+@param[in]   Callbacks       -- Functions receiving the parse events.
+@param[in]   Context         -- Passed to the callbacks.
+
+@return  EFI_SUCCESS, EFI_INVALID_PARAMETER if the document is not valid XML
+         or holds no element, or the error returned by a callback.
+
+**/
+EFI_STATUS
+EFIAPI
+XmlParse(
+  IN CONST CHAR8*                XmlDocument,
+  IN       UINTN                 SizeXmlDocument,
+  IN CONST XML_PARSE_CALLBACKS*  Callbacks,
+  IN       VOID*                 Context
+);
+
 /**
   This function creates a new XML tree.
 
+  The node is stored like Parent: in the arena of Parent if it has one,
+  otherwise in pool.
+
   @param[in]   Parent   -- Optional parent for this node.
   @param[in]   Name     -- Name for this node.
   @param[in]   Value    -- Optional value for this node.
@@ -72,6 +171,33 @@ AddNode(
 );
 
 
+/**
+  This function creates a node with no parent, stored like the nodes of Tree.
+  It is meant to build a subtree that is then added to Tree with AddChildTree.
+
+  If Tree was created by CreateXmlTree the node lives in the arena of that
+  document and is released with it: FreeXmlTree on the node only unlinks its
+  children, the memory is given back when FreeXmlTree frees the root of Tree.
+  Otherwise this is AddNode(NULL, Name, Value, Node).
+
+  @param[in]   Tree     -- Any node of the tree the new node is meant for.
+  @param[in]   Name     -- Name for this node.
+  @param[in]   Value    -- Optional value for this node.
+  @param[out]  Node     -- Return pointer for this node.
+
+  @return  EFI_SUCCESS or underlying failure code.
+
+**/
+EFI_STATUS
+EFIAPI
+CreateNodeForTree(
+  IN  CONST XmlNode*     Tree,
+  IN  CONST CHAR8*       Name,
+  IN  CONST CHAR8*       Value OPTIONAL,
+  OUT       XmlNode**    Node
+);
+
+
 /**
   This function adds an existing tree to a parent node.
 
@@ -141,6 +267,9 @@ DeleteAttribute(
 
 /**
   This function will free all of the resources allocated for an XML Tree.
+
+  For a tree of CreateXmlTree this frees its arena in one go, walking the
+  nodes only if trees of pool or of another document were added to it.
   
   @param   RootNode -- The root node that contains the node list.
 
@@ -188,6 +317,44 @@ XmlTreeToString(
   OUT       CHAR8      **String
 );
 
+/**
+Function called by XmlTreeWrite with each chunk of the serialized document.
+
+@param[in] Context - Context given to XmlTreeWrite
+@param[in] Data    - Next characters of the document.  Not NULL terminated
+@param[in] Length  - Number of characters in Data
+
+@return EFI_SUCCESS to continue, any error to stop writing
+**/
+typedef
+EFI_STATUS
+(EFIAPI *XML_TREE_WRITE_CALLBACK)(
+  IN       VOID    *Context,
+  IN CONST CHAR8   *Data,
+  IN       UINTN   Length
+);
+
+/**
+Public function to write an xml tree through a callback, e.g. straight to a file.
+This will use the same notation as XmlTreeToString.  The document is produced in
+a single pass and never held in memory as a whole.
+
+@param[in]  Node    - Root node or first node to start printing.
+@param[in]  Escaped - Should the Xml be escaped.  Generally this should be true
+@param[in]  Write   - Function receiving the document, chunk by chunk
+@param[in]  Context - Passed to Write
+
+@return EFI_SUCCESS, or the error of the tree or of Write
+**/
+EFI_STATUS
+EFIAPI
+XmlTreeWrite(
+  IN  CONST XmlNode                  *Node,
+  IN        BOOLEAN                  Escaped,
+  IN        XML_TREE_WRITE_CALLBACK  Write,
+  IN        VOID                     *Context
+);
+
 /**
 Function to calculate the size of the Ascii string needed
 to print this XmlNode and its children.  Generally assumed it will
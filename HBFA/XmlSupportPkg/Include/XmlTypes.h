@@ -31,6 +31,14 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __XML_TYPES_H__
 
 
+//
+// Storage of a tree created by CreateXmlTree().  Nodes, attributes and values
+// are carved out of a few large blocks and the element/attribute names are
+// interned, so nodes of such a tree may share the same Name buffer.  Treat
+// Name and Value of those nodes as read only.
+//
+typedef struct _XmlArena XmlArena;
+
 typedef struct _XmlDeclaration
 {
   CHAR8* Declaration;
@@ -52,6 +60,7 @@ typedef struct _XmlNode
   CHAR8*             Name;           // Name of this node.
   CHAR8*             Value;          // Optional value.
   XmlDeclaration     XmlDeclaration;    // Optional XML declaration for the node.
+  XmlArena*          Arena;             // Arena the node, its attributes and strings live in.  NULL for pool.
 
 } XmlNode;
 
@@ -93,7 +93,7 @@ New_TestSuiteNodeInList(
 
 
   //Create the testsuite node with no parent
-  Status = AddNode(NULL, TESTSUITE_ELEMENT_NAME, NULL, &NewSuiteNode);
+  Status = CreateNodeForTree(RootNode, TESTSUITE_ELEMENT_NAME, NULL, &NewSuiteNode);
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "%a - AddNode for test suite Failed.  Status %r\n", __FUNCTION__, Status));
@@ -181,7 +181,7 @@ New_TestCaseInSuite(
 
 
   //Create the tesetCase node with no parent
-  Status = AddNode(NULL, TESTCASE_ELEMENT_NAME, NULL, &NewTestNode);
+  Status = CreateNodeForTree(TestSuite, TESTCASE_ELEMENT_NAME, NULL, &NewTestNode);
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "%a - AddNode for test case Failed.  Status %r\n", __FUNCTION__, Status));
@@ -302,7 +302,7 @@ New_FailureForTestCase(
 
 
   //Create the failure node with no parent
-  Status = AddNode(NULL, TESTCASE_FAILURE_ELEMENT_NAME, NULL, &NewFailureNode);
+  Status = CreateNodeForTree(TestCase, TESTCASE_FAILURE_ELEMENT_NAME, NULL, &NewFailureNode);
   if (EFI_ERROR(Status))
   {
     DEBUG((DEBUG_ERROR, "%a - AddNode for failure node Failed.  Status %r\n", __FUNCTION__, Status));
@@ -101,6 +101,21 @@ ConvertAndAllocateUnicodeStringToAsciiString(
   return AsciiString;
 }
 
+/**
+  XML_TREE_WRITE_CALLBACK writing the report to the open log file.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+WriteXmlToFile(
+  IN       VOID    *Context,
+  IN CONST CHAR8   *Data,
+  IN       UINTN   Length
+)
+{
+  return ShellWriteFile((SHELL_FILE_HANDLE)Context, &Length, (VOID*)Data);
+}
+
 STATIC
 EFI_STATUS
 WriteXmlNodeToLogFile(
@@ -113,8 +128,6 @@ WriteXmlNodeToLogFile(
   CHAR16                         *LogFileName = NULL;
   CHAR16                         *LogFileNameSuffix = L"_JUNIT.XML";
   SHELL_FILE_HANDLE              FileHandle;
-  UINTN                          StringSize = 0;
-  CHAR8*                         XmlString = NULL;
 
   if (Framework == NULL)
   {
@@ -145,27 +158,6 @@ WriteXmlNodeToLogFile(
   StrnCatS(LogFileName, FileNameLen, Framework->ShortTitle, FileNameLen-1);
   StrnCatS(LogFileName, FileNameLen, LogFileNameSuffix, FileNameLen - 1);
 
-
-  //Write XML
-  Status = XmlTreeToString(Doc, TRUE, &StringSize, &XmlString);
-  if (EFI_ERROR(Status))
-  {
-    DEBUG((DEBUG_ERROR, "XmlTreeToString failed.  %r\n", Status));
-    goto Exit;
-  }
-
-  if (StringSize == 0)
-  {
-    Status = EFI_OUT_OF_RESOURCES;
-    DEBUG((DEBUG_ERROR, "StringSize equal 0.\n"));
-    goto Exit;
-  }
-
-  //
-  // subtract 1 from string size to avoid writing the NULL terminator
-  //
-  StringSize--;
-
   //
   //First lets open the file if it exists so we can delete it...This is the work around for truncation
   //
@@ -188,9 +180,17 @@ WriteXmlNodeToLogFile(
   }
   else
   {
+    //
+    // Write XML straight to the file, the report is never held in memory as a whole
+    //
     ShellPrintEx(-1, -1, L"Writing XML to file %s\n", LogFileName);
-    ShellWriteFile(FileHandle, &StringSize, XmlString);
+    Status = XmlTreeWrite(Doc, TRUE, WriteXmlToFile, FileHandle);
     ShellCloseFile(&FileHandle);
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_ERROR, "XmlTreeWrite failed.  %r\n", Status));
+      goto Exit;
+    }
   }
 
   //success
@@ -198,7 +198,6 @@ WriteXmlNodeToLogFile(
 
 Exit:
   if (LogFileName != NULL) {FreePool(LogFileName); }
-  if (XmlString != NULL) { FreePool(XmlString); }
   return Status;
 }
 
@@ -40,14 +40,6 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define fDoOnce FALSE
 #endif // fDoOnce
 
-#ifndef MAX_PATH
-#define MAX_PATH (260)
-#endif // MAX_PATH
-
-#ifndef ARRAYSIZE
-#define ARRAYSIZE(A) sizeof(A)/sizeof(A[0])
-#endif // ARRAYSIZE
-
 
 //DEFINE the max number of nodes deep the parser will support
 #define MAX_RECURSIVE_LEVEL (25)  
@@ -69,6 +61,14 @@ _GetXmlEscapedLength(
 	IN UINTN MaxStringLength
 );
 
+STATIC
+EFI_STATUS
+_XmlUnEscapeToBuffer(
+  IN CONST CHAR8* EscapedString,
+  IN UINTN        Length,
+  OUT CHAR8*      RawString
+);
+
 
 
 /**
@@ -113,6 +113,315 @@ VOID SafeFreeBuffer(CHAR8** ppBuff)
 }// SafeFreeBuffer()
 
 
+//
+// Arena backing the trees created by CreateXmlTree.  Nodes, attributes and
+// strings are carved out of large zeroed blocks and names are interned, so a
+// report repeating "testcase" or "name" thousands of times stores them once.
+//
+#define XML_ARENA_FIRST_BLOCK_SIZE  (0x1000)
+#define XML_ARENA_BLOCK_SIZE        (0x10000)
+#define XML_ARENA_NAME_BUCKETS      (64)
+
+typedef struct _XML_ARENA_BLOCK
+{
+  struct _XML_ARENA_BLOCK  *Next;
+  UINTN                    Size;   // Bytes of data following the header
+  UINTN                    Used;
+} XML_ARENA_BLOCK;
+
+#define XML_ARENA_DATA(Block)  ((UINT8*)(Block) + ALIGN_VALUE(sizeof(XML_ARENA_BLOCK), sizeof(UINT64)))
+
+typedef struct _XML_INTERNED_NAME
+{
+  struct _XML_INTERNED_NAME  *Next;
+  UINTN                      Length;
+  CHAR8                      *Name;
+} XML_INTERNED_NAME;
+
+struct _XmlArena
+{
+  XML_ARENA_BLOCK    *Blocks;         // Block being filled first
+  XmlNode            *Owner;          // Root node whose FreeXmlTree frees the arena
+  UINTN              ForeignTrees;    // Trees of pool or another arena added below our nodes
+  XML_INTERNED_NAME  *Names[XML_ARENA_NAME_BUCKETS];
+};
+
+STATIC
+XML_ARENA_BLOCK*
+_ArenaNewBlock(
+  IN UINTN Size
+)
+{
+  XML_ARENA_BLOCK* Block;
+
+  Block = AllocateZeroPool(ALIGN_VALUE(sizeof(XML_ARENA_BLOCK), sizeof(UINT64)) + Size);
+  if (Block != NULL)
+  {
+    Block->Size = Size;
+  }
+  return Block;
+}
+
+/**
+Create an empty arena.  The arena header is the first allocation of its first block.
+**/
+STATIC
+XmlArena*
+_ArenaCreate(
+  VOID
+)
+{
+  XML_ARENA_BLOCK* Block;
+  XmlArena*        Arena;
+
+  Block = _ArenaNewBlock(XML_ARENA_FIRST_BLOCK_SIZE);
+  if (Block == NULL)
+  {
+    return NULL;
+  }
+  Arena = (XmlArena*)XML_ARENA_DATA(Block);
+  Block->Used = ALIGN_VALUE(sizeof(XmlArena), sizeof(UINT64));
+  Arena->Blocks = Block;
+  return Arena;
+}
+
+/**
+Free all the blocks of the arena, the arena included.
+**/
+STATIC
+VOID
+_ArenaFree(
+  IN XmlArena* Arena
+)
+{
+  XML_ARENA_BLOCK* Block;
+  XML_ARENA_BLOCK* Next;
+
+  for (Block = Arena->Blocks; Block != NULL; Block = Next)
+  {
+    Next = Block->Next;
+    FreePool(Block);
+  }
+}
+
+/**
+Return Size bytes of zeroed memory from the arena, NULL if out of resources.
+**/
+STATIC
+VOID*
+_ArenaAllocate(
+  IN XmlArena* Arena,
+  IN UINTN     Size
+)
+{
+  XML_ARENA_BLOCK* Block;
+  VOID*            Buffer;
+
+  Size = ALIGN_VALUE(Size, sizeof(UINT64));
+  Block = Arena->Blocks;
+  if (Block->Size - Block->Used < Size)
+  {
+    if (Size > XML_ARENA_BLOCK_SIZE / 4)
+    {
+      //
+      // Big values get a block of their own, behind the one being filled
+      //
+      Block = _ArenaNewBlock(Size);
+      if (Block == NULL)
+      {
+        return NULL;
+      }
+      Block->Next = Arena->Blocks->Next;
+      Arena->Blocks->Next = Block;
+    }
+    else
+    {
+      //
+      // Small documents stay small, blocks double up to XML_ARENA_BLOCK_SIZE
+      //
+      Block = _ArenaNewBlock(MAX(Size, MIN(Block->Size * 2, XML_ARENA_BLOCK_SIZE)));
+      if (Block == NULL)
+      {
+        return NULL;
+      }
+      Block->Next = Arena->Blocks;
+      Arena->Blocks = Block;
+    }
+  }
+
+  Buffer = XML_ARENA_DATA(Block) + Block->Used;
+  Block->Used += Size;
+  return Buffer;
+}
+
+/**
+Return the NULL terminated copy of the Length characters of Name stored in
+the arena, shared by all the nodes and attributes of that name.  NULL if out
+of resources.
+**/
+STATIC
+CHAR8*
+_ArenaInternName(
+  IN       XmlArena* Arena,
+  IN CONST CHAR8*    Name,
+  IN       UINTN     Length
+)
+{
+  XML_INTERNED_NAME** Bucket;
+  XML_INTERNED_NAME*  Entry;
+  UINTN               Index;
+  UINT32              Hash;
+
+  //
+  // FNV-1a
+  //
+  Hash = 2166136261U;
+  for (Index = 0; Index < Length; Index++)
+  {
+    Hash = (Hash ^ (UINT8)Name[Index]) * 16777619U;
+  }
+
+  Bucket = &Arena->Names[Hash % XML_ARENA_NAME_BUCKETS];
+  for (Entry = *Bucket; Entry != NULL; Entry = Entry->Next)
+  {
+    if (Entry->Length == Length && CompareMem(Entry->Name, Name, Length) == 0)
+    {
+      return Entry->Name;
+    }
+  }
+
+  Entry = _ArenaAllocate(Arena, sizeof(XML_INTERNED_NAME) + Length + 1);
+  if (Entry == NULL)
+  {
+    return NULL;
+  }
+  Entry->Name = (CHAR8*)(Entry + 1);
+  CopyMem(Entry->Name, Name, Length);
+  Entry->Length = Length;
+  Entry->Next = *Bucket;
+  *Bucket = Entry;
+  return Entry->Name;
+}
+
+/**
+Allocate zeroed memory for a node, an attribute or their strings:
+from Arena if the tree has one, otherwise from pool.
+**/
+STATIC
+VOID*
+_TreeAllocate(
+  IN XmlArena* Arena OPTIONAL,
+  IN UINTN     Size
+)
+{
+  if (Arena != NULL)
+  {
+    return _ArenaAllocate(Arena, Size);
+  }
+  return AllocateZeroPool(Size);
+}
+
+/**
+Free memory of _TreeAllocate.  Arena memory is only given back with the arena.
+**/
+STATIC
+VOID
+_TreeFree(
+  IN     XmlArena* Arena OPTIONAL,
+  IN OUT CHAR8**   ppBuff
+)
+{
+  if (Arena == NULL)
+  {
+    SafeFreeBuffer(ppBuff);
+  }
+  else
+  {
+    *ppBuff = NULL;
+  }
+}
+
+/**
+Copy an element or attribute name for a tree, interned when the tree has an arena.
+**/
+STATIC
+CHAR8*
+_TreeCopyName(
+  IN       XmlArena* Arena OPTIONAL,
+  IN CONST CHAR8*    Name
+)
+{
+  CHAR8* Copy;
+
+  if (Arena != NULL)
+  {
+    return _ArenaInternName(Arena, Name, AsciiStrLen(Name));
+  }
+
+  Copy = (CHAR8*)AllocateZeroPool(AsciiStrLen(Name) + 1);
+  if (Copy != NULL)
+  {
+    CopyMem(Copy, Name, AsciiStrLen(Name));
+  }
+  return Copy;
+}
+
+/**
+XmlUnEscape for a tree, the result is allocated with _TreeAllocate.
+**/
+STATIC
+EFI_STATUS
+_TreeUnEscape(
+  IN       XmlArena* Arena OPTIONAL,
+  IN CONST CHAR8*    EscapedString,
+  IN       UINTN     MaxEscapedStringLength,
+  OUT      CHAR8**   String
+)
+{
+  EFI_STATUS Status;
+  UINTN      Length;
+  CHAR8*     RawString;
+
+  if (Arena == NULL)
+  {
+    return XmlUnEscape(EscapedString, MaxEscapedStringLength, String);
+  }
+
+  Length = _GetXmlUnEscapedLength(EscapedString, MaxEscapedStringLength);
+  if (Length == 0)
+  {
+    DEBUG((DEBUG_ERROR, "%a failed to get valid unescaped length\n", __FUNCTION__));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  RawString = _ArenaAllocate(Arena, Length + 1);
+  if (RawString == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = _XmlUnEscapeToBuffer(EscapedString, Length, RawString);
+  if (!EFI_ERROR(Status))
+  {
+    *String = RawString;
+  }
+  return Status;
+}
+
+/**
+AddNode storing the node in Arena, or in pool if Arena is NULL.
+**/
+STATIC
+EFI_STATUS
+_AddNode(
+  IN        XmlArena*    Arena OPTIONAL,
+  IN        XmlNode*     Parent OPTIONAL,
+  IN  CONST CHAR8*       Name,
+  IN  CONST CHAR8*       Value OPTIONAL,
+  OUT       XmlNode**    Node OPTIONAL
+);
+
+
 //
 // Public functions
 //
@@ -136,6 +445,46 @@ AddNode(
   IN  CONST CHAR8*       Value OPTIONAL,
   OUT       XmlNode**    Node OPTIONAL
 )
+{
+  return _AddNode((Parent != NULL) ? Parent->Arena : NULL, Parent, Name, Value, Node);
+}// AddNode()
+
+/**
+This function creates a node with no parent, stored like the nodes of Tree.
+
+@param[in]   Tree     -- Any node of the tree the new node is meant for.
+@param[in]   Name     -- Name for this node.
+@param[in]   Value    -- Optional value for this node.
+@param[out]  Node     -- Return pointer for this node.
+
+@return  EFI_SUCCESS or underlying failure code.
+
+**/
+EFI_STATUS
+EFIAPI
+CreateNodeForTree(
+  IN  CONST XmlNode*     Tree,
+  IN  CONST CHAR8*       Name,
+  IN  CONST CHAR8*       Value OPTIONAL,
+  OUT       XmlNode**    Node
+)
+{
+  if (Tree == NULL || Node == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+  return _AddNode(Tree->Arena, NULL, Name, Value, Node);
+}// CreateNodeForTree()
+
+STATIC
+EFI_STATUS
+_AddNode(
+  IN        XmlArena*    Arena OPTIONAL,
+  IN        XmlNode*     Parent OPTIONAL,
+  IN  CONST CHAR8*       Name,
+  IN  CONST CHAR8*       Value OPTIONAL,
+  OUT       XmlNode**    Node OPTIONAL
+)
 {
   EFI_STATUS Status = EFI_SUCCESS;
   CHAR8*     NodeValue = NULL;
@@ -156,28 +505,23 @@ AddNode(
       *Node = NULL;
     }
 
-    NodeTemp = (XmlNode*)AllocateZeroPool(sizeof(XmlNode));
+    NodeTemp = (XmlNode*)_TreeAllocate(Arena, sizeof(XmlNode));
     if (NodeTemp == NULL)
     {
       Status = EFI_OUT_OF_RESOURCES;
       break;
     }
 
-    NodeName = (CHAR8*)AllocateZeroPool(AsciiStrLen(Name) + 1);
+    NodeName = _TreeCopyName(Arena, Name);
     if (NodeName == NULL)
     {
       Status = EFI_OUT_OF_RESOURCES;
       break;
     }
-    Status = AsciiStrCpyS(NodeName, AsciiStrLen(Name) + 1, Name);
-    if (EFI_ERROR(Status))
-    {
-      break;
-    }
 
     if (Value && *Value != '\0')
     {
-	  Status = XmlUnEscape(Value, XML_MAX_ELEMENT_VALUE_LENGTH, &NodeValue);
+	  Status = _TreeUnEscape(Arena, Value, XML_MAX_ELEMENT_VALUE_LENGTH, &NodeValue);
       //NodeValue = AllocateZeroPool(AsciiStrLen(Value) + 1);
       if (EFI_ERROR(Status))
       {
@@ -191,6 +535,7 @@ AddNode(
     NodeTemp->ParentNode = Parent;
     NodeTemp->Name = NodeName;
     NodeTemp->Value = NodeValue;
+    NodeTemp->Arena = Arena;
 
     //
     // Initailize our list head entries.
@@ -235,13 +580,13 @@ AddNode(
     // SafeFreeBuffer() only frees the memory if the pointer is not NULL.
     // It then sets the pointer to null.
     //
-    SafeFreeBuffer((CHAR8**)&NodeTemp);
-    SafeFreeBuffer(&NodeName);
-    SafeFreeBuffer(&NodeValue);
+    _TreeFree(Arena, (CHAR8**)&NodeTemp);
+    _TreeFree(Arena, &NodeName);
+    _TreeFree(Arena, &NodeValue);
   }
 
   return Status;
-}// AddNode()
+}// _AddNode()
 
  /**
  This function adds an existing tree to a parent node.
@@ -279,6 +624,14 @@ AddChildTree(
     //
     Parent->NumChildren++;
 
+    //
+    // An arena tree can then no longer be freed without walking it
+    //
+    if (Parent->Arena != NULL && Tree->Arena != Parent->Arena)
+    {
+      Parent->Arena->ForeignTrees++;
+    }
+
     //
     // Set the node's new parent...
     //
@@ -311,6 +664,7 @@ AddAttributeToNode(
   EFI_STATUS      Status = EFI_SUCCESS;
   CHAR8*          AsciiString = NULL;
   XmlAttribute*   Attribute = NULL;
+  XmlArena*       Arena = NULL;
 
   do
   {
@@ -321,10 +675,15 @@ AddAttributeToNode(
       break;
     }
 
+    //
+    // Attributes are stored like the node they belong to
+    //
+    Arena = Parent->Arena;
+
     //
     // Allocate the attribute structure
     //
-    Attribute = (XmlAttribute*)AllocateZeroPool(sizeof(XmlAttribute));
+    Attribute = (XmlAttribute*)_TreeAllocate(Arena, sizeof(XmlAttribute));
     if (Attribute == NULL)
     {
       Status = EFI_OUT_OF_RESOURCES;
@@ -334,24 +693,19 @@ AddAttributeToNode(
     //
     // Allocate and store the name...
     //
-    AsciiString = (CHAR8*)AllocateZeroPool(AsciiStrLen(Name) + 1);
+    AsciiString = _TreeCopyName(Arena, Name);
     if (AsciiString == NULL)
     {
       Status = EFI_OUT_OF_RESOURCES;
       break;
     }
-    Status = AsciiStrCpyS(AsciiString, AsciiStrLen(Name) + 1, Name);
-    if (EFI_ERROR(Status))
-    {
-      break;
-    }
     Attribute->Name = AsciiString;
 
     //
     // Allocate and store the value...
     //
     AsciiString = NULL;
-	Status = XmlUnEscape(Value, XML_MAX_ATTRIBUTE_VALUE_LENGTH, &AsciiString);
+	Status = _TreeUnEscape(Arena, Value, XML_MAX_ATTRIBUTE_VALUE_LENGTH, &AsciiString);
     if (EFI_ERROR(Status))
     {
       break;
@@ -379,9 +733,9 @@ AddAttributeToNode(
     //
     if (Attribute)
     {
-      SafeFreeBuffer((CHAR8**)&Attribute->Name);
-      SafeFreeBuffer((CHAR8**)&Attribute->Value);
-      SafeFreeBuffer((CHAR8**)&Attribute);
+      _TreeFree(Arena, (CHAR8**)&Attribute->Name);
+      _TreeFree(Arena, (CHAR8**)&Attribute->Value);
+      _TreeFree(Arena, (CHAR8**)&Attribute);
     }
   }
 
@@ -404,6 +758,7 @@ DeleteNode(IN XmlNode* Node)
 {
   EFI_STATUS      Status = EFI_SUCCESS;
   LIST_ENTRY*     Link = NULL;
+  XmlNode*        Child = NULL;
 
   //check for null
   if (Node == NULL)
@@ -427,7 +782,18 @@ DeleteNode(IN XmlNode* Node)
     //Now remove it from our children list
     RemoveEntryList(Link);
     Node->NumChildren--;
-    FreePool(Link);
+    Child = (XmlNode*)Link;
+    if (Child->Arena == NULL)
+    {
+      FreePool(Link);
+    }
+    else if (Child->Arena->Owner == Child)
+    {
+      //
+      // A tree of CreateXmlTree added with AddChildTree, its arena goes with it
+      //
+      _ArenaFree(Child->Arena);
+    }
   }
 
   // all children gone....
@@ -446,13 +812,16 @@ DeleteNode(IN XmlNode* Node)
     //now remove from Attribute list
     RemoveEntryList(Link);
     Node->NumAttributes--;
-    FreePool(Link);
+    if (Node->Arena == NULL)
+    {
+      FreePool(Link);
+    }
   }//go to next attribute
 
   //now free our node memory
-  SafeFreeBuffer(&(Node->XmlDeclaration.Declaration));
-  SafeFreeBuffer(&(Node->Name));
-  SafeFreeBuffer(&(Node->Value));
+  _TreeFree(Node->Arena, &(Node->XmlDeclaration.Declaration));
+  _TreeFree(Node->Arena, &(Node->Name));
+  _TreeFree(Node->Arena, &(Node->Value));
   Node->ParentNode = NULL;
 
   return Status;
@@ -474,170 +843,181 @@ DeleteAttribute(
   IN XmlAttribute* Attribute)
 {
   EFI_STATUS Status = EFI_SUCCESS;
+  XmlArena*  Arena;
 
   if (Attribute == NULL)
   {
     return EFI_INVALID_PARAMETER;
   }
 
-  SafeFreeBuffer(&(Attribute->Name));
-  SafeFreeBuffer(&(Attribute->Value));
+  Arena = (Attribute->Parent != NULL) ? Attribute->Parent->Arena : NULL;
+  _TreeFree(Arena, &(Attribute->Name));
+  _TreeFree(Arena, &(Attribute->Value));
   Attribute->Parent = NULL;
   return Status;
 }// DeleteAttribute()
 
 
-/**
-Function to calculate the size of the Ascii string needed
-to print this XmlNode and its children.
-This uses a shortened XML format, minimal whitespace, and xml encoded strings
+//
+// Size of the chunks handed to the XML_TREE_WRITE_CALLBACK
+//
+#define XML_WRITE_BUFFER_SIZE (0x1000)
+
+//
+// Serializer state.  Output is gathered in Buffer and handed to the
+// callback a chunk at a time, so the document is produced in one pass
+// without rescanning what has already been written.
+//
+typedef struct
+{
+  XML_TREE_WRITE_CALLBACK  Write;
+  VOID                     *Context;
+  UINTN                    Used;
+  CHAR8                    Buffer[XML_WRITE_BUFFER_SIZE];
+} XML_WRITER;
 
-This is an internal function.  Public function is CalculateXmlDocSize
+//
+// Growable string used by XmlTreeToString
+//
+typedef struct
+{
+  CHAR8  *String;
+  UINTN  Length;
+  UINTN  Capacity;
+} XML_STRING_BUFFER;
 
+/**
+Hand the gathered characters to the callback.
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-_CaclSizeRecursively(
-  IN  CONST XmlNode*   Node,
-  IN        BOOLEAN    Escaped,
-  OUT       UINTN*     Size,
-  IN        UINTN      Level)
+_WriterFlush(
+  IN OUT XML_WRITER  *Writer
+)
 {
-  XmlAttribute *Att = NULL;
-  LIST_ENTRY *Link = NULL;
-  UINTN      NameSize = 0;
   EFI_STATUS Status = EFI_SUCCESS;
 
-  if ((Node == NULL) || (Size == NULL))
+  if (Writer->Used > 0)
   {
-    return EFI_INVALID_PARAMETER;
+    Status = Writer->Write(Writer->Context, Writer->Buffer, Writer->Used);
+    Writer->Used = 0;
   }
+  return Status;
+}
 
-  if (Level > MAX_RECURSIVE_LEVEL)
-  {
-    DEBUG((DEBUG_ERROR, "!!!ERROR: BAD XML.  Allowable recursive depth exceeded.\n"));
-    return EFI_BAD_BUFFER_SIZE;
-  }
+/**
+Append Length characters to the output.
+**/
+STATIC
+EFI_STATUS
+_WriterAppend(
+  IN OUT XML_WRITER  *Writer,
+  IN CONST CHAR8     *Data,
+  IN UINTN           Length
+)
+{
+  EFI_STATUS Status;
+  UINTN      Count;
 
-  /* handle the xml decl*/
-  if (Node->XmlDeclaration.Declaration != NULL)
+  while (Length > 0)
   {
-    if (Node->ParentNode != NULL)
+    if (Writer->Used == XML_WRITE_BUFFER_SIZE)
     {
-      DEBUG((DEBUG_ERROR, "!!!ERROR: BAD XML.  Should not have XmlDeclaration for a non-root node\n"));
+      Status = _WriterFlush(Writer);
+      if (EFI_ERROR(Status))
+      {
+        return Status;
+      }
     }
-    *Size = (*Size) + AsciiStrLen(Node->XmlDeclaration.Declaration);
+    Count = MIN(Length, XML_WRITE_BUFFER_SIZE - Writer->Used);
+    CopyMem(&Writer->Buffer[Writer->Used], Data, Count);
+    Writer->Used += Count;
+    Data += Count;
+    Length -= Count;
   }
+  return EFI_SUCCESS;
+}
 
-  /* Handle start tag*/
-  NameSize = AsciiStrLen(Node->Name);
-  *Size = (*Size) + NameSize + 1;  //'<'
-
-  //Loop attributes
-  for (Link = Node->AttributesListHead.ForwardLink; Link != &(Node->AttributesListHead); Link = Link->ForwardLink)
-  {
-    Att = (XmlAttribute*)Link;
-    *Size = (*Size) + AsciiStrLen(Att->Name) + 4; // '=', ' ','"','"'
-	if (Escaped)
-	{
-		*Size = (*Size) + _GetXmlEscapedLength(Att->Value, XML_MAX_ATTRIBUTE_VALUE_LENGTH);
-	}
-	else
-	{
-		*Size = (*Size) + AsciiStrLen(Att->Value);
-	}
-  }
-
-  //handle children and ending
-  if ((Node->Value == NULL) && (Node->NumChildren == 0))
-  {
-    //Special short cut on the node  - Use empty node notation  />
-    *Size = (*Size) + 3; // ' ', '/', '>'
-  }
-  else  //longer notation
-  {
-    *Size = (*Size) + 1; // '>'
-
-    //Show Value if value
-    if (Node->Value != NULL)
-    {
-	  if (Escaped)
-	  {
-		  *Size = (*Size) + _GetXmlEscapedLength(Node->Value, XML_MAX_ELEMENT_VALUE_LENGTH);
-	  }
-	  else
-	  {
-		  *Size = (*Size) + AsciiStrLen(Node->Value);
-	  }
-    }
-
-    // Process all children
-    if (Node->NumChildren > 0)
-    {
-      UINTN child = 0;  //use for debugging only
-      //loop children
-      for (Link = Node->ChildrenListHead.ForwardLink; Link != &(Node->ChildrenListHead); Link = Link->ForwardLink, child++)
-      {
-        Status = _CaclSizeRecursively((CONST XmlNode*)Link, Escaped, Size, Level+1);
-        if (EFI_ERROR(Status))
-        {
-          DEBUG((DEBUG_ERROR, "%a - Error Status from child index %d of element: %a\n", __FUNCTION__, child, Node->Name));
-          return Status;
-        }
-      }
-    } //end children loop
-
-    *Size = (*Size) + NameSize + 3; // '<', '/', '>/
-  } //end of node
-  return EFI_SUCCESS;
-}
+/**
+Append a NULL terminated string to the output.
+**/
+STATIC
+EFI_STATUS
+_WriterAppendString(
+  IN OUT XML_WRITER  *Writer,
+  IN CONST CHAR8     *String
+)
+{
+  return _WriterAppend(Writer, String, AsciiStrLen(String));
+}
 
 /**
-Function to calculate the size of the Ascii string needed
-to print this XmlNode and its children.  Generally assumed it will
-be the root node.
-
-This uses a shortened XML format and uses minimal whitespace.
-
-@param Node - The root node of the xml tree to start printing from
-@param Size - the number of Ascii characters in the string.  This does not include the NULL terminator
-
+Append a value to the output, escaping it if requested.  Values longer than
+MaxStringLength are rejected when escaping, as XmlEscape does.
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-CalculateXmlDocSize(
-  IN  CONST XmlNode* Node,
-  IN        BOOLEAN    Escaped,
-  OUT       UINTN*   Size)
+_WriterAppendValue(
+  IN OUT XML_WRITER  *Writer,
+  IN CONST CHAR8     *Value,
+  IN UINTN           MaxStringLength,
+  IN BOOLEAN         Escaped
+)
 {
+  EFI_STATUS  Status;
+  CONST CHAR8 *Run;
+  CONST CHAR8 *Escape = NULL;
 
-  if ((Node == NULL) || (Size == NULL))
+  if (!Escaped)
   {
-    return EFI_INVALID_PARAMETER;
+    return _WriterAppendString(Writer, Value);
   }
 
-  if (Node->ParentNode != NULL)
+  if (AsciiStrnLenS(Value, MaxStringLength + 1) > MaxStringLength)
   {
-    DEBUG((DEBUG_WARN, "%a - Called with node other than root node.  Siblings will not be traversed.\n", __FUNCTION__));
+    DEBUG((DEBUG_ERROR, "%a String is too big or not NULL terminated\n", __FUNCTION__));
+    return EFI_INVALID_PARAMETER;
   }
 
-  *Size = 0;
-
-  return _CaclSizeRecursively(Node, Escaped, Size, 0);
+  //
+  // Copy runs of characters that need no escaping as a whole
+  //
+  for (Run = Value; *Value != '\0'; Value++)
+  {
+    switch (*Value)
+    {
+      case '<':  Escape = "&lt;";   break;
+      case '>':  Escape = "&gt;";   break;
+      case '\"': Escape = "&quot;"; break;
+      case '\'': Escape = "&apos;"; break;
+      case '&':  Escape = "&amp;";  break;
+      default:   continue;
+    }
+    Status = _WriterAppend(Writer, Run, (UINTN)(Value - Run));
+    if (!EFI_ERROR(Status))
+    {
+      Status = _WriterAppendString(Writer, Escape);
+    }
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+    Run = Value + 1;
+  }
+  return _WriterAppend(Writer, Run, (UINTN)(Value - Run));
 }
 
 /**
-Internal function to convert an Xml Node and its children into an Ascii string
+Internal function to write an Xml Node and its children
 using shortened Xml Notation and no whitespace.
 
-Public function is XmlTreeToString
+Public function is XmlTreeWrite
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-_ToStringRecursively(
+_WriteRecursively(
+  IN OUT    XML_WRITER *Writer,
   IN  CONST XmlNode*   Node,
-  IN        UINTN      BufferSize,
-  IN OUT    CHAR8      *String,
   IN        UINTN      Level,
   IN        BOOLEAN    Escaped)
 {
@@ -645,11 +1025,6 @@ _ToStringRecursively(
   LIST_ENTRY *Link = NULL;
   EFI_STATUS Status = EFI_SUCCESS;
 
-  if ((Node == NULL) || (String == NULL))
-  {
-    return EFI_INVALID_PARAMETER;
-  }
-
   if (Level > MAX_RECURSIVE_LEVEL)
   {
     DEBUG((DEBUG_ERROR, "!!!ERROR: BAD XML.  Allowable recursive depth exceeded.\n"));
@@ -663,7 +1038,7 @@ _ToStringRecursively(
     {
       DEBUG((DEBUG_ERROR, "!!!ERROR: BAD XML.  Should not have XmlDeclaration for a non-root node\n"));
     }
-    Status = AsciiStrCatS(String, BufferSize, Node->XmlDeclaration.Declaration);
+    Status = _WriterAppendString(Writer, Node->XmlDeclaration.Declaration);
     if (EFI_ERROR(Status))
     {
       goto EXIT;
@@ -671,13 +1046,12 @@ _ToStringRecursively(
   }
 
   /* Handle start tag*/
-  Status = AsciiStrCatS(String, BufferSize, "<");
+  Status = _WriterAppend(Writer, "<", 1);
   if (EFI_ERROR(Status))
   {
     goto EXIT;
   }
-
-  Status = AsciiStrCatS(String, BufferSize, Node->Name);
+  Status = _WriterAppendString(Writer, Node->Name);
   if (EFI_ERROR(Status))
   {
     goto EXIT;
@@ -687,42 +1061,27 @@ _ToStringRecursively(
   for (Link = Node->AttributesListHead.ForwardLink; Link != &(Node->AttributesListHead); Link = Link->ForwardLink)
   {
     Att = (XmlAttribute*)Link;
-    Status = AsciiStrCatS(String, BufferSize, " ");
+    Status = _WriterAppend(Writer, " ", 1);
     if (EFI_ERROR(Status))
     {
       goto EXIT;
     }
-    Status = AsciiStrCatS(String, BufferSize, Att->Name);
+    Status = _WriterAppendString(Writer, Att->Name);
     if (EFI_ERROR(Status))
     {
       goto EXIT;
     }
-
-    Status = AsciiStrCatS(String, BufferSize, "=\"");
+    Status = _WriterAppend(Writer, "=\"", 2);
     if (EFI_ERROR(Status))
     {
       goto EXIT;
     }
-	if (Escaped)
-	{
-		CHAR8 *EscapedString = NULL;
-		Status = XmlEscape(Att->Value, XML_MAX_ATTRIBUTE_VALUE_LENGTH, &EscapedString);
-		if (EFI_ERROR(Status))
-		{
-			goto EXIT;
-		}
-		Status = AsciiStrCatS(String, BufferSize, EscapedString);
-		SafeFreeBuffer(&EscapedString);
-	}
-	else
-	{
-		Status = AsciiStrCatS(String, BufferSize, Att->Value);
-	}
+    Status = _WriterAppendValue(Writer, Att->Value, XML_MAX_ATTRIBUTE_VALUE_LENGTH, Escaped);
     if (EFI_ERROR(Status))
     {
       goto EXIT;
     }
-    Status = AsciiStrCatS(String, BufferSize, "\"");
+    Status = _WriterAppend(Writer, "\"", 1);
     if (EFI_ERROR(Status))
     {
       goto EXIT;
@@ -733,79 +1092,189 @@ _ToStringRecursively(
   if ((Node->Value == NULL) && (Node->NumChildren == 0))
   {
     //Special short cut on the node  - Use empty node notation  />
-    Status = AsciiStrCatS(String, BufferSize, " />");
-    if (EFI_ERROR(Status))
-    {
-      goto EXIT;
-    }
+    Status = _WriterAppend(Writer, " />", 3);
+    goto EXIT;
   }
-  else  //longer notation
+
+  Status = _WriterAppend(Writer, ">", 1);
+  if (EFI_ERROR(Status))
   {
-    Status = AsciiStrCatS(String, BufferSize, ">");
+    goto EXIT;
+  }
+
+  //Show Value if value
+  if (Node->Value != NULL)
+  {
+    Status = _WriterAppendValue(Writer, Node->Value, XML_MAX_ELEMENT_VALUE_LENGTH, Escaped);
     if (EFI_ERROR(Status))
     {
       goto EXIT;
     }
+  }
 
-    //Show Value if value
-    if (Node->Value != NULL)
+  // Process all children
+  if (Node->NumChildren > 0)
+  {
+    UINTN child = 0;  //use for debugging only
+    //loop children
+    for (Link = Node->ChildrenListHead.ForwardLink; Link != &(Node->ChildrenListHead); Link = Link->ForwardLink, child++)
     {
-		if (Escaped)
-		{
-			CHAR8 *EscapedString = NULL;
-			Status = XmlEscape(Node->Value, XML_MAX_ELEMENT_VALUE_LENGTH, &EscapedString);
-			if (EFI_ERROR(Status))
-			{
-				goto EXIT;
-			}
-			Status = AsciiStrCatS(String, BufferSize, EscapedString);
-			SafeFreeBuffer(&EscapedString);
-		}
-		else
-		{
-			Status = AsciiStrCatS(String, BufferSize, Node->Value);
-		}
+      Status = _WriteRecursively(Writer, (CONST XmlNode*)Link, Level + 1, Escaped);
       if (EFI_ERROR(Status))
       {
+        DEBUG((DEBUG_ERROR, "%a - Error Status from child index %d of element: %a\n", __FUNCTION__, child, Node->Name));
         goto EXIT;
       }
     }
+  } //end children loop
 
-    // Process all children
-    if (Node->NumChildren > 0)
-    {
-      UINTN child = 0;  //use for debugging only
-      //loop children
-      for (Link = Node->ChildrenListHead.ForwardLink; Link != &(Node->ChildrenListHead); Link = Link->ForwardLink, child++)
-      {
-        Status = _ToStringRecursively((CONST XmlNode*)Link, BufferSize, String, Level+1, Escaped);
-        if (EFI_ERROR(Status))
-        {
-          DEBUG((DEBUG_ERROR, "%a - Error Status from child index %d of element: %a\n", __FUNCTION__, child, Node->Name));
-          goto EXIT;
-        }
-      }
-    } //end children loop
+  Status = _WriterAppend(Writer, "</", 2);
+  if (EFI_ERROR(Status))
+  {
+    goto EXIT;
+  }
+  Status = _WriterAppendString(Writer, Node->Name);
+  if (EFI_ERROR(Status))
+  {
+    goto EXIT;
+  }
+  Status = _WriterAppend(Writer, ">", 1);
 
-    Status = AsciiStrCatS(String, BufferSize, "</");
-    if (EFI_ERROR(Status))
-    {
-      goto EXIT;
-    }
-    Status = AsciiStrCatS(String, BufferSize, Node->Name);
-    if (EFI_ERROR(Status))
-    {
-      goto EXIT;
-    }
-    Status = AsciiStrCatS(String, BufferSize, ">");
-    if (EFI_ERROR(Status))
+EXIT:
+  return Status;
+}
+
+/**
+Public function to write an xml tree through a callback.
+This will use shortened XML notation and no whitespace.
+
+The document is produced in a single pass and handed to Write in chunks,
+so it never has to be held in memory as a whole.
+
+@param[in]  Node    - Root node or first node to start printing.
+@param[in]  Escaped - Should the Xml be escaped.  Generally this should be true
+@param[in]  Write   - Function receiving the document, chunk by chunk
+@param[in]  Context - Passed to Write
+
+@return EFI_SUCCESS, or the error of the tree or of Write
+**/
+EFI_STATUS
+EFIAPI
+XmlTreeWrite(
+  IN  CONST XmlNode                  *Node,
+  IN        BOOLEAN                  Escaped,
+  IN        XML_TREE_WRITE_CALLBACK  Write,
+  IN        VOID                     *Context
+  )
+{
+  EFI_STATUS  Status;
+  XML_WRITER  *Writer;
+
+  if ((Node == NULL) || (Write == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Node->ParentNode != NULL)
+  {
+    DEBUG((DEBUG_WARN, "%a - Called with node other than root node.  Siblings will not be traversed.\n", __FUNCTION__));
+  }
+
+  Writer = AllocatePool(sizeof(XML_WRITER));
+  if (Writer == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Writer->Write = Write;
+  Writer->Context = Context;
+  Writer->Used = 0;
+
+  Status = _WriteRecursively(Writer, Node, 0, Escaped);
+  if (!EFI_ERROR(Status))
+  {
+    Status = _WriterFlush(Writer);
+  }
+
+  FreePool(Writer);
+  return Status;
+}
+
+/**
+XML_TREE_WRITE_CALLBACK counting the characters of the document.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+_CountCallback(
+  IN       VOID    *Context,
+  IN CONST CHAR8   *Data,
+  IN       UINTN   Length
+)
+{
+  *(UINTN*)Context += Length;
+  return EFI_SUCCESS;
+}
+
+/**
+XML_TREE_WRITE_CALLBACK appending the document to an XML_STRING_BUFFER.
+The buffer doubles when full, so appending stays linear overall.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+_StringBufferCallback(
+  IN       VOID    *Context,
+  IN CONST CHAR8   *Data,
+  IN       UINTN   Length
+)
+{
+  XML_STRING_BUFFER *StringBuffer = (XML_STRING_BUFFER*)Context;
+  UINTN             NewCapacity;
+  CHAR8             *NewString;
+
+  if (StringBuffer->Length + Length + 1 > StringBuffer->Capacity)
+  {
+    NewCapacity = MAX(StringBuffer->Capacity * 2, StringBuffer->Length + Length + 1);
+    NewString = ReallocatePool(StringBuffer->Capacity, NewCapacity, StringBuffer->String);
+    if (NewString == NULL)
     {
-      goto EXIT;
+      return EFI_OUT_OF_RESOURCES;
     }
-  } //end of node
+    StringBuffer->String = NewString;
+    StringBuffer->Capacity = NewCapacity;
+  }
+  CopyMem(&StringBuffer->String[StringBuffer->Length], Data, Length);
+  StringBuffer->Length += Length;
+  return EFI_SUCCESS;
+}
 
-EXIT:
-  return Status;
+/**
+Function to calculate the size of the Ascii string needed
+to print this XmlNode and its children.  Generally assumed it will
+be the root node.
+
+This uses a shortened XML format and uses minimal whitespace.
+
+@param Node - The root node of the xml tree to start printing from
+@param Size - the number of Ascii characters in the string.  This does not include the NULL terminator
+
+**/
+EFI_STATUS
+EFIAPI
+CalculateXmlDocSize(
+  IN  CONST XmlNode* Node,
+  IN        BOOLEAN    Escaped,
+  OUT       UINTN*   Size)
+{
+
+  if ((Node == NULL) || (Size == NULL))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Size = 0;
+
+  return XmlTreeWrite(Node, Escaped, _CountCallback, Size);
 }
 
 /**
@@ -826,88 +1295,67 @@ XmlTreeToString(
   OUT       CHAR8      **String
   )
 {
-  EFI_STATUS Status;
-  UINTN Size = 0;
-  CHAR8* XmlString = NULL;
+  EFI_STATUS        Status;
+  XML_STRING_BUFFER StringBuffer;
+
   if ((Node == NULL) || (BufferSize == NULL) || (String == NULL))
   {
     return EFI_INVALID_PARAMETER;
   }
 
-  if (Node->ParentNode != NULL)
-  {
-    DEBUG((DEBUG_WARN, "%a - Called with node other than root node.  Siblings will not be traversed.\n", __FUNCTION__));
-  }
-
-  Status = CalculateXmlDocSize(Node, Escaped, &Size);
-  if (EFI_ERROR(Status))
-  {
-    DEBUG((DEBUG_ERROR, "%a - Error in CalculateXmlDocSize %r\n", __FUNCTION__, Status));
-    return Status;
-  }
-  Size++;  //for the NULL char
-  DEBUG((DEBUG_INFO, "%a - Pre Calculated Size of string is 0x%X\n", __FUNCTION__, Size));
-
-  XmlString = (CHAR8*)AllocatePool(Size);
-  if (XmlString == NULL)
+  StringBuffer.Length = 0;
+  StringBuffer.Capacity = XML_WRITE_BUFFER_SIZE;
+  StringBuffer.String = AllocatePool(StringBuffer.Capacity);
+  if (StringBuffer.String == NULL)
   {
     DEBUG((DEBUG_ERROR, "Failed to allocate string for XML"));
     return EFI_OUT_OF_RESOURCES;
   }
-  *XmlString = '\0';  //set to null for ascii str cat
-  Status = _ToStringRecursively(Node, Size, XmlString, 0, Escaped);
+
+  Status = XmlTreeWrite(Node, Escaped, _StringBufferCallback, &StringBuffer);
   if (EFI_ERROR(Status))
   {
-    DEBUG((DEBUG_ERROR, "%a - Failed to convert xml node tree into string. %r\n", Status));
+    DEBUG((DEBUG_ERROR, "%a - Failed to convert xml node tree into string. %r\n", __FUNCTION__, Status));
+    FreePool(StringBuffer.String);
     return Status;
   }
 
-  DEBUG((DEBUG_INFO, "%a - Pre Calculated Length of string is 0x%X. AsciiStrLen is 0x%X\n", __FUNCTION__, (Size - 1), AsciiStrLen(XmlString)));
+  // _StringBufferCallback always leaves room for the NULL char
+  StringBuffer.String[StringBuffer.Length] = '\0';
 
-  *String = XmlString;
-  *BufferSize = Size;
+  *String = StringBuffer.String;
+  *BufferSize = StringBuffer.Length + 1;
   return EFI_SUCCESS;
 }
 
 
 /**
-Engine parsing code which will build a XmlNode for the XmlTree
+Public function to parse an XML document in one pass, without building a tree.
 
-*Internal Function
-
-@param[in] XmlDocument      -- XML document.
-@param[in] XmlDocumentSize  -- Size of the XML document.
-@param[in out] Root         -- Pointer to recieve the node list.
-
-Return Value:
-
-EFI_SUCCESS or underlying failure code.
+*See XmlTreeLib.h
 
 **/
 EFI_STATUS
 EFIAPI
-BuildNodeList(
-  IN CONST CHAR8*      XmlDocument,
-  IN       UINTN       XmlDocumentSize,
-  IN OUT   XmlNode**   Root
+XmlParse(
+  IN CONST CHAR8*                XmlDocument,
+  IN       UINTN                 XmlDocumentSize,
+  IN CONST XML_PARSE_CALLBACKS*  Callbacks,
+  IN       VOID*                 Context
 )
 {
   EFI_STATUS             Status = EFI_INVALID_PARAMETER;
   UINTN                  EncodingLength = 0;
-  XmlNode*               CurrentNode = NULL;
-  CHAR8*                 XmlDeclaration = NULL;
   CHAR8*                 StartDoc = NULL;
   UINT64                 ProcessedCharacters = 0;
   BOOLEAN                ProcessedNode = FALSE;
+  XML_SLICE              Run;
+  XML_SLICE              ElementName;
+  XML_SLICE              AttributeName;
 
   XML_TOKENIZATION_STATE State;
   XML_TOKENIZATION_INIT  Init;
   XML_LINE_AND_COLUMN    Location;
-  CHAR8                  Element[MAX_PATH];
-  CHAR8                  HyperSpace[MAX_PATH];
-  CHAR8                  EndElement[MAX_PATH];
-  CHAR8                  AttributeName[MAX_PATH];
-  CHAR8                  AttributeValue[MAX_PATH];
 
   //
   // Zero everthing out to start.
@@ -915,11 +1363,14 @@ BuildNodeList(
   ZeroMem(&State, sizeof(State));
   ZeroMem(&Init, sizeof(Init));
   ZeroMem(&Location, sizeof(Location));
-  ZeroMem(Element, ARRAYSIZE(Element));
-  ZeroMem(HyperSpace, ARRAYSIZE(HyperSpace));
-  ZeroMem(EndElement, ARRAYSIZE(EndElement));
-  ZeroMem(AttributeName, ARRAYSIZE(AttributeName));
-  ZeroMem(AttributeValue, ARRAYSIZE(AttributeValue));
+  ZeroMem(&ElementName, sizeof(ElementName));
+  ZeroMem(&AttributeName, sizeof(AttributeName));
+
+  if (XmlDocument == NULL || XmlDocumentSize == 0 || Callbacks == NULL)
+  {
+    Status = EFI_INVALID_PARAMETER;
+    goto Exit;
+  }
 
   //
   // Initialize the XML engine.
@@ -929,13 +1380,6 @@ BuildNodeList(
   Init.XmlDataSize = (UINT32)XmlDocumentSize;
   Init.SupportPosition = TRUE;
 
-  if (XmlDocument == NULL || XmlDocumentSize == 0 || Root == NULL)
-  {
-    Status = EFI_INVALID_PARAMETER;
-    goto Exit;
-  }
-  *Root = NULL;
-
   //
   // Start by initializing the tokenizer with our data.  Note that we don't
   // pass along the optional "special string" and normal comparison functions,
@@ -986,6 +1430,7 @@ BuildNodeList(
       // fError member
       //
       DEBUG((EFI_D_ERROR, "Error during tokenization, Status = 0x%x\n", Next.fError));
+      Status = EFI_INVALID_PARAMETER;
       goto Exit;
     }
 
@@ -1017,240 +1462,93 @@ BuildNodeList(
     Status = RtlXmlGetCurrentLocation(&State, &Location);
     if (EFI_ERROR(Status))
     {
-      DEBUG((EFI_D_ERROR, "Failed to get location information.\n"));
-    }
-
-    if (Next.Run.pvData == NULL)
-    {
-      DEBUG((EFI_D_ERROR, "ERROR:  Next.Run.pvData == NULL\n"));
-      Status = EFI_INVALID_PARAMETER;
-      goto Exit;
-    }
-    //
-    // Pick off the XML declaration if there is one.
-    //
-    if (Next.State == XTSS_XMLDECL_CLOSE)
-    {
-      const UINTN EndlineSize = 2;
-      XmlDeclaration = AllocateZeroPool(State.Location.Column + EndlineSize);
-      if (XmlDeclaration == NULL)
-      {
-        Status = EFI_OUT_OF_RESOURCES;
-        goto Exit;
-      }
-
-      Status = AsciiStrnCpyS(XmlDeclaration, State.Location.Column + EndlineSize, StartDoc, State.Location.Column + 1);
-      if (EFI_ERROR(Status))
-      {
-        goto Exit;
-      }
-    }
-    else if (Next.State == XTSS_ELEMENT_NAME)
-    {
-      //
-      // We found an element name, so create a new node for it.
-      //
-      Status = AsciiStrnCpyS(Element,  ARRAYSIZE(Element), (CHAR8*)Next.Run.pvData,  (UINTN)Next.Run.ulCharacters);
-      if (EFI_ERROR(Status))
-      {
-        DEBUG((EFI_D_ERROR, "ERROR, AsciiStrnCpyS() failed\n"));
-        goto Exit;
-      }
-      DEBUG((DEBUG_VERBOSE, "New, adding node: '%a'\n", Element));
-
-      if (*Root == NULL)
-      {
-        //
-        // This is the root node.
-        //
-        Status = AddNode(NULL, Element, NULL, Root);
-        if (EFI_ERROR(Status))
-        {
-          goto Exit;
-        }
-
-        //
-        // Add the declaration if we had one.
-        //
-        (*Root)->XmlDeclaration.Declaration = XmlDeclaration;
-
-        CurrentNode = *Root;
-      }
-      else
-      {
-        Status = AddNode(CurrentNode, Element, NULL, &CurrentNode);
-        if (EFI_ERROR(Status))
-        {
-          goto Exit;
-        }
-      }
-
-      //
-      // Mark that we have successfully added a new node, so we can check
-      // for valid XML when the end of the document is reached.
-      //
-      ProcessedNode = TRUE;
-    }
-    else if (Next.State == XTSS_STREAM_HYPERSPACE)
-    {
-      BOOLEAN NotWhiteSpace = FALSE;
-// MS_CHANGE  [begin]
-      CHAR8   *LocalHyperSpace;
-      UINTN   LocalSize;
-      UINTN    TempSize;
-      LocalHyperSpace = (CHAR8 *)Next.Run.pvData;
-
-      LocalSize =  (UINTN)Next.Run.ulCharacters;
-      TempSize = LocalSize;
-      if (TempSize >= MAX_PATH)
-      {
-        TempSize = MAX_PATH - 1 ;
-      }
-
-      Status = AsciiStrnCpyS(HyperSpace, ARRAYSIZE(HyperSpace), (CHAR8*)Next.Run.pvData, TempSize);
-// MS_CHANGE [end]
-      if (EFI_ERROR(Status))
-      {
-        goto Exit;
-      }
-
-      //
-      // See if we have a value.
-      //
-      for (UINT32 i = 0; i < Next.Run.ulCharacters; i++)
-      {
-        if (!IsWhiteSpace(LocalHyperSpace[i]))                    // MS_CHANGE
-        {
-          NotWhiteSpace = TRUE;
-          break;
-        } else {                                                  // MS_CHANGE
-          LocalSize--;           // Trim leading whitespace       // MS_CHANGE
-          LocalHyperSpace++;                                      // MS_CHANGE
-        }
-      }
+      DEBUG((EFI_D_ERROR, "Failed to get location information.\n"));
+    }
 
-      if (NotWhiteSpace)
-      {                                                           // MS_CHANGE
-        for (UINTN i = LocalSize-1; i > 0; i--)                   // MS_CHANGE
-        {                                                         // MS_CHANGE
-          if (!IsWhiteSpace(LocalHyperSpace[i]))                  // MS_CHANGE
-          {                                                       // MS_CHANGE
-            break;                                                // MS_CHANGE
-          } else {                                                // MS_CHANGE
-            LocalSize--;       // Trim trailing whitespace        // MS_CHANGE
-          }                                                       // MS_CHANGE
-        }                                                         // MS_CHANGE
-        //
-        // Allocate memory for the value.  This will be cleaned up when the
-        // node is deleted when FreeXmlTree() is called.
-        //
-        CHAR8* Value = AllocateZeroPool(LocalSize + 1);           // MS_CHANGE
-        if (Value == NULL)
-        {
-          Status = EFI_OUT_OF_RESOURCES;
-          goto Exit;
-        }
+    if (Next.Run.pvData == NULL)
+    {
+      DEBUG((EFI_D_ERROR, "ERROR:  Next.Run.pvData == NULL\n"));
+      Status = EFI_INVALID_PARAMETER;
+      goto Exit;
+    }
 
-        DEBUG((DEBUG_VERBOSE, "Found value %a\n", HyperSpace));
-        Status = AsciiStrnCpyS(Value, LocalSize + 1, LocalHyperSpace, LocalSize); // MS_CHANGE
-        if (EFI_ERROR(Status))
-        {
-          goto Exit;
-        }
+    //
+    // The run of this token, straight from the document.
+    //
+    Run.Data = (CONST CHAR8*)Next.Run.pvData;
+    Run.Length = (UINTN)Next.Run.ulCharacters;
+    Status = EFI_SUCCESS;
 
-        if (CurrentNode)
-        {
-          CurrentNode->Value = Value;
-        }
-      }
-    }
-    else if (Next.State == XTSS_ELEMENT_ATTRIBUTE_NAME)
+    if (Next.State == XTSS_XMLDECL_CLOSE)
     {
       //
-      // We found an attribute name, so buffer it so that it is available
-      // once we get the attribute value.
+      // The XML declaration, from the top of the document
       //
-      Status = AsciiStrnCpyS(AttributeName, ARRAYSIZE(AttributeName), (CHAR8*)Next.Run.pvData, (UINTN)Next.Run.ulCharacters);
-      if (EFI_ERROR(Status))
+      if (Callbacks->Declaration != NULL)
       {
-        goto Exit;
+        Run.Data = StartDoc;
+        Run.Length = State.Location.Column + 1;
+        Status = Callbacks->Declaration(Context, &Run);
       }
-      DEBUG((DEBUG_VERBOSE, "Found attribute name: '%a'\n", AttributeName));
-
     }
-    else if (Next.State == XTSS_ELEMENT_ATTRIBUTE_VALUE)
+    else if (Next.State == XTSS_ELEMENT_NAME)
     {
-      //
-      // We received the attribute value, so we can now add the name 
-      // and value to the current node.
-      //
-      Status = AsciiStrnCpyS(AttributeValue, ARRAYSIZE(AttributeValue), (CHAR8*)Next.Run.pvData, (UINTN)Next.Run.ulCharacters);
-      if (EFI_ERROR(Status))
-      {
-        goto Exit;
-      }
-      DEBUG((DEBUG_VERBOSE, "Found attribute Value: '%a'\n", AttributeValue));
-
-      //
-      // Now add the attribute to the current node...
-      //
-      Status = AddAttributeToNode(CurrentNode, AttributeName, AttributeValue);
-      if (EFI_ERROR(Status))
+      DEBUG((DEBUG_VERBOSE, "New element\n"));
+      ElementName = Run;
+      ProcessedNode = TRUE;
+      if (Callbacks->StartElement != NULL)
       {
-        DEBUG((EFI_D_ERROR, "ERROR:  AddAttributeToNode() failed, Status = 0x%x\n", Status));
-        goto Exit;
+        Status = Callbacks->StartElement(Context, &Run);
       }
     }
-    else if (Next.State == XTSS_ENDELEMENT_NAME)
+    else if (Next.State == XTSS_STREAM_HYPERSPACE)
     {
-      Status = AsciiStrnCpyS(EndElement, ARRAYSIZE(EndElement), (CHAR8*)Next.Run.pvData, (UINTN)Next.Run.ulCharacters);
-      if (EFI_ERROR(Status))
+      if (Callbacks->Text != NULL)
       {
-        goto Exit;
+        Status = Callbacks->Text(Context, &Run);
       }
-
-      DEBUG((DEBUG_VERBOSE, "XTSS_ENDELEMENT_NAME, %a\n", EndElement));
-
+    }
+    else if (Next.State == XTSS_ELEMENT_ATTRIBUTE_NAME)
+    {
       //
-      // If szEndElement is not equal to pCurrentNode->pszName,
-      // we were given invalid XML, so we should fail.
+      // Keep the name until the value comes.
       //
-      if (CurrentNode)
+      AttributeName = Run;
+    }
+    else if (Next.State == XTSS_ELEMENT_ATTRIBUTE_VALUE)
+    {
+      if (Callbacks->Attribute != NULL)
       {
-        if (AsciiStrCmp(EndElement, CurrentNode->Name) != 0)
-        {
-          DEBUG((EFI_D_ERROR, "ERROR:  Ending element does not match current node CurrentElement: '%a', CurrentNode: '%a'\n",
-            EndElement, CurrentNode->Name));
-          Status = EFI_INVALID_PARAMETER;
-          goto Exit;
-        }
+        Status = Callbacks->Attribute(Context, &AttributeName, &Run);
       }
-
-
-      //
-      // We have reached the end of an element, so move the current
-      // node up to the parent.
-      //
-      if (CurrentNode)
+    }
+    else if (Next.State == XTSS_ENDELEMENT_NAME)
+    {
+      DEBUG((DEBUG_VERBOSE, "XTSS_ENDELEMENT_NAME\n"));
+      if (Callbacks->EndElement != NULL)
       {
-        CurrentNode = CurrentNode->ParentNode;
+        Status = Callbacks->EndElement(Context, &Run);
       }
-
     }
     else if (Next.State == XTSS_ELEMENT_CLOSE_EMPTY)
     {
       DEBUG((DEBUG_VERBOSE,"XTSS_ELEMENT_CLOSE_EMPTY, empty close\n"));
 
       //
-      // We have reached the end of an element, so move the current
-      // node up to the parent.
+      // An empty element closes right after its own name and attributes.
       //
-      if (CurrentNode)
+      if (Callbacks->EndElement != NULL)
       {
-        CurrentNode = CurrentNode->ParentNode;
+        Status = Callbacks->EndElement(Context, &ElementName);
       }
     }
 
+    if (EFI_ERROR(Status))
+    {
+      DEBUG((DEBUG_VERBOSE, "Parse stopped by the callback.  Status = %r\n", Status));
+      goto Exit;
+    }
+
     //
     // Advance to the next token within the document...
     //
@@ -1273,17 +1571,288 @@ BuildNodeList(
   } while (TRUE);
 
 Exit:
+  return Status;
+}//XmlParse()
+
+
+//
+// State of BuildNodeList while XmlParse walks the document
+//
+typedef struct
+{
+  XmlArena*  Arena;
+  XmlNode*   Root;
+  XmlNode*   CurrentNode;
+  CHAR8*     Declaration;
+  CHAR8      AttributeValue[XML_MAX_ATTRIBUTE_VALUE_LENGTH + 1];
+} XML_TREE_BUILDER;
+
+STATIC
+EFI_STATUS
+EFIAPI
+_BuildDeclaration(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Declaration
+)
+{
+  XML_TREE_BUILDER* Builder = (XML_TREE_BUILDER*)Context;
+
+  Builder->Declaration = _ArenaAllocate(Builder->Arena, Declaration->Length + 1);
+  if (Builder->Declaration == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem(Builder->Declaration, Declaration->Data, Declaration->Length);
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+_BuildStartElement(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Name
+)
+{
+  XML_TREE_BUILDER* Builder = (XML_TREE_BUILDER*)Context;
+  EFI_STATUS        Status;
+  CHAR8*            NodeName;
+
+  NodeName = _ArenaInternName(Builder->Arena, Name->Data, Name->Length);
+  if (NodeName == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  DEBUG((DEBUG_VERBOSE, "New, adding node: '%a'\n", NodeName));
+
+  if (Builder->Root == NULL)
+  {
+    //
+    // This is the root node, it owns the arena.
+    //
+    Status = _AddNode(Builder->Arena, NULL, NodeName, NULL, &Builder->Root);
+    if (EFI_ERROR(Status))
+    {
+      return Status;
+    }
+    Builder->Arena->Owner = Builder->Root;
+
+    //
+    // Add the declaration if we had one.
+    //
+    Builder->Root->XmlDeclaration.Declaration = Builder->Declaration;
+    Builder->CurrentNode = Builder->Root;
+    return EFI_SUCCESS;
+  }
+
+  if (Builder->CurrentNode == NULL)
+  {
+    DEBUG((EFI_D_ERROR, "ERROR:  Element '%a' after the end of the root node\n", NodeName));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return _AddNode(Builder->Arena, Builder->CurrentNode, NodeName, NULL, &Builder->CurrentNode);
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+_BuildAttribute(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Name,
+  IN CONST XML_SLICE*  Value
+)
+{
+  XML_TREE_BUILDER* Builder = (XML_TREE_BUILDER*)Context;
+  EFI_STATUS        Status;
+  CHAR8*            AttributeName;
+
+  AttributeName = _ArenaInternName(Builder->Arena, Name->Data, Name->Length);
+  if (AttributeName == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // AddAttributeToNode unescapes the value, it needs it NULL terminated
+  //
+  if (Value->Length > XML_MAX_ATTRIBUTE_VALUE_LENGTH)
+  {
+    DEBUG((EFI_D_ERROR, "ERROR:  Value of attribute '%a' is too long\n", AttributeName));
+    return EFI_INVALID_PARAMETER;
+  }
+  CopyMem(Builder->AttributeValue, Value->Data, Value->Length);
+  Builder->AttributeValue[Value->Length] = '\0';
+  DEBUG((DEBUG_VERBOSE, "Found attribute '%a' Value: '%a'\n", AttributeName, Builder->AttributeValue));
+
+  //
+  // Now add the attribute to the current node...
+  //
+  Status = AddAttributeToNode(Builder->CurrentNode, AttributeName, Builder->AttributeValue);
   if (EFI_ERROR(Status))
+  {
+    DEBUG((EFI_D_ERROR, "ERROR:  AddAttributeToNode() failed, Status = 0x%x\n", Status));
+  }
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+_BuildText(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Text
+)
+{
+  XML_TREE_BUILDER* Builder = (XML_TREE_BUILDER*)Context;
+  CONST CHAR8*      Start;
+  UINTN             Length;
+  CHAR8*            Value;
+
+  //
+  // Trim leading and trailing whitespace, a value of whitespace only is no value
+  //
+  Start = Text->Data;
+  Length = Text->Length;
+  while (Length > 0 && IsWhiteSpace(*Start))
+  {
+    Start++;
+    Length--;
+  }
+  while (Length > 0 && IsWhiteSpace(Start[Length - 1]))
+  {
+    Length--;
+  }
+
+  if (Length == 0 || Builder->CurrentNode == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // The value is cleaned up with the arena when FreeXmlTree() is called.
+  //
+  Value = _ArenaAllocate(Builder->Arena, Length + 1);
+  if (Value == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem(Value, Start, Length);
+  Builder->CurrentNode->Value = Value;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+_BuildEndElement(
+  IN       VOID*       Context,
+  IN CONST XML_SLICE*  Name
+)
+{
+  XML_TREE_BUILDER* Builder = (XML_TREE_BUILDER*)Context;
+  XmlNode*          CurrentNode = Builder->CurrentNode;
+
+  if (CurrentNode == NULL)
+  {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // If the end element is not the name of the current node,
+  // we were given invalid XML, so we should fail.
+  //
+  if (AsciiStrnLenS(CurrentNode->Name, Name->Length + 1) != Name->Length ||
+      CompareMem(CurrentNode->Name, Name->Data, Name->Length) != 0)
+  {
+    DEBUG((EFI_D_ERROR, "ERROR:  Ending element does not match current node CurrentNode: '%a'\n", CurrentNode->Name));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // We have reached the end of an element, so move the current
+  // node up to the parent.
+  //
+  Builder->CurrentNode = CurrentNode->ParentNode;
+  return EFI_SUCCESS;
+}
+
+STATIC CONST XML_PARSE_CALLBACKS mTreeBuilderCallbacks = {
+  _BuildDeclaration,
+  _BuildStartElement,
+  _BuildAttribute,
+  _BuildText,
+  _BuildEndElement
+};
+
+/**
+Engine parsing code which will build a XmlNode for the XmlTree
+
+*Internal Function
+
+@param[in] XmlDocument      -- XML document.
+@param[in] XmlDocumentSize  -- Size of the XML document.
+@param[in out] Root         -- Pointer to recieve the node list.
+
+Return Value:
+
+EFI_SUCCESS or underlying failure code.
+
+**/
+EFI_STATUS
+EFIAPI
+BuildNodeList(
+  IN CONST CHAR8*      XmlDocument,
+  IN       UINTN       XmlDocumentSize,
+  IN OUT   XmlNode**   Root
+)
+{
+  EFI_STATUS         Status;
+  XML_TREE_BUILDER*  Builder;
+
+  if (XmlDocument == NULL || XmlDocumentSize == 0 || Root == NULL)
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+  *Root = NULL;
+
+  //
+  // The whole document goes into one arena, owned by the root node.
+  //
+  Builder = AllocateZeroPool(sizeof(XML_TREE_BUILDER));
+  if (Builder == NULL)
+  {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Builder->Arena = _ArenaCreate();
+  if (Builder->Arena == NULL)
+  {
+    FreePool(Builder);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = XmlParse(XmlDocument, XmlDocumentSize, &mTreeBuilderCallbacks, Builder);
+
+  if (!EFI_ERROR(Status) && Builder->Root != NULL)
+  {
+    *Root = Builder->Root;
+  }
+  else if (Builder->Root != NULL)
   {
     //In error state clean up after ourselves
     // the api makes it clear if parsing fails
     // no xml tree is to be returned
-    if (*Root != NULL)
-    {
-      FreeXmlTree(Root);
-    }
+    FreeXmlTree(&Builder->Root);
+  }
+  else
+  {
+    //
+    // Without root node nobody owns the arena
+    //
+    _ArenaFree(Builder->Arena);
   }
 
+  FreePool(Builder);
   return Status;
 }//BuildNodeList()
 
@@ -1341,6 +1910,9 @@ FreeXmlTree(
 )
 {
   EFI_STATUS  Status = EFI_SUCCESS;
+  XmlArena*   Arena = NULL;
+  BOOLEAN     OwnsArena = FALSE;
+
   if (RootNode == NULL)
   {
     return EFI_INVALID_PARAMETER;
@@ -1351,8 +1923,26 @@ FreeXmlTree(
     return EFI_INVALID_PARAMETER;
   }
 
-  Status = DeleteNode(*RootNode);
-  SafeFreeBuffer((CHAR8**)RootNode);
+  Arena = (*RootNode)->Arena;
+  OwnsArena = (BOOLEAN)(Arena != NULL && Arena->Owner == *RootNode);
+
+  //
+  // Nothing to walk when the whole tree lives in its own arena
+  //
+  if (!OwnsArena || Arena->ForeignTrees != 0)
+  {
+    Status = DeleteNode(*RootNode);
+  }
+
+  if (OwnsArena)
+  {
+    _ArenaFree(Arena);
+    *RootNode = NULL;
+  }
+  else
+  {
+    _TreeFree(Arena, (CHAR8**)RootNode);
+  }
 
   return Status;
 }// FreeXmlTree()
@@ -1723,11 +2313,6 @@ XmlUnEscape(
 {
   UINTN Length = 0;
   CHAR8* RawString = NULL;  //local copy of the raw string
-  UINTN i, j;
-
-  i = 0;
-  j = 0;
-
 
   if (String == NULL)
   {
@@ -1747,6 +2332,33 @@ XmlUnEscape(
     return EFI_OUT_OF_RESOURCES;
   }
 
+  if (EFI_ERROR(_XmlUnEscapeToBuffer(EscapedString, Length, RawString)))
+  {
+    FreePool(RawString);
+    return EFI_DEVICE_ERROR;
+  }
+
+  *String = RawString;
+  return EFI_SUCCESS;
+}
+
+/**
+Unescape EscapedString into RawString, which has room for Length characters
+and the NULL terminator.  Length comes from _GetXmlUnEscapedLength.
+**/
+STATIC
+EFI_STATUS
+_XmlUnEscapeToBuffer(
+  IN CONST CHAR8* EscapedString,
+  IN UINTN        Length,
+  OUT CHAR8*      RawString
+)
+{
+  UINTN i, j;
+
+  i = 0;
+  j = 0;
+
   //Now traverse the String and Unescape chars
   while ((EscapedString[i] != '\0') && (j < Length))
   {
@@ -1804,14 +2416,12 @@ XmlUnEscape(
       ASSERT(EscapedString[i] == '\0');
     }
 
-    FreePool(RawString);
     return EFI_DEVICE_ERROR;
   }
 
 
   RawString[j] = '\0';  //null terminate
 
-  *String = RawString;
   return EFI_SUCCESS;
 }
 